@@ -0,0 +1,275 @@
+/*******************************************************************************
+ * Class: AsyncLogWriter
+ * Filename: async_log_writer.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Every slot in the ring carries a sequence number.  A slot at position pos
+ * is free for a producer when its sequence equals pos, and holds a record
+ * ready for the consumer when its sequence is pos + 1.  After the consumer
+ * has written a record it sets the sequence to pos + capacity, handing the
+ * slot to the producer one lap later.  Producers claim a position with a
+ * compare and swap on the head, so no locks are taken on the push path.
+ *
+ * The mutex is only shared between the consumer and code that reconfigures
+ * the sink (i.e. changing the log file).
+ *
+ ******************************************************************************/
+
+#include "async_log_writer.h"
+#include "logger.h"
+#include "clock.h"
+#include "exception.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+using namespace std;
+using namespace logger;
+
+/******************************************************************************
+ *   PUBLIC METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Constructor
+ * Description: Preallocate the ring.
+ * Parameters:
+ *   records - number of records in the ring.  Rounded up to a power of 2.
+ *   sink - called by the writer for each record
+ *   flush - called by the writer after each batch, may be NULL
+ ******************************************************************************/
+AsyncLogWriter::AsyncLogWriter(size_t records, LogRecordSink sink, LogFlushSink flush) {
+    m_iCapacity = 2;
+    while(m_iCapacity < records)
+        m_iCapacity <<= 1;
+
+    m_iMask = m_iCapacity - 1;
+    m_pRecords = new LogRecord[m_iCapacity];
+
+    for(size_t i = 0; i < m_iCapacity; i++)
+        m_pRecords[i].sequence = i;
+
+    m_iHead = 0;
+    m_iTail = 0;
+    m_iDropped = 0;
+    m_iDroppedReported = 0;
+
+    m_pSink = sink;
+    m_pFlush = flush;
+
+    m_bRunning = false;
+    m_bStop = false;
+
+    pthread_mutex_init(&m_oLock, NULL);
+}
+
+/******************************************************************************
+ * Method: Destructor
+ * Description: Stop the writer thread, writing anything still queued.
+ ******************************************************************************/
+AsyncLogWriter::~AsyncLogWriter() {
+    stop();
+    drain();
+
+    pthread_mutex_destroy(&m_oLock);
+
+    delete [] m_pRecords;
+    m_pRecords = NULL;
+}
+
+/******************************************************************************
+ * Method: start
+ * Description: Start the background writer thread.
+ * Exceptions:
+ *   LoggerThreadFailure
+ ******************************************************************************/
+void AsyncLogWriter::start() {
+    if(running())
+        return;
+
+    __atomic_store_n(&m_bStop, false, __ATOMIC_RELEASE);
+
+    if(pthread_create(&m_oThread, NULL, AsyncLogWriter::Run, this))
+        throw LoggerThreadFailure();
+
+    __atomic_store_n(&m_bRunning, true, __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+ * Method: stop
+ * Description: Stop the background writer thread.  The thread writes all
+ * queued records before it exits.
+ ******************************************************************************/
+void AsyncLogWriter::stop() {
+    if(!running())
+        return;
+
+    __atomic_store_n(&m_bStop, true, __ATOMIC_RELEASE);
+    pthread_join(m_oThread, NULL);
+    __atomic_store_n(&m_bRunning, false, __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+ * Method: push
+ * Description: Copy a log message into the next free slot of the ring.  This
+ * never blocks.
+ * Parameters:
+ *   level - log level
+ *   file, fileLength - source file of the caller
+ *   line - source line of the caller
+ *   message, messageLength - formatted message
+ * Return:
+ *   false if the ring was full and the record was dropped.
+ ******************************************************************************/
+bool AsyncLogWriter::push(int level, const char *file, size_t fileLength, int line,
+                          const char *message, size_t messageLength) {
+    LogRecord *record;
+    size_t pos = __atomic_load_n(&m_iHead, __ATOMIC_RELAXED);
+
+    while(true) {
+        record = &m_pRecords[pos & m_iMask];
+        size_t sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+        long diff = (long)sequence - (long)pos;
+
+        if(diff == 0) {
+            if(__atomic_compare_exchange_n(&m_iHead, &pos, pos + 1, true,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if(diff < 0) {
+            __atomic_fetch_add(&m_iDropped, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        else {
+            pos = __atomic_load_n(&m_iHead, __ATOMIC_RELAXED);
+        }
+    }
+
+    if(fileLength >= LOG_RECORD_FILE_SIZE)
+        fileLength = LOG_RECORD_FILE_SIZE - 1;
+
+    if(messageLength > LOG_RECORD_MESSAGE_SIZE)
+        messageLength = LOG_RECORD_MESSAGE_SIZE;
+
+    Clock::Coarse(record->time);
+    record->level = level;
+    record->line = line;
+    record->fileLength = fileLength;
+    record->messageLength = messageLength;
+    memcpy(record->file, file, fileLength);
+    record->file[fileLength] = '\0';
+    memcpy(record->message, message, messageLength);
+
+    __atomic_store_n(&record->sequence, pos + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/******************************************************************************
+ * Method: drain
+ * Description: Write all queued records from the calling thread.
+ * Return:
+ *   number of records written
+ ******************************************************************************/
+size_t AsyncLogWriter::drain() {
+    size_t count;
+
+    lock();
+    count = writeQueued();
+    unlock();
+
+    return count;
+}
+
+/******************************************************************************
+ * Method: lock
+ * Description: Hold off the writer while the sink is reconfigured.
+ ******************************************************************************/
+void AsyncLogWriter::lock() {
+    pthread_mutex_lock(&m_oLock);
+}
+
+/******************************************************************************
+ * Method: unlock
+ * Description: Release the writer lock.
+ ******************************************************************************/
+void AsyncLogWriter::unlock() {
+    pthread_mutex_unlock(&m_oLock);
+}
+
+/******************************************************************************
+ * Method: dropped
+ * Description: Total number of records dropped because the ring was full.
+ ******************************************************************************/
+size_t AsyncLogWriter::dropped() {
+    return __atomic_load_n(&m_iDropped, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************
+ *   PRIVATE METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: writeQueued
+ * Description: Pass every ready record to the sink then call flush once for
+ * the batch.  If records were dropped since the last batch a warning record
+ * is written first.  The caller must hold the lock.
+ * Return:
+ *   number of records written
+ ******************************************************************************/
+size_t AsyncLogWriter::writeQueued() {
+    size_t count = 0;
+    size_t dropped = __atomic_load_n(&m_iDropped, __ATOMIC_RELAXED);
+
+    if(dropped != m_iDroppedReported) {
+        LogRecord notice;
+        Clock::Coarse(notice.time);
+        notice.level = WARNING;
+        notice.line = __LINE__;
+        notice.fileLength = snprintf(notice.file, LOG_RECORD_FILE_SIZE, "%s", __FILE__);
+        notice.messageLength = snprintf(notice.message, LOG_RECORD_MESSAGE_SIZE,
+                                        "log ring full, %lu messages dropped",
+                                        (unsigned long)(dropped - m_iDroppedReported));
+        m_iDroppedReported = dropped;
+        m_pSink(notice);
+        count++;
+    }
+
+    while(true) {
+        LogRecord *record = &m_pRecords[m_iTail & m_iMask];
+        size_t sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+
+        if(sequence != m_iTail + 1)
+            break;
+
+        m_pSink(*record);
+        count++;
+
+        __atomic_store_n(&record->sequence, m_iTail + m_iCapacity, __ATOMIC_RELEASE);
+        m_iTail++;
+    }
+
+    if(count && m_pFlush)
+        m_pFlush();
+
+    return count;
+}
+
+/******************************************************************************
+ * Method: Run
+ * Description: Writer thread main loop.  Write batches until stopped, sleeping
+ * when the ring is empty.
+ ******************************************************************************/
+void* AsyncLogWriter::Run(void *arg) {
+    AsyncLogWriter *writer = (AsyncLogWriter *)arg;
+
+    while(!__atomic_load_n(&writer->m_bStop, __ATOMIC_ACQUIRE)) {
+        if(!writer->drain())
+            usleep(LOG_ASYNC_IDLE_SLEEP);
+    }
+
+    writer->drain();
+    return NULL;
+}
@@ -0,0 +1,138 @@
+/*******************************************************************************
+ * Class: AsyncLogWriter
+ * Filename: async_log_writer.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Background writer for log messages.  Log records are copied into a
+ * preallocated ring of fixed size slots and a background thread hands them
+ * to a sink function in batches.  Pushing a record never takes a lock and
+ * never blocks; if the ring is full the record is dropped and counted.  The
+ * writer thread reports the number of dropped records with the next batch.
+ *
+ * The ring is a bounded multi-producer queue using a per slot sequence
+ * number, so any thread may push.  There is a single consumer, the writer
+ * thread, or a caller of drain().
+ *
+ * Messages longer than LOG_RECORD_MESSAGE_SIZE are truncated.
+ *
+ * Usage:
+ *
+ *   void sink(const LogRecord &record) { ... }
+ *   void flush() { ... }
+ *
+ *   AsyncLogWriter writer(1024, sink, flush);
+ *   writer.start();
+ *
+ *   writer.push(level, "file.cxx", 8, 10, "message", 7);
+ *
+ *   // Write everything queued right now
+ *   writer.drain();
+ *
+ *   writer.stop();
+ *
+ * Exceptions:
+ *
+ * LoggerThreadFailure - when the writer thread fails to start
+ *
+ ******************************************************************************/
+
+#ifndef __ASYNC_LOG_WRITER_H__
+#define __ASYNC_LOG_WRITER_H__
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#define LOG_RECORD_FILE_SIZE     128
+#define LOG_RECORD_MESSAGE_SIZE  2048
+#define LOG_ASYNC_RECORDS        1024
+
+// Time the writer thread sleeps when there is nothing to write (usec)
+#define LOG_ASYNC_IDLE_SLEEP     10000
+
+namespace logger {
+
+    struct LogRecord {
+        // Ring slot sequence, used by the queue only
+        size_t sequence;
+
+        int level;
+        int line;
+        struct timeval time;
+
+        uint16_t fileLength;
+        uint16_t messageLength;
+        char file[LOG_RECORD_FILE_SIZE];
+        char message[LOG_RECORD_MESSAGE_SIZE];
+    };
+
+    typedef void (*LogRecordSink)(const LogRecord &record);
+    typedef void (*LogFlushSink)();
+
+    class AsyncLogWriter {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            // Records is rounded up to a power of 2
+            AsyncLogWriter(size_t records, LogRecordSink sink, LogFlushSink flush);
+            ~AsyncLogWriter();
+
+            // Start and stop the background writer thread
+            void start();
+            void stop();
+            bool running() { return __atomic_load_n(&m_bRunning, __ATOMIC_ACQUIRE); }
+
+            // Queue a record, returns false if it was dropped.
+            bool push(int level, const char *file, size_t fileLength, int line,
+                      const char *message, size_t messageLength);
+
+            // Write all queued records from the calling thread
+            size_t drain();
+
+            // Hold off the writer thread while the sink is reconfigured
+            void lock();
+            void unlock();
+
+            size_t capacity() { return m_iCapacity; }
+            size_t dropped();
+
+        private:
+            AsyncLogWriter();
+            AsyncLogWriter(const AsyncLogWriter &);
+            AsyncLogWriter & operator=(const AsyncLogWriter &);
+
+            // Pop records into the sink, caller holds the lock
+            size_t writeQueued();
+
+            static void* Run(void *arg);
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            LogRecord *m_pRecords;
+            size_t m_iCapacity;
+            size_t m_iMask;
+
+            // Producers claim slots at the head, the consumer reads the tail
+            size_t m_iHead;
+            size_t m_iTail;
+            size_t m_iDropped;
+            size_t m_iDroppedReported;
+
+            LogRecordSink m_pSink;
+            LogFlushSink m_pFlush;
+
+            pthread_t m_oThread;
+            pthread_mutex_t m_oLock;
+            bool m_bRunning;
+            bool m_bStop;
+    };
+}
+
+#endif //__ASYNC_LOG_WRITER_H__
@@ -0,0 +1,108 @@
+/*******************************************************************************
+ * Class: Clock
+ * Filename: clock.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Wall clock sources for the port agent.
+ *
+ ******************************************************************************/
+
+#include "clock.h"
+
+#include <time.h>
+#include <sys/time.h>
+
+// Cached coarse time, see Tick()
+uint64_t Clock::m_iCoarseTime = 0;
+
+/******************************************************************************
+ *   PUBLIC METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Now
+ * Description: Read the high resolution wall clock.
+ * Parameters:
+ *   now - set to the current time
+ ******************************************************************************/
+void Clock::Now(struct timespec &now) {
+    clock_gettime(CLOCK_REALTIME, &now);
+}
+
+/******************************************************************************
+ * Method: Tick
+ * Description: Read the wall clock and cache it for Coarse().
+ ******************************************************************************/
+void Clock::Tick() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    __atomic_store_n(&m_iCoarseTime,
+                     now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec,
+                     __ATOMIC_RELAXED);
+}
+
+/******************************************************************************
+ * Method: Coarse
+ * Description: Get the time of the last Tick().
+ * Parameters:
+ *   now - set to the cached time
+ ******************************************************************************/
+void Clock::Coarse(struct timespec &now) {
+    uint64_t time = coarseTime();
+
+    now.tv_sec = time / NANOSECONDS_PER_SECOND;
+    now.tv_nsec = time % NANOSECONDS_PER_SECOND;
+}
+
+/******************************************************************************
+ * Method: Coarse
+ * Description: Get the time of the last Tick() as a timeval.
+ * Parameters:
+ *   now - set to the cached time
+ ******************************************************************************/
+void Clock::Coarse(struct timeval &now) {
+    uint64_t time = coarseTime();
+
+    now.tv_sec = time / NANOSECONDS_PER_SECOND;
+    now.tv_usec = (time % NANOSECONDS_PER_SECOND) / 1000;
+}
+
+/******************************************************************************
+ * Method: CoarseSeconds
+ * Description: Get the time of the last Tick() in seconds.
+ ******************************************************************************/
+time_t Clock::CoarseSeconds() {
+    return coarseTime() / NANOSECONDS_PER_SECOND;
+}
+
+/******************************************************************************
+ * Method: Reset
+ * Description: Forget the cached time so Coarse() reads the kernel coarse
+ * clock again.
+ ******************************************************************************/
+void Clock::Reset() {
+    __atomic_store_n(&m_iCoarseTime, 0, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************
+ *   PRIVATE METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: coarseTime
+ * Description: The cached time in nanoseconds, or the kernel coarse clock if
+ * there isn't one.
+ ******************************************************************************/
+uint64_t Clock::coarseTime() {
+    uint64_t time = __atomic_load_n(&m_iCoarseTime, __ATOMIC_RELAXED);
+
+    if(!time) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME_COARSE, &now);
+        time = now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+    }
+
+    return time;
+}
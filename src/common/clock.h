@@ -0,0 +1,76 @@
+/*******************************************************************************
+ * Class: Clock
+ * Filename: clock.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Wall clock sources for the port agent.
+ *
+ * Now() is a high resolution clock_gettime read and is used to timestamp
+ * instrument data.
+ *
+ * Coarse() is for everything that only needs to know roughly what time it
+ * is: log messages, heartbeats and file rotation.  The event loop calls
+ * Tick() once per iteration and Coarse() returns that cached time, so all
+ * the log lines written while handling one select wake up share a single
+ * clock read.  Until Tick() is first called Coarse() reads the kernel's
+ * coarse clock, which is cheap but only as precise as the scheduler tick.
+ *
+ * The cached time is a single 64 bit value so it can be read from any
+ * thread.
+ *
+ * Usage:
+ *
+ *   struct timespec now;
+ *   Clock::Now(now);
+ *
+ *   // once per event loop iteration
+ *   Clock::Tick();
+ *
+ *   Clock::Coarse(now);
+ *   time_t seconds = Clock::CoarseSeconds();
+ *
+ ******************************************************************************/
+
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/time.h>
+
+#define NANOSECONDS_PER_SECOND 1000000000ULL
+
+class Clock {
+    /********************
+     *      METHODS     *
+     ********************/
+
+    public:
+        // High resolution wall clock
+        static void Now(struct timespec &now);
+
+        // Cache the coarse time, once per event loop iteration
+        static void Tick();
+
+        // Wall clock as of the last Tick()
+        static void Coarse(struct timespec &now);
+        static void Coarse(struct timeval &now);
+        static time_t CoarseSeconds();
+
+        // Stop returning the cached time.  Used for testing.
+        static void Reset();
+
+    private:
+        static uint64_t coarseTime();
+
+    /********************
+     *      MEMBERS     *
+     ********************/
+
+    private:
+        // Nanoseconds since the unix epoch, 0 if Tick() hasn't been called
+        static uint64_t m_iCoarseTime;
+};
+
+#endif //__CLOCK_H__
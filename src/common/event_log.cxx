@@ -0,0 +1,156 @@
+/*******************************************************************************
+ * Class: EventLog
+ * Filename: event_log.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Events are written to the ring with the MappedRing claim and commit
+ * protocol, so a record torn by a crash is skipped by readers.
+ *
+ ******************************************************************************/
+
+#include "event_log.h"
+#include "clock.h"
+#include "exception.h"
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+using namespace std;
+using namespace logger;
+
+// Global static pointer used to ensure a single instance of the class.
+EventLog* EventLog::m_pInstance = NULL;
+int EventLog::m_iLevel = INFO;
+
+/******************************************************************************
+ *   PUBLIC METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Open
+ * Description: Map the event log file, creating it if needed.  Any open
+ * event log is closed first.
+ * Parameters:
+ *   path - event log file
+ *   messages - message id and format table
+ *   count - number of messages in the table
+ *   records - number of records in the ring
+ * Exceptions:
+ *   EventLogOpenFailure
+ ******************************************************************************/
+void EventLog::Open(const string &path, const EventMessage *messages,
+                    size_t count, size_t records) {
+    Close();
+
+    EventLog *instance = new EventLog();
+    try {
+        instance->open(path, messages, count, records);
+    }
+    catch(EventLogOpenFailure &e) {
+        delete instance;
+        throw;
+    }
+
+    m_pInstance = instance;
+}
+
+/******************************************************************************
+ * Method: Close
+ * Description: Unmap the event log file.
+ ******************************************************************************/
+void EventLog::Close() {
+    if(m_pInstance)
+        delete m_pInstance;
+
+    m_pInstance = NULL;
+}
+
+/******************************************************************************
+ * Method: SetLevel
+ * Description: Set the most verbose level written to the event log.
+ ******************************************************************************/
+void EventLog::SetLevel(TLogLevel level) {
+    m_iLevel = level;
+}
+
+/******************************************************************************
+ * Method: Header
+ * Description: Get the mapped file header.
+ * Return:
+ *   pointer to the header, NULL if the log isn't open
+ ******************************************************************************/
+const EventLogHeader* EventLog::Header() {
+    return m_pInstance ? (const EventLogHeader *)m_pInstance->m_oRing.header() : NULL;
+}
+
+/******************************************************************************
+ * Method: Record
+ * Description: Get a record by sequence number.
+ * Parameters:
+ *   sequence - sequence number, the first event written is 1
+ * Return:
+ *   pointer to the record, NULL if it has been overwritten or isn't written
+ ******************************************************************************/
+const EventRecord* EventLog::Record(uint64_t sequence) {
+    return m_pInstance ? (const EventRecord *)m_pInstance->m_oRing.record(sequence) : NULL;
+}
+
+/******************************************************************************
+ *   PRIVATE METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: open
+ * Description: Map the file.  An existing file with the same layout is
+ * reused so the ring continues; otherwise it is reinitialized.
+ * Exceptions:
+ *   EventLogOpenFailure
+ ******************************************************************************/
+void EventLog::open(const string &path, const EventMessage *messages,
+                    size_t count, size_t records) {
+    if(!records)
+        throw EventLogOpenFailure("zero records");
+
+    if(!m_oRing.open(path, EVENT_LOG_MAGIC, EVENT_LOG_VERSION,
+                     sizeof(EventLogHeader), sizeof(EventRecord), records, true))
+        throw EventLogOpenFailure(path + ": " + strerror(errno));
+
+    EventLogHeader *header = (EventLogHeader *)m_oRing.header();
+
+    // Formats are replaced on every open, message ids are expected to be
+    // stable between versions.
+    memset(header->formats, 0, sizeof(header->formats));
+    for(size_t i = 0; i < count; i++) {
+        if(messages[i].id >= EVENT_LOG_MESSAGES || !messages[i].format)
+            continue;
+
+        strncpy(header->formats[messages[i].id], messages[i].format,
+                EVENT_LOG_FORMAT_SIZE - 1);
+    }
+}
+
+/******************************************************************************
+ * Method: write
+ * Description: Claim the next slot in the ring and fill in the record.
+ ******************************************************************************/
+void EventLog::write(TLogLevel level, uint16_t id, int64_t a0, int64_t a1,
+                     int64_t a2, int64_t a3) {
+    struct timespec now;
+    uint64_t sequence;
+    EventRecord *record = (EventRecord *)m_oRing.claim(sequence);
+
+    Clock::Coarse(now);
+
+    record->seconds = now.tv_sec;
+    record->nanoseconds = now.tv_nsec;
+    record->level = level;
+    record->id = id;
+    record->args[0] = a0;
+    record->args[1] = a1;
+    record->args[2] = a2;
+    record->args[3] = a3;
+
+    m_oRing.commit(record, sequence);
+}
@@ -0,0 +1,148 @@
+/*******************************************************************************
+ * Class: EventLog
+ * Filename: event_log.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Binary structured event log (singleton).  Each event is a fixed size
+ * record holding a timestamp, log level, message id and up to
+ * EVENT_LOG_ARGS integer arguments.  Records are written to a ring in a
+ * memory mapped file, so writing an event is a handful of stores and the
+ * most recent EVENT_LOG_RECORDS events survive a crash of the process.
+ *
+ * Nothing is formatted when an event is written.  The message formats are
+ * stored once in the file header and tools/event_log_decoder.py renders the
+ * records as text offline.  Formats use printf integer conversions only
+ * (%d, %x, ...), one per argument.  The ring is a MappedRing.
+ *
+ * Reopening an existing event log continues the ring where it left off.
+ *
+ * File Layout:
+ *
+ *   EventLogHeader
+ *   EventRecord[records]
+ *
+ *   A record is valid when its sequence is non-zero; its position in the
+ *   ring is (sequence - 1) % records.
+ *
+ * Usage:
+ *
+ *   #include "event_log.h"
+ *
+ *   enum { EVENT_STARTUP = 1, EVENT_READ };
+ *
+ *   const EventMessage messages[] = {
+ *       { EVENT_STARTUP, "startup" },
+ *       { EVENT_READ,    "read %d bytes from fd %d" }
+ *   };
+ *
+ *   EventLog::Open("/tmp/port_agent.events", messages, 2);
+ *   EventLog::SetLevel(INFO);
+ *
+ *   EventLog::Write(INFO, EVENT_READ, bytesRead, fd);
+ *
+ *   EventLog::Close();
+ *
+ * Exceptions:
+ *
+ * EventLogOpenFailure - when the event log file can't be created or mapped
+ *
+ ******************************************************************************/
+
+#ifndef __EVENT_LOG_H__
+#define __EVENT_LOG_H__
+
+#include "logger.h"
+#include "mapped_ring.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#define EVENT_LOG_MAGIC          0x47564521  // "!EVG"
+#define EVENT_LOG_VERSION        1
+
+#define EVENT_LOG_RECORDS        65536
+#define EVENT_LOG_ARGS           4
+#define EVENT_LOG_MESSAGES       256
+#define EVENT_LOG_FORMAT_SIZE    64
+
+using namespace std;
+
+namespace logger {
+
+    struct EventMessage {
+        uint16_t id;
+        const char *format;
+    };
+
+    // 64 bytes on disk
+    struct EventRecord {
+        uint64_t sequence;
+        uint64_t seconds;
+        uint32_t nanoseconds;
+        uint16_t level;
+        uint16_t id;
+        uint64_t reserved;
+        int64_t args[EVENT_LOG_ARGS];
+    };
+
+    struct EventLogHeader : public MappedRingHeader {
+        uint64_t reserved;
+
+        char formats[EVENT_LOG_MESSAGES][EVENT_LOG_FORMAT_SIZE];
+    };
+
+    class EventLog {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            // Map the event log file and store the message formats
+            static void Open(const string &path, const EventMessage *messages,
+                             size_t count, size_t records = EVENT_LOG_RECORDS);
+
+            // Unmap the event log file
+            static void Close();
+
+            static bool IsOpen() { return m_pInstance != NULL; }
+
+            // Only events at or below level are written
+            static void SetLevel(TLogLevel level);
+
+            // Write an event.  Does nothing when the log isn't open.
+            static void Write(TLogLevel level, uint16_t id, int64_t a0 = 0,
+                              int64_t a1 = 0, int64_t a2 = 0, int64_t a3 = 0) {
+                if(m_pInstance && level <= m_iLevel && level <= LOG_MIN_LEVEL)
+                    m_pInstance->write(level, id, a0, a1, a2, a3);
+            }
+
+            // Access for readers and tests
+            static const EventLogHeader* Header();
+            static const EventRecord* Record(uint64_t sequence);
+
+        private:
+            EventLog() {}
+            EventLog(const EventLog &);
+            EventLog & operator=(const EventLog &);
+            ~EventLog() {}
+
+            void open(const string &path, const EventMessage *messages,
+                      size_t count, size_t records);
+            void write(TLogLevel level, uint16_t id, int64_t a0, int64_t a1,
+                       int64_t a2, int64_t a3);
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            static EventLog *m_pInstance;
+            static int m_iLevel;
+
+            MappedRing m_oRing;
+    };
+}
+
+#endif //__EVENT_LOG_H__
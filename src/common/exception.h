@@ -115,6 +115,26 @@ class LoggerOpenFailure : public OOIException {
         OOIException("Failed to open log file", 204, msg) {}
 };
 
+class LoggerThreadFailure : public OOIException {
+    public: LoggerThreadFailure(const string & msg = "") :
+        OOIException("Failed to start log writer thread", 205, msg) {}
+};
+
+class EventLogOpenFailure : public OOIException {
+    public: EventLogOpenFailure(const string & msg = "") :
+        OOIException("Failed to open event log", 206, msg) {}
+};
+
+class ShmRingOpenFailure : public OOIException {
+    public: ShmRingOpenFailure(const string & msg = "") :
+        OOIException("Failed to open shared memory ring", 207, msg) {}
+};
+
+class TraceLogOpenFailure : public OOIException {
+    public: TraceLogOpenFailure(const string & msg = "") :
+        OOIException("Failed to open trace log", 208, msg) {}
+};
+
 /*******************************************************************************
  * Socket Exceptions
  ******************************************************************************/
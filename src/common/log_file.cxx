@@ -39,6 +39,7 @@
  ******************************************************************************/
 
 #include "log_file.h"
+#include "clock.h"
 #include "util.h"
 #include "logger.h"
 #include "exception.h"
@@ -210,8 +211,7 @@ string LogFile::getFilename() {
 string LogFile::fileDate()
 {
     char buffer[11];
-    time_t t;
-    time(&t);
+    time_t t = Clock::CoarseSeconds();
     tm r = {0};
     strftime(buffer, sizeof(buffer), "%Y%m%d", localtime_r(&t, &r));
     return buffer;
@@ -227,8 +227,7 @@ string LogFile::fileDate()
 string LogFile::fileTime()
 {
     char buffer[7];
-	time_t ts;
-    time (&ts);
+	time_t ts = Clock::CoarseSeconds();
     struct tm * timeinfo = localtime(&ts);
   
 	int hour = timeinfo->tm_hour;
@@ -344,7 +343,7 @@ void LogFile::setRotation(RotationType type) {
  *   buffer  - what we need to write.
  *   size - how big the buffer is
  ******************************************************************************/
-bool LogFile::write(const char *buffer, uint16_t size) {
+bool LogFile::write(const char *buffer, uint32_t size) {
     ofstream *out = getStreamObject();
     
 	out->write(buffer, size);
@@ -121,7 +121,7 @@ namespace logger {
 			void flush();
 
 			// Raw write to the output file
-			bool write(const char *buffer, uint16_t size);
+			bool write(const char *buffer, uint32_t size);
 
 			// Get a date to use for file rotation.
 			string fileDate();
@@ -48,6 +48,7 @@
  ******************************************************************************/
 
 #include "logger.h"
+#include "clock.h"
 #include "util.h"
 #include "exception.h"
 
@@ -68,6 +69,9 @@ using namespace logger;
 // Global static pointer used to ensure a single instance of the class.
 Logger* Logger::m_pInstance = NULL;
 
+// Log level checked by LOG(), kept in step with the singleton.
+int Logger::m_iActiveLogLevel = DEFAULT_LOG_LEVEL;
+
 /******************************************************************************
  *   PUBLIC METHODS
  ******************************************************************************/
@@ -83,6 +87,8 @@ Logger::Logger()
     m_pException = NULL;
     m_iLastLogDate = 0;
     m_sLogfileStream = NULL;
+    m_pAsyncWriter = NULL;
+    m_pAsyncException = NULL;
 }
 
 
@@ -101,11 +107,13 @@ Logger::~Logger() {
  ******************************************************************************/
 void Logger::close()
 {
-    if(m_sLogfileStream) {
-    	m_sLogfileStream->close();
-	    delete m_sLogfileStream;
-	    m_sLogfileStream = NULL;
-    }
+    if(m_pAsyncWriter)
+        m_pAsyncWriter->lock();
+    
+    closeStream();
+    
+    if(m_pAsyncWriter)
+        m_pAsyncWriter->unlock();
 }
 
 /******************************************************************************
@@ -117,19 +125,14 @@ void Logger::close()
  *   string path to a log file.
  ******************************************************************************/
 string Logger::getLogFilename() {
-    ostringstream out;
-    
-    if(m_sLogFileName.length())
-        return m_sLogFileName;
+    string file = logFilename();
     
-    if(m_sLogFileBase.length()) {
-        out << m_sLogFileBase << "." << fileDate() << "." << LOG_EXTENSION;
-	return out.str();
-    }
+    if(file.length())
+        return file;
     
     // We have made it this far.  So it must be an error
+    clearError();
     if(m_bRaiseErrors) {
-        clearError();
 	throw LoggerFileNotSet();
     } else {
 	    m_pException = new LoggerFileNotSet();
@@ -149,34 +152,113 @@ string Logger::getLogFilename() {
 void Logger::WriteLog(string message, TLogLevel level, string file, int line) {
     Logger* instance = Logger::Instance();
     
+    // Hand the message off to the writer thread.  Never blocks.
+    if(instance->m_pAsyncWriter) {
+        if(message.length())
+            instance->m_pAsyncWriter->push(level, file.c_str(), file.length(), line,
+                                           message.c_str(), message.length());
+        return;
+    }
+    
     instance->clearError();
     
     if(message.length()) {
-        ofstream* logout = instance->getLogStream();
-        if(logout){
-            *logout << instance->nowTime() << " " << file << " " << " [" << line << "] "
-                    << " " << instance->levelToString(level) << ": ";
-    
-            // Indent debug messages
-	        if(level < MESG && level >= DEBUG)
-    	        *logout << string(level > DEBUG ? level - DEBUG : 0, '\t');
-				
-	        *logout << message << endl;
-	    
-            if(!logout->good()) {
-                // We have made it this far.  So it must be an error
-                if(instance->m_bRaiseErrors) {
-    	            throw LoggerWriteError();
-                } else {
-                    instance->clearError();
-		            instance->close();
-	                instance->m_pException = new LoggerWriteError();
-                }
-			}
+        struct timeval now;
+        Clock::Coarse(now);
+        
+        try {
+            instance->writeMessage(now, level, file.c_str(), line,
+                                   message.c_str(), message.length(), true);
+        }
+        catch(OOIException &e) {
+            if(instance->m_bRaiseErrors)
+                throw;
+            
+            instance->m_pException = new OOIException(e);
         }
     }
 }
 
+/******************************************************************************
+ * Method: Flush
+ * Description: Write all queued log messages and flush the log stream.
+ ******************************************************************************/
+void Logger::Flush() {
+    Logger* instance = Logger::Instance();
+    AsyncLogWriter* writer = instance->m_pAsyncWriter;
+    
+    if(writer) {
+        writer->drain();
+        writer->lock();
+    }
+    
+    FlushStream();
+    
+    if(writer)
+        writer->unlock();
+}
+
+/******************************************************************************
+ * Method: StartAsync
+ * Description: Start a background thread to write log messages.  LOG() then
+ * only copies the message into a preallocated ring.  If the ring fills up
+ * messages are dropped rather than blocking the caller.  Threads do not
+ * survive a fork so this must be called after a process daemonizes.
+ * Parameters:
+ *   records - number of messages the ring can hold
+ *
+ * Exceptions:
+ *   LoggerThreadFailure
+ ******************************************************************************/
+void Logger::StartAsync(size_t records) {
+    Logger* instance = Logger::Instance();
+    
+    if(instance->m_pAsyncWriter)
+        return;
+    
+    instance->m_pAsyncWriter = new AsyncLogWriter(records, Logger::WriteRecord,
+                                                  Logger::FlushStream);
+    try {
+        instance->m_pAsyncWriter->start();
+    }
+    catch(LoggerThreadFailure &e) {
+        delete instance->m_pAsyncWriter;
+        instance->m_pAsyncWriter = NULL;
+        
+        if(instance->m_bRaiseErrors) {
+            throw;
+        } else {
+            instance->clearError();
+            instance->m_pException = new LoggerThreadFailure();
+        }
+    }
+}
+
+/******************************************************************************
+ * Method: StopAsync
+ * Description: Stop the background writer thread and write any queued
+ * messages.  Messages are written synchronously after this call.
+ ******************************************************************************/
+void Logger::StopAsync() {
+    Logger* instance = Logger::Instance();
+    AsyncLogWriter* writer = instance->m_pAsyncWriter;
+    
+    if(!writer)
+        return;
+    
+    writer->stop();
+    instance->m_pAsyncWriter = NULL;
+    delete writer;
+}
+
+/******************************************************************************
+ * Method: IsAsync
+ * Description: Are messages written by a background thread?
+ ******************************************************************************/
+bool Logger::IsAsync() {
+    return Logger::Instance()->m_pAsyncWriter != NULL;
+}
+
 /******************************************************************************
  * Method: Instance
  * Description: Get a pointer to the logger singleton instance.
@@ -197,10 +279,17 @@ Logger* Logger::Instance()
  ******************************************************************************/
 void Logger::Reset()
 {
-    if(m_pInstance)
+    if(m_pInstance && m_pInstance->m_pAsyncWriter)
+        StopAsync();
+    
+    if(m_pInstance) {
+        m_pInstance->clearError();
+        delete m_pInstance->m_pAsyncException;
         delete m_pInstance;
+    }
 	
     m_pInstance = new Logger();
+    m_pInstance->setLogLevel(DEFAULT_LOG_LEVEL);
 }
 
 /******************************************************************************
@@ -210,8 +299,20 @@ void Logger::Reset()
  *   string file - path to the log file
  ******************************************************************************/
 void Logger::SetLogFile(const string& file) {
-	Logger::Instance()->close();
-    Logger::Instance()->m_sLogFileName = file;
+    Logger* instance = Logger::Instance();
+    
+    // Queued messages go to the old file.  Then keep the writer thread
+    // out while the stream is swapped.
+    if(instance->m_pAsyncWriter) {
+        instance->m_pAsyncWriter->drain();
+        instance->m_pAsyncWriter->lock();
+    }
+    
+	instance->closeStream();
+    instance->m_sLogFileName = file;
+    
+    if(instance->m_pAsyncWriter)
+        instance->m_pAsyncWriter->unlock();
 }
 
 /******************************************************************************
@@ -229,7 +330,15 @@ string Logger::GetLogFile() {
  *   string file - path to the log base
  ******************************************************************************/
 void Logger::SetLogBase(const string& file) {
-    Logger::Instance()->m_sLogFileBase = file;
+    Logger* instance = Logger::Instance();
+    
+    if(instance->m_pAsyncWriter)
+        instance->m_pAsyncWriter->lock();
+    
+    instance->m_sLogFileBase = file;
+    
+    if(instance->m_pAsyncWriter)
+        instance->m_pAsyncWriter->unlock();
 }
 
 /******************************************************************************
@@ -245,7 +354,7 @@ string Logger::GetLogBase() {
  * Description: Get the current log level
  ******************************************************************************/
 TLogLevel Logger::GetLogLevel() {
-    return Logger::Instance()->m_tLogLevel;
+    return ActiveLogLevel();
 }
 
 /******************************************************************************
@@ -258,7 +367,7 @@ void Logger::IncreaseLogLevel(const unsigned short levels) {
     Logger* instance = Logger::Instance();
     
     int index = instance->m_tLogLevel + levels > 7 ? 7 : instance->m_tLogLevel + levels;
-    instance->m_tLogLevel = TLogLevel(index);
+    instance->setLogLevel(TLogLevel(index));
 }
 
 /******************************************************************************
@@ -271,7 +380,7 @@ void Logger::DecreaseLogLevel(const unsigned short levels) {
     Logger* instance = Logger::Instance();
     
     int index = instance->m_tLogLevel - levels < 0 ? 0 : instance->m_tLogLevel - levels;
-    instance->m_tLogLevel = TLogLevel(index);
+    instance->setLogLevel(TLogLevel(index));
 }
 
 /******************************************************************************
@@ -290,7 +399,7 @@ void Logger::SetLogLevel(const string& level) {
     TLogLevel newLevel = instance->levelFromString(level);
     
     if(!GetError())
-        instance->m_tLogLevel = newLevel;
+        instance->setLogLevel(newLevel);
 }
     
 /******************************************************************************
@@ -302,7 +411,13 @@ void Logger::SetLogLevel(const string& level) {
 void Logger::SetRaiseErrors(bool raise_error) {
     Logger* instance = Logger::Instance();
     
+    if(instance->m_pAsyncWriter)
+        instance->m_pAsyncWriter->lock();
+    
     instance->m_bRaiseErrors = raise_error;
+    
+    if(instance->m_pAsyncWriter)
+        instance->m_pAsyncWriter->unlock();
 }
 
 /******************************************************************************
@@ -319,12 +434,21 @@ bool Logger::GetRaiseErrors() {
 
 /******************************************************************************
  * Method: GetError
- * Description: Get the last error
+ * Description: Get the last error.  An error left by the async writer thread
+ * is picked up here and becomes the last error.
  * Return:
  *   OOIException* the last exception object created
  ******************************************************************************/
 OOIException* Logger::GetError() {
     Logger* instance = Logger::Instance();
+    OOIException* error = __atomic_exchange_n(&instance->m_pAsyncException,
+                                              (OOIException *)NULL,
+                                              __ATOMIC_ACQUIRE);
+    if(error) {
+        instance->clearError();
+        instance->m_pException = error;
+    }
+    
     return instance->m_pException;
 }
 
@@ -360,19 +484,116 @@ ostringstream& Logger::get(TLogLevel level, const string &file, int line)
  *   string with time stamp
  ******************************************************************************/
 string Logger::nowTime()
+{
+    struct timeval tv;
+    Clock::Coarse(tv);
+    return nowTime(tv);
+}
+
+/******************************************************************************
+ * Method: NowTime
+ * Description: Build a timestamp for the log message from a time value
+ * Parameters:
+ *   tv - time the message was logged
+ * Return:
+ *   string with time stamp
+ ******************************************************************************/
+string Logger::nowTime(const struct timeval &tv)
 {
     char buffer[32];
-    time_t t;
-    time(&t);
+    time_t t = tv.tv_sec;
     tm r = {0};
     strftime(buffer, sizeof(buffer), "%Y-%b-%d %X", localtime_r(&t, &r));
-    struct timeval tv;
-    gettimeofday(&tv, 0);
     char result[100] = {0};
     sprintf(result, "%s.%03ld", buffer, (long)tv.tv_usec / 1000); 
     return result;
 }
 
+/******************************************************************************
+ * Method: writeMessage
+ * Description: Format and write one message to the log stream.
+ * Parameters:
+ *   time - time the message was logged
+ *   level - log level of the message
+ *   file - filename of caller
+ *   line - line number of caller
+ *   message, length - message text
+ *   flush - flush the stream after writing
+ *
+ * Exceptions:
+ *   LoggerWriteError
+ *   LoggerOpenFailure
+ *   LoggerFileNotSet
+ ******************************************************************************/
+void Logger::writeMessage(const struct timeval &time, TLogLevel level,
+                          const char *file, int line,
+                          const char *message, size_t length, bool flush) {
+    ofstream* logout = getLogStream();
+    
+    *logout << nowTime(time) << " " << file << " " << " [" << line << "] "
+            << " " << levelToString(level) << ": ";
+    
+    // Indent debug messages
+    if(level < MESG && level >= DEBUG)
+        *logout << string(level > DEBUG ? level - DEBUG : 0, '\t');
+    
+    logout->write(message, length);
+    *logout << '\n';
+    
+    if(flush)
+        logout->flush();
+    
+    if(!logout->good()) {
+        closeStream();
+        throw LoggerWriteError();
+    }
+}
+
+/******************************************************************************
+ * Method: WriteRecord
+ * Description: Sink for the async writer thread.  Errors can not be raised
+ * in the writer thread so they are handed to GetError().
+ ******************************************************************************/
+void Logger::WriteRecord(const LogRecord &record) {
+    Logger* instance = Logger::Instance();
+    
+    try {
+        instance->writeMessage(record.time, TLogLevel(record.level),
+                               record.file, record.line,
+                               record.message, record.messageLength, false);
+    }
+    catch(OOIException &e) {
+        instance->setAsyncError(new OOIException(e));
+    }
+}
+
+/******************************************************************************
+ * Method: FlushStream
+ * Description: Flush the log file stream.  Called once per batch by the
+ * async writer thread, or by Flush() holding the writer lock.
+ ******************************************************************************/
+void Logger::FlushStream() {
+    Logger* instance = Logger::Instance();
+    
+    if(instance->m_sLogfileStream)
+        instance->m_sLogfileStream->flush();
+}
+
+/******************************************************************************
+ * Method: setAsyncError
+ * Description: Hand an error from the writer thread to GetError().  The
+ * writer thread never touches m_pException, which belongs to the caller's
+ * thread.  If an earlier error wasn't picked up it is replaced.
+ * Parameters:
+ *   error - error to store, the logger takes ownership
+ ******************************************************************************/
+void Logger::setAsyncError(OOIException *error) {
+    OOIException* old = __atomic_exchange_n(&m_pAsyncException, error,
+                                            __ATOMIC_ACQ_REL);
+    if(old)
+        delete old;
+}
+
 /******************************************************************************
  * Method: fileDate
  * Description: Build a date for the log file
@@ -382,8 +603,7 @@ string Logger::nowTime()
 int Logger::fileDate()
 {
     char buffer[11];
-    time_t t;
-    time(&t);
+    time_t t = Clock::CoarseSeconds();
     tm r = {0};
     strftime(buffer, sizeof(buffer), "%Y%m%d", localtime_r(&t, &r));
     return atoi(buffer);
@@ -396,61 +616,80 @@ int Logger::fileDate()
  * exists we will create a new ofstream object.
  * 
  * Return:
- *   ofstream* pointer to an ofstream object appending to the log file.
+ *   ofstream* pointer to an ofstream object appending to the log file.  If
+ *   the file can't be opened and errors aren't raised the stream is returned
+ *   in a failed state and the write reports the error.
  *
  * Exceptions:
  *   LoggerOpenFailure
  *   LoggerFileNotSet
  ******************************************************************************/
 ofstream* Logger::getLogStream() {
-    string file = getLogFilename();
-    
-    // If we have a log file to write to then lets work on getting the ostream
-    if(file.length()) {
-	// We already have a file handle.  Let's try to see if it's good.
-	if(m_sLogfileStream) {
-	    
-	    // The fail bit is set for some reason.
-	    if(m_sLogfileStream->fail()) {
-		close();
-	    }
-	    
-	    // Explicitly check to see if the file still exists.  This will
-	    // protect us if the file is removed or the file name has changed
-	    // because it's time to roll.
-	    if(! file_exists(file.c_str())) {
-		close();
-	    }
+    string file = logFilename();
+    
+    if(!file.length())
+	throw LoggerFileNotSet();
+    
+    // We already have a file handle.  Let's try to see if it's good.
+    if(m_sLogfileStream) {
+	
+	// The fail bit is set for some reason.
+	if(m_sLogfileStream->fail()) {
+	    closeStream();
 	}
 	
-        // We can fall into this if the logfile was closed above OR this is
-	// our first call to this method.
-	if(!m_sLogfileStream) {
-	    m_sLogfileStream = new ofstream;
-	    m_sLogfileStream->open(file.c_str(), ios::out | ios::app);
-	    
-	    if(m_sLogfileStream->fail()) {
-                if(m_bRaiseErrors) {
-                    clearError();
-	            throw LoggerOpenFailure();
-                } else {
-	            m_pException = new LoggerOpenFailure();
-                }
-	    }
+	// Explicitly check to see if the file still exists.  This will
+	// protect us if the file is removed or the file name has changed
+	// because it's time to roll.
+	else if(! file_exists(file.c_str())) {
+	    closeStream();
 	}
-	    
-        return m_sLogfileStream;
     }
     
-    // We have made it this far.  So it must be an error
-    if(m_bRaiseErrors) {
-        clearError();
-	throw LoggerFileNotSet();
-    } else {
-	m_pException = new LoggerFileNotSet();
+    // We can fall into this if the logfile was closed above OR this is
+    // our first call to this method.
+    if(!m_sLogfileStream) {
+	m_sLogfileStream = new ofstream;
+	m_sLogfileStream->open(file.c_str(), ios::out | ios::app);
+	
+	if(m_sLogfileStream->fail() && m_bRaiseErrors)
+	    throw LoggerOpenFailure();
+    }
+    
+    return m_sLogfileStream;
+}
+
+/******************************************************************************
+ * Method: logFilename
+ * Description: Build the log file name without recording an error.
+ * Return:
+ *   string path to a log file, empty if neither a name nor a base is set.
+ ******************************************************************************/
+string Logger::logFilename() {
+    ostringstream out;
+    
+    if(m_sLogFileName.length())
+        return m_sLogFileName;
+    
+    if(m_sLogFileBase.length()) {
+        out << m_sLogFileBase << "." << fileDate() << "." << LOG_EXTENSION;
+	return out.str();
     }
     
-    return NULL;
+    return string();
+}
+
+/******************************************************************************
+ * Method: closeStream
+ * Description: Close the log file stream.  While async logging is running
+ * the caller must be the writer or hold the writer lock.
+ ******************************************************************************/
+void Logger::closeStream() {
+    if(m_sLogfileStream) {
+    	m_sLogfileStream->close();
+	    delete m_sLogfileStream;
+	    m_sLogfileStream = NULL;
+    }
 }
 
 
@@ -464,6 +703,17 @@ void Logger::clearError() {
     m_pException = NULL;
 }
 
+/******************************************************************************
+ * Method: setLogLevel
+ * Description: Set the instance log level and the copy read by LOG().
+ * Parameters:
+ *   TLogLevel level - new log level
+ ******************************************************************************/
+void Logger::setLogLevel(TLogLevel level) {
+    m_tLogLevel = level;
+    __atomic_store_n(&m_iActiveLogLevel, (int)level, __ATOMIC_RELAXED);
+}
+
 /******************************************************************************
  * Method: levelToString
  * Description: Convert a log level to a string representation
@@ -48,6 +48,31 @@
  *   downstream processes' job to check for errors.
  *
  *   Logger::SetRaiseErrors(true)
+ *
+ *   Asynchronous Logging
+ *
+ *   By default messages are written and flushed to the log file before LOG()
+ *   returns.  Once async logging is started messages are queued in a
+ *   preallocated ring and written in batches by a background thread so
+ *   logging never blocks the caller.  Start the writer after forking.
+ *
+ *   Logger::StartAsync();
+ *
+ *   // Write everything queued so far
+ *   Logger::Flush();
+ *
+ *   Logger::StopAsync();
+ *
+ *   While async logging runs the log stream belongs to the writer thread;
+ *   other threads only touch it holding the writer lock.  Write errors from
+ *   the writer thread are handed over atomically and show up in the next
+ *   GetError() call on the caller's thread.
+ *
+ *   Compiled Log Level
+ *
+ *   LOG() statements more verbose than LOG_MIN_LEVEL are removed by the
+ *   compiler.  Set it with ./configure --with-min-log-level=LEVEL.  Raising
+ *   the runtime log level past it has no effect on those statements.
  ******************************************************************************/
 
 #ifndef __LOGGER_H__
@@ -57,11 +82,18 @@
 #include <sstream>
 #include <string>
 #include <stdio.h>
+#include <sys/time.h>
 
 #include "exception.h"
+#include "async_log_writer.h"
 	
 #define LOG_EXTENSION "log"
 
+// Most verbose level compiled into the program, normally set by configure.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL logger::MESG
+#endif
+
 using namespace std;
 
 namespace logger {
@@ -135,6 +167,12 @@ namespace logger {
 		// Get the current log level
 		static TLogLevel GetLogLevel();
 
+		// Get the current log level without touching the singleton.  Used
+		// by LOG() for every statement so it is inline and lock free.
+		static TLogLevel ActiveLogLevel() {
+			return TLogLevel(__atomic_load_n(&m_iActiveLogLevel, __ATOMIC_RELAXED));
+		}
+
 		// Get the current log level as a string
 		static string ToString(TLogLevel level);
 
@@ -147,6 +185,15 @@ namespace logger {
 		// Clear the current singleton
 		static void Reset();
 
+		// Start writing log messages from a background thread
+		static void StartAsync(size_t records = LOG_ASYNC_RECORDS);
+
+		// Stop the background writer, writing all queued messages
+		static void StopAsync();
+
+		// Are messages written by the background writer?
+		static bool IsAsync();
+
 
 		// Get the log level from a string.
 		TLogLevel levelFromString(const string& level);
@@ -157,6 +204,9 @@ namespace logger {
 	protected:
 		static Logger* m_pInstance;
 
+		// Copy of the singleton log level read by LOG()
+		static int m_iActiveLogLevel;
+
 		ostringstream m_sLogoutStream;
 		ofstream* m_sLogfileStream;
 
@@ -172,6 +222,11 @@ namespace logger {
 
 		bool m_bRaiseErrors;
 		OOIException* m_pException;
+		
+		// Error left by the async writer thread for GetError()
+		OOIException* m_pAsyncException;
+
+		AsyncLogWriter* m_pAsyncWriter;
 
 	private:
 		// Copy constructor
@@ -182,12 +237,34 @@ namespace logger {
 
 		// Reset the error field.
 		void clearError();
+		
+		// Hand an error from the writer thread to GetError()
+		void setAsyncError(OOIException *error);
+
+		// Set the log level and publish it to LOG()
+		void setLogLevel(TLogLevel level);
 
 		// Get / Create a ofstream object to write the log file.
 		ofstream* getLogStream();
+		
+		// Log file name, empty if not set.  Doesn't record an error.
+		string logFilename();
+		
+		// Close the log stream, the writer lock must be held if async
+		void closeStream();
 
 		// Return a formatted date/time string for the log message
 		string nowTime();
+		string nowTime(const struct timeval &tv);
+
+		// Format and write a single message to the log stream
+		void writeMessage(const struct timeval &time, TLogLevel level,
+		                  const char *file, int line,
+		                  const char *message, size_t length, bool flush);
+
+		// Sinks used by the async writer thread
+		static void WriteRecord(const LogRecord &record);
+		static void FlushStream();
 
 		// Return a formatted date for the log file name.
 		int fileDate();
@@ -197,8 +274,10 @@ namespace logger {
 
 
 
+// The first test is a constant, so statements above LOG_MIN_LEVEL are dropped
+// by the compiler.
 #define LOG(level) \
-    if (level > logger::Logger::GetLogLevel()) ; \
+    if (level > LOG_MIN_LEVEL || level > logger::Logger::ActiveLogLevel()) ; \
     else logger::Logger().get(level, __FILE__, __LINE__)
 
 #endif //__LOGGER_H__
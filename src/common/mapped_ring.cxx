@@ -0,0 +1,156 @@
+/*******************************************************************************
+ * Class: MappedRing
+ * Filename: mapped_ring.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * A ring of fixed size records in a memory mapped file.
+ *
+ ******************************************************************************/
+
+#include "mapped_ring.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace logger;
+
+/******************************************************************************
+ *   PUBLIC METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Constructor
+ ******************************************************************************/
+MappedRing::MappedRing() {
+    m_pHeader = NULL;
+    m_pRecords = NULL;
+    m_iRecordSize = 0;
+    m_iMapSize = 0;
+    m_iFD = -1;
+    m_bReused = false;
+}
+
+/******************************************************************************
+ * Method: Destructor
+ ******************************************************************************/
+MappedRing::~MappedRing() {
+    close();
+}
+
+/******************************************************************************
+ * Method: open
+ * Description: Create, size and map the file.  With keep, an existing file
+ * with the same size, magic, version and record layout is reused so the
+ * ring continues; otherwise the file starts over with an empty ring and a
+ * zeroed header.  Any open file is closed first.
+ * Parameters:
+ *   path - ring file
+ *   magic, version - identify the file format
+ *   headerSize - size of the caller's header, at least a MappedRingHeader
+ *   recordSize - size of a record, starting with its sequence
+ *   records - number of records in the ring
+ *   keep - reuse an existing ring
+ * Return:
+ *   false with errno set on failure
+ ******************************************************************************/
+bool MappedRing::open(const string &path, uint32_t magic, uint32_t version,
+                      size_t headerSize, size_t recordSize, size_t records,
+                      bool keep) {
+    struct stat st;
+    bool reuse = false;
+
+    close();
+
+    if(!records || headerSize < sizeof(MappedRingHeader) ||
+       recordSize < sizeof(uint64_t)) {
+        errno = EINVAL;
+        return false;
+    }
+
+    m_iRecordSize = recordSize;
+    m_iMapSize = headerSize + records * recordSize;
+
+    m_iFD = ::open(path.c_str(), O_RDWR | O_CREAT | (keep ? 0 : O_TRUNC), 0644);
+    if(m_iFD < 0)
+        return false;
+
+    if(keep && fstat(m_iFD, &st) == 0 && (size_t)st.st_size == m_iMapSize)
+        reuse = true;
+    else if(ftruncate(m_iFD, m_iMapSize)) {
+        int error = errno;
+        close();
+        errno = error;
+        return false;
+    }
+
+    void *map = mmap(NULL, m_iMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_iFD, 0);
+    if(map == MAP_FAILED) {
+        int error = errno;
+        close();
+        errno = error;
+        return false;
+    }
+
+    m_pHeader = (MappedRingHeader *)map;
+    m_pRecords = (char *)map + headerSize;
+
+    if(reuse && (m_pHeader->magic != magic ||
+                 m_pHeader->version != version ||
+                 m_pHeader->recordSize != recordSize ||
+                 m_pHeader->records != records))
+        reuse = false;
+
+    if(!reuse) {
+        memset(map, 0, m_iMapSize);
+        m_pHeader->magic = magic;
+        m_pHeader->version = version;
+        m_pHeader->recordSize = recordSize;
+        m_pHeader->records = records;
+        m_pHeader->head = 0;
+    }
+
+    m_bReused = reuse;
+    return true;
+}
+
+/******************************************************************************
+ * Method: close
+ * Description: Unmap and close the file.  The kernel writes the pages back.
+ ******************************************************************************/
+void MappedRing::close() {
+    if(m_pHeader)
+        munmap(m_pHeader, m_iMapSize);
+
+    if(m_iFD >= 0)
+        ::close(m_iFD);
+
+    m_pHeader = NULL;
+    m_pRecords = NULL;
+    m_iFD = -1;
+    m_bReused = false;
+}
+
+/******************************************************************************
+ * Method: record
+ * Description: Get a record by sequence number.
+ * Parameters:
+ *   sequence - sequence number, the first record written is 1
+ * Return:
+ *   pointer to the record, NULL if it has been overwritten or isn't written
+ ******************************************************************************/
+const void * MappedRing::record(uint64_t sequence) {
+    if(!m_pHeader || !sequence)
+        return NULL;
+
+    uint64_t *slot = (uint64_t *)slotAt(sequence);
+    if(__atomic_load_n(slot, __ATOMIC_ACQUIRE) != sequence)
+        return NULL;
+
+    return slot;
+}
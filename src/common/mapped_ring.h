@@ -0,0 +1,122 @@
+/*******************************************************************************
+ * Class: MappedRing
+ * Filename: mapped_ring.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * A ring of fixed size records in a memory mapped file, the storage behind
+ * the event log and the trace log.  The file starts with a header, which
+ * begins with a MappedRingHeader, followed by the records.  Every record
+ * begins with its uint64_t sequence number.
+ *
+ * A writer claims a slot by incrementing the header head, which clears the
+ * slot sequence, fills in the record, then commits it by storing the
+ * sequence.  Readers ignore slots whose sequence doesn't match the position
+ * they expect, so a record torn by a crash is skipped rather than misread.
+ * A record is valid when its sequence is non-zero; its position in the ring
+ * is (sequence - 1) % records.
+ *
+ * Usage:
+ *
+ *   struct MyHeader : public MappedRingHeader { ... };
+ *   struct MyRecord { uint64_t sequence; ... };
+ *
+ *   MappedRing ring;
+ *   if(!ring.open(path, MY_MAGIC, MY_VERSION, sizeof(MyHeader),
+ *                 sizeof(MyRecord), records, true))
+ *       throw MyOpenFailure(path + ": " + strerror(errno));
+ *
+ *   uint64_t sequence;
+ *   MyRecord *record = (MyRecord *)ring.claim(sequence);
+ *   ...
+ *   ring.commit(record, sequence);
+ *
+ ******************************************************************************/
+
+#ifndef __MAPPED_RING_H__
+#define __MAPPED_RING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+using namespace std;
+
+namespace logger {
+
+    struct MappedRingHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t recordSize;
+        uint32_t records;
+
+        // Number of records ever written, the next sequence number
+        uint64_t head;
+    };
+
+    class MappedRing {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            MappedRing();
+            ~MappedRing();
+
+            // Map the file, false with errno set on failure.  With keep, an
+            // existing file with the same layout continues where it left off.
+            bool open(const string &path, uint32_t magic, uint32_t version,
+                      size_t headerSize, size_t recordSize, size_t records,
+                      bool keep);
+
+            // Unmap and close the file
+            void close();
+
+            bool isOpen() { return m_pHeader != NULL; }
+
+            // True if open() continued an existing ring
+            bool reused() { return m_bReused; }
+
+            MappedRingHeader * header() { return m_pHeader; }
+
+            // Claim the next slot, returned with its sequence cleared
+            void * claim(uint64_t &sequence) {
+                sequence = __atomic_add_fetch(&m_pHeader->head, 1, __ATOMIC_RELAXED);
+                uint64_t *slot = (uint64_t *)slotAt(sequence);
+
+                __atomic_store_n(slot, 0, __ATOMIC_RELAXED);
+                __atomic_thread_fence(__ATOMIC_RELEASE);
+                return slot;
+            }
+
+            // Publish a claimed record
+            void commit(void *record, uint64_t sequence) {
+                __atomic_store_n((uint64_t *)record, sequence, __ATOMIC_RELEASE);
+            }
+
+            // Get a record by sequence, NULL if overwritten or not written
+            const void * record(uint64_t sequence);
+
+        private:
+            MappedRing(const MappedRing &);
+            MappedRing & operator=(const MappedRing &);
+
+            char * slotAt(uint64_t sequence) {
+                return m_pRecords + ((sequence - 1) % m_pHeader->records) * m_iRecordSize;
+            }
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            MappedRingHeader *m_pHeader;
+            char *m_pRecords;
+            size_t m_iRecordSize;
+            size_t m_iMapSize;
+            int m_iFD;
+            bool m_bReused;
+    };
+}
+
+#endif //__MAPPED_RING_H__
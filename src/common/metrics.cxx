@@ -0,0 +1,401 @@
+/*******************************************************************************
+ * Class: Counter, Histogram, Metrics
+ * Filename: metrics.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * In-process metrics for the port agent.
+ *
+ ******************************************************************************/
+
+#include "metrics.h"
+
+#include <ctype.h>
+#include <endian.h>
+#include <math.h>
+#include <sstream>
+
+using namespace std;
+using namespace metrics;
+
+// Registered metrics, see GetCounter(), GetGauge() and GetHistogram()
+CounterMap Metrics::m_oCounters;
+GaugeMap Metrics::m_oGauges;
+HistogramMap Metrics::m_oHistograms;
+
+// Percentiles reported in snapshots, with their JSON and Prometheus names
+static const struct {
+    double percent;
+    const char *name;
+    const char *quantile;
+} SNAPSHOT_PERCENTILES[] = {
+    { 50.0, "p50",  "0.5" },
+    { 90.0, "p90",  "0.9" },
+    { 99.0, "p99",  "0.99" },
+    { 99.9, "p999", "0.999" },
+};
+#define SNAPSHOT_PERCENTILE_COUNT \
+    (sizeof(SNAPSHOT_PERCENTILES) / sizeof(SNAPSHOT_PERCENTILES[0]))
+
+/******************************************************************************
+ *   HISTOGRAM
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Constructor
+ * Description: An empty histogram.
+ ******************************************************************************/
+Histogram::Histogram() {
+    reset();
+}
+
+/******************************************************************************
+ * Method: reset
+ * Description: Forget every recorded value.
+ ******************************************************************************/
+void Histogram::reset() {
+    for(uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+        __atomic_store_n(&m_iCounts[i], 0, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&m_iSum, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&m_iMax, 0, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************
+ * Method: count
+ * Description: Number of values recorded.
+ ******************************************************************************/
+uint64_t Histogram::count() const {
+    uint64_t total = 0;
+
+    for(uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+        total += bucketCount(i);
+
+    return total;
+}
+
+/******************************************************************************
+ * Method: mean
+ * Description: Average of the recorded values, 0 when empty.
+ ******************************************************************************/
+uint64_t Histogram::mean() const {
+    uint64_t total = count();
+    return total ? sum() / total : 0;
+}
+
+/******************************************************************************
+ * Method: percentile
+ * Description: Find the value that percent of the recorded values are at or
+ * below.  The answer is the top of the bucket it falls in, capped at the
+ * largest value recorded.
+ * Parameters:
+ *   percent - 0 to 100
+ * Return:
+ *   the value, 0 if nothing has been recorded
+ ******************************************************************************/
+uint64_t Histogram::percentile(double percent) const {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total = 0, target, seen = 0;
+
+    // Work from one copy so the answer is consistent with itself
+    for(uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        counts[i] = bucketCount(i);
+        total += counts[i];
+    }
+
+    if(! total)
+        return 0;
+
+    if(percent > 100.0)
+        percent = 100.0;
+
+    target = (uint64_t)ceil(total * percent / 100.0);
+    if(target < 1)
+        target = 1;
+
+    for(uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += counts[i];
+
+        if(seen >= target) {
+            uint64_t highest = BucketHighest(i);
+            return highest < max() ? highest : max();
+        }
+    }
+
+    return max();
+}
+
+/******************************************************************************
+ * Method: BucketIndex
+ * Description: The bucket a value is counted in.
+ ******************************************************************************/
+uint32_t Histogram::BucketIndex(uint64_t value) {
+    if(value < HISTOGRAM_SUB_BUCKETS)
+        return value;
+
+    uint32_t exponent = 63 - __builtin_clzll(value);
+    uint32_t shift = exponent - HISTOGRAM_SUB_BUCKET_BITS;
+
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS +
+           ((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+/******************************************************************************
+ * Method: BucketLowest
+ * Description: The smallest value counted in a bucket.
+ ******************************************************************************/
+uint64_t Histogram::BucketLowest(uint32_t index) {
+    if(index < HISTOGRAM_SUB_BUCKETS)
+        return index;
+
+    uint32_t shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t sub = index % HISTOGRAM_SUB_BUCKETS;
+
+    return (HISTOGRAM_SUB_BUCKETS + sub) << shift;
+}
+
+/******************************************************************************
+ * Method: BucketHighest
+ * Description: The largest value counted in a bucket.
+ ******************************************************************************/
+uint64_t Histogram::BucketHighest(uint32_t index) {
+    if(index < HISTOGRAM_SUB_BUCKETS)
+        return index;
+
+    uint32_t shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+
+    return BucketLowest(index) + ((1ULL << shift) - 1);
+}
+
+/******************************************************************************
+ *   METRICS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: GetCounter
+ * Description: Find a counter by name, creating it the first time.
+ * Return:
+ *   the counter, valid for the life of the process
+ ******************************************************************************/
+Counter * Metrics::GetCounter(const string &name) {
+    CounterMap::iterator i = m_oCounters.find(name);
+
+    if(i != m_oCounters.end())
+        return i->second;
+
+    Counter *counter = new Counter();
+    m_oCounters[name] = counter;
+    return counter;
+}
+
+/******************************************************************************
+ * Method: GetGauge
+ * Description: Find a gauge by name, creating it the first time.
+ * Return:
+ *   the gauge, valid for the life of the process
+ ******************************************************************************/
+Gauge * Metrics::GetGauge(const string &name) {
+    GaugeMap::iterator i = m_oGauges.find(name);
+
+    if(i != m_oGauges.end())
+        return i->second;
+
+    Gauge *gauge = new Gauge();
+    m_oGauges[name] = gauge;
+    return gauge;
+}
+
+/******************************************************************************
+ * Method: GetHistogram
+ * Description: Find a histogram by name, creating it the first time.
+ * Return:
+ *   the histogram, valid for the life of the process
+ ******************************************************************************/
+Histogram * Metrics::GetHistogram(const string &name) {
+    HistogramMap::iterator i = m_oHistograms.find(name);
+
+    if(i != m_oHistograms.end())
+        return i->second;
+
+    Histogram *histogram = new Histogram();
+    m_oHistograms[name] = histogram;
+    return histogram;
+}
+
+/******************************************************************************
+ * Method: Reset
+ * Description: Zero every registered metric.
+ ******************************************************************************/
+void Metrics::Reset() {
+    for(CounterMap::iterator i = m_oCounters.begin(); i != m_oCounters.end(); i++)
+        i->second->reset();
+
+    for(GaugeMap::iterator i = m_oGauges.begin(); i != m_oGauges.end(); i++)
+        i->second->reset();
+
+    for(HistogramMap::iterator i = m_oHistograms.begin(); i != m_oHistograms.end(); i++)
+        i->second->reset();
+}
+
+/******************************************************************************
+ * Method: Json
+ * Description: Every metric as one JSON object, grouped by type.  Metric
+ * names are plain identifiers so nothing needs escaping.
+ ******************************************************************************/
+string Metrics::Json() {
+    ostringstream out;
+    const char *separator = "";
+
+    out << "{\"counters\":{";
+    for(CounterMap::iterator i = m_oCounters.begin(); i != m_oCounters.end(); i++) {
+        out << separator << "\"" << i->first << "\":" << i->second->value();
+        separator = ",";
+    }
+
+    out << "},\"gauges\":{";
+    separator = "";
+    for(GaugeMap::iterator i = m_oGauges.begin(); i != m_oGauges.end(); i++) {
+        out << separator << "\"" << i->first << "\":" << i->second->value();
+        separator = ",";
+    }
+
+    out << "},\"histograms\":{";
+    separator = "";
+    for(HistogramMap::iterator i = m_oHistograms.begin(); i != m_oHistograms.end(); i++) {
+        Histogram *histogram = i->second;
+
+        out << separator << "\"" << i->first << "\":{"
+            << "\"count\":" << histogram->count()
+            << ",\"sum\":" << histogram->sum()
+            << ",\"max\":" << histogram->max();
+
+        for(size_t p = 0; p < SNAPSHOT_PERCENTILE_COUNT; p++)
+            out << ",\"" << SNAPSHOT_PERCENTILES[p].name << "\":"
+                << histogram->percentile(SNAPSHOT_PERCENTILES[p].percent);
+
+        out << "}";
+        separator = ",";
+    }
+
+    out << "}}";
+    return out.str();
+}
+
+/******************************************************************************
+ * Method: Prometheus
+ * Description: Every metric in the Prometheus text exposition format.
+ * Dotted names become underscored and get the prefix, counters get a
+ * _total suffix and histograms are exposed as summaries.
+ * Parameters:
+ *   prefix - prepended to every name, may be empty
+ ******************************************************************************/
+string Metrics::Prometheus(const string &prefix) {
+    ostringstream out;
+
+    for(CounterMap::iterator i = m_oCounters.begin(); i != m_oCounters.end(); i++) {
+        string name = PrometheusName(prefix, i->first) + "_total";
+        out << "# TYPE " << name << " counter" << endl
+            << name << " " << i->second->value() << endl;
+    }
+
+    for(GaugeMap::iterator i = m_oGauges.begin(); i != m_oGauges.end(); i++) {
+        string name = PrometheusName(prefix, i->first);
+        out << "# TYPE " << name << " gauge" << endl
+            << name << " " << i->second->value() << endl;
+    }
+
+    for(HistogramMap::iterator i = m_oHistograms.begin(); i != m_oHistograms.end(); i++) {
+        Histogram *histogram = i->second;
+        string name = PrometheusName(prefix, i->first);
+
+        out << "# TYPE " << name << " summary" << endl;
+
+        for(size_t p = 0; p < SNAPSHOT_PERCENTILE_COUNT; p++)
+            out << name << "{quantile=\"" << SNAPSHOT_PERCENTILES[p].quantile << "\"} "
+                << histogram->percentile(SNAPSHOT_PERCENTILES[p].percent) << endl;
+
+        out << name << "_sum " << histogram->sum() << endl
+            << name << "_count " << histogram->count() << endl;
+    }
+
+    return out.str();
+}
+
+/******************************************************************************
+ * Method: Binary
+ * Description: Every metric as a compact binary record, see metrics.h for
+ * the layout.
+ ******************************************************************************/
+string Metrics::Binary() {
+    string out;
+    uint16_t count = htobe16(m_oCounters.size() + m_oGauges.size() + m_oHistograms.size());
+
+    out.append((const char *)&count, sizeof(count));
+
+    for(CounterMap::iterator i = m_oCounters.begin(); i != m_oCounters.end(); i++) {
+        AppendName(out, METRIC_COUNTER, i->first);
+        AppendValue(out, i->second->value());
+    }
+
+    for(GaugeMap::iterator i = m_oGauges.begin(); i != m_oGauges.end(); i++) {
+        AppendName(out, METRIC_GAUGE, i->first);
+        AppendValue(out, i->second->value());
+    }
+
+    for(HistogramMap::iterator i = m_oHistograms.begin(); i != m_oHistograms.end(); i++) {
+        Histogram *histogram = i->second;
+
+        AppendName(out, METRIC_HISTOGRAM, i->first);
+        AppendValue(out, histogram->count());
+        AppendValue(out, histogram->sum());
+        AppendValue(out, histogram->max());
+
+        for(size_t p = 0; p < SNAPSHOT_PERCENTILE_COUNT; p++)
+            AppendValue(out, histogram->percentile(SNAPSHOT_PERCENTILES[p].percent));
+    }
+
+    return out;
+}
+
+/******************************************************************************
+ *   PRIVATE METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: PrometheusName
+ * Description: Prefix a metric name and replace anything Prometheus doesn't
+ * allow in a name with an underscore.
+ ******************************************************************************/
+string Metrics::PrometheusName(const string &prefix, const string &name) {
+    string result = prefix.length() ? prefix + "_" + name : name;
+
+    for(size_t i = 0; i < result.length(); i++) {
+        char c = result[i];
+        if(! isalnum(c) && c != '_' && c != ':')
+            result[i] = '_';
+    }
+
+    return result;
+}
+
+/******************************************************************************
+ * Method: AppendName
+ * Description: Start a binary metric record with its type and name.  Names
+ * longer than 255 bytes are truncated.
+ ******************************************************************************/
+void Metrics::AppendName(string &out, MetricType type, const string &name) {
+    uint8_t length = name.length() > 255 ? 255 : name.length();
+
+    out += (char)type;
+    out += (char)length;
+    out.append(name, 0, length);
+}
+
+/******************************************************************************
+ * Method: AppendValue
+ * Description: Append a big endian 64 bit value to a binary record.
+ ******************************************************************************/
+void Metrics::AppendValue(string &out, uint64_t value) {
+    uint64_t be = htobe64(value);
+    out.append((const char *)&be, sizeof(be));
+}
@@ -0,0 +1,220 @@
+/*******************************************************************************
+ * Class: Counter, Histogram, Metrics
+ * Filename: metrics.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * In-process metrics for the port agent.  Metrics are cheap enough to leave
+ * on in production: a counter update is one relaxed atomic add and a
+ * histogram record is a few shifts and two relaxed adds.  Nothing is
+ * formatted or locked when a metric is updated.
+ *
+ * Counters and histograms are updated by the event loop thread and may be
+ * read from any thread.  Relaxed atomics keep each value whole without
+ * ordering reads between metrics, so a snapshot of several metrics isn't
+ * taken at a single instant.
+ *
+ * Histograms are log-linear like HdrHistogram.  Values below
+ * HISTOGRAM_SUB_BUCKETS get a bucket each; above that each power of two is
+ * split into HISTOGRAM_SUB_BUCKETS linear buckets, so any recorded value is
+ * reported within 1/HISTOGRAM_SUB_BUCKETS (6.25%) of its true value.  The
+ * whole 64 bit range is covered, nothing is clipped.
+ *
+ * The registry owns every metric and never frees one, so callers look a
+ * metric up by name once and keep the pointer.  Lookups aren't thread safe
+ * and should be done from the event loop.
+ *
+ * Usage:
+ *
+ *   Counter *reads = Metrics::GetCounter("instrument.reads");
+ *   Histogram *latency = Metrics::GetHistogram("publisher.tcp.latency_us");
+ *
+ *   reads->add();
+ *   latency->record(elapsedMicroseconds);
+ *
+ *   uint64_t p99 = latency->percentile(99.0);
+ *
+ *   for(CounterMap::const_iterator i = Metrics::Counters().begin();
+ *       i != Metrics::Counters().end(); i++)
+ *       cout << i->first << " " << i->second->value() << endl;
+ *
+ *   // Queue depths and other levels are gauges, set when sampled
+ *   Metrics::GetGauge("subscription.pending_bytes")->set(hub.pending());
+ *
+ * Snapshots:
+ *
+ *   Every registered metric can be rendered at once as JSON, Prometheus text
+ *   or a compact binary record.  Histograms are summarized as count, sum,
+ *   max and the 50th, 90th, 99th and 99.9th percentiles.
+ *
+ *   The binary snapshot is big endian, like port agent packet headers:
+ *
+ *     uint16  number of metrics
+ *     each metric:
+ *       uint8   type, METRIC_COUNTER, METRIC_GAUGE or METRIC_HISTOGRAM
+ *       uint8   name length
+ *       char[]  name, not terminated
+ *       uint64  value for counters and gauges, or for histograms
+ *               count, sum, max, p50, p90, p99 and p999
+ *
+ ******************************************************************************/
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <stdint.h>
+#include <map>
+#include <string>
+
+#define HISTOGRAM_SUB_BUCKET_BITS 4
+#define HISTOGRAM_SUB_BUCKETS     (1 << HISTOGRAM_SUB_BUCKET_BITS)
+
+// The first HISTOGRAM_SUB_BUCKETS values each have a bucket, then
+// HISTOGRAM_SUB_BUCKETS for each power of two up to 2^63
+#define HISTOGRAM_BUCKETS \
+    ((64 - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+using namespace std;
+
+namespace metrics {
+
+    class Counter {
+        public:
+            Counter() : m_iValue(0) {}
+
+            void add(uint64_t count = 1) {
+                __atomic_fetch_add(&m_iValue, count, __ATOMIC_RELAXED);
+            }
+
+            uint64_t value() const {
+                return __atomic_load_n(&m_iValue, __ATOMIC_RELAXED);
+            }
+
+            void reset() { __atomic_store_n(&m_iValue, 0, __ATOMIC_RELAXED); }
+
+        private:
+            uint64_t m_iValue;
+    };
+
+    class Gauge {
+        public:
+            Gauge() : m_iValue(0) {}
+
+            void set(uint64_t value) {
+                __atomic_store_n(&m_iValue, value, __ATOMIC_RELAXED);
+            }
+
+            uint64_t value() const {
+                return __atomic_load_n(&m_iValue, __ATOMIC_RELAXED);
+            }
+
+            void reset() { set(0); }
+
+        private:
+            uint64_t m_iValue;
+    };
+
+    class Histogram {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            Histogram();
+
+            void record(uint64_t value) {
+                __atomic_fetch_add(&m_iCounts[BucketIndex(value)], 1, __ATOMIC_RELAXED);
+                __atomic_fetch_add(&m_iSum, value, __ATOMIC_RELAXED);
+
+                if(value > __atomic_load_n(&m_iMax, __ATOMIC_RELAXED))
+                    __atomic_store_n(&m_iMax, value, __ATOMIC_RELAXED);
+            }
+
+            void reset();
+
+            /* Accessors */
+            uint64_t count() const;
+            uint64_t sum() const { return __atomic_load_n(&m_iSum, __ATOMIC_RELAXED); }
+            uint64_t max() const { return __atomic_load_n(&m_iMax, __ATOMIC_RELAXED); }
+            uint64_t mean() const;
+
+            // Value that percent of the recorded values are at or below,
+            // reported as the top of its bucket.  0 when empty.
+            uint64_t percentile(double percent) const;
+
+            uint64_t bucketCount(uint32_t index) const {
+                return __atomic_load_n(&m_iCounts[index], __ATOMIC_RELAXED);
+            }
+
+            // Bucket layout
+            static uint32_t BucketIndex(uint64_t value);
+            static uint64_t BucketLowest(uint32_t index);
+            static uint64_t BucketHighest(uint32_t index);
+
+        private:
+            Histogram(const Histogram &);
+            Histogram & operator=(const Histogram &);
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            uint64_t m_iCounts[HISTOGRAM_BUCKETS];
+            uint64_t m_iSum;
+            uint64_t m_iMax;
+    };
+
+    typedef enum MetricType {
+        METRIC_COUNTER   = 0x01,
+        METRIC_GAUGE     = 0x02,
+        METRIC_HISTOGRAM = 0x03
+    } MetricType;
+
+    typedef map<string, Counter *> CounterMap;
+    typedef map<string, Gauge *> GaugeMap;
+    typedef map<string, Histogram *> HistogramMap;
+
+    class Metrics {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            // Find a metric by name, creating it the first time
+            static Counter * GetCounter(const string &name);
+            static Gauge * GetGauge(const string &name);
+            static Histogram * GetHistogram(const string &name);
+
+            // Every registered metric, in name order
+            static const CounterMap & Counters() { return m_oCounters; }
+            static const GaugeMap & Gauges() { return m_oGauges; }
+            static const HistogramMap & Histograms() { return m_oHistograms; }
+
+            // Zero every metric.  Registrations and pointers stay valid.
+            static void Reset();
+
+            // Snapshot of every metric
+            static string Json();
+            static string Prometheus(const string &prefix = "port_agent");
+            static string Binary();
+
+        private:
+            Metrics();
+
+            static string PrometheusName(const string &prefix, const string &name);
+            static void AppendName(string &out, MetricType type, const string &name);
+            static void AppendValue(string &out, uint64_t value);
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            static CounterMap m_oCounters;
+            static GaugeMap m_oGauges;
+            static HistogramMap m_oHistograms;
+    };
+}
+
+#endif //__METRICS_H__
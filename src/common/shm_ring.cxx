@@ -0,0 +1,444 @@
+/*******************************************************************************
+ * Class: ShmRing, ShmRingReader
+ * Filename: shm_ring.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * The writer is the only process that stores reserve and head, so it never
+ * needs an atomic read-modify-write for them.  Readers only ever store to
+ * the waiters count.
+ *
+ ******************************************************************************/
+
+#include "shm_ring.h"
+#include "logger.h"
+#include "exception.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+using namespace std;
+using namespace logger;
+
+// Records and payloads are 8 byte aligned
+#define SHM_ALIGN(size) (((uint64_t)(size) + 7) & ~(uint64_t)7)
+
+/******************************************************************************
+ *   ShmRing PUBLIC METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Constructor
+ ******************************************************************************/
+ShmRing::ShmRing() {
+    m_pHeader = NULL;
+    m_pData = NULL;
+    m_iMapSize = 0;
+}
+
+/******************************************************************************
+ * Method: Destructor
+ * Description: Unmap the ring.  The shared memory is left for readers.
+ ******************************************************************************/
+ShmRing::~ShmRing() {
+    close();
+}
+
+/******************************************************************************
+ * Method: open
+ * Description: Create and map the ring.  An existing ring with the same
+ * layout is reused so readers carry on where they are; otherwise the old
+ * ring is retired and replaced.  Any open ring is closed first.
+ * Parameters:
+ *   name - shared memory name, i.e. "/port_agent_4001"
+ *   size - bytes of record data, rounded up to a multiple of 8
+ * Exceptions:
+ *   ShmRingOpenFailure
+ ******************************************************************************/
+void ShmRing::open(const string &name, size_t size) {
+    struct stat st;
+    bool reuse = false;
+    uint32_t epoch = 0;
+    int fd;
+
+    close();
+    memset(&st, 0, sizeof(st));
+
+    size = SHM_ALIGN(size);
+    if(size < MIN_SHM_RING_SIZE || size > MAX_SHM_RING_SIZE)
+        throw ShmRingOpenFailure(name + ": size out of range");
+
+    if(name.length() < 2 || name[0] != '/' || name.find('/', 1) != string::npos)
+        throw ShmRingOpenFailure(name + ": invalid name");
+
+    size_t mapSize = sizeof(ShmRingHeader) + size;
+
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0660);
+    if(fd < 0)
+        throw ShmRingOpenFailure(name + ": " + strerror(errno));
+
+    // Look at what is already there
+    if(fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ShmRingHeader)) {
+        void *map = mmap(NULL, sizeof(ShmRingHeader), PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, 0);
+        if(map != MAP_FAILED) {
+            ShmRingHeader *old = (ShmRingHeader *)map;
+
+            if(old->magic == SHM_RING_MAGIC && old->version == SHM_RING_VERSION) {
+                epoch = old->epoch;
+
+                if(old->size == size && (size_t)st.st_size == mapSize)
+                    reuse = true;
+                else
+                    __atomic_store_n(&old->epoch, 0, __ATOMIC_RELEASE);
+            }
+
+            munmap(map, sizeof(ShmRingHeader));
+        }
+    }
+
+    // Readers of a retired ring keep their mapping, give them a new object
+    // rather than resizing the one they have.
+    if(!reuse && st.st_size) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+
+        fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0660);
+        if(fd < 0)
+            throw ShmRingOpenFailure(name + ": " + strerror(errno));
+    }
+
+    if(!reuse && ftruncate(fd, mapSize)) {
+        string error = strerror(errno);
+        ::close(fd);
+        throw ShmRingOpenFailure(name + ": " + error);
+    }
+
+    void *map = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if(map == MAP_FAILED)
+        throw ShmRingOpenFailure(name + ": " + strerror(errno));
+
+    m_pHeader = (ShmRingHeader *)map;
+    m_pData = (char *)map + sizeof(ShmRingHeader);
+    m_iMapSize = mapSize;
+    m_sName = name;
+
+    if(!reuse) {
+        memset(m_pHeader, 0, sizeof(ShmRingHeader));
+        m_pHeader->magic = SHM_RING_MAGIC;
+        m_pHeader->version = SHM_RING_VERSION;
+        m_pHeader->size = size;
+    }
+
+    // A write interrupted by a crash left reserve ahead of head.  Those
+    // bytes may be torn, so the records start again after them.
+    m_pHeader->head = m_pHeader->reserve;
+    m_pHeader->writerPid = getpid();
+
+    if(++epoch == 0)
+        epoch = 1;
+    __atomic_store_n(&m_pHeader->epoch, epoch, __ATOMIC_RELEASE);
+
+    LOG(DEBUG) << "shared memory ring " << name << " size " << size
+               << (reuse ? " reused" : " created") << " epoch " << epoch;
+}
+
+/******************************************************************************
+ * Method: close
+ * Description: Unmap the ring.
+ ******************************************************************************/
+void ShmRing::close() {
+    if(m_pHeader)
+        munmap(m_pHeader, m_iMapSize);
+
+    m_pHeader = NULL;
+    m_pData = NULL;
+    m_iMapSize = 0;
+}
+
+/******************************************************************************
+ * Method: write
+ * Description: Append one record.  Readers that haven't read the records
+ * this overwrites will see an overrun.
+ * Parameters:
+ *   buffer - record payload
+ *   size - bytes in buffer
+ * Return:
+ *   false if the ring isn't open or the record is larger than the ring
+ ******************************************************************************/
+bool ShmRing::write(const char *buffer, uint32_t size) {
+    if(!m_pHeader)
+        return false;
+
+    uint64_t ringSize = m_pHeader->size;
+    uint64_t total = sizeof(ShmRecord) + SHM_ALIGN(size);
+
+    if(total > ringSize) {
+        LOG(ERROR) << "record larger than shared memory ring, dropped: " << size;
+        return false;
+    }
+
+    uint64_t head = m_pHeader->head;
+    uint64_t offset = head % ringSize;
+    uint64_t gap = ringSize - offset < total ? ringSize - offset : 0;
+
+    // Claim the region before touching it
+    __atomic_store_n(&m_pHeader->reserve, head + gap + total, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if(gap) {
+        ShmRecord *pad = (ShmRecord *)(m_pData + offset);
+        pad->size = gap - sizeof(ShmRecord);
+        pad->flags = SHM_RECORD_PAD;
+        offset = 0;
+    }
+
+    ShmRecord *record = (ShmRecord *)(m_pData + offset);
+    record->size = size;
+    record->flags = 0;
+    memcpy(record + 1, buffer, size);
+
+    __atomic_store_n(&m_pHeader->head, head + gap + total, __ATOMIC_RELEASE);
+
+    wake();
+    return true;
+}
+
+/******************************************************************************
+ *   ShmRing PRIVATE METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: wake
+ * Description: Bump the notify word, and wake readers if any are blocked on
+ * it.  The bump and the waiters check are sequentially consistent with the
+ * reader's increment and wait, so a reader either sees the new head or its
+ * futex wait fails because notify changed.
+ ******************************************************************************/
+void ShmRing::wake() {
+    __atomic_add_fetch(&m_pHeader->notify, 1, __ATOMIC_SEQ_CST);
+
+    if(__atomic_load_n(&m_pHeader->waiters, __ATOMIC_SEQ_CST))
+        syscall(SYS_futex, &m_pHeader->notify, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/******************************************************************************
+ *   ShmRingReader PUBLIC METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Constructor
+ ******************************************************************************/
+ShmRingReader::ShmRingReader() {
+    m_pHeader = NULL;
+    m_pData = NULL;
+    m_iMapSize = 0;
+    m_iCursor = 0;
+    m_iEpoch = 0;
+    m_iOverruns = 0;
+}
+
+/******************************************************************************
+ * Method: Destructor
+ ******************************************************************************/
+ShmRingReader::~ShmRingReader() {
+    close();
+}
+
+/******************************************************************************
+ * Method: open
+ * Description: Map an existing ring.  Reading starts at the head, so only
+ * records written after the open are seen.  Any open ring is closed first.
+ * Parameters:
+ *   name - shared memory name the writer opened
+ * Exceptions:
+ *   ShmRingOpenFailure
+ ******************************************************************************/
+void ShmRingReader::open(const string &name) {
+    struct stat st;
+
+    close();
+
+    // Read-write so the reader can register as a waiter
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if(fd < 0)
+        throw ShmRingOpenFailure(name + ": " + strerror(errno));
+
+    if(fstat(fd, &st) || (size_t)st.st_size < sizeof(ShmRingHeader)) {
+        ::close(fd);
+        throw ShmRingOpenFailure(name + ": not a shared memory ring");
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if(map == MAP_FAILED)
+        throw ShmRingOpenFailure(name + ": " + strerror(errno));
+
+    ShmRingHeader *header = (ShmRingHeader *)map;
+    if(header->magic != SHM_RING_MAGIC || header->version != SHM_RING_VERSION ||
+       sizeof(ShmRingHeader) + header->size != (size_t)st.st_size) {
+        munmap(map, st.st_size);
+        throw ShmRingOpenFailure(name + ": not a shared memory ring");
+    }
+
+    m_pHeader = header;
+    m_pData = (char *)map + sizeof(ShmRingHeader);
+    m_iMapSize = st.st_size;
+    m_iEpoch = __atomic_load_n(&m_pHeader->epoch, __ATOMIC_ACQUIRE);
+
+    resync();
+}
+
+/******************************************************************************
+ * Method: close
+ * Description: Unmap the ring.
+ ******************************************************************************/
+void ShmRingReader::close() {
+    if(m_pHeader)
+        munmap(m_pHeader, m_iMapSize);
+
+    m_pHeader = NULL;
+    m_pData = NULL;
+    m_iMapSize = 0;
+}
+
+/******************************************************************************
+ * Method: available
+ * Description: Check for something to read without reading it.
+ * Return:
+ *   true if read would return something other than SHM_RING_EMPTY
+ ******************************************************************************/
+bool ShmRingReader::available() {
+    if(!m_pHeader)
+        return true;
+
+    return __atomic_load_n(&m_pHeader->epoch, __ATOMIC_ACQUIRE) != m_iEpoch ||
+           __atomic_load_n(&m_pHeader->head, __ATOMIC_ACQUIRE) != m_iCursor;
+}
+
+/******************************************************************************
+ * Method: read
+ * Description: Copy the record at the cursor and advance.  No system calls
+ * are made.
+ * Parameters:
+ *   buffer - destination for the payload
+ *   size - size of buffer
+ *   bytes - set to the number of bytes copied
+ * Return:
+ *   SHM_RING_OK or SHM_RING_TRUNCATED when a record was copied, otherwise
+ *   the reason nothing was.
+ ******************************************************************************/
+ShmRingStatus ShmRingReader::read(char *buffer, uint32_t size, uint32_t &bytes) {
+    bytes = 0;
+
+    if(!m_pHeader)
+        return SHM_RING_CLOSED;
+
+    uint32_t epoch = __atomic_load_n(&m_pHeader->epoch, __ATOMIC_ACQUIRE);
+    if(epoch == 0)
+        return SHM_RING_CLOSED;
+
+    if(epoch != m_iEpoch) {
+        m_iEpoch = epoch;
+        resync();
+        return SHM_RING_RESET;
+    }
+
+    uint64_t ringSize = m_pHeader->size;
+
+    while(true) {
+        uint64_t head = __atomic_load_n(&m_pHeader->head, __ATOMIC_ACQUIRE);
+        uint64_t offset = m_iCursor % ringSize;
+
+        if(head == m_iCursor)
+            return SHM_RING_EMPTY;
+
+        if(head - m_iCursor > ringSize)
+            break;
+
+        ShmRecord record = *(ShmRecord *)(m_pData + offset);
+        uint64_t total = sizeof(ShmRecord) + SHM_ALIGN(record.size);
+        bool pad = record.flags & SHM_RECORD_PAD;
+        uint32_t copy = 0;
+
+        // A torn header can hold anything, don't copy past what's written
+        if(total <= head - m_iCursor && offset + total <= ringSize && !pad) {
+            copy = record.size < size ? record.size : size;
+            memcpy(buffer, m_pData + offset + sizeof(ShmRecord), copy);
+        }
+
+        // Everything copied is only good if the writer hasn't claimed it
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint64_t reserve = __atomic_load_n(&m_pHeader->reserve, __ATOMIC_RELAXED);
+
+        if(reserve - m_iCursor > ringSize || total > head - m_iCursor ||
+           offset + total > ringSize)
+            break;
+
+        m_iCursor += total;
+        if(pad)
+            continue;
+
+        bytes = copy;
+        return record.size > size ? SHM_RING_TRUNCATED : SHM_RING_OK;
+    }
+
+    m_iOverruns++;
+    resync();
+    return SHM_RING_OVERRUN;
+}
+
+/******************************************************************************
+ * Method: wait
+ * Description: Block on the notify futex until the writer writes something.
+ * Parameters:
+ *   timeout - milliseconds, negative to wait forever
+ * Return:
+ *   true if something is available to read
+ ******************************************************************************/
+bool ShmRingReader::wait(int timeout) {
+    struct timespec ts;
+    struct timespec *pts = NULL;
+
+    if(!m_pHeader)
+        return false;
+
+    uint32_t notify = __atomic_load_n(&m_pHeader->notify, __ATOMIC_SEQ_CST);
+    if(available())
+        return true;
+
+    if(timeout >= 0) {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000;
+        pts = &ts;
+    }
+
+    __atomic_add_fetch(&m_pHeader->waiters, 1, __ATOMIC_SEQ_CST);
+    syscall(SYS_futex, &m_pHeader->notify, FUTEX_WAIT, notify, pts, NULL, 0);
+    __atomic_sub_fetch(&m_pHeader->waiters, 1, __ATOMIC_SEQ_CST);
+
+    return available();
+}
+
+/******************************************************************************
+ *   ShmRingReader PRIVATE METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: resync
+ * Description: Skip to the newest data.
+ ******************************************************************************/
+void ShmRingReader::resync() {
+    m_iCursor = __atomic_load_n(&m_pHeader->head, __ATOMIC_ACQUIRE);
+}
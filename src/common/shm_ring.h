@@ -0,0 +1,199 @@
+/*******************************************************************************
+ * Class: ShmRing, ShmRingReader
+ * Filename: shm_ring.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * A single writer, many reader ring of variable sized records in POSIX
+ * shared memory.  The port agent writes packets into the ring and any
+ * number of processes on the same host read them without a system call
+ * per packet and without the writer knowing who is reading.
+ *
+ * The writer never waits for readers.  Each reader keeps its own cursor
+ * and is told when it has been overrun; it is never handed a record that
+ * was overwritten while it was being copied.
+ *
+ * Protocol:
+ *
+ *   Positions are absolute byte counts; the byte at position p is stored
+ *   at p % size.  The header holds two positions that act as a seqlock:
+ *
+ *     reserve - end of the region the writer is about to fill
+ *     head    - end of the last complete record
+ *
+ *   The writer stores reserve, fills the records, then stores head.  A
+ *   reader copies the record at its cursor and then checks reserve; if the
+ *   writer has claimed the bytes it copied the record is discarded.
+ *
+ *   Records never wrap.  If a record doesn't fit before the end of the
+ *   ring a padding record fills the gap and the record starts at offset 0.
+ *
+ *   epoch is changed every time a writer opens the ring.  Readers resync
+ *   to the head when it changes.  A ring replaced by one with a different
+ *   layout has its epoch set to 0 and should be reopened.
+ *
+ *   Readers block on the notify word with a futex.  The writer only makes
+ *   the wake system call when a reader is waiting.
+ *
+ * Layout:
+ *
+ *   ShmRingHeader
+ *   data[size]   - ShmRecord followed by the payload, padded to 8 bytes
+ *
+ * Usage:
+ *
+ *   // Writer
+ *   ShmRing ring;
+ *   ring.open("/port_agent_4001", 4194304);
+ *   ring.write(packet->packet(), packet->packetSize());
+ *
+ *   // Reader
+ *   ShmRingReader reader;
+ *   reader.open("/port_agent_4001");
+ *
+ *   while(true) {
+ *       ShmRingStatus status = reader.read(buffer, sizeof(buffer), bytes);
+ *       if(status == SHM_RING_EMPTY)
+ *           reader.wait(1000);
+ *       else if(status == SHM_RING_OK)
+ *           process(buffer, bytes);
+ *       else if(status == SHM_RING_CLOSED)
+ *           reader.open("/port_agent_4001");
+ *   }
+ *
+ * Exceptions:
+ *
+ * ShmRingOpenFailure - when the shared memory can't be created or mapped
+ *
+ ******************************************************************************/
+
+#ifndef __SHM_RING_H__
+#define __SHM_RING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#define SHM_RING_MAGIC           0x474e5253  // "SRNG"
+#define SHM_RING_VERSION         1
+
+#define DEFAULT_SHM_RING_SIZE    4194304
+#define MIN_SHM_RING_SIZE        65536
+#define MAX_SHM_RING_SIZE        1073741824
+
+// Record flags
+#define SHM_RECORD_PAD           0x01
+
+using namespace std;
+
+// 64 bytes, shared with readers
+struct ShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+
+    // Bytes of record data following the header
+    uint64_t size;
+
+    // Seqlock positions, reserve is stored before the data and head after
+    uint64_t reserve;
+    uint64_t head;
+
+    // Changed each time a writer opens the ring, 0 when it was replaced
+    uint32_t epoch;
+
+    // Futex word bumped on every write, and the readers blocked on it
+    uint32_t notify;
+    uint32_t waiters;
+
+    uint32_t writerPid;
+    uint64_t reserved[2];
+};
+
+// Precedes each payload, size excludes this header and the padding
+struct ShmRecord {
+    uint32_t size;
+    uint32_t flags;
+};
+
+typedef enum ShmRingStatus {
+    // a record was read
+    SHM_RING_OK,
+    // nothing new
+    SHM_RING_EMPTY,
+    // records were overwritten before they were read, the cursor moved
+    // to the head
+    SHM_RING_OVERRUN,
+    // the record was larger than the buffer, the buffer holds the start
+    SHM_RING_TRUNCATED,
+    // the writer restarted, the cursor moved to the head
+    SHM_RING_RESET,
+    // the ring was replaced or isn't open, reopen it
+    SHM_RING_CLOSED
+} ShmRingStatus;
+
+class ShmRing {
+    public:
+        ShmRing();
+        virtual ~ShmRing();
+
+        void open(const string &name, size_t size);
+        void close();
+
+        bool isOpen() { return m_pHeader != NULL; }
+        const string & name() { return m_sName; }
+        size_t size() { return m_pHeader ? m_pHeader->size : 0; }
+
+        const ShmRingHeader * header() { return m_pHeader; }
+
+        // Append one record and wake waiting readers
+        bool write(const char *buffer, uint32_t size);
+
+    private:
+        ShmRing(const ShmRing &rhs);
+        ShmRing & operator=(const ShmRing &rhs);
+
+        void wake();
+
+        ShmRingHeader *m_pHeader;
+        char *m_pData;
+        size_t m_iMapSize;
+        string m_sName;
+};
+
+class ShmRingReader {
+    public:
+        ShmRingReader();
+        virtual ~ShmRingReader();
+
+        void open(const string &name);
+        void close();
+
+        bool isOpen() { return m_pHeader != NULL; }
+        bool available();
+
+        // Copy the next record into buffer
+        ShmRingStatus read(char *buffer, uint32_t size, uint32_t &bytes);
+
+        // Block until data is available or timeout milliseconds pass.
+        // A negative timeout waits forever.
+        bool wait(int timeout);
+
+        // Times the reader has been overrun
+        uint64_t overruns() { return m_iOverruns; }
+
+    private:
+        ShmRingReader(const ShmRingReader &rhs);
+        ShmRingReader & operator=(const ShmRingReader &rhs);
+
+        void resync();
+
+        ShmRingHeader *m_pHeader;
+        char *m_pData;
+        size_t m_iMapSize;
+
+        uint64_t m_iCursor;
+        uint32_t m_iEpoch;
+        uint64_t m_iOverruns;
+};
+
+#endif //__SHM_RING_H__
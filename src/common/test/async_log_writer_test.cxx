@@ -0,0 +1,198 @@
+/*******************************************************************************
+ * Filename: async_log_writer_test.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Test the async log writer ring and the logger async mode.
+ ******************************************************************************/
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/async_log_writer.h"
+#include "common/util.h"
+#include "gmock/gmock.h"
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <string.h>
+#include <pthread.h>
+
+using namespace std;
+using namespace logger;
+
+#define LOGFILE "/tmp/gtest_async_logger.log"
+
+#define PRODUCERS 4
+#define PRODUCER_RECORDS 1000
+
+// Records seen by the test sink
+static size_t g_iRecordCount = 0;
+static size_t g_iInfoCount = 0;
+static size_t g_iFlushCount = 0;
+static string g_sLastMessage;
+
+static void countRecord(const LogRecord &record) {
+    g_iRecordCount++;
+    if(record.level == INFO)
+        g_iInfoCount++;
+    g_sLastMessage = string(record.message, record.messageLength);
+}
+
+static void countFlush() {
+    g_iFlushCount++;
+}
+
+static void* produce(void *arg) {
+    AsyncLogWriter *writer = (AsyncLogWriter *)arg;
+
+    for(int i = 0; i < PRODUCER_RECORDS; i++) {
+        // Spin until there is room, we want every record to arrive.
+        while(!writer->push(INFO, __FILE__, strlen(__FILE__), __LINE__, "message", 7))
+            ;
+    }
+
+    return NULL;
+}
+
+class AsyncLogWriterTest : public testing::Test {
+
+    protected:
+        virtual void SetUp() {
+            g_iRecordCount = 0;
+            g_iInfoCount = 0;
+            g_iFlushCount = 0;
+            g_sLastMessage = "";
+            Logger::Reset();
+        }
+
+        virtual void TearDown() {
+            Logger::Reset();
+            remove_file(LOGFILE);
+        }
+};
+
+/* Test push and drain without the writer thread */
+TEST_F(AsyncLogWriterTest, PushDrain) {
+    AsyncLogWriter writer(3, countRecord, countFlush);
+
+    // Capacity is rounded to a power of 2
+    EXPECT_EQ(writer.capacity(), 4);
+
+    EXPECT_TRUE(writer.push(INFO, "file", 4, 1, "one", 3));
+    EXPECT_TRUE(writer.push(INFO, "file", 4, 2, "two", 3));
+
+    EXPECT_EQ(writer.drain(), 2);
+    EXPECT_EQ(g_iRecordCount, 2);
+    EXPECT_EQ(g_iFlushCount, 1);
+    EXPECT_EQ(g_sLastMessage, "two");
+
+    // Nothing left, no flush
+    EXPECT_EQ(writer.drain(), 0);
+    EXPECT_EQ(g_iFlushCount, 1);
+}
+
+/* Test a full ring drops records and reports them */
+TEST_F(AsyncLogWriterTest, Overflow) {
+    AsyncLogWriter writer(4, countRecord, countFlush);
+
+    for(int i = 0; i < 4; i++)
+        EXPECT_TRUE(writer.push(INFO, "file", 4, i, "full", 4));
+
+    EXPECT_FALSE(writer.push(INFO, "file", 4, 5, "dropped", 7));
+    EXPECT_EQ(writer.dropped(), 1);
+
+    // Four records plus the drop notice
+    EXPECT_EQ(writer.drain(), 5);
+
+    // The ring wraps
+    EXPECT_TRUE(writer.push(INFO, "file", 4, 6, "again", 5));
+    EXPECT_EQ(writer.drain(), 1);
+    EXPECT_EQ(g_sLastMessage, "again");
+}
+
+/* Test long messages are truncated */
+TEST_F(AsyncLogWriterTest, Truncate) {
+    AsyncLogWriter writer(4, countRecord, NULL);
+    string longMessage(LOG_RECORD_MESSAGE_SIZE + 10, 'x');
+
+    EXPECT_TRUE(writer.push(INFO, "file", 4, 1, longMessage.c_str(), longMessage.length()));
+    EXPECT_EQ(writer.drain(), 1);
+    EXPECT_EQ(g_sLastMessage.length(), LOG_RECORD_MESSAGE_SIZE);
+}
+
+/* Test many producers with the writer thread running */
+TEST_F(AsyncLogWriterTest, Threaded) {
+    AsyncLogWriter writer(64, countRecord, countFlush);
+    pthread_t threads[PRODUCERS];
+
+    writer.start();
+    EXPECT_TRUE(writer.running());
+
+    for(int i = 0; i < PRODUCERS; i++)
+        pthread_create(&threads[i], NULL, produce, &writer);
+
+    for(int i = 0; i < PRODUCERS; i++)
+        pthread_join(threads[i], NULL);
+
+    writer.stop();
+    EXPECT_FALSE(writer.running());
+
+    // Producers retry when the ring is full so drop notices may be mixed in
+    EXPECT_EQ(g_iInfoCount, PRODUCERS * PRODUCER_RECORDS);
+}
+
+/* Test the logger writes through the async writer */
+TEST_F(AsyncLogWriterTest, LoggerAsync) {
+    string line;
+    int count = 0;
+
+    Logger::SetLogFile(LOGFILE);
+    Logger::SetLogLevel("DEBUG");
+
+    EXPECT_FALSE(Logger::IsAsync());
+    Logger::StartAsync(16);
+    EXPECT_TRUE(Logger::IsAsync());
+
+    LOG(ERROR) << "async message one";
+    LOG(DEBUG) << "async message two";
+    Logger::Flush();
+
+    ifstream infile(LOGFILE);
+    while(getline(infile, line)) {
+        count++;
+        if(count == 1)
+            EXPECT_NE(line.find("ERROR: async message one"), string::npos);
+        if(count == 2)
+            EXPECT_NE(line.find("DEBUG: async message two"), string::npos);
+    }
+    EXPECT_EQ(count, 2);
+
+    Logger::StopAsync();
+    EXPECT_FALSE(Logger::IsAsync());
+}
+
+/* Writer thread errors are handed to GetError on the caller's thread */
+TEST_F(AsyncLogWriterTest, LoggerAsyncError) {
+    Logger::SetLogFile("/tmp");
+    Logger::StartAsync(16);
+
+    LOG(ERROR) << "can't be written";
+    Logger::Flush();
+
+    OOIException *error = Logger::GetError();
+    ASSERT_TRUE(error);
+    EXPECT_EQ(error->errcode(), 203);
+
+    // Logging from the writer thread doesn't free an error we hold
+    Logger::SetLogFile(LOGFILE);
+    for(int i = 0; i < 100; i++)
+        LOG(ERROR) << "async message " << i;
+    Logger::Flush();
+
+    EXPECT_EQ(Logger::GetError(), error);
+    EXPECT_EQ(error->errcode(), 203);
+
+    Logger::StopAsync();
+}
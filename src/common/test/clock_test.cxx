@@ -0,0 +1,67 @@
+/*******************************************************************************
+ * Filename: clock_test.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Test the high resolution and cached coarse clocks.
+ ******************************************************************************/
+
+#include "common/clock.h"
+#include "gmock/gmock.h"
+
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+
+class ClockTest : public testing::Test {
+
+    protected:
+        virtual void SetUp() {
+            Clock::Reset();
+        }
+
+        virtual void TearDown() {
+            Clock::Reset();
+        }
+};
+
+/* Test the high resolution clock is the wall clock */
+TEST_F(ClockTest, Now) {
+    struct timespec now;
+    time_t before = time(NULL);
+
+    Clock::Now(now);
+
+    EXPECT_GE(now.tv_sec, before);
+    EXPECT_LE(now.tv_sec, time(NULL));
+    EXPECT_LT(now.tv_nsec, NANOSECONDS_PER_SECOND);
+}
+
+/* Test the coarse clock holds the time of the last tick */
+TEST_F(ClockTest, Coarse) {
+    struct timespec first, second;
+    struct timeval tv;
+
+    // Without a tick we read the kernel coarse clock
+    EXPECT_LE(abs(Clock::CoarseSeconds() - time(NULL)), 1);
+
+    Clock::Tick();
+    Clock::Coarse(first);
+    usleep(20000);
+    Clock::Coarse(second);
+
+    EXPECT_EQ(first.tv_sec, second.tv_sec);
+    EXPECT_EQ(first.tv_nsec, second.tv_nsec);
+    EXPECT_EQ(Clock::CoarseSeconds(), first.tv_sec);
+
+    Clock::Coarse(tv);
+    EXPECT_EQ(tv.tv_sec, first.tv_sec);
+    EXPECT_EQ(tv.tv_usec, first.tv_nsec / 1000);
+
+    // The next tick moves it on
+    Clock::Tick();
+    Clock::Coarse(second);
+    EXPECT_GT((second.tv_sec - first.tv_sec) * 1000000000LL + (second.tv_nsec - first.tv_nsec),
+              10000000LL);
+}
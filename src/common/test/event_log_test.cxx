@@ -0,0 +1,116 @@
+/*******************************************************************************
+ * Filename: event_log_test.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Test the binary event log.
+ ******************************************************************************/
+
+#include "common/exception.h"
+#include "common/event_log.h"
+#include "common/util.h"
+#include "gmock/gmock.h"
+
+#include <string>
+#include <string.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace logger;
+
+#define EVENTFILE "/tmp/gtest_event_log.events"
+
+enum { EVENT_ONE = 1, EVENT_TWO = 2 };
+
+static const EventMessage testMessages[] = {
+    { EVENT_ONE, "event one" },
+    { EVENT_TWO, "event two %d %d" },
+};
+
+class EventLogTest : public testing::Test {
+
+    protected:
+        virtual void SetUp() {
+            remove_file(EVENTFILE);
+            EventLog::SetLevel(INFO);
+        }
+
+        virtual void TearDown() {
+            EventLog::Close();
+            remove_file(EVENTFILE);
+        }
+};
+
+/* Test the file layout and message formats */
+TEST_F(EventLogTest, Open) {
+    struct stat st;
+
+    EXPECT_FALSE(EventLog::IsOpen());
+    EventLog::Open(EVENTFILE, testMessages, 2, 8);
+    EXPECT_TRUE(EventLog::IsOpen());
+
+    ASSERT_TRUE(EventLog::Header());
+    EXPECT_EQ(sizeof(EventRecord), 64);
+    EXPECT_EQ(EventLog::Header()->magic, EVENT_LOG_MAGIC);
+    EXPECT_EQ(EventLog::Header()->records, 8);
+    EXPECT_EQ(EventLog::Header()->head, 0);
+    EXPECT_STREQ(EventLog::Header()->formats[EVENT_TWO], "event two %d %d");
+    EXPECT_STREQ(EventLog::Header()->formats[0], "");
+
+    ASSERT_EQ(stat(EVENTFILE, &st), 0);
+    EXPECT_EQ(st.st_size, sizeof(EventLogHeader) + 8 * sizeof(EventRecord));
+
+    EXPECT_THROW(EventLog::Open("/tmp", testMessages, 2, 8), EventLogOpenFailure);
+    EXPECT_FALSE(EventLog::IsOpen());
+}
+
+/* Test writing, level filtering and ring wrap */
+TEST_F(EventLogTest, Write) {
+    const EventRecord *record;
+
+    // Not open, nothing happens
+    EventLog::Write(INFO, EVENT_ONE);
+
+    EventLog::Open(EVENTFILE, testMessages, 2, 4);
+
+    EventLog::Write(INFO, EVENT_TWO, 10, 20);
+    EventLog::Write(DEBUG, EVENT_ONE);
+    EXPECT_EQ(EventLog::Header()->head, 1);
+
+    record = EventLog::Record(1);
+    ASSERT_TRUE(record);
+    EXPECT_EQ(record->level, INFO);
+    EXPECT_EQ(record->id, EVENT_TWO);
+    EXPECT_EQ(record->args[0], 10);
+    EXPECT_EQ(record->args[1], 20);
+    EXPECT_GT(record->seconds, 0);
+
+    EventLog::SetLevel(DEBUG);
+    for(int i = 0; i < 4; i++)
+        EventLog::Write(DEBUG, EVENT_ONE, i);
+
+    // Record 1 was overwritten by record 5
+    EXPECT_EQ(EventLog::Header()->head, 5);
+    EXPECT_FALSE(EventLog::Record(1));
+    ASSERT_TRUE(EventLog::Record(5));
+    EXPECT_EQ(EventLog::Record(5)->args[0], 3);
+    EXPECT_FALSE(EventLog::Record(6));
+}
+
+/* Test reopening continues the ring */
+TEST_F(EventLogTest, Reopen) {
+    EventLog::Open(EVENTFILE, testMessages, 2, 4);
+    EventLog::Write(ERROR, EVENT_ONE);
+    EventLog::Write(ERROR, EVENT_ONE);
+    EventLog::Close();
+
+    EventLog::Open(EVENTFILE, testMessages, 1, 4);
+    EXPECT_EQ(EventLog::Header()->head, 2);
+    EXPECT_TRUE(EventLog::Record(2));
+    EXPECT_STREQ(EventLog::Header()->formats[EVENT_TWO], "");
+    EventLog::Close();
+
+    // A different layout starts over
+    EventLog::Open(EVENTFILE, testMessages, 2, 8);
+    EXPECT_EQ(EventLog::Header()->head, 0);
+}
@@ -268,3 +268,46 @@ TEST_F(LoggerTest, DerivedLogFileTest) {
 
 
 
+
+// count how many times a log statement was evaluated
+static int logArgument(int &count) {
+    return ++count;
+}
+
+// test the level read by LOG() follows the singleton
+TEST_F(LoggerTest, ActiveLogLevelTest) {
+    EXPECT_EQ(Logger::ActiveLogLevel(), DEFAULT_LOG_LEVEL);
+    
+    Logger::SetLogLevel("DEBUG2");
+    EXPECT_EQ(Logger::ActiveLogLevel(), DEBUG2);
+    
+    Logger::DecreaseLogLevel(2);
+    EXPECT_EQ(Logger::ActiveLogLevel(), DEBUG);
+    
+    Logger::IncreaseLogLevel(20);
+    EXPECT_EQ(Logger::ActiveLogLevel(), MESG);
+    
+    Logger::Reset();
+    EXPECT_EQ(Logger::ActiveLogLevel(), DEFAULT_LOG_LEVEL);
+}
+
+// test statements above the compiled log level are never evaluated
+TEST_F(LoggerTest, CompiledLogLevelTest) {
+    int count = 0;
+    
+    Logger::SetLogFile(LOGFILE);
+    Logger::SetLogLevel("MESG");
+    
+#undef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL logger::INFO
+    LOG(INFO) << logArgument(count);
+    LOG(DEBUG) << logArgument(count);
+    LOG(MESG) << logArgument(count);
+#undef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL logger::MESG
+
+    EXPECT_EQ(count, 1);
+    
+    LOG(MESG) << logArgument(count);
+    EXPECT_EQ(count, 2);
+}
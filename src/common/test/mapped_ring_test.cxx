@@ -0,0 +1,108 @@
+/*******************************************************************************
+ * Filename: mapped_ring_test.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Test the memory mapped record ring shared by the event and trace logs.
+ ******************************************************************************/
+
+#include "common/mapped_ring.h"
+#include "common/util.h"
+#include "gmock/gmock.h"
+
+#include <string>
+
+using namespace std;
+using namespace logger;
+
+#define RINGFILE "/tmp/gtest_mapped_ring.ring"
+#define RING_MAGIC 0x474e4952
+
+struct TestHeader : public MappedRingHeader {
+    uint64_t extra;
+};
+
+struct TestRecord {
+    uint64_t sequence;
+    uint64_t value;
+};
+
+class MappedRingTest : public testing::Test {
+
+    protected:
+        virtual void SetUp() {
+            remove_file(RINGFILE);
+        }
+
+        virtual void TearDown() {
+            remove_file(RINGFILE);
+        }
+
+        bool open(MappedRing &ring, size_t records, bool keep) {
+            return ring.open(RINGFILE, RING_MAGIC, 1, sizeof(TestHeader),
+                             sizeof(TestRecord), records, keep);
+        }
+
+        void write(MappedRing &ring, uint64_t value) {
+            uint64_t sequence;
+            TestRecord *record = (TestRecord *)ring.claim(sequence);
+            record->value = value;
+            ring.commit(record, sequence);
+        }
+};
+
+/* Records wrap and overwritten or torn slots read as missing */
+TEST_F(MappedRingTest, Records) {
+    MappedRing ring;
+    uint64_t sequence;
+
+    ASSERT_TRUE(open(ring, 4, false));
+    EXPECT_FALSE(ring.reused());
+    EXPECT_EQ(ring.header()->magic, RING_MAGIC);
+    EXPECT_EQ(ring.header()->records, 4);
+    EXPECT_EQ(ring.record(1), (const void *)NULL);
+
+    for(uint64_t i = 1; i <= 5; i++)
+        write(ring, i * 10);
+
+    EXPECT_EQ(ring.header()->head, 5);
+    EXPECT_EQ(ring.record(1), (const void *)NULL);
+    ASSERT_TRUE(ring.record(5));
+    EXPECT_EQ(((const TestRecord *)ring.record(5))->value, 50);
+    EXPECT_EQ(((const TestRecord *)ring.record(2))->value, 20);
+
+    // Claimed but not committed
+    ring.claim(sequence);
+    EXPECT_EQ(sequence, 6);
+    EXPECT_EQ(ring.record(6), (const void *)NULL);
+    EXPECT_EQ(ring.record(2), (const void *)NULL);
+}
+
+/* keep continues a ring with the same layout, otherwise it starts over */
+TEST_F(MappedRingTest, Reopen) {
+    MappedRing ring;
+
+    ASSERT_TRUE(open(ring, 4, true));
+    write(ring, 1);
+    ((TestHeader *)ring.header())->extra = 7;
+    ring.close();
+    EXPECT_FALSE(ring.isOpen());
+
+    ASSERT_TRUE(open(ring, 4, true));
+    EXPECT_TRUE(ring.reused());
+    EXPECT_EQ(ring.header()->head, 1);
+    EXPECT_EQ(((TestHeader *)ring.header())->extra, 7);
+
+    ASSERT_TRUE(open(ring, 8, true));
+    EXPECT_FALSE(ring.reused());
+    EXPECT_EQ(ring.header()->head, 0);
+
+    write(ring, 1);
+    ASSERT_TRUE(open(ring, 8, false));
+    EXPECT_FALSE(ring.reused());
+    EXPECT_EQ(ring.header()->head, 0);
+
+    EXPECT_FALSE(ring.open("/tmp", RING_MAGIC, 1, sizeof(TestHeader),
+                           sizeof(TestRecord), 4, true));
+    EXPECT_FALSE(ring.isOpen());
+}
@@ -0,0 +1,168 @@
+/*******************************************************************************
+ * Filename: metrics_test.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Test the metrics registry, counters and histograms.
+ ******************************************************************************/
+
+#include "common/metrics.h"
+#include "gmock/gmock.h"
+
+#include <endian.h>
+#include <string.h>
+
+using namespace std;
+using namespace metrics;
+
+/* Counters are found by name and keep their value */
+TEST(MetricsTest, Counter) {
+    Counter *reads = Metrics::GetCounter("test.reads");
+
+    EXPECT_EQ(reads->value(), 0);
+    reads->add();
+    reads->add(10);
+    EXPECT_EQ(reads->value(), 11);
+
+    EXPECT_EQ(Metrics::GetCounter("test.reads"), reads);
+    EXPECT_NE(Metrics::GetCounter("test.writes"), reads);
+    EXPECT_EQ(Metrics::Counters().count("test.reads"), 1);
+
+    Metrics::Reset();
+    EXPECT_EQ(reads->value(), 0);
+    EXPECT_EQ(Metrics::GetCounter("test.reads"), reads);
+}
+
+/* Gauges hold the last value set */
+TEST(MetricsTest, Gauge) {
+    Gauge *depth = Metrics::GetGauge("test.depth");
+
+    depth->set(10);
+    depth->set(4);
+    EXPECT_EQ(depth->value(), 4);
+    EXPECT_EQ(Metrics::GetGauge("test.depth"), depth);
+
+    Metrics::Reset();
+    EXPECT_EQ(depth->value(), 0);
+}
+
+/* Every value falls in a bucket that holds it and buckets don't overlap */
+TEST(MetricsTest, BucketLayout) {
+    uint64_t values[] = { 0, 1, 15, 16, 17, 31, 32, 33, 1000, 1023, 1024,
+                          123456789, 0x8000000000000000ULL, 0xffffffffffffffffULL };
+
+    for(size_t i = 0; i < sizeof(values) / sizeof(uint64_t); i++) {
+        uint32_t index = Histogram::BucketIndex(values[i]);
+        ASSERT_LT(index, HISTOGRAM_BUCKETS);
+        EXPECT_LE(Histogram::BucketLowest(index), values[i]);
+        EXPECT_GE(Histogram::BucketHighest(index), values[i]);
+    }
+
+    for(uint32_t index = 1; index < HISTOGRAM_BUCKETS; index++)
+        ASSERT_EQ(Histogram::BucketLowest(index), Histogram::BucketHighest(index - 1) + 1);
+
+    EXPECT_EQ(Histogram::BucketHighest(HISTOGRAM_BUCKETS - 1), 0xffffffffffffffffULL);
+
+    // Small values are exact, larger ones within 1/16
+    EXPECT_EQ(Histogram::BucketHighest(Histogram::BucketIndex(7)), 7);
+    uint32_t index = Histogram::BucketIndex(1000000);
+    EXPECT_LE(Histogram::BucketHighest(index) - Histogram::BucketLowest(index),
+              1000000 / HISTOGRAM_SUB_BUCKETS);
+}
+
+/* Percentiles, mean and max */
+TEST(MetricsTest, Histogram) {
+    Histogram *latency = Metrics::GetHistogram("test.latency_us");
+
+    EXPECT_EQ(latency->count(), 0);
+    EXPECT_EQ(latency->percentile(50), 0);
+
+    for(uint64_t value = 1; value <= 1000; value++)
+        latency->record(value);
+
+    EXPECT_EQ(latency->count(), 1000);
+    EXPECT_EQ(latency->sum(), 500500);
+    EXPECT_EQ(latency->mean(), 500);
+    EXPECT_EQ(latency->max(), 1000);
+
+    EXPECT_NEAR(latency->percentile(50), 500, 500 / HISTOGRAM_SUB_BUCKETS);
+    EXPECT_NEAR(latency->percentile(99), 990, 990 / HISTOGRAM_SUB_BUCKETS);
+    EXPECT_EQ(latency->percentile(100), 1000);
+    EXPECT_EQ(latency->percentile(0), 1);
+
+    // One slow value shows up in the tail only
+    latency->record(1000000);
+    EXPECT_LT(latency->percentile(99.9), 1100);
+    EXPECT_EQ(latency->percentile(100), 1000000);
+
+    EXPECT_EQ(Metrics::GetHistogram("test.latency_us"), latency);
+    Metrics::Reset();
+    EXPECT_EQ(latency->count(), 0);
+    EXPECT_EQ(latency->max(), 0);
+}
+
+/* Every metric shows up in each snapshot format */
+TEST(MetricsTest, Snapshots) {
+    Metrics::Reset();
+    Metrics::GetCounter("snap.reads")->add(3);
+    Metrics::GetGauge("snap.depth")->set(7);
+    Metrics::GetHistogram("snap.latency_us")->record(100);
+
+    string json = Metrics::Json();
+    EXPECT_THAT(json, testing::HasSubstr("\"snap.reads\":3"));
+    EXPECT_THAT(json, testing::HasSubstr("\"snap.depth\":7"));
+    EXPECT_THAT(json, testing::HasSubstr(
+        "\"snap.latency_us\":{\"count\":1,\"sum\":100,\"max\":100,"
+        "\"p50\":100,\"p90\":100,\"p99\":100,\"p999\":100}"));
+    EXPECT_EQ(json[0], '{');
+    EXPECT_EQ(json[json.length() - 1], '}');
+
+    string text = Metrics::Prometheus();
+    EXPECT_THAT(text, testing::HasSubstr("# TYPE port_agent_snap_reads_total counter\n"
+                                         "port_agent_snap_reads_total 3\n"));
+    EXPECT_THAT(text, testing::HasSubstr("port_agent_snap_depth 7\n"));
+    EXPECT_THAT(text, testing::HasSubstr("port_agent_snap_latency_us{quantile=\"0.99\"} 100\n"));
+    EXPECT_THAT(text, testing::HasSubstr("port_agent_snap_latency_us_count 1\n"));
+
+    // Walk the binary records looking for ours
+    string binary = Metrics::Binary();
+    const char *p = binary.data();
+    uint16_t count;
+    uint64_t value;
+    int found = 0;
+
+    memcpy(&count, p, sizeof(count));
+    p += sizeof(count);
+    EXPECT_EQ(be16toh(count), Metrics::Counters().size() + Metrics::Gauges().size() +
+                              Metrics::Histograms().size());
+
+    for(int i = 0; i < be16toh(count); i++) {
+        uint8_t type = p[0], length = p[1];
+        string name(p + 2, length);
+        p += 2 + length;
+
+        memcpy(&value, p, sizeof(value));
+        value = be64toh(value);
+
+        if(name == "snap.reads") {
+            EXPECT_EQ(type, METRIC_COUNTER);
+            EXPECT_EQ(value, 3);
+            found++;
+        }
+        else if(name == "snap.depth") {
+            EXPECT_EQ(type, METRIC_GAUGE);
+            EXPECT_EQ(value, 7);
+            found++;
+        }
+        else if(name == "snap.latency_us") {
+            EXPECT_EQ(type, METRIC_HISTOGRAM);
+            EXPECT_EQ(value, 1);
+            found++;
+        }
+
+        p += type == METRIC_HISTOGRAM ? 7 * sizeof(uint64_t) : sizeof(uint64_t);
+    }
+
+    EXPECT_EQ(found, 3);
+    EXPECT_EQ(p, binary.data() + binary.length());
+}
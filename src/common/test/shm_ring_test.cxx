@@ -0,0 +1,207 @@
+/*******************************************************************************
+ * Filename: shm_ring_test.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Test the shared memory ring writer and reader.
+ ******************************************************************************/
+
+#include "common/exception.h"
+#include "common/shm_ring.h"
+#include "gmock/gmock.h"
+
+#include <string>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+using namespace std;
+
+#define SHM_NAME "/gtest_shm_ring"
+
+class ShmRingTest : public testing::Test {
+
+    protected:
+        virtual void SetUp() {
+            shm_unlink(SHM_NAME);
+        }
+
+        virtual void TearDown() {
+            shm_unlink(SHM_NAME);
+        }
+
+        string next(ShmRingReader &reader) {
+            char buffer[MIN_SHM_RING_SIZE];
+            uint32_t bytes;
+
+            if(reader.read(buffer, sizeof(buffer), bytes) != SHM_RING_OK)
+                return "";
+
+            return string(buffer, bytes);
+        }
+};
+
+static void * delayedWrite(void *arg) {
+    usleep(50000);
+    ((ShmRing *)arg)->write("late", 4);
+    return NULL;
+}
+
+/* Test the layout and opening errors */
+TEST_F(ShmRingTest, Open) {
+    ShmRing ring;
+    ShmRingReader reader;
+
+    EXPECT_EQ(sizeof(ShmRingHeader), 64);
+    EXPECT_THROW(reader.open(SHM_NAME), ShmRingOpenFailure);
+    EXPECT_THROW(ring.open("no_slash", MIN_SHM_RING_SIZE), ShmRingOpenFailure);
+    EXPECT_THROW(ring.open(SHM_NAME, 100), ShmRingOpenFailure);
+    EXPECT_FALSE(ring.isOpen());
+
+    ring.open(SHM_NAME, MIN_SHM_RING_SIZE + 1);
+    ASSERT_TRUE(ring.isOpen());
+    EXPECT_EQ(ring.size(), MIN_SHM_RING_SIZE + 8);
+    EXPECT_EQ(ring.header()->magic, SHM_RING_MAGIC);
+    EXPECT_EQ(ring.header()->epoch, 1);
+    EXPECT_EQ(ring.header()->writerPid, getpid());
+
+    reader.open(SHM_NAME);
+    EXPECT_TRUE(reader.isOpen());
+    EXPECT_FALSE(reader.available());
+}
+
+/* Test records come out the way they went in, across the end of the ring */
+TEST_F(ShmRingTest, WriteRead) {
+    ShmRing ring;
+    ShmRingReader reader;
+    char buffer[1000];
+    uint32_t bytes;
+
+    ring.open(SHM_NAME, MIN_SHM_RING_SIZE);
+
+    // Written before the reader opened, never seen
+    ring.write("old", 3);
+    reader.open(SHM_NAME);
+
+    EXPECT_EQ(reader.read(buffer, sizeof(buffer), bytes), SHM_RING_EMPTY);
+    EXPECT_EQ(bytes, 0);
+
+    ring.write("abc", 3);
+    ring.write("", 0);
+    ring.write("defgh", 5);
+    EXPECT_TRUE(reader.available());
+
+    EXPECT_EQ(next(reader), "abc");
+    EXPECT_EQ(next(reader), "");
+    EXPECT_EQ(next(reader), "defgh");
+    EXPECT_EQ(reader.read(buffer, sizeof(buffer), bytes), SHM_RING_EMPTY);
+
+    // Wrap the ring several times, padding at the end
+    for(int i = 0; i < 300; i++) {
+        memset(buffer, 'a' + i % 26, sizeof(buffer));
+        ASSERT_TRUE(ring.write(buffer, 500 + i));
+
+        ASSERT_EQ(reader.read(buffer, sizeof(buffer), bytes), SHM_RING_OK);
+        ASSERT_EQ(bytes, 500 + i);
+        ASSERT_EQ(buffer[0], 'a' + i % 26);
+        ASSERT_EQ(buffer[bytes - 1], 'a' + i % 26);
+    }
+
+    EXPECT_EQ(reader.overruns(), 0);
+    EXPECT_EQ(ring.header()->head, ring.header()->reserve);
+
+    // Too big for the ring
+    char big[MIN_SHM_RING_SIZE];
+    EXPECT_FALSE(ring.write(big, sizeof(big)));
+
+    // Too big for the buffer
+    ring.write("0123456789", 10);
+    EXPECT_EQ(reader.read(buffer, 4, bytes), SHM_RING_TRUNCATED);
+    EXPECT_EQ(bytes, 4);
+    EXPECT_EQ(string(buffer, 4), "0123");
+}
+
+/* Test a reader that falls a ring behind skips to the head */
+TEST_F(ShmRingTest, Overrun) {
+    ShmRing ring;
+    ShmRingReader reader;
+    ShmRingReader other;
+    char buffer[1000];
+    uint32_t bytes;
+
+    ring.open(SHM_NAME, MIN_SHM_RING_SIZE);
+    reader.open(SHM_NAME);
+    other.open(SHM_NAME);
+
+    memset(buffer, 'x', sizeof(buffer));
+    for(int i = 0; i < 100; i++)
+        ring.write(buffer, sizeof(buffer));
+
+    EXPECT_EQ(reader.read(buffer, sizeof(buffer), bytes), SHM_RING_OVERRUN);
+    EXPECT_EQ(reader.overruns(), 1);
+    EXPECT_EQ(reader.read(buffer, sizeof(buffer), bytes), SHM_RING_EMPTY);
+
+    ring.write("abc", 3);
+    EXPECT_EQ(next(reader), "abc");
+
+    // Each reader is independent, this one skips to after "abc"
+    EXPECT_EQ(other.read(buffer, sizeof(buffer), bytes), SHM_RING_OVERRUN);
+    EXPECT_EQ(other.read(buffer, sizeof(buffer), bytes), SHM_RING_EMPTY);
+    ring.write("def", 3);
+    EXPECT_EQ(next(other), "def");
+    EXPECT_EQ(next(reader), "def");
+}
+
+/* Test writer restarts */
+TEST_F(ShmRingTest, Reopen) {
+    ShmRing ring;
+    ShmRingReader reader;
+    char buffer[100];
+    uint32_t bytes;
+
+    ring.open(SHM_NAME, MIN_SHM_RING_SIZE);
+    reader.open(SHM_NAME);
+    ring.write("abc", 3);
+    ring.close();
+
+    // Same layout, the ring continues and readers resync
+    ring.open(SHM_NAME, MIN_SHM_RING_SIZE);
+    EXPECT_EQ(ring.header()->epoch, 2);
+    EXPECT_EQ(ring.header()->head, 16);
+
+    EXPECT_EQ(reader.read(buffer, sizeof(buffer), bytes), SHM_RING_RESET);
+    ring.write("def", 3);
+    EXPECT_EQ(next(reader), "def");
+
+    // A different layout replaces the ring, readers have to reopen
+    ring.open(SHM_NAME, MIN_SHM_RING_SIZE * 2);
+    EXPECT_EQ(ring.header()->head, 0);
+    EXPECT_EQ(reader.read(buffer, sizeof(buffer), bytes), SHM_RING_CLOSED);
+
+    reader.open(SHM_NAME);
+    ring.write("ghi", 3);
+    EXPECT_EQ(next(reader), "ghi");
+}
+
+/* Test blocking for data */
+TEST_F(ShmRingTest, Wait) {
+    ShmRing ring;
+    ShmRingReader reader;
+    pthread_t thread;
+
+    ring.open(SHM_NAME, MIN_SHM_RING_SIZE);
+    reader.open(SHM_NAME);
+
+    EXPECT_FALSE(reader.wait(10));
+    EXPECT_EQ(ring.header()->waiters, 0);
+
+    ring.write("abc", 3);
+    EXPECT_TRUE(reader.wait(10));
+    EXPECT_EQ(next(reader), "abc");
+
+    ASSERT_EQ(pthread_create(&thread, NULL, delayedWrite, &ring), 0);
+    EXPECT_TRUE(reader.wait(5000));
+    EXPECT_EQ(next(reader), "late");
+    pthread_join(thread, NULL);
+}
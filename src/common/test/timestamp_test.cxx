@@ -7,6 +7,8 @@
 #include <fstream>
 #include <string>
 #include <math.h>
+#include <sstream>
+#include <iomanip>
 
 using namespace std;
 using namespace logger;
@@ -54,8 +56,68 @@ TEST_F(TimestampTest, Default) {
     LOG(INFO) << "expectedDouble: " << expectedTime;
 }
 
-/* Test setNow() and SetTime() explicitly */
+/* Test setTime() with nanosecond precision */
+TEST_F(TimestampTest, SetTimeNanoseconds) {
+    Timestamp myTime(0, 0);
+    struct timespec ts;
+
+    ts.tv_sec = 1;
+    ts.tv_nsec = 500000000;
+    myTime.setTime(ts);
+
+    EXPECT_EQ(myTime.seconds(), EPOCH + 1);
+    EXPECT_EQ(myTime.fraction(), 0x7fffffff);
+
+    // One nanosecond is about 4.3 fraction units, below microsecond
+    // precision.
+    ts.tv_nsec = 1;
+    myTime.setTime(ts);
+    EXPECT_EQ(myTime.fraction(), 4);
+}
+
 /* Test elapseTime() */
+TEST_F(TimestampTest, ElapseTime) {
+    Timestamp start;
+    Timestamp later(start.seconds() + 2, start.fraction());
+
+    EXPECT_GE(start.elapseTime(), 0);
+    EXPECT_LT(start.elapseTime(), 1);
+
+    EXPECT_NEAR(start.elapseTime(later), 2, 0.000001);
+}
+
+/* Test the buffer formatters */
+TEST_F(TimestampTest, Format) {
+    char buffer[TIMESTAMP_NUMBER_SIZE];
+    
+    EXPECT_EQ(Timestamp(1, 0x80000000).formatNumber(buffer, sizeof(buffer)), 3);
+    EXPECT_STREQ(buffer, "1.5");
+    
+    Timestamp(0, 0).formatNumber(buffer, sizeof(buffer));
+    EXPECT_STREQ(buffer, "0");
+    
+    Timestamp(3900000000U, 0x00010000).formatNumber(buffer, sizeof(buffer));
+    EXPECT_STREQ(buffer, "3900000000.000015");
+    
+    // Rounds up into the seconds
+    Timestamp(0xffffffff, 0xffffffff).formatNumber(buffer, sizeof(buffer));
+    EXPECT_STREQ(buffer, "4294967296");
+    
+    // Too small
+    EXPECT_EQ(Timestamp(1, 0x80000000).formatNumber(buffer, 3), 0);
+    
+    Timestamp myTime(0x01020304, 0xa0b0c0d0);
+    stringstream hexOut, stringOut;
+    hexOut << hex << setfill('0') << setw(16) << myTime.asBinary();
+    stringOut << hex << myTime.asBinary();
+    
+    EXPECT_EQ(myTime.formatHex(buffer, sizeof(buffer)), 16);
+    EXPECT_EQ(hexOut.str(), buffer);
+    EXPECT_EQ(myTime.asHex(), hexOut.str());
+    EXPECT_EQ(myTime.asString(), stringOut.str());
+    EXPECT_EQ(Timestamp(0, 0).asString(), "0");
+    EXPECT_EQ(myTime.formatHex(buffer, 16), 0);
+}
 
 /* Test copy constructor and assignment operator */
 TEST_F(TimestampTest, CopyCTOR) {
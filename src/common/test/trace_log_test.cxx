@@ -0,0 +1,136 @@
+/*******************************************************************************
+ * Filename: trace_log_test.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Test the per-packet trace log.
+ ******************************************************************************/
+
+#include "common/exception.h"
+#include "common/trace_log.h"
+#include "common/util.h"
+#include "gmock/gmock.h"
+
+#include <string>
+#include <string.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace logger;
+
+#define TRACEFILE "/tmp/gtest_trace_log.trace"
+
+class TraceLogTest : public testing::Test {
+
+    protected:
+        virtual void SetUp() {
+            remove_file(TRACEFILE);
+            TraceLog::SetSampleRate(1);
+        }
+
+        virtual void TearDown() {
+            TraceLog::SetSampleRate(0);
+            TraceLog::Close();
+            remove_file(TRACEFILE);
+        }
+};
+
+/* Test the file layout */
+TEST_F(TraceLogTest, Open) {
+    struct stat st;
+
+    EXPECT_FALSE(TraceLog::IsOpen());
+    TraceLog::Open(TRACEFILE, 8);
+    EXPECT_TRUE(TraceLog::IsOpen());
+
+    ASSERT_TRUE(TraceLog::Header());
+    EXPECT_EQ(sizeof(TraceRecord), 32);
+    EXPECT_EQ(TraceLog::Header()->magic, TRACE_LOG_MAGIC);
+    EXPECT_EQ(TraceLog::Header()->records, 8);
+    EXPECT_EQ(TraceLog::Header()->head, 0);
+    EXPECT_GT(TraceLog::Header()->realtimeOffset, 0);
+
+    ASSERT_EQ(stat(TRACEFILE, &st), 0);
+    EXPECT_EQ(st.st_size, sizeof(TraceLogHeader) + 8 * sizeof(TraceRecord));
+
+    EXPECT_THROW(TraceLog::Open("/tmp", 8), TraceLogOpenFailure);
+    EXPECT_FALSE(TraceLog::IsOpen());
+}
+
+/* Test a traced read from receive to done */
+TEST_F(TraceLogTest, Trace) {
+    const TraceRecord *record;
+    struct timespec received;
+    uint64_t trace;
+
+    // Not open, nothing happens
+    EXPECT_EQ(TraceLog::Start(10), 0);
+    TraceLog::Point(TRACE_PACKET);
+    TraceLog::Finish();
+
+    TraceLog::Open(TRACEFILE, 16);
+
+    clock_gettime(CLOCK_REALTIME, &received);
+    trace = TraceLog::Start(10, &received);
+    EXPECT_NE(trace, 0);
+    EXPECT_EQ(TraceLog::Current(), trace);
+
+    TraceLog::Point(TRACE_PACKET, 3);
+    TraceLog::Point(TRACE_WRITE, 42);
+    TraceLog::Finish();
+    EXPECT_EQ(TraceLog::Current(), 0);
+    ASSERT_EQ(TraceLog::Header()->head, 5);
+
+    // Outside a trace nothing is recorded
+    TraceLog::Point(TRACE_PACKET, 3);
+    EXPECT_EQ(TraceLog::Header()->head, 5);
+
+    uint16_t points[] = { TRACE_RECEIVED, TRACE_READ, TRACE_PACKET, TRACE_WRITE, TRACE_DONE };
+    uint32_t args[] = { 10, 10, 3, 42, 0 };
+    uint64_t last = 0;
+
+    for(uint64_t i = 1; i <= 5; i++) {
+        record = TraceLog::Record(i);
+        ASSERT_TRUE(record);
+        EXPECT_EQ(record->trace, trace);
+        EXPECT_EQ(record->point, points[i - 1]);
+        EXPECT_EQ(record->arg, args[i - 1]);
+
+        // The receive time comes from the wall clock, the rest are in order
+        if(i > 1)
+            EXPECT_GE(record->time, last);
+        last = record->time;
+    }
+
+    // The receive time maps back to the wall clock
+    record = TraceLog::Record(1);
+    int64_t wall = (int64_t)received.tv_sec * 1000000000LL + received.tv_nsec;
+    EXPECT_EQ((int64_t)record->time + TraceLog::Header()->realtimeOffset, wall);
+}
+
+/* Test sampling and ring wrap */
+TEST_F(TraceLogTest, Sampling) {
+    TraceLog::Open(TRACEFILE, 4);
+    TraceLog::SetSampleRate(3);
+
+    int traced = 0;
+    for(int i = 0; i < 9; i++) {
+        if(TraceLog::Start(1))
+            traced++;
+        TraceLog::Point(TRACE_PACKET);
+        TraceLog::Finish();
+    }
+
+    EXPECT_EQ(traced, 3);
+    EXPECT_EQ(TraceLog::Header()->head, 9);
+
+    // Only the last four records are left
+    EXPECT_FALSE(TraceLog::Record(5));
+    ASSERT_TRUE(TraceLog::Record(6));
+    EXPECT_EQ(TraceLog::Record(9)->point, TRACE_DONE);
+
+    // Rate 0 stops tracing
+    TraceLog::SetSampleRate(0);
+    EXPECT_EQ(TraceLog::Start(1), 0);
+    EXPECT_EQ(TraceLog::Header()->head, 9);
+}
@@ -1,4 +1,5 @@
 #include "timestamp.h"
+#include "clock.h"
 #include "logger.h"
 #include "util.h"
 
@@ -11,6 +12,7 @@
 #include <sstream>
 #include <iostream>
 #include <stdio.h>
+#include <string.h>
 
 using namespace std;
 using namespace logger;
@@ -20,9 +22,9 @@ Timestamp::Timestamp() {
 }
 
 void Timestamp::setNow() {
-    struct timeval now;
-    gettimeofday(&now, NULL);
-    setTime(&now);
+    struct timespec now;
+    Clock::Now(now);
+    setTime(now);
 }
 
 void Timestamp::setTime(uint32_t seconds, uint32_t fraction) {
@@ -31,9 +33,14 @@ void Timestamp::setTime(uint32_t seconds, uint32_t fraction) {
 }
 
 double Timestamp::elapseTime() {
-    Timestamp currentTime;
+    struct timespec now;
+    Clock::Now(now);
     
-    return currentTime.asDouble() - asDouble();
+    return (now.tv_sec + EPOCH) + now.tv_nsec / (double)NANOSECONDS_PER_SECOND - asDouble();
+}
+
+double Timestamp::elapseTime(const Timestamp &now) {
+    return Timestamp(now).asDouble() - asDouble();
 }
 
 double Timestamp::asDouble(){
@@ -54,30 +61,103 @@ uint64_t Timestamp::asBinary(){
 }
 
 string Timestamp::asNumber(){
-    stringstream out;
-    out << asDouble();
-    return out.str();
+    char buffer[TIMESTAMP_NUMBER_SIZE];
+    return string(buffer, formatNumber(buffer, sizeof(buffer)));
 }
 
 string Timestamp::asHex() {
-    stringstream out;
-    out << hex << setfill('0') << setw(16) << asBinary();
-    return out.str();
+    char buffer[TIMESTAMP_HEX_SIZE];
+    return string(buffer, formatHex(buffer, sizeof(buffer)));
 }
 
 string Timestamp::asString() {
-    stringstream out;
-    out << hex << asBinary();
-    return out.str();
+    char buffer[TIMESTAMP_HEX_SIZE];
+    return string(buffer, formatString(buffer, sizeof(buffer)));
+}
+
+size_t Timestamp::formatNumber(char *buffer, size_t size) {
+    char digits[TIMESTAMP_NUMBER_SIZE];
+    char *pos = digits + sizeof(digits);
+    
+    // Round the fraction to microseconds, it may carry into the seconds
+    uint64_t seconds = m_seconds;
+    uint64_t micro = ((uint64_t)m_fraction * 1000000ULL + NTP_SCALE_FRAC / 2) / NTP_SCALE_FRAC;
+    if(micro >= 1000000ULL) {
+        seconds++;
+        micro -= 1000000ULL;
+    }
+    
+    // Digits are built backwards from the end of the scratch buffer
+    if(micro) {
+        int places = 6;
+        while(micro % 10 == 0) {
+            micro /= 10;
+            places--;
+        }
+        
+        while(places--) {
+            *--pos = '0' + micro % 10;
+            micro /= 10;
+        }
+        *--pos = '.';
+    }
+    
+    do {
+        *--pos = '0' + seconds % 10;
+        seconds /= 10;
+    } while(seconds);
+    
+    size_t length = digits + sizeof(digits) - pos;
+    if(length >= size)
+        return 0;
+    
+    memcpy(buffer, pos, length);
+    buffer[length] = '\0';
+    return length;
+}
+
+size_t Timestamp::formatHex(char *buffer, size_t size) {
+    static const char hexDigits[] = "0123456789abcdef";
+    uint64_t value = asBinary();
+    
+    if(size < TIMESTAMP_HEX_SIZE)
+        return 0;
+    
+    for(int i = 15; i >= 0; i--) {
+        buffer[i] = hexDigits[value & 0xf];
+        value >>= 4;
+    }
+    buffer[16] = '\0';
+    
+    return 16;
+}
+
+size_t Timestamp::formatString(char *buffer, size_t size) {
+    char digits[TIMESTAMP_HEX_SIZE];
+    size_t skip = 0;
+    
+    formatHex(digits, sizeof(digits));
+    while(skip < 15 && digits[skip] == '0')
+        skip++;
+    
+    size_t length = 16 - skip;
+    if(length >= size)
+        return 0;
+    
+    memcpy(buffer, digits + skip, length + 1);
+    return length;
 }
   
 void Timestamp::setTime(struct timeval *tv) {
-    uint64_t ntpts;
-
     m_seconds = (uint32_t)tv->tv_sec + EPOCH;
     m_fraction = (uint32_t)((NTP_SCALE_FRAC * tv->tv_usec) / 1000000UL);
 }
 
+void Timestamp::setTime(const struct timespec &ts) {
+    m_seconds = (uint32_t)ts.tv_sec + EPOCH;
+    m_fraction = (uint32_t)((NTP_SCALE_FRAC * ts.tv_nsec) / NANOSECONDS_PER_SECOND);
+}
+
 Timestamp & Timestamp::operator=(const Timestamp &rhs) {
     m_seconds = rhs.m_seconds;
     m_fraction = rhs.m_fraction;
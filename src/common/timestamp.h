@@ -10,6 +10,17 @@
  * Standard Definition:
  *   - http://www.ietf.org/rfc/rfc5905.txt
  * 
+ * The current time is read from the high resolution clock (see clock.h) and
+ * carries nanosecond precision into the NTP fraction.
+ * 
+ * The format methods write into a caller buffer without allocating and are
+ * what the packet ASCII output uses.  Each returns the length written, not
+ * counting the terminating null, or 0 if the buffer is too small.  The as*
+ * methods return the same text as a string.
+ * 
+ *   char buffer[TIMESTAMP_NUMBER_SIZE];
+ *   size_t length = ts.formatNumber(buffer, sizeof(buffer));
+ * 
  ******************************************************************************/
 
 #ifndef TIMESTAMP_H
@@ -17,6 +28,7 @@
 
 #include <sys/time.h>
 #include <stdint.h>
+#include <time.h>
 
 #include <string>
 using namespace std;
@@ -24,6 +36,10 @@ using namespace std;
 const unsigned long long EPOCH = 2208988800ULL;
 const unsigned long long NTP_SCALE_FRAC = 4294967295ULL;
 
+// Buffer sizes for the format methods, including the terminating null
+const size_t TIMESTAMP_NUMBER_SIZE = 24;
+const size_t TIMESTAMP_HEX_SIZE = 17;
+
 class Timestamp {
     public:
         Timestamp();
@@ -37,8 +53,15 @@ class Timestamp {
 
         void setTime(uint32_t seconds, uint32_t fraction);
 
+        // Set from a unix time with nanosecond precision
+        void setTime(const struct timespec &ts);
+
         // Get elapse time between the stored timestamp and now.
         double elapseTime();
+
+        // Get elapse time between the stored timestamp and a time the
+        // caller already has.
+        double elapseTime(const Timestamp &now);
         
         uint32_t seconds() { return m_seconds; }
         uint32_t fraction() { return m_fraction; }
@@ -49,6 +72,13 @@ class Timestamp {
         string asHex();
         string asString();
 
+        // Seconds with a microsecond decimal fraction, trailing zeros removed
+        size_t formatNumber(char *buffer, size_t size);
+        // asBinary() as 16 hex digits
+        size_t formatHex(char *buffer, size_t size);
+        // asBinary() as hex without leading zeros
+        size_t formatString(char *buffer, size_t size);
+
     private:
         void setTime(struct timeval *tv);
         uint32_t m_seconds;
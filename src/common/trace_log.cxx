@@ -0,0 +1,179 @@
+/*******************************************************************************
+ * Class: TraceLog
+ * Filename: trace_log.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Records are written with the MappedRing claim and commit protocol, like
+ * the event log.
+ *
+ ******************************************************************************/
+
+#include "trace_log.h"
+#include "exception.h"
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+using namespace std;
+using namespace logger;
+
+// Global static pointer used to ensure a single instance of the class.
+TraceLog* TraceLog::m_pInstance = NULL;
+uint32_t TraceLog::m_iSampleRate = 0;
+uint64_t TraceLog::m_iReads = 0;
+uint64_t TraceLog::m_iNextTrace = 0;
+uint64_t TraceLog::m_iCurrent = 0;
+
+/******************************************************************************
+ *   PUBLIC METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Open
+ * Description: Create and map a trace file.  Any open trace file is closed
+ * first.
+ * Parameters:
+ *   path - trace file
+ *   records - number of records in the ring
+ * Exceptions:
+ *   TraceLogOpenFailure
+ ******************************************************************************/
+void TraceLog::Open(const string &path, size_t records) {
+    Close();
+
+    TraceLog *instance = new TraceLog();
+    try {
+        instance->open(path, records);
+    }
+    catch(TraceLogOpenFailure &e) {
+        delete instance;
+        throw;
+    }
+
+    m_pInstance = instance;
+}
+
+/******************************************************************************
+ * Method: Close
+ * Description: Unmap the trace file.  A trace in progress is dropped.
+ ******************************************************************************/
+void TraceLog::Close() {
+    if(m_pInstance)
+        delete m_pInstance;
+
+    m_pInstance = NULL;
+    m_iCurrent = 0;
+}
+
+/******************************************************************************
+ * Method: Start
+ * Description: Count a read and, if it is the one in the sample rate we
+ * trace, give it a trace id and make it current.  A trace left current by a
+ * missing Finish() is replaced.
+ * Parameters:
+ *   bytes - bytes read
+ *   received - kernel receive time (CLOCK_REALTIME), NULL if unknown
+ * Return:
+ *   the trace id, 0 if the read isn't traced
+ ******************************************************************************/
+uint64_t TraceLog::Start(uint32_t bytes, const struct timespec *received) {
+    m_iCurrent = 0;
+
+    if(!m_pInstance || !m_iSampleRate || ++m_iReads % m_iSampleRate)
+        return 0;
+
+    m_iCurrent = ++m_iNextTrace;
+
+    if(received && (received->tv_sec || received->tv_nsec)) {
+        int64_t realtime = (int64_t)received->tv_sec * 1000000000LL + received->tv_nsec;
+        m_pInstance->write(m_iCurrent, TRACE_RECEIVED, bytes,
+                           realtime - Header()->realtimeOffset);
+    }
+
+    m_pInstance->write(m_iCurrent, TRACE_READ, bytes, Now());
+    return m_iCurrent;
+}
+
+/******************************************************************************
+ * Method: Now
+ * Description: Read the monotonic clock.
+ * Return:
+ *   nanoseconds
+ ******************************************************************************/
+uint64_t TraceLog::Now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/******************************************************************************
+ * Method: Header
+ * Description: Get the mapped file header.
+ * Return:
+ *   pointer to the header, NULL if the trace file isn't open
+ ******************************************************************************/
+const TraceLogHeader* TraceLog::Header() {
+    return m_pInstance ? (const TraceLogHeader *)m_pInstance->m_oRing.header() : NULL;
+}
+
+/******************************************************************************
+ * Method: Record
+ * Description: Get a record by sequence number.
+ * Parameters:
+ *   sequence - sequence number, the first record written is 1
+ * Return:
+ *   pointer to the record, NULL if it has been overwritten or isn't written
+ ******************************************************************************/
+const TraceRecord* TraceLog::Record(uint64_t sequence) {
+    return m_pInstance ? (const TraceRecord *)m_pInstance->m_oRing.record(sequence) : NULL;
+}
+
+/******************************************************************************
+ *   PRIVATE METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: open
+ * Description: Create, size and map the file and start the ring over.
+ * Exceptions:
+ *   TraceLogOpenFailure
+ ******************************************************************************/
+void TraceLog::open(const string &path, size_t records) {
+    struct timespec realtime;
+    uint64_t before, after;
+
+    if(!records)
+        throw TraceLogOpenFailure("zero records");
+
+    if(!m_oRing.open(path, TRACE_LOG_MAGIC, TRACE_LOG_VERSION,
+                     sizeof(TraceLogHeader), sizeof(TraceRecord), records, false))
+        throw TraceLogOpenFailure(path + ": " + strerror(errno));
+
+    // Read the wall clock between two monotonic reads to line them up
+    before = Now();
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    after = Now();
+
+    ((TraceLogHeader *)m_oRing.header())->realtimeOffset =
+        (int64_t)realtime.tv_sec * 1000000000LL + realtime.tv_nsec -
+        (int64_t)(before + (after - before) / 2);
+}
+
+/******************************************************************************
+ * Method: write
+ * Description: Claim the next slot in the ring and fill in the record.
+ ******************************************************************************/
+void TraceLog::write(uint64_t trace, uint16_t point, uint32_t arg, uint64_t time) {
+    uint64_t sequence;
+    TraceRecord *record = (TraceRecord *)m_oRing.claim(sequence);
+
+    record->trace = trace;
+    record->time = time;
+    record->point = point;
+    record->reserved = 0;
+    record->arg = arg;
+
+    m_oRing.commit(record, sequence);
+}
@@ -0,0 +1,174 @@
+/*******************************************************************************
+ * Class: TraceLog
+ * Filename: trace_log.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Per-packet latency tracing (singleton).  A sampled instrument read is
+ * given a trace id and every trace point it passes on its way through the
+ * port agent, from the read to each publisher's write, is recorded with
+ * the monotonic clock.  Records go to a MappedRing like the event log, so a
+ * trace point costs a clock read and a few stores and unsampled reads cost
+ * a counter increment.
+ *
+ * The port agent handles one read at a time, so the trace in progress is
+ * kept here rather than carried by packets.  Start() samples a read and
+ * makes it current, Point() records against the current trace, and
+ * Finish() ends it.  Points outside a sampled read record nothing.
+ *
+ * So a trace only covers work done while its read is handled.  Packets the
+ * output throttle or the RSN buffer hold and publish later are not traced
+ * past the read.  The subscription hub, shared memory and multicast
+ * publishers record TRACE_ENQUEUE and TRACE_DISPATCHED when the packet is
+ * added to their ring or batch, but the sends happen at the end of the
+ * event loop pass, after Finish(), and have no TRACE_WRITE.
+ *
+ * If the kernel receive time of the read is known it is recorded as
+ * TRACE_RECEIVED, so time spent waiting in the socket buffer can be told
+ * apart from time spent in the port agent.
+ *
+ * tools/trace_log_decoder.py converts a trace file to the Chrome trace
+ * event format for chrome://tracing or Perfetto.
+ *
+ * File Layout:
+ *
+ *   TraceLogHeader
+ *   TraceRecord[records]
+ *
+ *   A record is valid when its sequence is non-zero; its position in the
+ *   ring is (sequence - 1) % records.  Record times are monotonic
+ *   nanoseconds, add the header realtimeOffset for wall clock time.
+ *
+ *   Opening a trace file starts it over, traces are kept per run.
+ *
+ * Usage:
+ *
+ *   TraceLog::Open("/tmp/port_agent.trace");
+ *   TraceLog::SetSampleRate(100);           // one read in 100
+ *
+ *   TraceLog::Start(bytesRead);
+ *   TraceLog::Point(TRACE_PACKET, packetType);
+ *   TraceLog::Finish();
+ *
+ *   TraceLog::Close();
+ *
+ * Exceptions:
+ *
+ * TraceLogOpenFailure - when the trace file can't be created or mapped
+ *
+ ******************************************************************************/
+
+#ifndef __TRACE_LOG_H__
+#define __TRACE_LOG_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <string>
+
+#include "mapped_ring.h"
+
+#define TRACE_LOG_MAGIC          0x43525421  // "!TRC"
+#define TRACE_LOG_VERSION        1
+
+#define TRACE_LOG_RECORDS        262144
+
+using namespace std;
+
+namespace logger {
+
+    // Trace points, in pipeline order.  Keep tools/trace_log_decoder.py in
+    // step when adding one.
+    typedef enum TracePoint {
+        TRACE_RECEIVED   = 1,   // kernel receive time, arg is bytes
+        TRACE_READ       = 2,   // read by the port agent, arg is bytes
+        TRACE_PACKET     = 3,   // packet handed to publishers, arg is type
+        TRACE_ENQUEUE    = 4,   // publisher handed the packet, arg is type
+        TRACE_WRITE      = 5,   // socket or file write done, arg is bytes
+        TRACE_DISPATCHED = 6,   // publisher done, arg is type
+        TRACE_DONE       = 7    // read fully handled
+    } TracePoint;
+
+    // 32 bytes on disk
+    struct TraceRecord {
+        uint64_t sequence;
+        uint64_t trace;
+        uint64_t time;
+        uint16_t point;
+        uint16_t reserved;
+        uint32_t arg;
+    };
+
+    struct TraceLogHeader : public MappedRingHeader {
+        // Realtime minus monotonic nanoseconds when the file was opened
+        int64_t realtimeOffset;
+    };
+
+    class TraceLog {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            // Map the trace file
+            static void Open(const string &path, size_t records = TRACE_LOG_RECORDS);
+
+            // Unmap the trace file
+            static void Close();
+
+            static bool IsOpen() { return m_pInstance != NULL; }
+
+            // Trace one read in rate, 0 to stop tracing
+            static void SetSampleRate(uint32_t rate) { m_iSampleRate = rate; }
+            static uint32_t SampleRate() { return m_iSampleRate; }
+
+            // Sample a read and, if it's traced, make it current.
+            // received is the kernel receive time if known.
+            static uint64_t Start(uint32_t bytes, const struct timespec *received = NULL);
+
+            // Record a point against the current trace
+            static void Point(TracePoint point, uint32_t arg = 0) {
+                if(m_iCurrent)
+                    m_pInstance->write(m_iCurrent, point, arg, Now());
+            }
+
+            // End the current trace
+            static void Finish() {
+                Point(TRACE_DONE);
+                m_iCurrent = 0;
+            }
+
+            static uint64_t Current() { return m_iCurrent; }
+
+            // Monotonic nanoseconds
+            static uint64_t Now();
+
+            // Access for readers and tests
+            static const TraceLogHeader* Header();
+            static const TraceRecord* Record(uint64_t sequence);
+
+        private:
+            TraceLog() {}
+            TraceLog(const TraceLog &);
+            TraceLog & operator=(const TraceLog &);
+            ~TraceLog() {}
+
+            void open(const string &path, size_t records);
+            void write(uint64_t trace, uint16_t point, uint32_t arg, uint64_t time);
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            static TraceLog *m_pInstance;
+            static uint32_t m_iSampleRate;
+            static uint64_t m_iReads;
+            static uint64_t m_iNextTrace;
+            static uint64_t m_iCurrent;
+
+            MappedRing m_oRing;
+    };
+}
+
+#endif //__TRACE_LOG_H__
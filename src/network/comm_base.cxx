@@ -32,6 +32,10 @@ CommBase::CommBase() {
     // Default behavior for sockets is non-blocking
     m_bBlocking = false;
     m_bConnected = false;
+    
+    m_bReceiveTimestamps = false;
+    m_bHaveReceiveTime = false;
+    m_bNoDelay = false;
 }
 
 
@@ -40,6 +44,9 @@ CommBase::CommBase() {
  * Description: Copy constructor.
  ******************************************************************************/
 CommBase::CommBase(const CommBase &rhs) {
+    m_bReceiveTimestamps = rhs.m_bReceiveTimestamps;
+    m_bHaveReceiveTime = false;
+    m_bNoDelay = rhs.m_bNoDelay;
 }
 
 
@@ -60,6 +67,24 @@ CommBase & CommBase::operator=(const CommBase &rhs) {
 }
 
 
+/******************************************************************************
+ * Method: lastReceiveTime
+ * Description: Get the kernel receive time of the data returned by the last
+ * call to readData().
+ * Parameters:
+ *   ts - set to the receive time
+ * Return:
+ *   true if the kernel gave us a receive time.
+ ******************************************************************************/
+bool CommBase::lastReceiveTime(struct timespec &ts) {
+    if(!m_bHaveReceiveTime)
+        return false;
+    
+    ts = m_oReceiveTime;
+    return true;
+}
+
+
 /******************************************************************************
  * Method: equality operator
  * Description: overloaded equality operator.
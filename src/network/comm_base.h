@@ -7,14 +7,25 @@
  * CommBase is the base class for network socket communications.  From this
  * class we will derive classes to setup TCP and UDP socket and listeners.
  *
+ * Connections that support it can ask the kernel to timestamp received data
+ * (SO_TIMESTAMPNS).  The kernel time of the data returned by the last
+ * readData() is then available from lastReceiveTime().  This time is taken
+ * when the data arrives, before any event loop scheduling delay.
+ *
+ * transmit() and receive() report routine conditions, like a closed peer, in
+ * an IOResult and don't throw.  writeData() and readData() are the older
+ * interface and turn failures into exceptions.
+ *
  ******************************************************************************/
 
 #ifndef __COMM_BASE_H_
 #define __COMM_BASE_H_
 
 #include "common/logger.h"
+#include "network/io_result.h"
 
 #include <stdint.h>
+#include <time.h>
 
 using namespace std;
 using namespace logger;
@@ -25,7 +36,9 @@ namespace network {
         COMM_TCP_LISTENER,
         COMM_TCP_SOCKET,
         COMM_UDP_SOCKET,
-        COMM_SERIAL_SOCKET
+        COMM_SERIAL_SOCKET,
+        COMM_UNIX_LISTENER,
+        COMM_UDP_LISTENER
     } CommType;
     
     class CommBase {
@@ -61,7 +74,28 @@ namespace network {
             virtual uint32_t writeData(const char *buffer, uint32_t size) = 0;
             virtual uint32_t readData(char *buffer, uint32_t size) = 0;
             
+            // Status code versions of writeData and readData
+            virtual IOResult transmit(const char *buffer, uint32_t size) = 0;
+            virtual IOResult receive(char *buffer, uint32_t size) = 0;
+            
             virtual uint16_t getListenPort() { return 0; }
+            
+            // Close the connection to the peer after a failed write, a
+            // listener goes back to waiting for a new client
+            virtual bool dropClient() = 0;
+            
+            /* Kernel receive timestamps */
+            virtual void setReceiveTimestamps(bool enable) { m_bReceiveTimestamps = enable; }
+            bool receiveTimestamps() { return m_bReceiveTimestamps; }
+            
+            // Kernel receive time of the data returned by the last readData().
+            // Returns false if there isn't one.
+            bool lastReceiveTime(struct timespec &ts);
+            
+            /* Send small writes right away rather than waiting to coalesce
+               them, only TCP sockets act on this */
+            virtual void setNoDelay(bool enable) { m_bNoDelay = enable; }
+            bool noDelay() { return m_bNoDelay; }
 
 
 
@@ -80,6 +114,12 @@ namespace network {
         protected:
             bool m_bConnected;
             
+            bool m_bReceiveTimestamps;
+            bool m_bHaveReceiveTime;
+            struct timespec m_oReceiveTime;
+            
+            bool m_bNoDelay;
+            
     };
 }
 
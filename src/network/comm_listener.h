@@ -56,6 +56,7 @@ namespace network {
 	        bool disconnect();
 	        bool disconnectClient();
 	        bool disconnectServer();
+	        bool dropClient() { return disconnectClient(); }
     	    
 	        bool acceptClient();
 	    
@@ -46,7 +46,7 @@ CommSocket::CommSocket() {
  * Method: Copy Constructor
  * Description: Copy constructor.
  ******************************************************************************/
-CommSocket::CommSocket(const CommSocket &rhs) {
+CommSocket::CommSocket(const CommSocket &rhs) : CommBase(rhs) {
 	m_pSocketFD = rhs.m_pSocketFD;
 	m_iPort = rhs.m_iPort;
 	m_sHostname = rhs.m_sHostname;
@@ -90,6 +90,21 @@ bool CommSocket::compare(CommBase *rhs) {
 		       m_sHostname == ((CommSocket *)rhs)->m_sHostname;
 }
 
+/******************************************************************************
+ * Method: setReceiveTimestamps
+ * Description: Turn kernel receive timestamps on or off.  If the socket is
+ * already open the option is set now, otherwise when it is initialized.
+ * Parameters:
+ *   enable - true to timestamp received data
+ ******************************************************************************/
+void CommSocket::setReceiveTimestamps(bool enable) {
+    m_bReceiveTimestamps = enable;
+    m_bHaveReceiveTime = false;
+    
+    if(m_pSocketFD)
+        applyReceiveTimestamps();
+}
+
 /******************************************************************************
  * Method: close
  * Description: close the connection and reselt the file descriptor.  Don't
@@ -121,9 +136,8 @@ bool CommSocket::disconnect() {
 
 /******************************************************************************
  * Method: write
- * Description: write a number of bytes to the socket connection.  Currently we
- * try to write three times before we fail.  We might want to update this retry
- * so that it keeps retrying if it see progress being made?
+ * Description: write a number of bytes to the socket connection.  Wraps
+ * transmit() and throws if the write fails.
  *
  * Parameters:
  *   buffer - the data to write
@@ -135,30 +149,58 @@ bool CommSocket::disconnect() {
  *   SocketWriteFailure
  ******************************************************************************/
 uint32_t CommSocket::writeData(const char *buffer, const uint32_t size) {
-    int bytesWritten = 0;
-    int bytesRemaining = size;
+    IOResult result = transmit(buffer, size);
+
+    if(result.status == IO_NOT_CONNECTED || result.status == IO_CLOSED ||
+       result.status == IO_ERROR)
+        throw(SocketWriteFailure(result.what()));
+
+    return result.bytes;
+}
+
+/******************************************************************************
+ * Method: transmit
+ * Description: write a number of bytes to the socket connection.  Keeps
+ * writing until the whole buffer is written, the socket would block or the
+ * write fails.  A failed write closes the socket.
+ *
+ * Parameters:
+ *   buffer - the data to write
+ *   size - the size of the buffer array
+ * Return:
+ *   IO_OK, IO_WOULD_BLOCK with the bytes written so far, IO_CLOSED,
+ *   IO_NOT_CONNECTED or IO_ERROR
+ ******************************************************************************/
+IOResult CommSocket::transmit(const char *buffer, const uint32_t size) {
+    uint32_t bytesWritten = 0;
     int count;
 
     if(! connected())
-        throw(SocketWriteFailure("not connected"));
+        return IOResult(IO_NOT_CONNECTED);
     
-    while( bytesRemaining > 0 ) {
+    while( bytesWritten < size ) {
         LOG(DEBUG) << "WRITE DEVICE: " << buffer;
-        count = write(m_pSocketFD, buffer + bytesWritten, bytesRemaining );
+        count = send(m_pSocketFD, buffer + bytesWritten, size - bytesWritten, MSG_NOSIGNAL);
         LOG(DEBUG1) << "bytes written: " << count;
         if(count < 0) {
-			m_pSocketFD = 0;
-            LOG(ERROR) << strerror(errno) << "(errno: " << errno << ")";
-            throw(SocketWriteFailure(strerror(errno)));
+            int error = errno;
+            if(error == EAGAIN || error == EWOULDBLOCK)
+                return IOResult(IO_WOULD_BLOCK, bytesWritten, error);
+
+            LOG(ERROR) << strerror(error) << "(errno: " << error << ")";
+            disconnect();
+            
+            if(error == EPIPE || error == ECONNRESET)
+                return IOResult(IO_CLOSED, bytesWritten, error);
+            return IOResult(IO_ERROR, bytesWritten, error);
         }
 
         bytesWritten += count;
-        bytesRemaining -= count;
 
-        LOG(DEBUG2) << "wrote bytes: " << count << " bytes remaining: " << bytesRemaining;
+        LOG(DEBUG2) << "wrote bytes: " << count << " bytes remaining: " << size - bytesWritten;
     }
 
-    return bytesWritten;
+    return IOResult(IO_OK, bytesWritten);
 }
 
 
@@ -190,31 +232,116 @@ uint32_t CommSocket::writeData(const char *buffer, const uint32_t size) {
  *   SocketReadFailure
  ******************************************************************************/
 uint32_t CommSocket::readData(char *buffer, const uint32_t size) {
+    IOResult result = receive(buffer, size);
+
+    if(result.status == IO_NOT_CONNECTED || result.status == IO_ERROR)
+        throw(SocketReadFailure(result.what()));
+
+    return result.bytes;
+}
+
+/******************************************************************************
+ * Method: receive
+ * Description: read a number of bytes from the socket connection.  The
+ * socket is closed when the peer closes it or the read fails.
+ *
+ * Parameters:
+ *   buffer - where to store the read data
+ *   size - max number of bytes to read
+ * Return:
+ *   IO_OK with the bytes read, IO_WOULD_BLOCK, IO_CLOSED, IO_NOT_CONNECTED
+ *   or IO_ERROR
+ ******************************************************************************/
+IOResult CommSocket::receive(char *buffer, const uint32_t size) {
     int bytesRead = 0;
 
     if(! connected())
-        throw(SocketReadFailure("not connected"));
+        return IOResult(IO_NOT_CONNECTED);
     
-    if ((bytesRead = read(m_pSocketFD, buffer, size)) < 0) {
-        if(errno != EAGAIN && errno != EINPROGRESS) {
-            disconnect();
-            LOG(ERROR) << "bytes read: " << bytesRead << " read_device: " << strerror(errno) << "(errno: " << errno << ")";
-            throw(SocketReadFailure(strerror(errno)));
-        }
-        if(errno == EAGAIN || errno == EINPROGRESS) {
-            LOG(DEBUG2) << "Error Ignored: " << strerror(errno);
+    if(m_bReceiveTimestamps)
+        bytesRead = readTimestamped(buffer, size);
+    else
+        bytesRead = read(m_pSocketFD, buffer, size);
+    
+    if (bytesRead < 0) {
+        int error = errno;
+        
+        if(error == EAGAIN || error == EINPROGRESS) {
+            LOG(DEBUG2) << "Error Ignored: " << strerror(error);
+            return IOResult(IO_WOULD_BLOCK, 0, error);
         }
-
-        LOG(DEBUG2) << "read bytes: " << bytesRead;
+        
+        LOG(ERROR) << "bytes read: " << bytesRead << " read_device: " << strerror(error) << "(errno: " << error << ")";
+        disconnect();
+        
+        if(error == ECONNRESET)
+            return IOResult(IO_CLOSED, 0, error);
+        return IOResult(IO_ERROR, 0, error);
     }
     else if(bytesRead == 0) {
         LOG(INFO) << " -- Device connection closed. zero bytes recv.";
         disconnect();
+        return IOResult(IO_CLOSED);
     }
-    else
-        LOG(DEBUG) << "READ DEVICE: " << buffer;
-
-    return bytesRead < 0 ? 0 : bytesRead;
+    
+    LOG(DEBUG) << "READ DEVICE: " << buffer;
+    return IOResult(IO_OK, bytesRead);
 }
 
+/******************************************************************************
+ * Method: applyReceiveTimestamps
+ * Description: Set or clear SO_TIMESTAMPNS on the socket.  If the kernel
+ * doesn't support it we log it and carry on reading without timestamps.
+ ******************************************************************************/
+void CommSocket::applyReceiveTimestamps() {
+    int enable = m_bReceiveTimestamps ? 1 : 0;
+    
+    if(setsockopt(m_pSocketFD, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) < 0) {
+        LOG(ERROR) << "failed to set SO_TIMESTAMPNS: " << strerror(errno);
+        m_bReceiveTimestamps = false;
+    }
+}
 
+/******************************************************************************
+ * Method: readTimestamped
+ * Description: Read from the socket with recvmsg and store the kernel
+ * receive time from the SCM_TIMESTAMPNS control message.  For stream sockets
+ * this is the arrival time of the most recent segment read.
+ *
+ * Parameters:
+ *   buffer - where to store the read data
+ *   size - max number of bytes to read
+ * Return:
+ *   result of recvmsg
+ ******************************************************************************/
+int CommSocket::readTimestamped(char *buffer, const uint32_t size) {
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    char control[CMSG_SPACE(sizeof(struct timespec))];
+    int bytesRead;
+    
+    iov.iov_base = buffer;
+    iov.iov_len = size;
+    
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    
+    m_bHaveReceiveTime = false;
+    bytesRead = recvmsg(m_pSocketFD, &msg, 0);
+    
+    if(bytesRead <= 0)
+        return bytesRead;
+    
+    for(cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            memcpy(&m_oReceiveTime, CMSG_DATA(cmsg), sizeof(m_oReceiveTime));
+            m_bHaveReceiveTime = true;
+        }
+    }
+    
+    return bytesRead;
+}
@@ -49,14 +49,27 @@ namespace network {
 
             // close
             virtual bool disconnect();
+            bool dropClient() { return disconnect(); }
             virtual bool compare(CommBase *rhs);
 
             virtual uint32_t writeData(const char *buffer, uint32_t size);
             virtual uint32_t readData(char *buffer, uint32_t size);
+            
+            virtual IOResult transmit(const char *buffer, uint32_t size);
+            virtual IOResult receive(char *buffer, uint32_t size);
+            
+            // Enable kernel timestamps, applied right away if connected
+            virtual void setReceiveTimestamps(bool enable);
 
         protected:
 
             void setSocket(int fd) { m_pSocketFD = fd; }
+            
+            // Set SO_TIMESTAMPNS on the socket to match m_bReceiveTimestamps
+            void applyReceiveTimestamps();
+            
+            // Read with recvmsg, storing the kernel receive time
+            int readTimestamped(char *buffer, uint32_t size);
 
         private:
         
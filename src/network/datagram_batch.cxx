@@ -0,0 +1,132 @@
+/*******************************************************************************
+ * Class: DatagramBatch
+ * Filename: datagram_batch.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Each queued datagram is one message of up to two iovecs, the sequence
+ * header and the payload.  Both point into storage owned by the batch, so
+ * the messages stay valid until flush.
+ *
+ ******************************************************************************/
+
+#include "datagram_batch.h"
+#include "common/logger.h"
+#include "common/exception.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+using namespace std;
+using namespace logger;
+using namespace network;
+
+/******************************************************************************
+ *   PUBLIC METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Constructor
+ * Description: Default constructor, allocates the batch buffer.
+ ******************************************************************************/
+DatagramBatch::DatagramBatch() {
+    m_bSequenceHeader = false;
+    m_iSequence = 0;
+    m_iDropped = 0;
+    m_iBytes = 0;
+    m_iCount = 0;
+
+    m_pBuffer = (char *)malloc(DATAGRAM_BATCH_SIZE);
+    memset(m_aMessages, 0, sizeof(m_aMessages));
+}
+
+/******************************************************************************
+ * Method: Destructor
+ * Description: Queued datagrams are discarded.
+ ******************************************************************************/
+DatagramBatch::~DatagramBatch() {
+    m_oSocket.disconnect();
+
+    if(m_pBuffer)
+        free(m_pBuffer);
+}
+
+/******************************************************************************
+ * Method: queue
+ * Description: Copy a datagram into the batch.  If it doesn't fit the batch
+ * is flushed first.
+ * Parameters:
+ *   buffer - datagram payload
+ *   size - payload size
+ * Return:
+ *   false if the datagram is too big to send
+ ******************************************************************************/
+bool DatagramBatch::queue(const char *buffer, uint32_t size) {
+    uint32_t header = m_bSequenceHeader ? DATAGRAM_SEQUENCE_HEADER_SIZE : 0;
+
+    if(size + header > MAX_DATAGRAM_SIZE || !m_pBuffer) {
+        LOG(ERROR) << "datagram too large: " << size;
+        return false;
+    }
+
+    if(m_iCount == DATAGRAM_BATCH_MESSAGES || m_iBytes + size > DATAGRAM_BATCH_SIZE)
+        flush();
+
+    struct iovec *iov = m_aIov[m_iCount];
+    struct msghdr *msg = &(m_aMessages[m_iCount].msg_hdr);
+
+    memcpy(m_pBuffer + m_iBytes, buffer, size);
+    msg->msg_iov = iov;
+    msg->msg_iovlen = 0;
+
+    if(header) {
+        char *out = m_aHeaders[m_iCount];
+        uint32_t magic = htonl(DATAGRAM_SEQUENCE_MAGIC);
+        uint32_t high = htonl((uint32_t)(m_iSequence >> 32));
+        uint32_t low = htonl((uint32_t)m_iSequence);
+
+        memcpy(out, &magic, 4);
+        memcpy(out + 4, &high, 4);
+        memcpy(out + 8, &low, 4);
+
+        iov[msg->msg_iovlen].iov_base = out;
+        iov[msg->msg_iovlen].iov_len = header;
+        msg->msg_iovlen++;
+    }
+
+    iov[msg->msg_iovlen].iov_base = m_pBuffer + m_iBytes;
+    iov[msg->msg_iovlen].iov_len = size;
+    msg->msg_iovlen++;
+
+    m_iBytes += size;
+    m_iCount++;
+    m_iSequence++;
+
+    return true;
+}
+
+/******************************************************************************
+ * Method: flush
+ * Description: Send every queued datagram with one sendmmsg call.  The batch
+ * is empty afterwards, whether or not the socket took everything.
+ * Return:
+ *   result of the send, bytes is the number of datagrams sent
+ ******************************************************************************/
+IOResult DatagramBatch::flush() {
+    IOResult result;
+
+    if(! m_iCount)
+        return result;
+
+    result = m_oSocket.transmitBatch(m_aMessages, m_iCount);
+    if(result.bytes < m_iCount) {
+        LOG(DEBUG) << "dropped " << m_iCount - result.bytes << " datagrams: " << result.what();
+        m_iDropped += m_iCount - result.bytes;
+    }
+
+    m_iCount = 0;
+    m_iBytes = 0;
+
+    return result;
+}
@@ -0,0 +1,110 @@
+/*******************************************************************************
+ * Class: DatagramBatch
+ * Filename: datagram_batch.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Queue datagrams for a UDP socket and send them all with one sendmmsg call.
+ * Packets published during one pass of the event loop are queued, then
+ * flushed together at the end of the pass, so the number of system calls
+ * doesn't grow with the packet rate.  Queued data is copied into a buffer
+ * allocated once with the batch.
+ *
+ * With the sequence header enabled each datagram starts with a 12 byte
+ * header, all fields in network byte order:
+ *
+ *   uint32_t magic     - DATAGRAM_SEQUENCE_MAGIC, "PASQ"
+ *   uint64_t sequence  - starts at 0, one per datagram
+ *
+ * Datagrams the socket refuses are dropped rather than held, UDP is lossy
+ * anyway, but they still use a sequence number so receivers see the gap.
+ *
+ * Usage:
+ *
+ *   DatagramBatch batch;
+ *   batch.socket().setHostname("239.255.0.1");
+ *   batch.socket().setPort(5000);
+ *   batch.socket().initialize();
+ *   batch.setSequenceHeader(true);
+ *
+ *   batch.queue(packet->packet(), packet->packetSize());
+ *   batch.flush();
+ *
+ ******************************************************************************/
+
+#ifndef __DATAGRAM_BATCH_H_
+#define __DATAGRAM_BATCH_H_
+
+#include "network/udp_comm_socket.h"
+#include "network/io_result.h"
+
+#include <stdint.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+
+using namespace std;
+
+#define DATAGRAM_BATCH_MESSAGES 64
+#define DATAGRAM_BATCH_SIZE 262144
+#define MAX_DATAGRAM_SIZE 65507
+
+#define DATAGRAM_SEQUENCE_MAGIC 0x50415351
+#define DATAGRAM_SEQUENCE_HEADER_SIZE 12
+
+namespace network {
+    class DatagramBatch {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            DatagramBatch();
+            virtual ~DatagramBatch();
+
+            UDPCommSocket & socket() { return m_oSocket; }
+
+            void setSequenceHeader(bool enabled) { m_bSequenceHeader = enabled; }
+            bool sequenceHeader() { return m_bSequenceHeader; }
+
+            // Sequence number of the next datagram
+            uint64_t sequence() { return m_iSequence; }
+
+            // Datagrams queued and not yet sent
+            uint32_t pending() { return m_iCount; }
+
+            // Datagrams the socket refused
+            uint64_t dropped() { return m_iDropped; }
+
+            // Copy a datagram into the batch, flushing first if it is full
+            bool queue(const char *buffer, uint32_t size);
+
+            // Send everything queued.  Bytes in the result is the number of
+            // datagrams sent.
+            IOResult flush();
+
+        private:
+            DatagramBatch(const DatagramBatch &rhs);
+            DatagramBatch & operator=(const DatagramBatch &rhs);
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            UDPCommSocket m_oSocket;
+            bool m_bSequenceHeader;
+            uint64_t m_iSequence;
+            uint64_t m_iDropped;
+
+            // Payloads of the queued datagrams
+            char *m_pBuffer;
+            uint32_t m_iBytes;
+
+            uint32_t m_iCount;
+            struct mmsghdr m_aMessages[DATAGRAM_BATCH_MESSAGES];
+            struct iovec m_aIov[DATAGRAM_BATCH_MESSAGES][2];
+            char m_aHeaders[DATAGRAM_BATCH_MESSAGES][DATAGRAM_SEQUENCE_HEADER_SIZE];
+    };
+}
+
+#endif //__DATAGRAM_BATCH_H_
@@ -0,0 +1,69 @@
+/*******************************************************************************
+ * Class: IOResult
+ * Filename: io_result.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Result of a read or write on a comm object.  Routine conditions, like a
+ * peer closing the connection or a non-blocking socket with nothing to
+ * read, are reported in the status rather than thrown, so the event loop
+ * can handle client churn without unwinding the stack.  Exceptions are
+ * left for configuration errors.
+ *
+ * Usage:
+ *
+ *   IOResult result = socket.receive(buffer, sizeof(buffer));
+ *
+ *   if(result.status == IO_CLOSED)
+ *       handleDisconnect();
+ *   else if(result.status == IO_ERROR)
+ *       LOG(ERROR) << "read failed: " << result.what();
+ *
+ ******************************************************************************/
+
+#ifndef __IO_RESULT_H_
+#define __IO_RESULT_H_
+
+#include <stdint.h>
+#include <string.h>
+
+namespace network {
+    typedef enum IOStatus {
+        // bytes were transferred
+        IO_OK,
+        // non-blocking and not ready, bytes may hold a partial write
+        IO_WOULD_BLOCK,
+        // the peer closed or reset the connection
+        IO_CLOSED,
+        // there is no connection to read or write
+        IO_NOT_CONNECTED,
+        // any other failure, error holds errno
+        IO_ERROR
+    } IOStatus;
+
+    struct IOResult {
+        IOResult(IOStatus s = IO_OK, uint32_t b = 0, int e = 0) :
+            status(s), bytes(b), error(e) {}
+
+        bool ok() const { return status == IO_OK; }
+
+        // Description of the status for logging
+        const char * what() const {
+            switch(status) {
+                case IO_OK: return "ok";
+                case IO_WOULD_BLOCK: return "would block";
+                case IO_CLOSED: return "connection closed";
+                case IO_NOT_CONNECTED: return "not connected";
+                case IO_ERROR: return error ? strerror(error) : "error";
+            };
+
+            return "unknown";
+        }
+
+        IOStatus status;
+        uint32_t bytes;
+        int error;
+    };
+}
+
+#endif //__IO_RESULT_H_
@@ -36,13 +36,16 @@ using namespace network;
  ******************************************************************************/
 SerialCommSocket::SerialCommSocket() {
 
-    m_sDevicePath = "devicePath not initialized!";
+    m_sDevicePath = "";
     m_baud = B9600;
     m_parity = PARITY_NONE;
     m_dataBits = DATABITS_8;
     m_stopBits = STOPBITS_1;
     m_flowControl = FLOW_CONTROL_NONE;
 
+    // Configured until applying the serial settings fails, so the first
+    // initialize() opens the device once it has a path.
+    bIsConfigured = true;
 }
 
 
@@ -51,6 +54,13 @@ SerialCommSocket::SerialCommSocket() {
  * Description: Copy constructor.
  ******************************************************************************/
 SerialCommSocket::SerialCommSocket(const SerialCommSocket &rhs) {
+    bIsConfigured = rhs.bIsConfigured;
+    m_sDevicePath = rhs.m_sDevicePath;
+    m_baud = rhs.m_baud;
+    m_parity = rhs.m_parity;
+    m_dataBits = rhs.m_dataBits;
+    m_stopBits = rhs.m_stopBits;
+    m_flowControl = rhs.m_flowControl;
 }
 
 
@@ -90,7 +100,15 @@ bool SerialCommSocket::compare(CommBase *rhs) {
  * Description: overloaded assignment operator.
  ******************************************************************************/
 SerialCommSocket & SerialCommSocket::operator=(const SerialCommSocket &rhs) {
-	return *this;
+    bIsConfigured = rhs.bIsConfigured;
+    m_sDevicePath = rhs.m_sDevicePath;
+    m_baud = rhs.m_baud;
+    m_parity = rhs.m_parity;
+    m_dataBits = rhs.m_dataBits;
+    m_stopBits = rhs.m_stopBits;
+    m_flowControl = rhs.m_flowControl;
+
+    return *this;
 }
 
 /******************************************************************************
@@ -265,11 +283,12 @@ bool SerialCommSocket::initializeSerialSettings() {
 }
 
 /******************************************************************************
- * Method: isInitialized
- * Description: Has this object been configured?
+ * Method: isConfigured
+ * Description: Has this object been configured?  It needs a device path and
+ * serial settings that could be applied.
  ******************************************************************************/
 bool SerialCommSocket::isConfigured() {
-	return bIsConfigured;
+	return bIsConfigured && m_sDevicePath.length() > 0;
 }
 
 bool SerialCommSocket::connected() {
@@ -277,45 +296,45 @@ bool SerialCommSocket::connected() {
 }
 
 /******************************************************************************
- * Method: write
- * Description: write a number of bytes to the socket connection.  Currently we
- * try to write three times before we fail.  We might want to update this retry
- * so that it keeps retrying if it see progress being made?
+ * Method: transmit
+ * Description: write a number of bytes to the serial device.  Serial devices
+ * aren't sockets so this uses write rather than send.  A failed write closes
+ * the device.
  *
  * Parameters:
  *   buffer - the data to write
  *   size - the size of the buffer array
  * Return:
- *   returns the actual number of bytes written.
- * Exceptions:
- *   SocketNotConnected
- *   SocketWriteFailure
+ *   IO_OK, IO_WOULD_BLOCK with the bytes written so far, IO_NOT_CONNECTED or
+ *   IO_ERROR
  ******************************************************************************/
-uint32_t SerialCommSocket::writeData(const char *buffer, const uint32_t size) {
-    int bytesWritten = 0;
-    int bytesRemaining = size;
+IOResult SerialCommSocket::transmit(const char *buffer, const uint32_t size) {
+    uint32_t bytesWritten = 0;
     int count;
 
     if(! connected())
-        throw(SocketWriteFailure("not connected"));
+        return IOResult(IO_NOT_CONNECTED);
 
-    while( bytesRemaining > 0 ) {
+    while( bytesWritten < size ) {
         LOG(DEBUG) << "WRITE DEVICE: " << buffer;
-        count = write(m_pSocketFD, buffer + bytesWritten, bytesRemaining );
+        count = write(m_pSocketFD, buffer + bytesWritten, size - bytesWritten );
         LOG(DEBUG1) << "bytes written: " << count;
         if(count < 0) {
-            m_pSocketFD = 0;
-            LOG(ERROR) << strerror(errno) << "(errno: " << errno << ")";
-            throw(SocketWriteFailure(strerror(errno)));
+            int error = errno;
+            if(error == EAGAIN || error == EWOULDBLOCK)
+                return IOResult(IO_WOULD_BLOCK, bytesWritten, error);
+            
+            LOG(ERROR) << strerror(error) << "(errno: " << error << ")";
+            disconnect();
+            return IOResult(IO_ERROR, bytesWritten, error);
         }
 
         bytesWritten += count;
-        bytesRemaining -= count;
 
-        LOG(DEBUG2) << "wrote bytes: " << count << " bytes remaining: " << bytesRemaining;
+        LOG(DEBUG2) << "wrote bytes: " << count << " bytes remaining: " << size - bytesWritten;
     }
 
-    return bytesWritten;
+    return IOResult(IO_OK, bytesWritten);
 }
 
 bool SerialCommSocket::sendBreak(uint32_t  iDuration) {
@@ -63,7 +63,7 @@ namespace network {
             virtual bool compare(CommBase *rhs);
             virtual bool connectClient() { return false; }
 
-            virtual uint32_t writeData(const char *buffer, uint32_t size);
+            virtual IOResult transmit(const char *buffer, uint32_t size);
             bool sendBreak(uint32_t iDuration);
             void setDevicePath(string sDevicePath);
             const string &devicePath() { return m_sDevicePath; }
@@ -0,0 +1,379 @@
+/*******************************************************************************
+ * Class: StatsServer
+ * Filename: stats_server.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Each connection carries one HTTP/1.0 style request and response.  Only
+ * the request line is looked at, headers are read and ignored.
+ *
+ ******************************************************************************/
+
+#include "stats_server.h"
+#include "common/logger.h"
+#include "common/exception.h"
+#include "common/clock.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sstream>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace std;
+using namespace logger;
+using namespace network;
+
+/******************************************************************************
+ *   PUBLIC METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Constructor
+ * Description: Default constructor, nothing listens until initialize.
+ ******************************************************************************/
+StatsServer::StatsServer() {
+    m_iPort = 0;
+    m_iServerFD = 0;
+    m_iTimeout = STATS_CLIENT_TIMEOUT;
+}
+
+/******************************************************************************
+ * Method: Destructor
+ * Description: Close all connections.
+ ******************************************************************************/
+StatsServer::~StatsServer() {
+    disconnect();
+}
+
+/******************************************************************************
+ * Method: getListenPort
+ * Description: The port we are actually listening on, useful when bound to
+ * a random port.
+ * Return:
+ *   the port, 0 if not listening
+ * Exceptions:
+ *   SocketConnectFailure
+ ******************************************************************************/
+uint16_t StatsServer::getListenPort() {
+    struct sockaddr_in sin;
+    socklen_t len = sizeof(sin);
+
+    if(!listening())
+        return 0;
+
+    if(getsockname(m_iServerFD, (struct sockaddr *)&sin, &len) == -1)
+        throw SocketConnectFailure(strerror(errno));
+
+    return ntohs(sin.sin_port);
+}
+
+/******************************************************************************
+ * Method: initialize
+ * Description: Start listening on the loopback interface.  Scrapes come
+ * from a local collector, the metrics aren't exposed off the host.
+ * Return:
+ *   true on success
+ * Exceptions:
+ *   SocketCreateFailure
+ *   SocketConnectFailure
+ ******************************************************************************/
+bool StatsServer::initialize() {
+    struct sockaddr_in addr;
+    int optval = 1;
+    int fd;
+
+    disconnect();
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0)
+        throw SocketCreateFailure(strerror(errno));
+
+    if(setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval)) == -1) {
+        close(fd);
+        throw SocketCreateFailure("setsockopt SO_REUSADDR failure");
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(m_iPort);
+
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+       listen(fd, STATS_MAX_CLIENTS) < 0) {
+        string error = strerror(errno);
+        close(fd);
+        throw SocketConnectFailure(error);
+    }
+
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    m_iServerFD = fd;
+
+    LOG(DEBUG) << "stats server listening on port " << getListenPort();
+    return true;
+}
+
+/******************************************************************************
+ * Method: disconnect
+ * Description: Close the listener and every client.
+ ******************************************************************************/
+void StatsServer::disconnect() {
+    while(m_oClients.size())
+        drop(m_oClients.size() - 1);
+
+    if(m_iServerFD > 0)
+        close(m_iServerFD);
+
+    m_iServerFD = 0;
+}
+
+/******************************************************************************
+ * Method: addFDs
+ * Description: Add the listener and clients to the select sets.  Clients
+ * are watched for reads until they have asked for something and for writes
+ * while a response is unsent.
+ ******************************************************************************/
+void StatsServer::addFDs(int &maxFD, fd_set &readFDs, fd_set &writeFDs) {
+    if(!listening())
+        return;
+
+    FD_SET(m_iServerFD, &readFDs);
+    maxFD = m_iServerFD > maxFD ? m_iServerFD : maxFD;
+
+    for(size_t i = 0; i < m_oClients.size(); i++) {
+        StatsClient &client = m_oClients[i];
+
+        if(client.response.length())
+            FD_SET(client.fd, &writeFDs);
+        else if(!client.waiting)
+            FD_SET(client.fd, &readFDs);
+
+        maxFD = client.fd > maxFD ? client.fd : maxFD;
+    }
+}
+
+/******************************************************************************
+ * Method: handle
+ * Description: Read requests, finish responses and accept new clients.
+ * Clients are closed once their response has been sent, or when they
+ * reach their deadline first.
+ ******************************************************************************/
+void StatsServer::handle(const fd_set &readFDs, const fd_set &writeFDs) {
+    uint64_t current = now();
+
+    if(!listening())
+        return;
+
+    for(size_t i = m_oClients.size(); i > 0; i--) {
+        StatsClient &client = m_oClients[i - 1];
+
+        if(current >= client.deadline) {
+            LOG(DEBUG) << "stats client timed out, dropping fd: " << client.fd;
+            drop(i - 1);
+            continue;
+        }
+
+        if(FD_ISSET(client.fd, &readFDs) && !read(client)) {
+            drop(i - 1);
+            continue;
+        }
+
+        if(FD_ISSET(client.fd, &writeFDs) && !send(client))
+            drop(i - 1);
+    }
+
+    if(FD_ISSET(m_iServerFD, &readFDs))
+        while(acceptClient());
+}
+
+/******************************************************************************
+ * Method: waiting
+ * Description: Is any client waiting for the metrics?
+ ******************************************************************************/
+bool StatsServer::waiting() {
+    for(size_t i = 0; i < m_oClients.size(); i++)
+        if(m_oClients[i].waiting)
+            return true;
+
+    return false;
+}
+
+/******************************************************************************
+ * Method: respond
+ * Description: Answer every waiting client with the same body and send as
+ * much of it as we can now.
+ * Parameters:
+ *   body - Prometheus text format metrics
+ ******************************************************************************/
+void StatsServer::respond(const string &body) {
+    for(size_t i = m_oClients.size(); i > 0; i--) {
+        StatsClient &client = m_oClients[i - 1];
+
+        if(!client.waiting)
+            continue;
+
+        client.waiting = false;
+        reply(client, "200 OK", body);
+
+        if(!send(client))
+            drop(i - 1);
+    }
+}
+
+/******************************************************************************
+ * Method: acceptClient
+ * Description: Accept one waiting connection.
+ * Return:
+ *   true if a client was accepted
+ ******************************************************************************/
+bool StatsServer::acceptClient() {
+    StatsClient client;
+
+    if(!listening())
+        return false;
+
+    client.fd = accept(m_iServerFD, NULL, NULL);
+    if(client.fd < 0) {
+        if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            LOG(ERROR) << "stats client accept failed: " << strerror(errno);
+        return false;
+    }
+
+    if(m_oClients.size() >= STATS_MAX_CLIENTS) {
+        LOG(INFO) << "stats client limit reached, refusing fd: " << client.fd;
+        close(client.fd);
+        return false;
+    }
+
+    fcntl(client.fd, F_SETFL, O_NONBLOCK);
+    client.waiting = false;
+    client.sent = 0;
+    client.deadline = now() + m_iTimeout;
+    m_oClients.push_back(client);
+
+    LOG(DEBUG) << "new stats client fd: " << client.fd;
+    return true;
+}
+
+/******************************************************************************
+ *   PRIVATE METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: read
+ * Description: Read what the client has sent.  Once the request is complete
+ * it is either marked waiting for the metrics or answered with an error.
+ * Return:
+ *   false if the client should be dropped
+ ******************************************************************************/
+bool StatsServer::read(StatsClient &client) {
+    char buffer[1024];
+    string method, path;
+
+    ssize_t bytes = recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if(bytes == 0)
+        return false;
+
+    if(bytes < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+    // Already answered, ignore anything else sent
+    if(client.waiting || client.response.length())
+        return true;
+
+    client.request.append(buffer, bytes);
+
+    if(client.request.find("\r\n\r\n") == string::npos &&
+       client.request.find("\n\n") == string::npos) {
+        if(client.request.length() > STATS_MAX_REQUEST) {
+            LOG(INFO) << "stats request too large, dropping fd: " << client.fd;
+            return false;
+        }
+        return true;
+    }
+
+    istringstream line(client.request);
+    line >> method >> path;
+
+    if(method != "GET")
+        reply(client, "405 Method Not Allowed", "only GET is supported\n");
+    else if(path != "/metrics" && path != "/")
+        reply(client, "404 Not Found", "try /metrics\n");
+    else
+        client.waiting = true;
+
+    LOG(DEBUG2) << "stats request: " << method << " " << path;
+    return client.waiting || send(client);
+}
+
+/******************************************************************************
+ * Method: send
+ * Description: Send what we can of the client's response without waiting.
+ * Return:
+ *   false if the client should be dropped, which includes when the whole
+ *   response has been sent.
+ ******************************************************************************/
+bool StatsServer::send(StatsClient &client) {
+    while(client.sent < client.response.length()) {
+        ssize_t bytes = ::send(client.fd, client.response.data() + client.sent,
+                               client.response.length() - client.sent, MSG_NOSIGNAL);
+
+        if(bytes < 0) {
+            if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                return true;
+
+            LOG(DEBUG) << "stats send failed, fd: " << client.fd
+                       << " " << strerror(errno);
+            return false;
+        }
+
+        client.sent += bytes;
+    }
+
+    return client.response.length() == 0;
+}
+
+/******************************************************************************
+ * Method: reply
+ * Description: Build the response for a client.
+ ******************************************************************************/
+void StatsServer::reply(StatsClient &client, const string &status,
+                        const string &body) {
+    ostringstream out;
+
+    out << "HTTP/1.0 " << status << "\r\n"
+        << "Content-Type: text/plain; version=0.0.4\r\n"
+        << "Content-Length: " << body.length() << "\r\n"
+        << "Connection: close\r\n"
+        << "\r\n"
+        << body;
+
+    client.response = out.str();
+    client.sent = 0;
+}
+
+/******************************************************************************
+ * Method: drop
+ * Description: Close a client and remove it from the list.
+ ******************************************************************************/
+void StatsServer::drop(size_t index) {
+    close(m_oClients[index].fd);
+
+    m_oClients[index] = m_oClients.back();
+    m_oClients.pop_back();
+}
+
+/******************************************************************************
+ * Method: now
+ * Description: Coarse wall clock time for client deadlines.
+ * Return:
+ *   milliseconds since the unix epoch
+ ******************************************************************************/
+uint64_t StatsServer::now() {
+    struct timespec ts;
+    Clock::Coarse(ts);
+
+    return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
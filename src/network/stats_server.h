@@ -0,0 +1,127 @@
+/*******************************************************************************
+ * Class: StatsServer
+ * Filename: stats_server.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * A minimal HTTP server for monitoring scrapes, run from the port agent's
+ * select loop.  It listens on the loopback interface only and answers
+ * GET /metrics (or GET /) with whatever body the owner supplies, then closes
+ * the connection.  Anything else gets a 404 or 405.
+ *
+ * The server never blocks and never renders anything itself.  After
+ * handle() has read the requests waiting, waiting() says whether a client
+ * wants the metrics; the owner renders them once and passes them to
+ * respond(), which answers every waiting client.  Responses that don't fit
+ * in the socket buffer are finished as the client becomes writable.
+ *
+ * Clients beyond the connection limit are closed as soon as they are
+ * accepted, as are clients that send an oversized request.  A client has
+ * STATS_CLIENT_TIMEOUT milliseconds from connecting to send its request and
+ * read the response, then it is closed so idle connections can't hold the
+ * client slots.
+ *
+ * Usage:
+ *
+ *   StatsServer server;
+ *   server.setPort(9100);
+ *   server.initialize();
+ *
+ *   server.addFDs(maxFD, readFDs, writeFDs);
+ *   select(maxFD + 1, &readFDs, &writeFDs, NULL, &tv);
+ *
+ *   server.handle(readFDs, writeFDs);
+ *   if(server.waiting())
+ *       server.respond(Metrics::Prometheus());
+ *
+ ******************************************************************************/
+
+#ifndef __STATS_SERVER_H_
+#define __STATS_SERVER_H_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/select.h>
+
+using namespace std;
+
+#define STATS_MAX_CLIENTS 8
+#define STATS_MAX_REQUEST 4096
+#define STATS_CLIENT_TIMEOUT 5000
+
+namespace network {
+    typedef struct StatsClient {
+        int fd;
+        string request;
+        // Asked for the metrics and hasn't been answered
+        bool waiting;
+        // Response and how much of it has been sent
+        string response;
+        size_t sent;
+        // Closed if still connected at this time, in milliseconds
+        uint64_t deadline;
+    } StatsClient;
+
+    class StatsServer {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            StatsServer();
+            virtual ~StatsServer();
+
+            void setPort(uint16_t port) { m_iPort = port; }
+            void setTimeout(uint32_t timeout) { m_iTimeout = timeout; }
+
+            uint16_t port() { return m_iPort; }
+            uint32_t timeout() { return m_iTimeout; }
+            uint16_t getListenPort();
+            int serverFD() { return m_iServerFD; }
+            bool listening() { return m_iServerFD > 0; }
+            size_t clients() { return m_oClients.size(); }
+
+            bool initialize();
+            void disconnect();
+
+            // Add the listener and clients to select sets
+            void addFDs(int &maxFD, fd_set &readFDs, fd_set &writeFDs);
+
+            // Accept clients, read requests, finish responses and close
+            // clients past their deadline
+            void handle(const fd_set &readFDs, const fd_set &writeFDs);
+
+            // True if a client is waiting for the metrics
+            bool waiting();
+
+            // Answer every waiting client with body
+            void respond(const string &body);
+
+            bool acceptClient();
+
+        private:
+            StatsServer(const StatsServer &rhs);
+            StatsServer & operator=(const StatsServer &rhs);
+
+            bool read(StatsClient &client);
+            bool send(StatsClient &client);
+            void reply(StatsClient &client, const string &status,
+                       const string &body);
+            void drop(size_t index);
+            static uint64_t now();
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            uint16_t m_iPort;
+            int m_iServerFD;
+            uint32_t m_iTimeout;
+
+            vector<StatsClient> m_oClients;
+    };
+}
+
+#endif //__STATS_SERVER_H_
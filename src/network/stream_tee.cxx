@@ -0,0 +1,206 @@
+/*******************************************************************************
+ * Class: StreamTee
+ * Filename: stream_tee.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Read from a stream socket and copy the data to a second socket in-kernel.
+ *
+ ******************************************************************************/
+
+#include "stream_tee.h"
+#include "common/logger.h"
+#include "common/exception.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace logger;
+using namespace network;
+
+/******************************************************************************
+ *   PUBLIC METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Constructor
+ * Description: Default constructor.  The pipes are created by initialize.
+ ******************************************************************************/
+StreamTee::StreamTee() {
+    m_iSourcePipe[0] = m_iSourcePipe[1] = -1;
+    m_iSinkPipe[0] = m_iSinkPipe[1] = -1;
+
+    m_bSupported = true;
+    m_iPending = 0;
+    m_iTeed = 0;
+    m_iDropped = 0;
+}
+
+/******************************************************************************
+ * Method: Destructor
+ ******************************************************************************/
+StreamTee::~StreamTee() {
+    close();
+}
+
+/******************************************************************************
+ * Method: initialize
+ * Description: Create the source and sink pipes.
+ * Exceptions:
+ *   SocketCreateFailure
+ ******************************************************************************/
+void StreamTee::initialize() {
+    close();
+
+    if(pipe2(m_iSourcePipe, O_NONBLOCK | O_CLOEXEC) < 0 ||
+       pipe2(m_iSinkPipe, O_NONBLOCK | O_CLOEXEC) < 0) {
+        string error = strerror(errno);
+        close();
+        throw SocketCreateFailure(error);
+    }
+
+    m_bSupported = true;
+}
+
+/******************************************************************************
+ * Method: receive
+ * Description: Splice what is waiting on the source into the source pipe,
+ * tee it into the sink pipe and send that to the sink, then read the source
+ * pipe into the buffer.
+ *
+ * Parameters:
+ *   source - connected stream socket select says is readable
+ *   buffer - where to put the data read
+ *   size - most bytes to read
+ *   sink - descriptor to copy the data to, negative for none
+ * Return:
+ *   IO_OK with the bytes read, IO_WOULD_BLOCK, IO_CLOSED, IO_NOT_CONNECTED or
+ *   IO_ERROR.  IO_ERROR with EINVAL means the source can't be spliced.
+ ******************************************************************************/
+IOResult StreamTee::receive(CommSocket *source, char *buffer, uint32_t size, int sink) {
+    ssize_t bytes, copied;
+    uint32_t total = 0;
+
+    if(! source || ! source->connected() || ! initialized())
+        return IOResult(IO_NOT_CONNECTED);
+
+    if(sink >= 0 && m_iPending)
+        flushPending(sink);
+
+    bytes = splice(source->getSocketFD(), NULL, m_iSourcePipe[1], NULL, size,
+                   SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+    if(bytes < 0) {
+        int error = errno;
+
+        if(error == EAGAIN || error == EINTR)
+            return IOResult(IO_WOULD_BLOCK, 0, error);
+
+        if(error == EINVAL) {
+            LOG(INFO) << "source can't be spliced, falling back to read";
+            m_bSupported = false;
+            return IOResult(IO_ERROR, 0, error);
+        }
+
+        LOG(ERROR) << "splice from source failed: " << strerror(error);
+        source->disconnect();
+
+        if(error == ECONNRESET)
+            return IOResult(IO_CLOSED, 0, error);
+        return IOResult(IO_ERROR, 0, error);
+    }
+    else if(bytes == 0) {
+        LOG(INFO) << " -- Device connection closed. zero bytes spliced.";
+        source->disconnect();
+        return IOResult(IO_CLOSED);
+    }
+
+    if(sink >= 0) {
+        copied = tee(m_iSourcePipe[0], m_iSinkPipe[1], bytes, SPLICE_F_NONBLOCK);
+        if(copied < 0)
+            copied = 0;
+
+        m_iPending += copied;
+        m_iDropped += bytes - copied;
+        flushPending(sink);
+    }
+
+    // tee doesn't consume the source pipe, this is the one user space copy
+    while(total < (uint32_t)bytes) {
+        ssize_t res = read(m_iSourcePipe[0], buffer + total, bytes - total);
+        if(res <= 0)
+            break;
+        total += res;
+    }
+
+    LOG(DEBUG2) << "spliced " << total << " bytes, sink pending: " << m_iPending;
+    return IOResult(IO_OK, total);
+}
+
+/******************************************************************************
+ * Method: reset
+ * Description: Throw away data waiting for the sink.  The sink pipe is
+ * recreated, there is no cheaper way to empty it without a copy.
+ ******************************************************************************/
+void StreamTee::reset() {
+    if(! m_iPending)
+        return;
+
+    m_iDropped += m_iPending;
+    m_iPending = 0;
+
+    if(m_iSinkPipe[0] >= 0) ::close(m_iSinkPipe[0]);
+    if(m_iSinkPipe[1] >= 0) ::close(m_iSinkPipe[1]);
+    m_iSinkPipe[0] = m_iSinkPipe[1] = -1;
+
+    if(pipe2(m_iSinkPipe, O_NONBLOCK | O_CLOEXEC) < 0) {
+        LOG(ERROR) << "failed to recreate sink pipe: " << strerror(errno);
+        close();
+    }
+}
+
+/******************************************************************************
+ *   PRIVATE METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: flushPending
+ * Description: Move what we can from the sink pipe to the sink without
+ * waiting.  If the sink has failed the data is discarded.
+ ******************************************************************************/
+void StreamTee::flushPending(int sink) {
+    while(m_iPending) {
+        ssize_t bytes = splice(m_iSinkPipe[0], NULL, sink, NULL, m_iPending,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+        if(bytes > 0) {
+            m_iPending -= bytes;
+            m_iTeed += bytes;
+            continue;
+        }
+
+        if(bytes < 0 && errno != EAGAIN && errno != EINTR) {
+            LOG(DEBUG) << "splice to sink failed: " << strerror(errno);
+            reset();
+        }
+
+        break;
+    }
+}
+
+/******************************************************************************
+ * Method: close
+ * Description: Close the pipes.
+ ******************************************************************************/
+void StreamTee::close() {
+    for(int i = 0; i < 2; i++) {
+        if(m_iSourcePipe[i] >= 0) ::close(m_iSourcePipe[i]);
+        if(m_iSinkPipe[i] >= 0) ::close(m_iSinkPipe[i]);
+        m_iSourcePipe[i] = m_iSinkPipe[i] = -1;
+    }
+
+    m_iPending = 0;
+}
@@ -0,0 +1,102 @@
+/*******************************************************************************
+ * Class: StreamTee
+ * Filename: stream_tee.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Read from a stream socket and copy what was read to a second socket
+ * without the copy passing through user space.  Data is spliced from the
+ * source into a pipe, tee'd into a second pipe that is spliced to the sink,
+ * then read out of the first pipe into the caller's buffer.  The port agent
+ * still gets every byte for its archive and publishers while the sniffer
+ * copy stays in the kernel.
+ *
+ * The sink is best effort.  If it can't keep up, data waits in the sink pipe
+ * and anything that doesn't fit there is dropped and counted, the read from
+ * the source never waits on the sink.
+ *
+ * Not every source can be spliced.  If the kernel refuses, receive() returns
+ * IO_ERROR with EINVAL, supported() turns false and the caller should fall
+ * back to a normal read.  Kernel receive timestamps need recvmsg, so they
+ * aren't available on this path either.
+ *
+ * Usage:
+ *
+ * StreamTee tee;
+ * tee.initialize();
+ *
+ * IOResult result = tee.receive(&instrument, buffer, sizeof(buffer), snifferFD);
+ *
+ ******************************************************************************/
+
+#ifndef __STREAM_TEE_H_
+#define __STREAM_TEE_H_
+
+#include "network/comm_socket.h"
+#include "network/io_result.h"
+
+#include <stdint.h>
+
+using namespace std;
+
+namespace network {
+    class StreamTee {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            ///////////////////////
+            // Public Methods
+            StreamTee();
+            virtual ~StreamTee();
+
+            /* Accessors */
+            bool initialized() { return m_iSourcePipe[0] >= 0; }
+
+            // false once the kernel refused to splice from a source
+            bool supported() { return m_bSupported; }
+
+            // Bytes waiting for the sink
+            uint32_t pending() { return m_iPending; }
+
+            // Bytes copied to the sink and bytes the sink missed
+            uint64_t teed() { return m_iTeed; }
+            uint64_t dropped() { return m_iDropped; }
+
+            /* Commands */
+
+            // Create the pipes, throws SocketCreateFailure
+            void initialize();
+
+            // Read up to size bytes from the source, copy them to the sink if
+            // it's a valid descriptor.  Closed or failed sources are
+            // disconnected like CommSocket::receive.
+            IOResult receive(CommSocket *source, char *buffer, uint32_t size, int sink);
+
+            // Discard data waiting for the sink, e.g. when the client changes
+            void reset();
+
+        private:
+            StreamTee(const StreamTee &rhs);
+            StreamTee & operator=(const StreamTee &rhs);
+
+            void flushPending(int sink);
+            void close();
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            int m_iSourcePipe[2];
+            int m_iSinkPipe[2];
+
+            bool m_bSupported;
+            uint32_t m_iPending;
+            uint64_t m_iTeed;
+            uint64_t m_iDropped;
+    };
+}
+
+#endif //__STREAM_TEE_H_
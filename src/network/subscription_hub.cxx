@@ -0,0 +1,427 @@
+/*******************************************************************************
+ * Class: SubscriptionHub
+ * Filename: subscription_hub.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Positions in the ring are absolute byte counts.  The byte at position p is
+ * stored at p % ring size, so a subscriber is behind by head - cursor bytes
+ * and has been overrun once that exceeds the ring size.
+ *
+ ******************************************************************************/
+
+#include "subscription_hub.h"
+#include "common/logger.h"
+#include "common/exception.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+using namespace std;
+using namespace logger;
+using namespace network;
+
+/******************************************************************************
+ *   PUBLIC METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Constructor
+ * Description: Default constructor, nothing is allocated until data is
+ * published.
+ ******************************************************************************/
+SubscriptionHub::SubscriptionHub() {
+    m_iPort = 0;
+    m_iServerFD = 0;
+    m_pRing = NULL;
+    m_iRingSize = DEFAULT_SUBSCRIPTION_RING_SIZE;
+    m_iHead = 0;
+    m_iMaxSubscribers = DEFAULT_SUBSCRIPTION_SUBSCRIBERS;
+    m_iOverruns = 0;
+}
+
+/******************************************************************************
+ * Method: Destructor
+ * Description: Close all connections and free the ring.
+ ******************************************************************************/
+SubscriptionHub::~SubscriptionHub() {
+    disconnect();
+
+    if(m_pRing)
+        free(m_pRing);
+}
+
+/******************************************************************************
+ * Method: setRingSize
+ * Description: Set the size of the shared ring.  Data that hasn't been sent
+ * yet is discarded when the size changes.
+ * Parameters:
+ *   size - ring size in bytes, raised to MIN_SUBSCRIPTION_RING_SIZE if smaller
+ ******************************************************************************/
+void SubscriptionHub::setRingSize(uint32_t size) {
+    if(size < MIN_SUBSCRIPTION_RING_SIZE)
+        size = MIN_SUBSCRIPTION_RING_SIZE;
+
+    if(size == m_iRingSize)
+        return;
+
+    if(m_pRing)
+        free(m_pRing);
+
+    m_pRing = NULL;
+    m_iRingSize = size;
+
+    for(size_t i = 0; i < m_oSubscribers.size(); i++)
+        m_oSubscribers[i].cursor = m_iHead;
+}
+
+/******************************************************************************
+ * Method: getListenPort
+ * Description: Get the port the listener is bound to.  Useful when the
+ * configured port is 0.
+ * Return:
+ *   port number, 0 if not listening
+ ******************************************************************************/
+uint16_t SubscriptionHub::getListenPort() {
+    struct sockaddr_in sin;
+    socklen_t len = sizeof(sin);
+
+    if(!listening())
+        return 0;
+
+    if(getsockname(m_iServerFD, (struct sockaddr *)&sin, &len) == -1)
+        throw SocketConnectFailure(strerror(errno));
+
+    return ntohs(sin.sin_port);
+}
+
+/******************************************************************************
+ * Method: pending
+ * Description: How far the slowest subscriber is behind.
+ * Return:
+ *   bytes in the ring not yet sent to every subscriber
+ ******************************************************************************/
+uint64_t SubscriptionHub::pending() {
+    uint64_t result = 0;
+
+    for(size_t i = 0; i < m_oSubscribers.size(); i++)
+        if(m_iHead - m_oSubscribers[i].cursor > result)
+            result = m_iHead - m_oSubscribers[i].cursor;
+
+    return result;
+}
+
+/******************************************************************************
+ * Method: initialize
+ * Description: Start listening.  Any existing listener and subscribers are
+ * closed first.
+ * Return:
+ *   true on success
+ * Exceptions:
+ *   SocketCreateFailure
+ *   SocketConnectFailure
+ ******************************************************************************/
+bool SubscriptionHub::initialize() {
+    struct sockaddr_in addr;
+    int optval = 1;
+    int fd;
+
+    disconnect();
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0)
+        throw SocketCreateFailure(strerror(errno));
+
+    if(setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval)) == -1) {
+        close(fd);
+        throw SocketCreateFailure("setsockopt SO_REUSADDR failure");
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(m_iPort);
+
+    // Unlike the single client listeners, subscribers can connect at the
+    // same time so keep a full backlog.
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+       listen(fd, SOMAXCONN) < 0) {
+        string error = strerror(errno);
+        close(fd);
+        throw SocketConnectFailure(error);
+    }
+
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    m_iServerFD = fd;
+
+    LOG(DEBUG) << "subscription hub listening on port " << getListenPort();
+    return true;
+}
+
+/******************************************************************************
+ * Method: disconnect
+ * Description: Close the listener and all subscribers.
+ ******************************************************************************/
+void SubscriptionHub::disconnect() {
+    while(m_oSubscribers.size())
+        drop(m_oSubscribers.size() - 1);
+
+    if(m_iServerFD > 0)
+        close(m_iServerFD);
+
+    m_iServerFD = 0;
+}
+
+/******************************************************************************
+ * Method: addFDs
+ * Description: Add the listener and subscribers to the read set, and
+ * subscribers that have unsent data to the write set.  Also update the max
+ * file descriptor.
+ ******************************************************************************/
+void SubscriptionHub::addFDs(int &maxFD, fd_set &readFDs, fd_set &writeFDs) {
+    if(!listening())
+        return;
+
+    FD_SET(m_iServerFD, &readFDs);
+    maxFD = m_iServerFD > maxFD ? m_iServerFD : maxFD;
+
+    for(size_t i = 0; i < m_oSubscribers.size(); i++) {
+        int fd = m_oSubscribers[i].fd;
+
+        FD_SET(fd, &readFDs);
+        if(m_oSubscribers[i].cursor != m_iHead)
+            FD_SET(fd, &writeFDs);
+
+        maxFD = fd > maxFD ? fd : maxFD;
+    }
+}
+
+/******************************************************************************
+ * Method: handle
+ * Description: Accept waiting subscribers, discard anything subscribers send
+ * and drop those that have closed, and continue sends that were blocked.
+ ******************************************************************************/
+void SubscriptionHub::handle(const fd_set &readFDs, const fd_set &writeFDs) {
+    char buffer[512];
+
+    if(!listening())
+        return;
+
+    for(size_t i = m_oSubscribers.size(); i > 0; i--) {
+        Subscriber &subscriber = m_oSubscribers[i - 1];
+
+        if(FD_ISSET(subscriber.fd, &readFDs)) {
+            ssize_t bytes = recv(subscriber.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+
+            if(bytes == 0 || (bytes < 0 && errno != EAGAIN && errno != EINTR)) {
+                LOG(DEBUG) << "subscriber disconnected, fd: " << subscriber.fd;
+                drop(i - 1);
+                continue;
+            }
+        }
+
+        if(FD_ISSET(subscriber.fd, &writeFDs) && !send(subscriber))
+            drop(i - 1);
+    }
+
+    if(FD_ISSET(m_iServerFD, &readFDs))
+        while(acceptSubscriber());
+}
+
+/******************************************************************************
+ * Method: acceptSubscriber
+ * Description: Accept one waiting connection.  New subscribers start at the
+ * ring head and only see data published after they connect.
+ * Return:
+ *   true if a subscriber was added
+ ******************************************************************************/
+bool SubscriptionHub::acceptSubscriber() {
+    Subscriber subscriber;
+
+    if(!listening())
+        return false;
+
+    subscriber.fd = accept(m_iServerFD, NULL, NULL);
+    if(subscriber.fd < 0) {
+        if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            LOG(ERROR) << "subscriber accept failed: " << strerror(errno);
+        return false;
+    }
+
+    if(m_iMaxSubscribers && m_oSubscribers.size() >= m_iMaxSubscribers) {
+        LOG(INFO) << "subscriber limit reached, refusing fd: " << subscriber.fd;
+        close(subscriber.fd);
+        return false;
+    }
+
+    // addFDs can't select on it
+    if(subscriber.fd >= FD_SETSIZE) {
+        LOG(ERROR) << "subscriber fd too large for select, refusing fd: "
+                   << subscriber.fd;
+        close(subscriber.fd);
+        return false;
+    }
+
+    fcntl(subscriber.fd, F_SETFL, O_NONBLOCK);
+    subscriber.cursor = m_iHead;
+    m_oSubscribers.push_back(subscriber);
+
+    LOG(DEBUG) << "new subscriber fd: " << subscriber.fd
+               << " subscribers: " << m_oSubscribers.size();
+    return true;
+}
+
+/******************************************************************************
+ * Method: publish
+ * Description: Append data to the ring.  Nothing is sent until flush().
+ * Parameters:
+ *   buffer - data to publish
+ *   size - bytes in buffer
+ * Return:
+ *   false if the data is bigger than the ring
+ ******************************************************************************/
+bool SubscriptionHub::publish(const char *buffer, uint32_t size) {
+    struct iovec iov;
+
+    iov.iov_base = (void *)buffer;
+    iov.iov_len = size;
+
+    return publish(&iov, 1);
+}
+
+/******************************************************************************
+ * Method: publish
+ * Description: Append the pieces of one packet to the ring.  Nothing is sent
+ * until flush().  Subscribers still holding the part of the ring this
+ * overwrites are dropped.
+ * Parameters:
+ *   iov - pieces to publish, in order
+ *   count - number of pieces
+ * Return:
+ *   false if the data is bigger than the ring
+ ******************************************************************************/
+bool SubscriptionHub::publish(const struct iovec *iov, int count) {
+    uint64_t size = 0;
+
+    for(int i = 0; i < count; i++)
+        size += iov[i].iov_len;
+
+    if(size > m_iRingSize) {
+        LOG(ERROR) << "subscription data larger than ring, dropped: " << size;
+        return false;
+    }
+
+    if(!size)
+        return true;
+
+    // No one to keep it for
+    if(m_oSubscribers.empty()) {
+        m_iHead += size;
+        return true;
+    }
+
+    if(!m_pRing) {
+        m_pRing = (char *)malloc(m_iRingSize);
+        if(!m_pRing) {
+            LOG(ERROR) << "failed to allocate subscription ring";
+            return false;
+        }
+    }
+
+    for(size_t i = m_oSubscribers.size(); i > 0; i--) {
+        if(m_iHead + size - m_oSubscribers[i - 1].cursor > m_iRingSize) {
+            LOG(INFO) << "subscriber fell behind, disconnecting fd: "
+                      << m_oSubscribers[i - 1].fd;
+            drop(i - 1);
+            m_iOverruns++;
+        }
+    }
+
+    for(int i = 0; i < count; i++) {
+        const char *buffer = (const char *)iov[i].iov_base;
+        uint32_t length = iov[i].iov_len;
+        uint32_t offset = m_iHead % m_iRingSize;
+        uint32_t first = m_iRingSize - offset < length ? m_iRingSize - offset : length;
+
+        memcpy(m_pRing + offset, buffer, first);
+        if(first < length)
+            memcpy(m_pRing, buffer + first, length - first);
+
+        m_iHead += length;
+    }
+
+    return true;
+}
+
+/******************************************************************************
+ * Method: flush
+ * Description: Send each subscriber what it hasn't seen, dropping those that
+ * fail.
+ ******************************************************************************/
+void SubscriptionHub::flush() {
+    for(size_t i = m_oSubscribers.size(); i > 0; i--) {
+        if(m_oSubscribers[i - 1].cursor != m_iHead && !send(m_oSubscribers[i - 1]))
+            drop(i - 1);
+    }
+}
+
+/******************************************************************************
+ *   PRIVATE METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: send
+ * Description: Send a subscriber everything between its cursor and the head
+ * in one call, two pieces if the data wraps the end of the ring.
+ * Return:
+ *   false if the connection failed
+ ******************************************************************************/
+bool SubscriptionHub::send(Subscriber &subscriber) {
+    struct iovec iov[2];
+    struct msghdr msg;
+    uint64_t bytes = m_iHead - subscriber.cursor;
+    uint32_t offset = subscriber.cursor % m_iRingSize;
+
+    if(!bytes)
+        return true;
+
+    iov[0].iov_base = m_pRing + offset;
+    iov[0].iov_len = m_iRingSize - offset < bytes ? m_iRingSize - offset : bytes;
+    iov[1].iov_base = m_pRing;
+    iov[1].iov_len = bytes - iov[0].iov_len;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov[1].iov_len ? 2 : 1;
+
+    ssize_t sent = sendmsg(subscriber.fd, &msg, MSG_NOSIGNAL);
+    if(sent < 0) {
+        if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+            return true;
+
+        LOG(DEBUG) << "subscriber send failed, fd: " << subscriber.fd
+                   << " " << strerror(errno);
+        return false;
+    }
+
+    subscriber.cursor += sent;
+    return true;
+}
+
+/******************************************************************************
+ * Method: drop
+ * Description: Close a subscriber and remove it from the list.  The last
+ * subscriber takes its place.
+ ******************************************************************************/
+void SubscriptionHub::drop(size_t index) {
+    close(m_oSubscribers[index].fd);
+
+    m_oSubscribers[index] = m_oSubscribers.back();
+    m_oSubscribers.pop_back();
+}
@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * Class: SubscriptionHub
+ * Filename: subscription_hub.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * A TCP listener that any number of clients can subscribe to.  Data is
+ * written once into a ring shared by every subscriber, and each subscriber
+ * keeps a cursor into the ring marking how much it has been sent.  A region
+ * of the ring is held as long as any subscriber's cursor is behind it, so
+ * the cost of publishing doesn't grow with the number of subscribers; only
+ * the sends do.
+ *
+ * publish() only appends to the ring.  flush() sends each subscriber
+ * everything it hasn't seen in at most one call, so packets published
+ * during one pass of the event loop are coalesced.  A subscriber that falls
+ * a full ring behind is disconnected rather than holding up the others.
+ *
+ * Subscribers are expected to only read.  Anything they send is discarded.
+ * Connections beyond the subscriber limit, DEFAULT_SUBSCRIPTION_SUBSCRIBERS
+ * unless set, are closed as soon as they are accepted.  So are connections
+ * whose descriptor is too big for an fd_set.
+ *
+ * A packet made of several pieces, e.g. framing around a payload, can be
+ * published from an iovec so it is rendered into the ring once without
+ * first being assembled in a temporary buffer.
+ *
+ * Usage:
+ *
+ *   SubscriptionHub hub;
+ *   hub.setPort(4005);
+ *   hub.setRingSize(1 << 20);
+ *   hub.initialize();
+ *
+ *   hub.addFDs(maxFD, readFDs, writeFDs);
+ *   select(maxFD + 1, &readFDs, &writeFDs, NULL, &tv);
+ *
+ *   // accept new subscribers and drop closed ones
+ *   hub.handle(readFDs, writeFDs);
+ *
+ *   hub.publish(packet->packet(), packet->packetSize());
+ *   hub.flush();
+ *
+ ******************************************************************************/
+
+#ifndef __SUBSCRIPTION_HUB_H_
+#define __SUBSCRIPTION_HUB_H_
+
+#include <vector>
+#include <stdint.h>
+#include <sys/select.h>
+#include <sys/uio.h>
+
+using namespace std;
+
+#define DEFAULT_SUBSCRIPTION_RING_SIZE 1048576
+#define MIN_SUBSCRIPTION_RING_SIZE 4096
+#define MAX_SUBSCRIPTION_RING_SIZE 268435456
+#define DEFAULT_SUBSCRIPTION_SUBSCRIBERS 64
+#define MAX_SUBSCRIPTION_SUBSCRIBERS 512
+
+namespace network {
+    typedef struct Subscriber {
+        int fd;
+        // Ring position of the next byte to send
+        uint64_t cursor;
+    } Subscriber;
+
+    class SubscriptionHub {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            SubscriptionHub();
+            virtual ~SubscriptionHub();
+
+            void setPort(uint16_t port) { m_iPort = port; }
+            void setRingSize(uint32_t size);
+            
+            // Most subscribers at once, 0 for no limit
+            void setMaxSubscribers(uint32_t count) { m_iMaxSubscribers = count; }
+            uint32_t maxSubscribers() { return m_iMaxSubscribers; }
+
+            uint16_t port() { return m_iPort; }
+            uint16_t getListenPort();
+            uint32_t ringSize() { return m_iRingSize; }
+            int serverFD() { return m_iServerFD; }
+            bool listening() { return m_iServerFD > 0; }
+            size_t subscribers() { return m_oSubscribers.size(); }
+
+            // Total bytes written to the ring
+            uint64_t head() { return m_iHead; }
+
+            // Bytes written to the ring that haven't been sent to everyone
+            uint64_t pending();
+
+            // Subscribers disconnected for falling a full ring behind
+            uint64_t overruns() { return m_iOverruns; }
+
+            bool initialize();
+            void disconnect();
+
+            // Add the listener, subscribers, and subscribers with unsent
+            // data to select sets
+            void addFDs(int &maxFD, fd_set &readFDs, fd_set &writeFDs);
+
+            // Accept new subscribers and drop those that have closed
+            void handle(const fd_set &readFDs, const fd_set &writeFDs);
+
+            bool acceptSubscriber();
+            bool publish(const char *buffer, uint32_t size);
+            bool publish(const struct iovec *iov, int count);
+            void flush();
+
+        private:
+            SubscriptionHub(const SubscriptionHub &rhs);
+            SubscriptionHub & operator=(const SubscriptionHub &rhs);
+
+            bool send(Subscriber &subscriber);
+            void drop(size_t index);
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            uint16_t m_iPort;
+            int m_iServerFD;
+
+            vector<Subscriber> m_oSubscribers;
+            uint32_t m_iMaxSubscribers;
+
+            char *m_pRing;
+            uint32_t m_iRingSize;
+
+            // Ring position of the next byte published
+            uint64_t m_iHead;
+
+            uint64_t m_iOverruns;
+    };
+}
+
+#endif //__SUBSCRIPTION_HUB_H_
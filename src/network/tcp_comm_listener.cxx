@@ -379,31 +379,59 @@ bool TCPCommListener::initialize() {
  *   SocketWriteFailure
  ******************************************************************************/
 uint32_t TCPCommListener::writeData(const char *buffer, const uint32_t size) {
-    int bytesWritten = 0;
-    int bytesRemaining = size;
+    IOResult result = transmit(buffer, size);
+
+    if(result.status == IO_CLOSED || result.status == IO_ERROR)
+        throw(SocketWriteFailure(result.what()));
+
+    return result.bytes;
+}
+
+/******************************************************************************
+ * Method: transmit
+ * Description: write a number of bytes to the client connection.  If the
+ * client has gone away the client connection is closed so the listener can
+ * accept a new one.
+ *
+ * Parameters:
+ *   buffer - the data to write
+ *   size - the size of the buffer array
+ * Return:
+ *   IO_OK, IO_WOULD_BLOCK with the bytes written so far, IO_CLOSED,
+ *   IO_NOT_CONNECTED or IO_ERROR
+ ******************************************************************************/
+IOResult TCPCommListener::transmit(const char *buffer, const uint32_t size) {
+    uint32_t bytesWritten = 0;
     int count;
 
     if(! connected()) {
 		LOG(DEBUG) << "Socket (FD: " << m_pClientFD << ") not connected";
-		return 0;
+		return IOResult(IO_NOT_CONNECTED);
     }
     
-    while( bytesRemaining > 0 ) {
+    while( bytesWritten < size ) {
         LOG(DEBUG) << "WRITE DEVICE: " << buffer << "FD: " << m_pClientFD;
-        count = write(m_pClientFD, buffer + bytesWritten, bytesRemaining );
-        LOG(DEBUG1) << "bytes written: " << count << " remaining: " << bytesRemaining;
+        count = send(m_pClientFD, buffer + bytesWritten, size - bytesWritten, MSG_NOSIGNAL);
+        LOG(DEBUG1) << "bytes written: " << count << " remaining: " << size - bytesWritten;
         if(count < 0) {
-            LOG(ERROR) << strerror(errno) << "(errno: " << errno << ")";
-            throw(SocketWriteFailure(strerror(errno)));
+            int error = errno;
+            if(error == EAGAIN || error == EWOULDBLOCK)
+                return IOResult(IO_WOULD_BLOCK, bytesWritten, error);
+            
+            LOG(ERROR) << strerror(error) << "(errno: " << error << ")";
+            if(error == EPIPE || error == ECONNRESET) {
+                disconnectClient();
+                return IOResult(IO_CLOSED, bytesWritten, error);
+            }
+            return IOResult(IO_ERROR, bytesWritten, error);
         }
 
         bytesWritten += count;
-        bytesRemaining -= count;
 
-        LOG(DEBUG2) << "wrote bytes: " << count << " bytes remaining: " << bytesRemaining;
+        LOG(DEBUG2) << "wrote bytes: " << count << " bytes remaining: " << size - bytesWritten;
     }
 
-    return bytesWritten;
+    return IOResult(IO_OK, bytesWritten);
 }
 
 
@@ -422,32 +450,60 @@ uint32_t TCPCommListener::writeData(const char *buffer, const uint32_t size) {
  *   SocketReadFailure
  ******************************************************************************/
 uint32_t TCPCommListener::readData(char *buffer, const uint32_t size) {
-    int bytesRead = 0;
+    IOResult result = receive(buffer, size);
 
-    if(! connected()) {
+    if(result.status == IO_NOT_CONNECTED) {
 	    LOG(ERROR) << "Socket Not Connected in readData";
         throw(SocketNotConnected("in TCPCommListener readData"));
 	}
     
+    if(result.status == IO_ERROR)
+        throw(SocketReadFailure(result.what()));
+
+    return result.bytes;
+}
+
+/******************************************************************************
+ * Method: receive
+ * Description: read a number of bytes from the client connection.  The client
+ * connection is closed when the client closes it, resets it or times out.
+ *
+ * Parameters:
+ *   buffer - where to store the read data
+ *   size - max number of bytes to read
+ * Return:
+ *   IO_OK with the bytes read, IO_WOULD_BLOCK, IO_CLOSED, IO_NOT_CONNECTED
+ *   or IO_ERROR
+ ******************************************************************************/
+IOResult TCPCommListener::receive(char *buffer, const uint32_t size) {
+    int bytesRead = 0;
+
+    if(! connected())
+        return IOResult(IO_NOT_CONNECTED);
+    
     if ((bytesRead = read(m_pClientFD, buffer, size)) < 0) {
-        if (errno == EAGAIN || errno == EINPROGRESS) {
-            LOG(DEBUG2) << "Error Ignored: " << strerror(errno);
-        } else if( errno == ETIMEDOUT ) {
-            LOG(DEBUG) << " -- socket read timeout. disconnecting client FD:" << m_pClientFD;
+        int error = errno;
+        
+        if (error == EAGAIN || error == EINPROGRESS) {
+            LOG(DEBUG2) << "Error Ignored: " << strerror(error);
+            return IOResult(IO_WOULD_BLOCK, 0, error);
+        }
+        
+        if( error == ETIMEDOUT || error == ECONNRESET ) {
+            LOG(DEBUG) << " -- " << strerror(error) << ". disconnecting client FD:" << m_pClientFD;
             disconnectClient();
-        } else {
-            LOG(ERROR) << "bytes read: " << bytesRead << " read_device: " << strerror(errno) << "(errno: " << errno << ")";
-            throw(SocketReadFailure(strerror(errno)));
+            return IOResult(IO_CLOSED, 0, error);
         }
-
-        LOG(DEBUG2) << "read bytes: " << bytesRead;
+        
+        LOG(ERROR) << "bytes read: " << bytesRead << " read_device: " << strerror(error) << "(errno: " << error << ")";
+        return IOResult(IO_ERROR, 0, error);
     }
     else if(bytesRead == 0) {
         LOG(INFO) << " -- Device connection closed; zero bytes received. port: " << m_iPort;
         disconnectClient();
+        return IOResult(IO_CLOSED);
     }
-    else
-        LOG(DEBUG) << "READ DEVICE: " << buffer;
-
-    return bytesRead < 0 ? 0 : bytesRead;
+    
+    LOG(DEBUG) << "READ DEVICE: " << buffer;
+    return IOResult(IO_OK, bytesRead);
 }
@@ -91,7 +91,8 @@ namespace network {
 	        /* Commands */
 	        bool disconnect();
 	        bool disconnectClient(bool server_shutdown = false);
-	        bool disconnectServer();
+	        virtual bool disconnectServer();
+	        bool dropClient() { return disconnectClient(); }
     	    
 	        bool acceptClient();
 			
@@ -100,6 +101,9 @@ namespace network {
             
 	        virtual uint32_t writeData(const char *buffer, uint32_t size);
             virtual uint32_t readData(char *buffer, uint32_t size);
+            
+            virtual IOResult transmit(const char *buffer, uint32_t size);
+            virtual IOResult receive(char *buffer, uint32_t size);
 
             // Does this object have a complete configuration?
             bool isConfigured();
@@ -112,13 +116,13 @@ namespace network {
          ********************/
         
         protected:
-            
-        private:
             uint16_t m_iPort;
 	    
 	        int m_pServerFD;
 	        int m_pClientFD;
             
+        private:
+            
     };
 }
 
@@ -14,6 +14,7 @@
 #include "common/exception.h"
 
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -48,6 +49,8 @@ TCPCommSocket::TCPCommSocket() {
 TCPCommSocket::TCPCommSocket(const TCPCommSocket &rhs) {
 	m_sHostname = rhs.m_sHostname;
 	m_iPort = rhs.m_iPort;
+	m_bReceiveTimestamps = rhs.m_bReceiveTimestamps;
+	m_bNoDelay = rhs.m_bNoDelay;
 }
 
 
@@ -66,6 +69,8 @@ TCPCommSocket::~TCPCommSocket() {
 TCPCommSocket & TCPCommSocket::operator=(const TCPCommSocket &rhs) {
 	m_sHostname = rhs.m_sHostname;
 	m_iPort = rhs.m_iPort;
+	m_bReceiveTimestamps = rhs.m_bReceiveTimestamps;
+	m_bNoDelay = rhs.m_bNoDelay;
 
 	return *this;
 }
@@ -122,6 +127,12 @@ bool TCPCommSocket::initialize() {
 
 	LOG(DEBUG3) << "Connect result: " << retval;
 	
+	if(receiveTimestamps())
+		applyReceiveTimestamps();
+	
+	if(noDelay())
+		applyNoDelay();
+	
 	if(! blocking()) {
 		LOG(DEBUG3) << "set socket non-blocking";
 		fcntl(m_pSocketFD, F_SETFL, O_NONBLOCK);
@@ -132,6 +143,32 @@ bool TCPCommSocket::initialize() {
 	return true;
 }
 
+/******************************************************************************
+ * Method: setNoDelay
+ * Description: Turn Nagle's algorithm off or back on.  With it off each write
+ * is sent right away, which is what an interactive instrument wants.  If the
+ * socket is already open the option is set now, otherwise when it connects.
+ * Parameters:
+ *   enable - true to set TCP_NODELAY
+ ******************************************************************************/
+void TCPCommSocket::setNoDelay(bool enable) {
+	m_bNoDelay = enable;
+	
+	if(m_pSocketFD)
+		applyNoDelay();
+}
+
+/******************************************************************************
+ * Method: applyNoDelay
+ * Description: Set TCP_NODELAY on the socket to match m_bNoDelay.
+ ******************************************************************************/
+void TCPCommSocket::applyNoDelay() {
+	int enable = m_bNoDelay ? 1 : 0;
+	
+	if(setsockopt(m_pSocketFD, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable)) < 0)
+		LOG(ERROR) << "failed to set TCP_NODELAY: " << strerror(errno);
+}
+
 /******************************************************************************
  * Method: isConfigured
  * Description: Does this class have enough config info?
@@ -48,10 +48,14 @@ namespace network {
 			
             // Does this object have a complete configuration?
             bool isConfigured();
+            
+            // Set TCP_NODELAY, applied right away if connected
+            void setNoDelay(bool enable);
 	    
         protected:
 
         private:
+            void applyNoDelay();
 
         /********************
          *      MEMBERS     *
@@ -0,0 +1,167 @@
+/*******************************************************************************
+ * Filename: datagram_batch_test.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Test batched UDP sends and the multicast socket options.
+ ******************************************************************************/
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "network/datagram_batch.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace std;
+using namespace logger;
+using namespace network;
+
+#define TEST_LOG "/tmp/gtest.log"
+
+class DatagramBatchTest : public testing::Test {
+    protected:
+        virtual void SetUp() {
+            struct sockaddr_in addr;
+            socklen_t length = sizeof(addr);
+            struct timeval tv = { 1, 0 };
+
+            Logger::SetLogFile(TEST_LOG);
+            Logger::SetLogLevel("MESG");
+
+            // Receiver on a random loopback port
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            receiver = socket(AF_INET, SOCK_DGRAM, 0);
+            ASSERT_GE(receiver, 0);
+            ASSERT_EQ(bind(receiver, (struct sockaddr *)&addr, sizeof(addr)), 0);
+            ASSERT_EQ(getsockname(receiver, (struct sockaddr *)&addr, &length), 0);
+            setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            port = ntohs(addr.sin_port);
+        }
+
+        virtual void TearDown() {
+            close(receiver);
+        }
+
+        string next() {
+            char buffer[MAX_DATAGRAM_SIZE];
+            int bytes = recv(receiver, buffer, sizeof(buffer), MSG_DONTWAIT);
+            return bytes < 0 ? "none" : string(buffer, bytes);
+        }
+
+        int receiver;
+        uint16_t port;
+};
+
+/* Test datagrams are held until flush and keep their boundaries */
+TEST_F(DatagramBatchTest, Flush) {
+    DatagramBatch batch;
+    IOResult result;
+
+    EXPECT_EQ(batch.flush().status, IO_OK);
+
+    batch.queue("lost", 4);
+    result = batch.flush();
+    EXPECT_EQ(result.status, IO_NOT_CONNECTED);
+    EXPECT_EQ(batch.dropped(), 1);
+    EXPECT_EQ(batch.pending(), 0);
+
+    batch.socket().setHostname("127.0.0.1");
+    batch.socket().setPort(port);
+    ASSERT_TRUE(batch.socket().initialize());
+    EXPECT_FALSE(batch.socket().multicast());
+
+    EXPECT_TRUE(batch.queue("abc", 3));
+    EXPECT_TRUE(batch.queue("", 0));
+    EXPECT_TRUE(batch.queue("defgh", 5));
+    EXPECT_EQ(batch.pending(), 3);
+    EXPECT_EQ(next(), "none");
+
+    result = batch.flush();
+    EXPECT_EQ(result.status, IO_OK);
+    EXPECT_EQ(result.bytes, 3);
+    EXPECT_EQ(batch.pending(), 0);
+
+    EXPECT_EQ(next(), "abc");
+    EXPECT_EQ(next(), "");
+    EXPECT_EQ(next(), "defgh");
+    EXPECT_EQ(next(), "none");
+
+    // Too big for one datagram
+    char big[MAX_DATAGRAM_SIZE + 1];
+    EXPECT_FALSE(batch.queue(big, sizeof(big)));
+
+    // A full batch is flushed to make room
+    for(int i = 0; i < DATAGRAM_BATCH_MESSAGES + 1; i++)
+        batch.queue("x", 1);
+
+    EXPECT_EQ(batch.pending(), 1);
+    for(int i = 0; i < DATAGRAM_BATCH_MESSAGES; i++)
+        ASSERT_EQ(next(), "x");
+    EXPECT_EQ(next(), "none");
+}
+
+/* Test the sequence header */
+TEST_F(DatagramBatchTest, Sequence) {
+    DatagramBatch batch;
+    uint32_t field;
+
+    batch.socket().setHostname("127.0.0.1");
+    batch.socket().setPort(port);
+    batch.socket().initialize();
+    batch.setSequenceHeader(true);
+
+    batch.queue("abc", 3);
+    batch.queue("def", 3);
+    batch.flush();
+    EXPECT_EQ(batch.sequence(), 2);
+
+    string first = next();
+    string second = next();
+    ASSERT_EQ(first.length(), DATAGRAM_SEQUENCE_HEADER_SIZE + 3);
+    ASSERT_EQ(second.length(), DATAGRAM_SEQUENCE_HEADER_SIZE + 3);
+
+    memcpy(&field, first.data(), 4);
+    EXPECT_EQ(ntohl(field), DATAGRAM_SEQUENCE_MAGIC);
+    memcpy(&field, first.data() + 8, 4);
+    EXPECT_EQ(ntohl(field), 0);
+    EXPECT_EQ(first.substr(DATAGRAM_SEQUENCE_HEADER_SIZE), "abc");
+
+    memcpy(&field, second.data() + 4, 4);
+    EXPECT_EQ(ntohl(field), 0);
+    memcpy(&field, second.data() + 8, 4);
+    EXPECT_EQ(ntohl(field), 1);
+    EXPECT_EQ(second.substr(DATAGRAM_SEQUENCE_HEADER_SIZE), "def");
+}
+
+/* Test the TTL and interface are applied to multicast sockets */
+TEST_F(DatagramBatchTest, Multicast) {
+    UDPCommSocket socket;
+    unsigned char ttl = 0;
+    socklen_t length = sizeof(ttl);
+
+    EXPECT_EQ(socket.multicastTTL(), DEFAULT_MULTICAST_TTL);
+
+    socket.setHostname("239.255.0.1");
+    socket.setPort(port);
+    socket.setMulticastTTL(4);
+    socket.setMulticastInterface("lo");
+    ASSERT_TRUE(socket.initialize());
+    EXPECT_TRUE(socket.multicast());
+
+    getsockopt(socket.getSocketFD(), IPPROTO_IP, IP_MULTICAST_TTL, &ttl, &length);
+    EXPECT_EQ(ttl, 4);
+    socket.disconnect();
+
+    socket.setMulticastInterface("no_such_interface");
+    EXPECT_THROW(socket.initialize(), SocketCreateFailure);
+    EXPECT_FALSE(socket.connected());
+}
@@ -0,0 +1,195 @@
+/*******************************************************************************
+ * Filename: stats_server_test.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Test the HTTP stats server used for monitoring scrapes.
+ ******************************************************************************/
+
+#include "common/logger.h"
+#include "network/stats_server.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace std;
+using namespace logger;
+using namespace network;
+
+#define TEST_LOG "/tmp/gtest.log"
+
+class StatsServerTest : public testing::Test {
+    protected:
+        virtual void SetUp() {
+            Logger::SetLogFile(TEST_LOG);
+            Logger::SetLogLevel("MESG");
+
+            server.initialize();
+            ASSERT_TRUE(server.listening());
+            ASSERT_GT(server.getListenPort(), 0);
+        }
+
+        virtual void TearDown() {
+            for(size_t i = 0; i < clients.size(); i++)
+                close(clients[i]);
+        }
+
+        // Connect a client and wait for the server to accept it
+        int connectClient() {
+            struct sockaddr_in addr;
+            size_t count = server.clients();
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(server.getListenPort());
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            if(fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+                return -1;
+
+            clients.push_back(fd);
+
+            for(int i = 0; i < 100 && server.clients() == count; i++)
+                handle(10);
+
+            return server.clients() > count ? fd : -1;
+        }
+
+        // One pass of a select loop, answering with body
+        void handle(int timeout, const string &body = "metrics 1\n") {
+            fd_set readFDs, writeFDs;
+            struct timeval tv = { 0, timeout * 1000 };
+            int maxFD = 0;
+
+            FD_ZERO(&readFDs);
+            FD_ZERO(&writeFDs);
+            server.addFDs(maxFD, readFDs, writeFDs);
+            select(maxFD + 1, &readFDs, &writeFDs, NULL, &tv);
+            server.handle(readFDs, writeFDs);
+
+            if(server.waiting())
+                server.respond(body);
+        }
+
+        // Send a request and run the server until the response is closed
+        string request(int fd, const string &text, const string &body = "metrics 1\n") {
+            string result;
+            char buffer[4096];
+            struct pollfd pfd = { fd, POLLIN, 0 };
+
+            if(write(fd, text.data(), text.length()) != (ssize_t)text.length())
+                return "write failed";
+
+            for(int i = 0; i < 200; i++) {
+                handle(10, body);
+
+                while(poll(&pfd, 1, 0) > 0) {
+                    ssize_t bytes = read(fd, buffer, sizeof(buffer));
+                    if(bytes <= 0)
+                        return result;
+                    result.append(buffer, bytes);
+                }
+            }
+
+            return result;
+        }
+
+        StatsServer server;
+        vector<int> clients;
+};
+
+/* GET /metrics is answered with the body and the connection closed */
+TEST_F(StatsServerTest, Metrics) {
+    int fd = connectClient();
+    ASSERT_GT(fd, 0);
+
+    string response = request(fd, "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+
+    EXPECT_EQ(response.find("HTTP/1.0 200 OK\r\n"), 0);
+    EXPECT_NE(response.find("Content-Type: text/plain; version=0.0.4\r\n"), string::npos);
+    EXPECT_NE(response.find("Content-Length: 10\r\n"), string::npos);
+    EXPECT_EQ(response.substr(response.length() - 14), "\r\n\r\nmetrics 1\n");
+    EXPECT_EQ(server.clients(), 0);
+}
+
+/* A request split over several writes is answered once it is complete */
+TEST_F(StatsServerTest, PartialRequest) {
+    int fd = connectClient();
+    ASSERT_GT(fd, 0);
+
+    ASSERT_EQ(write(fd, "GET / HT", 8), 8);
+    handle(10);
+    EXPECT_FALSE(server.waiting());
+    EXPECT_EQ(server.clients(), 1);
+
+    string response = request(fd, "TP/1.0\r\n\r\n");
+    EXPECT_EQ(response.find("HTTP/1.0 200 OK\r\n"), 0);
+}
+
+/* Other paths and methods get errors */
+TEST_F(StatsServerTest, Errors) {
+    int fd = connectClient();
+    ASSERT_GT(fd, 0);
+    EXPECT_EQ(request(fd, "GET /other HTTP/1.0\r\n\r\n").find("HTTP/1.0 404 Not Found\r\n"), 0);
+
+    fd = connectClient();
+    ASSERT_GT(fd, 0);
+    EXPECT_EQ(request(fd, "POST /metrics HTTP/1.0\r\n\r\n").find("HTTP/1.0 405 Method Not Allowed\r\n"), 0);
+}
+
+/* A response larger than the socket buffer is finished as the client reads */
+TEST_F(StatsServerTest, LargeResponse) {
+    string body(1 << 20, 'x');
+    int fd = connectClient();
+    ASSERT_GT(fd, 0);
+
+    string response = request(fd, "GET /metrics HTTP/1.0\r\n\r\n", body);
+    ASSERT_GT(response.length(), body.length());
+    EXPECT_EQ(response.substr(response.length() - body.length()), body);
+}
+
+/* Oversized requests and connections beyond the limit are closed */
+TEST_F(StatsServerTest, Limits) {
+    string junk(STATS_MAX_REQUEST + 1, 'x');
+    int fd = connectClient();
+    ASSERT_GT(fd, 0);
+    EXPECT_EQ(request(fd, junk), "");
+    EXPECT_EQ(server.clients(), 0);
+
+    for(int i = 0; i < STATS_MAX_CLIENTS; i++)
+        ASSERT_GT(connectClient(), 0);
+
+    EXPECT_EQ(connectClient(), -1);
+    EXPECT_EQ(server.clients(), STATS_MAX_CLIENTS);
+}
+
+/* Clients that don't finish before the deadline are closed, freeing slots */
+TEST_F(StatsServerTest, Timeout) {
+    char buffer[16];
+
+    server.setTimeout(500);
+
+    for(int i = 0; i < STATS_MAX_CLIENTS; i++)
+        ASSERT_GT(connectClient(), 0);
+
+    handle(10);
+    EXPECT_EQ(server.clients(), STATS_MAX_CLIENTS);
+
+    usleep(600000);
+    handle(10);
+    EXPECT_EQ(server.clients(), 0);
+    EXPECT_EQ(read(clients[0], buffer, sizeof(buffer)), 0);
+
+    server.setTimeout(STATS_CLIENT_TIMEOUT);
+    int fd = connectClient();
+    ASSERT_GT(fd, 0);
+    EXPECT_EQ(request(fd, "GET /metrics HTTP/1.0\r\n\r\n").find("HTTP/1.0 200 OK\r\n"), 0);
+}
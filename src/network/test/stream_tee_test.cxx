@@ -0,0 +1,175 @@
+/*******************************************************************************
+ * Filename: stream_tee_test.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Test reading a stream while copying it to a second socket in-kernel.
+ ******************************************************************************/
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "network/tcp_comm_socket.h"
+#include "network/stream_tee.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace std;
+using namespace logger;
+using namespace network;
+
+#define TEST_LOG "/tmp/gtest.log"
+
+class StreamTeeTest : public testing::Test {
+    protected:
+        virtual void SetUp() {
+            struct sockaddr_in addr;
+            socklen_t length = sizeof(addr);
+            int server, sinks[2];
+
+            Logger::SetLogFile(TEST_LOG);
+            Logger::SetLogLevel("MESG");
+
+            // The instrument end of a loopback connection
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            server = socket(AF_INET, SOCK_STREAM, 0);
+            ASSERT_EQ(bind(server, (struct sockaddr *)&addr, sizeof(addr)), 0);
+            ASSERT_EQ(listen(server, 1), 0);
+            getsockname(server, (struct sockaddr *)&addr, &length);
+
+            source.setHostname("127.0.0.1");
+            source.setPort(ntohs(addr.sin_port));
+            source.setBlocking(true);
+            ASSERT_TRUE(source.initialize());
+
+            instrument = accept(server, NULL, NULL);
+            close(server);
+            ASSERT_GE(instrument, 0);
+
+            // The sniffer client
+            ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sinks), 0);
+            sink = sinks[0];
+            sniffer = sinks[1];
+            fcntl(sink, F_SETFL, O_NONBLOCK);
+        }
+
+        virtual void TearDown() {
+            close(instrument);
+            close(sink);
+            close(sniffer);
+        }
+
+        string sniffed() {
+            char buffer[1024];
+            int bytes = recv(sniffer, buffer, sizeof(buffer), MSG_DONTWAIT);
+            return bytes < 0 ? "none" : string(buffer, bytes);
+        }
+
+        TCPCommSocket source;
+        int instrument;
+        int sink;
+        int sniffer;
+};
+
+/* Data is read into the buffer and copied to the sink */
+TEST_F(StreamTeeTest, Receive) {
+    StreamTee tee;
+    char buffer[1024];
+
+    EXPECT_FALSE(tee.initialized());
+    EXPECT_EQ(tee.receive(&source, buffer, sizeof(buffer), sink).status, IO_NOT_CONNECTED);
+
+    tee.initialize();
+    EXPECT_TRUE(tee.initialized());
+    EXPECT_TRUE(tee.supported());
+
+    ASSERT_EQ(write(instrument, "instrument data", 15), 15);
+
+    IOResult result = tee.receive(&source, buffer, sizeof(buffer), sink);
+    EXPECT_EQ(result.status, IO_OK);
+    ASSERT_EQ(result.bytes, 15);
+    EXPECT_EQ(string(buffer, 15), "instrument data");
+
+    EXPECT_EQ(sniffed(), "instrument data");
+    EXPECT_EQ(tee.teed(), 15);
+    EXPECT_EQ(tee.pending(), 0);
+    EXPECT_EQ(tee.dropped(), 0);
+
+    // Without a sink the data is only read
+    ASSERT_EQ(write(instrument, "more", 4), 4);
+    result = tee.receive(&source, buffer, sizeof(buffer), -1);
+    ASSERT_EQ(result.bytes, 4);
+    EXPECT_EQ(string(buffer, 4), "more");
+    EXPECT_EQ(sniffed(), "none");
+}
+
+/* Reading stops at the size asked for */
+TEST_F(StreamTeeTest, PartialRead) {
+    StreamTee tee;
+    char buffer[1024];
+
+    tee.initialize();
+    ASSERT_EQ(write(instrument, "0123456789", 10), 10);
+
+    ASSERT_EQ(tee.receive(&source, buffer, 4, sink).bytes, 4);
+    EXPECT_EQ(string(buffer, 4), "0123");
+    ASSERT_EQ(tee.receive(&source, buffer, sizeof(buffer), sink).bytes, 6);
+    EXPECT_EQ(string(buffer, 6), "456789");
+
+    EXPECT_EQ(sniffed(), "0123456789");
+}
+
+/* A sink that can't keep up never holds up the read */
+TEST_F(StreamTeeTest, SlowSink) {
+    StreamTee tee;
+    char data[4096], buffer[4096];
+    int size = 4096;
+    uint64_t total = 0;
+
+    memset(data, 'x', sizeof(data));
+    setsockopt(sink, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    tee.initialize();
+
+    // Nobody reads the sniffer end, eventually the sink pipe fills
+    for(int i = 0; i < 256; i++) {
+        ASSERT_EQ(write(instrument, data, sizeof(data)), sizeof(data));
+
+        uint32_t read = 0;
+        while(read < sizeof(data)) {
+            IOResult result = tee.receive(&source, buffer, sizeof(buffer), sink);
+            ASSERT_EQ(result.status, IO_OK);
+            read += result.bytes;
+        }
+        total += read;
+    }
+
+    EXPECT_EQ(total, 256 * sizeof(data));
+    EXPECT_GT(tee.dropped(), 0);
+    EXPECT_EQ(tee.teed() + tee.pending() + tee.dropped(), total);
+
+    tee.reset();
+    EXPECT_EQ(tee.pending(), 0);
+    EXPECT_EQ(tee.teed() + tee.dropped(), total);
+}
+
+/* The source closing disconnects it */
+TEST_F(StreamTeeTest, Closed) {
+    StreamTee tee;
+    char buffer[1024];
+
+    tee.initialize();
+    close(instrument);
+    instrument = -1;
+
+    EXPECT_EQ(tee.receive(&source, buffer, sizeof(buffer), sink).status, IO_CLOSED);
+    EXPECT_FALSE(source.connected());
+}
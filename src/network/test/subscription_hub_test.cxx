@@ -0,0 +1,283 @@
+/*******************************************************************************
+ * Filename: subscription_hub_test.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Test the multi client subscription hub.
+ ******************************************************************************/
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/util.h"
+#include "network/subscription_hub.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+using namespace std;
+using namespace logger;
+using namespace network;
+
+#define TEST_LOG "/tmp/gtest.log"
+
+class SubscriptionHubTest : public testing::Test {
+    protected:
+        virtual void SetUp() {
+            Logger::SetLogFile(TEST_LOG);
+            Logger::SetLogLevel("MESG");
+
+            hub.initialize();
+            ASSERT_TRUE(hub.listening());
+            ASSERT_GT(hub.getListenPort(), 0);
+        }
+
+        virtual void TearDown() {
+            for(size_t i = 0; i < clients.size(); i++)
+                close(clients[i]);
+        }
+
+        // Connect a client and wait for the hub to accept it.  Unless
+        // loop is set the hub accepts without sending anything pending.
+        int subscribe(bool loop = true) {
+            struct sockaddr_in addr;
+            size_t count = hub.subscribers();
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(hub.getListenPort());
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            if(fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+                return -1;
+
+            clients.push_back(fd);
+
+            for(int i = 0; i < 100 && hub.subscribers() == count; i++) {
+                if(loop)
+                    handle(10);
+                else if(!hub.acceptSubscriber())
+                    usleep(10000);
+            }
+
+            return hub.subscribers() > count ? fd : -1;
+        }
+
+        // One pass of a select loop
+        void handle(int timeout) {
+            fd_set readFDs, writeFDs;
+            struct timeval tv = { 0, timeout * 1000 };
+            int maxFD = 0;
+
+            FD_ZERO(&readFDs);
+            FD_ZERO(&writeFDs);
+            hub.addFDs(maxFD, readFDs, writeFDs);
+            select(maxFD + 1, &readFDs, &writeFDs, NULL, &tv);
+            hub.handle(readFDs, writeFDs);
+        }
+
+        // Read exactly size bytes or until the peer closes
+        string receive(int fd, size_t size) {
+            string result;
+            char buffer[4096];
+            struct pollfd pfd = { fd, POLLIN, 0 };
+
+            while(result.length() < size && poll(&pfd, 1, 1000) > 0) {
+                ssize_t bytes = read(fd, buffer, sizeof(buffer) < size - result.length() ?
+                                                 sizeof(buffer) : size - result.length());
+                if(bytes <= 0)
+                    break;
+                result.append(buffer, bytes);
+            }
+
+            return result;
+        }
+
+        SubscriptionHub hub;
+        vector<int> clients;
+};
+
+/* Every subscriber gets every packet, sent in one flush */
+TEST_F(SubscriptionHubTest, FanOut) {
+    int a = subscribe();
+    int b = subscribe();
+    int c = subscribe();
+    ASSERT_GT(a, 0);
+    ASSERT_GT(b, 0);
+    ASSERT_GT(c, 0);
+    EXPECT_EQ(hub.subscribers(), 3);
+
+    EXPECT_TRUE(hub.publish("abc", 3));
+    EXPECT_TRUE(hub.publish("def", 3));
+    EXPECT_EQ(hub.pending(), 6);
+
+    hub.flush();
+    EXPECT_EQ(hub.pending(), 0);
+
+    EXPECT_EQ(receive(a, 6), "abcdef");
+    EXPECT_EQ(receive(b, 6), "abcdef");
+    EXPECT_EQ(receive(c, 6), "abcdef");
+
+    // Late subscribers only see new data
+    int d = subscribe();
+    ASSERT_GT(d, 0);
+    hub.publish("ghi", 3);
+    hub.flush();
+    EXPECT_EQ(receive(d, 3), "ghi");
+    EXPECT_EQ(receive(a, 3), "ghi");
+}
+
+/* Data that wraps the end of the ring arrives intact */
+TEST_F(SubscriptionHubTest, Wrap) {
+    char buffer[3000];
+
+    hub.setRingSize(MIN_SUBSCRIPTION_RING_SIZE);
+    int fd = subscribe();
+    ASSERT_GT(fd, 0);
+
+    for(int pass = 0; pass < 4; pass++) {
+        for(size_t i = 0; i < sizeof(buffer); i++)
+            buffer[i] = 'a' + (i + pass) % 26;
+
+        ASSERT_TRUE(hub.publish(buffer, sizeof(buffer)));
+        hub.flush();
+        EXPECT_EQ(receive(fd, sizeof(buffer)), string(buffer, sizeof(buffer)));
+    }
+
+    // Too big for the ring
+    char big[MIN_SUBSCRIPTION_RING_SIZE + 1];
+    memset(big, 'x', sizeof(big));
+    EXPECT_FALSE(hub.publish(big, sizeof(big)));
+    EXPECT_EQ(hub.subscribers(), 1);
+}
+
+/* A subscriber that falls a ring behind is dropped, the others aren't */
+TEST_F(SubscriptionHubTest, SlowSubscriber) {
+    char buffer[3000];
+    memset(buffer, 'x', sizeof(buffer));
+
+    hub.setRingSize(MIN_SUBSCRIPTION_RING_SIZE);
+    int slow = subscribe();
+    ASSERT_GT(slow, 0);
+
+    // Hold the slow subscriber back by publishing without flushing
+    ASSERT_TRUE(hub.publish(buffer, sizeof(buffer)));
+    int fast = subscribe(false);
+    ASSERT_GT(fast, 0);
+    EXPECT_EQ(hub.subscribers(), 2);
+
+    EXPECT_EQ(hub.overruns(), 0);
+    ASSERT_TRUE(hub.publish(buffer, sizeof(buffer)));
+    EXPECT_EQ(hub.subscribers(), 1);
+    EXPECT_EQ(hub.overruns(), 1);
+
+    hub.flush();
+    EXPECT_EQ(receive(fast, sizeof(buffer)), string(buffer, sizeof(buffer)));
+    EXPECT_EQ(receive(slow, 1), "");
+}
+
+/* Closed subscribers are removed */
+TEST_F(SubscriptionHubTest, Disconnect) {
+    int a = subscribe();
+    int b = subscribe();
+    ASSERT_GT(a, 0);
+    ASSERT_GT(b, 0);
+
+    close(a);
+    clients.erase(clients.begin());
+
+    for(int i = 0; i < 100 && hub.subscribers() == 2; i++)
+        handle(10);
+    EXPECT_EQ(hub.subscribers(), 1);
+
+    hub.publish("abc", 3);
+    hub.flush();
+    EXPECT_EQ(receive(b, 3), "abc");
+
+    hub.disconnect();
+    EXPECT_FALSE(hub.listening());
+    EXPECT_EQ(hub.subscribers(), 0);
+}
+
+/* Pieces of a packet are rendered into the ring once, in order */
+TEST_F(SubscriptionHubTest, PublishPieces) {
+    struct iovec iov[3];
+    char buffer[1500];
+
+    hub.setRingSize(MIN_SUBSCRIPTION_RING_SIZE);
+    int fd = subscribe();
+    ASSERT_GT(fd, 0);
+
+    iov[0].iov_base = (void *)"<<";
+    iov[0].iov_len = 2;
+    iov[1].iov_base = buffer;
+    iov[1].iov_len = sizeof(buffer);
+    iov[2].iov_base = (void *)">>";
+    iov[2].iov_len = 2;
+
+    // Enough passes to wrap the ring in the middle of a piece
+    for(int pass = 0; pass < 4; pass++) {
+        memset(buffer, 'a' + pass, sizeof(buffer));
+
+        ASSERT_TRUE(hub.publish(iov, 3));
+        hub.flush();
+        EXPECT_EQ(receive(fd, sizeof(buffer) + 4),
+                  "<<" + string(buffer, sizeof(buffer)) + ">>");
+    }
+
+    EXPECT_EQ(hub.head(), 4 * (sizeof(buffer) + 4));
+}
+
+/* Connections beyond the limit are refused */
+TEST_F(SubscriptionHubTest, MaxSubscribers) {
+    hub.setMaxSubscribers(2);
+    EXPECT_EQ(hub.maxSubscribers(), 2);
+
+    ASSERT_GT(subscribe(), 0);
+    ASSERT_GT(subscribe(), 0);
+    EXPECT_EQ(subscribe(), -1);
+    EXPECT_EQ(hub.subscribers(), 2);
+
+    // The refused client was closed
+    EXPECT_EQ(receive(clients.back(), 1), "");
+}
+
+/* Connections whose fd doesn't fit in an fd_set are refused */
+TEST_F(SubscriptionHubTest, FDSetSize) {
+    struct rlimit limit;
+    vector<int> filler;
+
+    EXPECT_EQ(hub.maxSubscribers(), DEFAULT_SUBSCRIPTION_SUBSCRIBERS);
+
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &limit), 0);
+    if(limit.rlim_cur < FD_SETSIZE + 16) {
+        limit.rlim_cur = limit.rlim_max < FD_SETSIZE + 16 ? limit.rlim_max : FD_SETSIZE + 16;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if(limit.rlim_cur < FD_SETSIZE + 16)
+        return;
+
+    // Use up every descriptor below FD_SETSIZE
+    for(int fd = dup(0); fd >= 0; fd = dup(0)) {
+        filler.push_back(fd);
+        if(fd >= FD_SETSIZE - 1)
+            break;
+    }
+
+    EXPECT_EQ(subscribe(), -1);
+    EXPECT_EQ(hub.subscribers(), 0);
+
+    for(size_t i = 0; i < filler.size(); i++)
+        close(filler[i]);
+
+    // The refused client was closed
+    EXPECT_EQ(receive(clients.back(), 1), "");
+}
@@ -6,6 +6,11 @@
 #include "gtest/gtest.h"
 
 #include <string>
+#include <string.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <signal.h>
 
 using namespace logger;
 using namespace network;
@@ -379,3 +384,182 @@ TEST_F(TCPSocketTest, DISABLED_ExceptionReadFailure) {
     EXPECT_TRUE(exceptionRaised);
 }
 
+/* Listen on an ephemeral loopback port, returns the listening socket */
+static int listenLocal(uint16_t &port) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(server < 0 ||
+       bind(server, (struct sockaddr *)&addr, sizeof(addr)) ||
+       listen(server, 16) ||
+       getsockname(server, (struct sockaddr *)&addr, &len))
+        return -1;
+    
+    port = ntohs(addr.sin_port);
+    return server;
+}
+
+/* Close a connection with a reset rather than a FIN */
+static void resetClose(int fd) {
+    struct linger lin;
+    lin.l_onoff = 1;
+    lin.l_linger = 0;
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+    close(fd);
+}
+
+/* Test kernel receive timestamps against a local listener */
+TEST(TCPSocketTimestampTest, ReceiveTime) {
+    struct timespec received, before;
+    char buffer[128];
+    uint16_t port;
+    int server, client;
+    
+    server = listenLocal(port);
+    ASSERT_GT(server, 0);
+    
+    TCPCommSocket socket;
+    socket.setHostname("127.0.0.1");
+    socket.setPort(port);
+    socket.setBlocking(true);
+    socket.setReceiveTimestamps(true);
+    EXPECT_TRUE(socket.receiveTimestamps());
+    ASSERT_TRUE(socket.initialize());
+    
+    client = accept(server, NULL, NULL);
+    ASSERT_GT(client, 0);
+    
+    EXPECT_FALSE(socket.lastReceiveTime(received));
+    
+    clock_gettime(CLOCK_REALTIME, &before);
+    ASSERT_EQ(write(client, "Test", 4), 4);
+    
+    EXPECT_EQ(socket.readData(buffer, sizeof(buffer)), 4);
+    ASSERT_TRUE(socket.lastReceiveTime(received));
+    EXPECT_GE(received.tv_sec, before.tv_sec);
+    EXPECT_LE(received.tv_sec, before.tv_sec + 1);
+    
+    // Turned off on a connected socket
+    socket.setReceiveTimestamps(false);
+    ASSERT_EQ(write(client, "Test", 4), 4);
+    EXPECT_EQ(socket.readData(buffer, sizeof(buffer)), 4);
+    EXPECT_FALSE(socket.lastReceiveTime(received));
+    
+    socket.disconnect();
+    close(client);
+    close(server);
+}
+
+/* Test setting TCP_NODELAY before and after connecting */
+TEST(TCPSocketNoDelayTest, NoDelay) {
+    socklen_t length = sizeof(int);
+    int server, client, value;
+    uint16_t port;
+    
+    server = listenLocal(port);
+    ASSERT_GT(server, 0);
+    
+    TCPCommSocket socket;
+    socket.setHostname("127.0.0.1");
+    socket.setPort(port);
+    socket.setBlocking(true);
+    EXPECT_FALSE(socket.noDelay());
+    
+    socket.setNoDelay(true);
+    ASSERT_TRUE(socket.initialize());
+    client = accept(server, NULL, NULL);
+    ASSERT_GT(client, 0);
+    
+    getsockopt(socket.getSocketFD(), IPPROTO_TCP, TCP_NODELAY, &value, &length);
+    EXPECT_TRUE(value);
+    
+    // Copies keep the setting for when they connect
+    TCPCommSocket copy(socket);
+    EXPECT_TRUE(copy.noDelay());
+    
+    socket.setNoDelay(false);
+    getsockopt(socket.getSocketFD(), IPPROTO_TCP, TCP_NODELAY, &value, &length);
+    EXPECT_FALSE(value);
+    
+    socket.disconnect();
+    close(client);
+    close(server);
+}
+
+/* Test status codes for a peer that closes or resets the connection */
+TEST(TCPSocketStatusTest, PeerClose) {
+    char buffer[128];
+    uint16_t port;
+    int server, client;
+    IOResult result;
+    
+    signal(SIGPIPE, SIG_IGN);
+    server = listenLocal(port);
+    ASSERT_GT(server, 0);
+    
+    TCPCommSocket socket;
+    socket.setHostname("127.0.0.1");
+    socket.setPort(port);
+    
+    result = socket.receive(buffer, sizeof(buffer));
+    EXPECT_EQ(result.status, IO_NOT_CONNECTED);
+    EXPECT_THROW(socket.readData(buffer, sizeof(buffer)), SocketReadFailure);
+    
+    // Orderly close
+    ASSERT_TRUE(socket.initialize());
+    client = accept(server, NULL, NULL);
+    ASSERT_GT(client, 0);
+    
+    result = socket.receive(buffer, sizeof(buffer));
+    EXPECT_EQ(result.status, IO_WOULD_BLOCK);
+    
+    close(client);
+    usleep(10000);
+    result = socket.receive(buffer, sizeof(buffer));
+    EXPECT_EQ(result.status, IO_CLOSED);
+    EXPECT_EQ(result.bytes, 0);
+    EXPECT_FALSE(socket.connected());
+    
+    // Reset, the write fails once the reset arrives
+    ASSERT_TRUE(socket.initialize());
+    client = accept(server, NULL, NULL);
+    ASSERT_GT(client, 0);
+    
+    resetClose(client);
+    usleep(10000);
+    result = socket.transmit("Test", 4);
+    EXPECT_EQ(result.status, IO_CLOSED);
+    EXPECT_FALSE(socket.connected());
+    
+    close(server);
+}
+
+/* Test the exception wrapper reports a reset connection */
+TEST(TCPSocketStatusTest, ResetThrows) {
+    uint16_t port;
+    int server, client;
+    
+    signal(SIGPIPE, SIG_IGN);
+    server = listenLocal(port);
+    ASSERT_GT(server, 0);
+    
+    TCPCommSocket socket;
+    socket.setHostname("127.0.0.1");
+    socket.setPort(port);
+    socket.setBlocking(true);
+    
+    ASSERT_TRUE(socket.initialize());
+    client = accept(server, NULL, NULL);
+    ASSERT_GT(client, 0);
+    
+    resetClose(client);
+    usleep(10000);
+    EXPECT_THROW(socket.writeData("Test", 4), SocketWriteFailure);
+    EXPECT_FALSE(socket.connected());
+    
+    close(server);
+}
@@ -0,0 +1,193 @@
+/*******************************************************************************
+ * Filename: udp_comm_listener_test.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Test batched datagram reads with kernel receive timestamps.
+ ******************************************************************************/
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "network/udp_comm_listener.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace std;
+using namespace logger;
+using namespace network;
+
+#define TEST_LOG "/tmp/gtest.log"
+#define TEST_PORT 4021
+
+class UDPCommListenerTest : public testing::Test {
+    protected:
+        virtual void SetUp() {
+            struct sockaddr_in addr;
+            socklen_t length = sizeof(addr);
+
+            Logger::SetLogFile(TEST_LOG);
+            Logger::SetLogLevel("MESG");
+
+            // Stands in for the instrument on a random loopback port
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            instrument = socket(AF_INET, SOCK_DGRAM, 0);
+            ASSERT_GE(instrument, 0);
+            ASSERT_EQ(bind(instrument, (struct sockaddr *)&addr, sizeof(addr)), 0);
+            ASSERT_EQ(getsockname(instrument, (struct sockaddr *)&addr, &length), 0);
+            instrumentPort = ntohs(addr.sin_port);
+        }
+
+        virtual void TearDown() {
+            close(instrument);
+        }
+
+        void send(const string &data) {
+            struct sockaddr_in addr;
+
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons(TEST_PORT);
+
+            sendto(instrument, data.c_str(), data.length(), 0,
+                   (struct sockaddr *)&addr, sizeof(addr));
+        }
+
+        string next() {
+            char buffer[1024];
+            int bytes = recv(instrument, buffer, sizeof(buffer), MSG_DONTWAIT);
+            return bytes < 0 ? "none" : string(buffer, bytes);
+        }
+
+        int instrument;
+        uint16_t instrumentPort;
+};
+
+/* Configuration and copies */
+TEST_F(UDPCommListenerTest, Configuration) {
+    UDPCommListener socket;
+
+    EXPECT_EQ(socket.type(), COMM_UDP_LISTENER);
+    EXPECT_FALSE(socket.isConfigured());
+    EXPECT_THROW(socket.initialize(), SocketMissingConfig);
+
+    socket.setPort(TEST_PORT);
+    socket.setHostname("127.0.0.1");
+    socket.setRemotePort(instrumentPort);
+    EXPECT_TRUE(socket.isConfigured());
+
+    UDPCommListener copy(socket);
+    EXPECT_TRUE(socket.compare(&copy));
+    EXPECT_EQ(copy.remotePort(), instrumentPort);
+
+    copy.setRemotePort(instrumentPort + 1);
+    EXPECT_FALSE(socket.compare(&copy));
+}
+
+/* Every waiting datagram is read with one call */
+TEST_F(UDPCommListenerTest, ReadBatch) {
+    UDPCommListener socket;
+    DatagramPool pool(4, 64);
+
+    socket.setPort(TEST_PORT);
+    ASSERT_TRUE(socket.initialize());
+
+    EXPECT_EQ(socket.readBatch(pool).status, IO_WOULD_BLOCK);
+    EXPECT_EQ(pool.count(), 0);
+
+    send("one");
+    send("");
+    send("three");
+
+    IOResult result = socket.readBatch(pool);
+    EXPECT_EQ(result.status, IO_OK);
+    EXPECT_EQ(result.bytes, 3);
+    ASSERT_EQ(pool.count(), 3);
+
+    EXPECT_EQ(string(pool.data(0), pool.length(0)), "one");
+    EXPECT_EQ(pool.length(1), 0);
+    EXPECT_EQ(string(pool.data(2), pool.length(2)), "three");
+    EXPECT_FALSE(pool.truncated(0));
+
+    // No timestamps unless they were asked for
+    struct timespec received;
+    EXPECT_FALSE(pool.receiveTime(0, received));
+
+    // More than the pool holds is read over several calls
+    for(int i = 0; i < 6; i++)
+        send("more");
+
+    EXPECT_EQ(socket.readBatch(pool).bytes, 4);
+    EXPECT_EQ(socket.readBatch(pool).bytes, 2);
+    EXPECT_EQ(socket.readBatch(pool).status, IO_WOULD_BLOCK);
+
+    socket.disconnect();
+    EXPECT_EQ(socket.readBatch(pool).status, IO_NOT_CONNECTED);
+}
+
+/* Datagrams larger than the pool's buffers are flagged */
+TEST_F(UDPCommListenerTest, Truncated) {
+    UDPCommListener socket;
+    DatagramPool pool(2, 4);
+
+    socket.setPort(TEST_PORT);
+    ASSERT_TRUE(socket.initialize());
+
+    send("0123456789");
+
+    ASSERT_EQ(socket.readBatch(pool).bytes, 1);
+    EXPECT_TRUE(pool.truncated(0));
+    EXPECT_EQ(string(pool.data(0), 4), "0123");
+}
+
+/* Each datagram keeps the time the kernel received it */
+TEST_F(UDPCommListenerTest, ReceiveTimestamps) {
+    UDPCommListener socket;
+    DatagramPool pool;
+    struct timespec before, first, second;
+
+    socket.setPort(TEST_PORT);
+    socket.setReceiveTimestamps(true);
+    ASSERT_TRUE(socket.initialize());
+
+    clock_gettime(CLOCK_REALTIME, &before);
+    send("first");
+    usleep(10000);
+    send("second");
+
+    ASSERT_EQ(socket.readBatch(pool).bytes, 2);
+    ASSERT_TRUE(pool.receiveTime(0, first));
+    ASSERT_TRUE(pool.receiveTime(1, second));
+    EXPECT_FALSE(pool.receiveTime(2, second));
+
+    EXPECT_GE(first.tv_sec, before.tv_sec);
+    EXPECT_GT((second.tv_sec - first.tv_sec) * 1000000000LL + second.tv_nsec - first.tv_nsec,
+              5000000LL);
+}
+
+/* Writes go to the instrument once it has an address */
+TEST_F(UDPCommListenerTest, Write) {
+    UDPCommListener socket;
+
+    socket.setPort(TEST_PORT);
+    ASSERT_TRUE(socket.initialize());
+    EXPECT_EQ(socket.transmit("data", 4).status, IO_NOT_CONNECTED);
+    EXPECT_THROW(socket.writeData("data", 4), SocketWriteFailure);
+
+    socket.setHostname("127.0.0.1");
+    socket.setRemotePort(instrumentPort);
+    ASSERT_TRUE(socket.initialize());
+
+    EXPECT_EQ(socket.writeData("data", 4), 4);
+    EXPECT_EQ(next(), "data");
+    EXPECT_EQ(next(), "none");
+}
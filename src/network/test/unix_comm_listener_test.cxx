@@ -0,0 +1,183 @@
+/*******************************************************************************
+ * Filename: unix_comm_listener_test.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Test the unix domain socket listener.
+ ******************************************************************************/
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "network/unix_comm_listener.h"
+#include "gtest/gtest.h"
+
+#include <string>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+
+using namespace std;
+using namespace logger;
+using namespace network;
+
+#define TEST_LOG "/tmp/gtest.log"
+#define TEST_ABSTRACT "@gtest_unix_comm_listener"
+#define TEST_PATH "/tmp/gtest_unix_comm_listener.sock"
+
+class UnixCommListenerTest : public testing::Test {
+    protected:
+        virtual void SetUp() {
+            Logger::SetLogFile(TEST_LOG);
+            Logger::SetLogLevel("MESG");
+            unlink(TEST_PATH);
+        }
+
+        virtual void TearDown() {
+            unlink(TEST_PATH);
+        }
+
+        // Connect a client to a listener path, abstract or file
+        int connectClient(const string &path, int type) {
+            struct sockaddr_un addr;
+            socklen_t length;
+            int fd = socket(AF_UNIX, type, 0);
+
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            memcpy(addr.sun_path, path.c_str(), path.length());
+            length = offsetof(struct sockaddr_un, sun_path) + path.length();
+
+            if(path[0] == '@')
+                addr.sun_path[0] = '\0';
+            else
+                length++;
+
+            if(fd < 0 || connect(fd, (struct sockaddr *)&addr, length)) {
+                if(fd >= 0) close(fd);
+                return -1;
+            }
+
+            return fd;
+        }
+
+        bool fileExists(const string &path) {
+            struct stat st;
+            return stat(path.c_str(), &st) == 0;
+        }
+};
+
+/* Test configuration errors, copies and compare */
+TEST_F(UnixCommListenerTest, Configuration) {
+    UnixCommListener listener;
+    UnixCommListener other;
+
+    EXPECT_EQ(listener.type(), COMM_UNIX_LISTENER);
+    EXPECT_EQ(listener.socketType(), SOCK_STREAM);
+    EXPECT_THROW(listener.initialize(), SocketMissingConfig);
+
+    listener.setPath(TEST_ABSTRACT);
+    listener.setSocketType(SOCK_DGRAM);
+    EXPECT_THROW(listener.initialize(), SocketMissingConfig);
+    EXPECT_FALSE(listener.listening());
+
+    listener.setSocketType(SOCK_SEQPACKET);
+    listener.setPort(4001);
+    EXPECT_TRUE(listener.abstract());
+
+    UnixCommListener *copy = (UnixCommListener *)listener.copy();
+    EXPECT_TRUE(copy->compare(&listener));
+    EXPECT_EQ(copy->path(), TEST_ABSTRACT);
+    EXPECT_EQ(copy->port(), 4001);
+    delete copy;
+
+    other.setPath(TEST_ABSTRACT);
+    EXPECT_FALSE(other.compare(&listener));
+
+    TCPCommListener tcp;
+    EXPECT_FALSE(listener.compare(&tcp));
+}
+
+/* Test each write to a seqpacket client arrives as its own message */
+TEST_F(UnixCommListenerTest, SeqPacketAbstract) {
+    UnixCommListener listener;
+    char buffer[128];
+    int fd;
+
+    listener.setPath(TEST_ABSTRACT);
+    listener.setSocketType(SOCK_SEQPACKET);
+    listener.setPort(4001);
+
+    EXPECT_EQ(listener.getListenPort(), 0);
+    ASSERT_TRUE(listener.initialize());
+    ASSERT_TRUE(listener.listening());
+    EXPECT_EQ(listener.getListenPort(), 4001);
+
+    fd = connectClient(TEST_ABSTRACT, SOCK_SEQPACKET);
+    ASSERT_GE(fd, 0);
+    ASSERT_TRUE(listener.acceptClient());
+    ASSERT_TRUE(listener.connected());
+
+    EXPECT_EQ(listener.writeData("abc", 3), 3);
+    EXPECT_EQ(listener.writeData("defgh", 5), 5);
+
+    EXPECT_EQ(read(fd, buffer, sizeof(buffer)), 3);
+    EXPECT_EQ(string(buffer, 3), "abc");
+    EXPECT_EQ(read(fd, buffer, sizeof(buffer)), 5);
+    EXPECT_EQ(string(buffer, 5), "defgh");
+
+    // And the other way
+    EXPECT_EQ(write(fd, "12", 2), 2);
+    EXPECT_EQ(write(fd, "345", 3), 3);
+    usleep(10000);
+    EXPECT_EQ(listener.readData(buffer, sizeof(buffer)), 2);
+    EXPECT_EQ(listener.readData(buffer, sizeof(buffer)), 3);
+    EXPECT_EQ(string(buffer, 3), "345");
+
+    // A stream client can't connect to a seqpacket listener
+    EXPECT_LT(connectClient(TEST_ABSTRACT, SOCK_STREAM), 0);
+
+    close(fd);
+    listener.disconnect();
+    EXPECT_FALSE(listener.listening());
+    EXPECT_LT(connectClient(TEST_ABSTRACT, SOCK_SEQPACKET), 0);
+}
+
+/* Test a socket file is created, replaced and removed */
+TEST_F(UnixCommListenerTest, StreamFile) {
+    UnixCommListener listener;
+    char buffer[128];
+    int fd;
+
+    // A stale file from a dead process doesn't block the bind
+    close(creat(TEST_PATH, 0600));
+
+    listener.setPath(TEST_PATH);
+    ASSERT_TRUE(listener.initialize());
+    EXPECT_TRUE(fileExists(TEST_PATH));
+    EXPECT_FALSE(listener.abstract());
+
+    fd = connectClient(TEST_PATH, SOCK_STREAM);
+    ASSERT_GE(fd, 0);
+    ASSERT_TRUE(listener.acceptClient());
+
+    EXPECT_EQ(listener.writeData("abc", 3), 3);
+    EXPECT_EQ(listener.writeData("def", 3), 3);
+    EXPECT_EQ(read(fd, buffer, sizeof(buffer)), 6);
+
+    // Reinitializing rebinds the same path
+    close(fd);
+    listener.disconnectClient();
+    ASSERT_TRUE(listener.initialize());
+
+    fd = connectClient(TEST_PATH, SOCK_STREAM);
+    ASSERT_GE(fd, 0);
+    EXPECT_TRUE(listener.acceptClient());
+    close(fd);
+
+    listener.disconnect();
+    EXPECT_FALSE(fileExists(TEST_PATH));
+}
@@ -0,0 +1,354 @@
+/*******************************************************************************
+ * Class: UDPCommListener
+ * Filename: udp_comm_listener.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * UDP socket bound to a local port with batched reads.
+ *
+ ******************************************************************************/
+
+#include "udp_comm_listener.h"
+#include "common/logger.h"
+#include "common/exception.h"
+
+#include <netdb.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+// Room for one SCM_TIMESTAMPNS control message per datagram
+#define DATAGRAM_CONTROL_SIZE CMSG_SPACE(sizeof(struct timespec))
+
+using namespace std;
+using namespace logger;
+using namespace network;
+
+/******************************************************************************
+ *   DatagramPool
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Constructor
+ * Description: Allocate buffers for a batch of datagrams.  The messages
+ * point into the pool's buffers and are reused by every read.
+ * Parameters:
+ *   capacity - most datagrams read at once
+ *   datagramSize - largest datagram kept whole, longer ones are truncated
+ ******************************************************************************/
+DatagramPool::DatagramPool(uint32_t capacity, uint32_t datagramSize) {
+    m_iCapacity = capacity ? capacity : 1;
+    m_iDatagramSize = datagramSize ? datagramSize : 1;
+    m_iCount = 0;
+
+    m_pBuffer = (char *)malloc((size_t)m_iCapacity * m_iDatagramSize);
+    m_pControl = (char *)calloc(m_iCapacity, DATAGRAM_CONTROL_SIZE);
+    m_pMessages = (struct mmsghdr *)calloc(m_iCapacity, sizeof(struct mmsghdr));
+    m_pIov = (struct iovec *)calloc(m_iCapacity, sizeof(struct iovec));
+
+    for(uint32_t i = 0; i < m_iCapacity; i++) {
+        m_pIov[i].iov_base = m_pBuffer + i * m_iDatagramSize;
+        m_pIov[i].iov_len = m_iDatagramSize;
+    }
+
+    prepare();
+}
+
+/******************************************************************************
+ * Method: Destructor
+ ******************************************************************************/
+DatagramPool::~DatagramPool() {
+    free(m_pBuffer);
+    free(m_pControl);
+    free(m_pMessages);
+    free(m_pIov);
+}
+
+/******************************************************************************
+ * Method: receiveTime
+ * Description: Find the kernel receive time of a datagram from the last read.
+ * Parameters:
+ *   index - datagram index, less than count()
+ *   ts - set to the receive time
+ * Return:
+ *   false if the datagram wasn't timestamped
+ ******************************************************************************/
+bool DatagramPool::receiveTime(uint32_t index, struct timespec &ts) {
+    struct msghdr *msg = &(m_pMessages[index].msg_hdr);
+    struct cmsghdr *cmsg;
+
+    if(index >= m_iCount || ! msg->msg_controllen)
+        return false;
+
+    for(cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/******************************************************************************
+ * Method: prepare
+ * Description: recvmmsg overwrites the lengths, reset them before each read.
+ ******************************************************************************/
+void DatagramPool::prepare() {
+    m_iCount = 0;
+
+    for(uint32_t i = 0; i < m_iCapacity; i++) {
+        struct msghdr *msg = &(m_pMessages[i].msg_hdr);
+
+        msg->msg_name = NULL;
+        msg->msg_namelen = 0;
+        msg->msg_iov = &m_pIov[i];
+        msg->msg_iovlen = 1;
+        msg->msg_control = m_pControl + i * DATAGRAM_CONTROL_SIZE;
+        msg->msg_controllen = DATAGRAM_CONTROL_SIZE;
+        msg->msg_flags = 0;
+        m_pMessages[i].msg_len = 0;
+    }
+}
+
+/******************************************************************************
+ *   UDPCommListener PUBLIC METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Constructor
+ * Description: Default constructor.
+ ******************************************************************************/
+UDPCommListener::UDPCommListener() : CommSocket() {
+    m_sHostname = "";
+    m_iPort = 0;
+    m_iRemotePort = 0;
+    m_bHaveRemote = false;
+    memset(&m_oRemote, 0, sizeof(m_oRemote));
+}
+
+/******************************************************************************
+ * Method: Copy Constructor
+ * Description: Copy the configuration, not the socket.
+ ******************************************************************************/
+UDPCommListener::UDPCommListener(const UDPCommListener &rhs) : CommSocket() {
+    operator=(rhs);
+}
+
+/******************************************************************************
+ * Method: Destructor
+ ******************************************************************************/
+UDPCommListener::~UDPCommListener() {
+}
+
+/******************************************************************************
+ * Method: copy
+ * Description: return a new object deep copied.
+ ******************************************************************************/
+CommBase * UDPCommListener::copy() {
+    return new UDPCommListener(*this);
+}
+
+/******************************************************************************
+ * Method: assignment operator
+ * Description: Copy the configuration, not the socket.
+ ******************************************************************************/
+UDPCommListener & UDPCommListener::operator=(const UDPCommListener &rhs) {
+    m_sHostname = rhs.m_sHostname;
+    m_iPort = rhs.m_iPort;
+    m_iRemotePort = rhs.m_iRemotePort;
+    m_bHaveRemote = false;
+    m_bReceiveTimestamps = rhs.m_bReceiveTimestamps;
+    memset(&m_oRemote, 0, sizeof(m_oRemote));
+
+    return *this;
+}
+
+/******************************************************************************
+ * Method: compare
+ * Description: Sockets are the same if they bind the same port and write to
+ * the same place.
+ ******************************************************************************/
+bool UDPCommListener::compare(CommBase *rhs) {
+    if(rhs->type() != COMM_UDP_LISTENER)
+        return false;
+
+    UDPCommListener *listener = (UDPCommListener *)rhs;
+    return m_iPort == listener->m_iPort && m_sHostname == listener->m_sHostname &&
+           m_iRemotePort == listener->m_iRemotePort;
+}
+
+/******************************************************************************
+ * Method: initalize
+ * Description: Bind the local port.  If a host and remote port are set the
+ * destination for writes is resolved here too.
+ * Exceptions:
+ *   SocketMissingConfig
+ *   SocketCreateFailure
+ *   SocketHostFailure
+ *   SocketConnectFailure
+ ******************************************************************************/
+bool UDPCommListener::initialize() {
+    struct sockaddr_in addr;
+    int newsock;
+    int on = 1;
+
+    LOG(DEBUG) << "UDP Listener initialize() port: " << m_iPort;
+
+    if(!isConfigured())
+        throw SocketMissingConfig("missing udp port");
+
+    disconnect();
+
+    m_bHaveRemote = false;
+    if(m_sHostname.length() && m_iRemotePort) {
+        struct hostent *server = gethostbyname(m_sHostname.c_str());
+
+        if(!server || server->h_length == 0)
+            throw SocketHostFailure(m_sHostname.c_str());
+
+        memset(&m_oRemote, 0, sizeof(m_oRemote));
+        m_oRemote.sin_family = AF_INET;
+        memcpy(&m_oRemote.sin_addr.s_addr, server->h_addr, server->h_length);
+        m_oRemote.sin_port = htons(m_iRemotePort);
+        m_bHaveRemote = true;
+    }
+
+    newsock = socket(AF_INET, SOCK_DGRAM, 0);
+    if(newsock < 0)
+        throw SocketCreateFailure(strerror(errno));
+
+    setsockopt(newsock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(m_iPort);
+
+    if(bind(newsock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        string error = strerror(errno);
+        close(newsock);
+        throw SocketConnectFailure(error);
+    }
+
+    if(! blocking())
+        fcntl(newsock, F_SETFL, O_NONBLOCK);
+
+    LOG(DEBUG2) << "storing new fd: " << newsock;
+    m_pSocketFD = newsock;
+
+    if(m_bReceiveTimestamps)
+        applyReceiveTimestamps();
+
+    return true;
+}
+
+/******************************************************************************
+ * Method: writeData
+ * Description: Send a datagram to the instrument.
+ * Exceptions:
+ *   SocketNotInitialized
+ *   SocketWriteFailure
+ ******************************************************************************/
+uint32_t UDPCommListener::writeData(const char *buffer, const uint32_t size) {
+    IOResult result;
+
+    if(! connected())
+        throw(SocketNotInitialized());
+
+    result = transmit(buffer, size);
+    if(result.status == IO_ERROR || result.status == IO_NOT_CONNECTED)
+        throw SocketWriteFailure(result.what());
+
+    return result.bytes;
+}
+
+/******************************************************************************
+ * Method: transmit
+ * Description: Send a datagram to the instrument.
+ * Return:
+ *   IO_OK, IO_WOULD_BLOCK, IO_NOT_CONNECTED if there is no destination, or
+ *   IO_ERROR
+ ******************************************************************************/
+IOResult UDPCommListener::transmit(const char *buffer, const uint32_t size) {
+    if(! connected() || ! m_bHaveRemote)
+        return IOResult(IO_NOT_CONNECTED);
+
+    int res = sendto(m_pSocketFD, buffer, size, 0, (struct sockaddr *)&m_oRemote,
+                     sizeof(m_oRemote));
+
+    if(res < 0)
+        return IOResult(errno == EAGAIN || errno == EWOULDBLOCK ? IO_WOULD_BLOCK : IO_ERROR,
+                        0, errno);
+
+    return IOResult(IO_OK, res);
+}
+
+/******************************************************************************
+ * Method: receive
+ * Description: Read one datagram.  Unlike a stream, reading zero bytes is
+ * an empty datagram and the socket stays open.
+ * Return:
+ *   IO_OK with the bytes read, IO_WOULD_BLOCK, IO_NOT_CONNECTED or IO_ERROR
+ ******************************************************************************/
+IOResult UDPCommListener::receive(char *buffer, const uint32_t size) {
+    int bytesRead;
+
+    if(! connected())
+        return IOResult(IO_NOT_CONNECTED);
+
+    if(m_bReceiveTimestamps)
+        bytesRead = readTimestamped(buffer, size);
+    else
+        bytesRead = recv(m_pSocketFD, buffer, size, 0);
+
+    if(bytesRead < 0) {
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+            return IOResult(IO_WOULD_BLOCK, 0, errno);
+
+        return IOResult(IO_ERROR, 0, errno);
+    }
+
+    return IOResult(IO_OK, bytesRead);
+}
+
+/******************************************************************************
+ * Method: readBatch
+ * Description: Read the datagrams waiting on the socket into a pool with one
+ * recvmmsg call.  Never blocks, the caller should only read when select
+ * says the socket is ready.
+ *
+ * Parameters:
+ *   pool - where to store the datagrams, count() is set to the number read
+ * Return:
+ *   IO_OK with bytes set to the number of datagrams read, IO_WOULD_BLOCK if
+ *   there were none, IO_NOT_CONNECTED or IO_ERROR
+ ******************************************************************************/
+IOResult UDPCommListener::readBatch(DatagramPool &pool) {
+    int count;
+
+    pool.prepare();
+
+    if(! connected())
+        return IOResult(IO_NOT_CONNECTED);
+
+    do {
+        count = recvmmsg(m_pSocketFD, pool.m_pMessages, pool.m_iCapacity, MSG_DONTWAIT, NULL);
+    } while(count < 0 && errno == EINTR);
+
+    if(count < 0) {
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+            return IOResult(IO_WOULD_BLOCK, 0, errno);
+
+        LOG(ERROR) << "recvmmsg failed: " << strerror(errno);
+        return IOResult(IO_ERROR, 0, errno);
+    }
+
+    pool.m_iCount = count;
+
+    LOG(DEBUG2) << "datagrams read: " << count;
+    return IOResult(IO_OK, count);
+}
@@ -0,0 +1,170 @@
+/*******************************************************************************
+ * Class: UDPCommListener
+ * Filename: udp_comm_listener.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * UDP socket bound to a local port, for instruments that send their data as
+ * datagrams.  Writes go to the instrument's address and port.
+ *
+ * readData() reads one datagram like any other socket.  readBatch() pulls
+ * every datagram waiting on the socket, up to the size of a DatagramPool,
+ * with one recvmmsg call.  An instrument sending thousands of small
+ * datagrams a second is then drained in a few system calls per wake up
+ * instead of one datagram per pass of the event loop.  With receive
+ * timestamps enabled each datagram keeps the time the kernel received it.
+ *
+ * Usage:
+ *
+ * UDPCommListener socket;
+ *
+ * // Local port the instrument sends to
+ * socket.setPort(5001);
+ *
+ * // Where writes go, optional
+ * socket.setHostname("instrument");
+ * socket.setRemotePort(5000);
+ *
+ * socket.setReceiveTimestamps(true);
+ * socket.initialize();
+ *
+ * DatagramPool pool;
+ * IOResult result = socket.readBatch(pool);
+ *
+ * for(uint32_t i = 0; i < pool.count(); i++) {
+ *     struct timespec received;
+ *     pool.receiveTime(i, received);
+ *     handle(pool.data(i), pool.length(i), received);
+ * }
+ *
+ ******************************************************************************/
+
+#ifndef __UDP_COMM_LISTENER_H_
+#define __UDP_COMM_LISTENER_H_
+
+#include "common/logger.h"
+#include "network/comm_socket.h"
+
+#include <stdint.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define DEFAULT_DATAGRAM_POOL_COUNT 64
+#define DEFAULT_DATAGRAM_POOL_SIZE 9216
+
+using namespace std;
+using namespace logger;
+
+namespace network {
+    class UDPCommListener;
+
+    // Preallocated buffers for a batch of received datagrams
+    class DatagramPool {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            DatagramPool(uint32_t capacity = DEFAULT_DATAGRAM_POOL_COUNT,
+                         uint32_t datagramSize = DEFAULT_DATAGRAM_POOL_SIZE);
+            virtual ~DatagramPool();
+
+            uint32_t capacity() { return m_iCapacity; }
+            uint32_t datagramSize() { return m_iDatagramSize; }
+
+            // Datagrams filled by the last read
+            uint32_t count() { return m_iCount; }
+
+            const char * data(uint32_t index) { return m_pBuffer + index * m_iDatagramSize; }
+            uint32_t length(uint32_t index) { return m_pMessages[index].msg_len; }
+
+            // Was the datagram larger than the pool's datagram size?
+            bool truncated(uint32_t index) { return m_pMessages[index].msg_hdr.msg_flags & MSG_TRUNC; }
+
+            // Kernel receive time, false if there isn't one
+            bool receiveTime(uint32_t index, struct timespec &ts);
+
+        private:
+            friend class UDPCommListener;
+
+            DatagramPool(const DatagramPool &rhs);
+            DatagramPool & operator=(const DatagramPool &rhs);
+
+            // Reset the messages for the next read
+            void prepare();
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            uint32_t m_iCapacity;
+            uint32_t m_iDatagramSize;
+            uint32_t m_iCount;
+
+            char *m_pBuffer;
+            char *m_pControl;
+            struct mmsghdr *m_pMessages;
+            struct iovec *m_pIov;
+    };
+
+    class UDPCommListener : public CommSocket {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            ///////////////////////
+            // Public Methods
+            UDPCommListener();
+            UDPCommListener(const UDPCommListener &rhs);
+            virtual ~UDPCommListener();
+
+            virtual CommBase *copy();
+
+            /* Operators */
+            virtual UDPCommListener & operator=(const UDPCommListener &rhs);
+
+            /* Accessors */
+            CommType type() { return COMM_UDP_LISTENER; }
+            virtual bool compare(CommBase *rhs);
+
+            uint16_t port() { return m_iPort; }
+            string hostname() { return m_sHostname; }
+
+            void setRemotePort(uint16_t port) { m_iRemotePort = port; }
+            uint16_t remotePort() { return m_iRemotePort; }
+
+            // Does this object have a complete configuration?
+            bool isConfigured() { return m_iPort > 0; }
+
+            /* Commands */
+
+            // Bind the local port
+            bool initialize();
+
+            virtual uint32_t writeData(const char *buffer, uint32_t size);
+            virtual IOResult transmit(const char *buffer, uint32_t size);
+
+            // Read one datagram, an empty datagram isn't a closed connection
+            virtual IOResult receive(char *buffer, uint32_t size);
+
+            // Read every waiting datagram that fits in the pool, bytes in the
+            // result is the number of datagrams read
+            IOResult readBatch(DatagramPool &pool);
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            uint16_t m_iRemotePort;
+
+            // Destination for writes, resolved by initialize
+            struct sockaddr_in m_oRemote;
+            bool m_bHaveRemote;
+    };
+}
+
+#endif //__UDP_COMM_LISTENER_H_
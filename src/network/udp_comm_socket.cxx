@@ -36,6 +36,8 @@
 #include "common/exception.h"
 
 #include <netinet/in.h>
+#include <arpa/inet.h>
+#include <net/if.h>
 #include <netdb.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -44,6 +46,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace logger;
@@ -60,6 +63,8 @@ using namespace network;
 UDPCommSocket::UDPCommSocket() : CommSocket() {
 	m_sHostname = "";
 	m_iPort = 0;
+	m_iTTL = DEFAULT_MULTICAST_TTL;
+	bzero((char *) &m_oAddress, sizeof(m_oAddress));
 }
 
 
@@ -70,6 +75,9 @@ UDPCommSocket::UDPCommSocket() : CommSocket() {
 UDPCommSocket::UDPCommSocket(const UDPCommSocket &rhs) {
 	m_sHostname = rhs.m_sHostname;
 	m_iPort = rhs.m_iPort;
+	m_iTTL = rhs.m_iTTL;
+	m_sInterface = rhs.m_sInterface;
+	m_oAddress = rhs.m_oAddress;
 }
 
 
@@ -96,6 +104,9 @@ CommBase * UDPCommSocket::copy() {
 UDPCommSocket & UDPCommSocket::operator=(const UDPCommSocket &rhs) {
 	m_sHostname = rhs.m_sHostname;
 	m_iPort = rhs.m_iPort;
+	m_iTTL = rhs.m_iTTL;
+	m_sInterface = rhs.m_sInterface;
+	m_oAddress = rhs.m_oAddress;
 
 	return *this;
 }
@@ -109,12 +120,22 @@ bool UDPCommSocket::isConfigured() {
     return m_sHostname.length() && m_iPort > 0;
 }
 
+/******************************************************************************
+ * Method: multicast
+ * Description: Is the resolved destination a multicast group?
+ ******************************************************************************/
+bool UDPCommSocket::multicast() {
+    return IN_MULTICAST(ntohl(m_oAddress.sin_addr.s_addr));
+}
+
 /******************************************************************************
  * Method: initalize
- * Description: Setup a UDP listener
+ * Description: Setup a UDP listener.  The destination is resolved here once
+ * rather than for every datagram.
  * Exceptions:
  *   SocketMissingConfig
- *   SocketConnectFailure
+ *   SocketCreateFailure
+ *   SocketHostFailure
  ******************************************************************************/
 bool UDPCommSocket::initialize() {
 	int fflags;
@@ -145,6 +166,17 @@ bool UDPCommSocket::initialize() {
 		 (char *)&serv_addr.sin_addr.s_addr,
 		 server->h_length);
 	serv_addr.sin_port = htons(m_iPort);
+	m_oAddress = serv_addr;
+	
+	if(multicast()) {
+		try {
+			setMulticastOptions(newsock);
+		}
+		catch(OOIException &e) {
+			close(newsock);
+			throw;
+		}
+	}
 	
 	if(! blocking()) {
 		LOG(DEBUG3) << "set server socket non-blocking";
@@ -178,38 +210,90 @@ bool UDPCommSocket::initialize() {
  *   SocketWriteFailure
  ******************************************************************************/
 uint32_t UDPCommSocket::writeData(const char *buffer, const uint32_t size) {
-    int count;
-    struct sockaddr_in serv_addr;
-    struct hostent *server;
-    socklen_t sendsize = sizeof(serv_addr);
-
+    IOResult result;
+    
     if(! connected())
         throw(SocketNotInitialized());
+    
+    result = transmit(buffer, size);
+    if(result.status == IO_ERROR)
+        throw SocketWriteFailure(result.what());
+    
+    return result.bytes;
+}
 
-    LOG(DEBUG2) << "Looking up server name";
-    server = gethostbyname(m_sHostname.c_str());
+/******************************************************************************
+ * Method: transmit
+ * Description: send a datagram.
+ *
+ * Parameters:
+ *   buffer - the data to write
+ *   size - the size of the buffer array
+ * Return:
+ *   IO_OK, IO_WOULD_BLOCK, IO_NOT_CONNECTED or IO_ERROR
+ ******************************************************************************/
+IOResult UDPCommSocket::transmit(const char *buffer, const uint32_t size) {
+    if(! connected())
+        return IOResult(IO_NOT_CONNECTED);
 
-    if(!server || server->h_length == 0)
-        throw SocketHostFailure(m_sHostname.c_str());
-    
-    bzero((char *) &serv_addr, sizeof(serv_addr));
-    serv_addr.sin_family = AF_INET;
-    bcopy((char *)server->h_addr, (char *)&serv_addr.sin_addr.s_addr,
-          server->h_length);
-    serv_addr.sin_port = htons(m_iPort);
-	
     LOG(DEBUG) << "WRITE DEVICE: " << buffer;
-    int res = sendto(m_pSocketFD, buffer, size, 0, (struct sockaddr*)&serv_addr, sendsize);
+    int res = sendto(m_pSocketFD, buffer, size, 0, (struct sockaddr*)&m_oAddress,
+                     sizeof(m_oAddress));
+    
+    if(res < 0)
+        return IOResult(errno == EAGAIN || errno == EWOULDBLOCK ? IO_WOULD_BLOCK : IO_ERROR,
+                        0, errno);
     
-    if(res < 0) {
-	throw SocketWriteFailure(strerror(errno));
-    }
     LOG(DEBUG) << "bytes written: " << res;
 
-    return size;
+    return IOResult(IO_OK, size);
 }
 
 
+/******************************************************************************
+ * Method: transmitBatch
+ * Description: send a batch of datagrams to the destination with one
+ * sendmmsg call.  The caller fills in the iovecs of each message, the
+ * destination address is filled in here.  sendmmsg may stop early, the
+ * rest of the batch is resent until it is all gone or the socket refuses.
+ *
+ * Parameters:
+ *   messages - messages to send
+ *   count - number of messages
+ * Return:
+ *   IO_OK with bytes set to the number of datagrams sent.  IO_WOULD_BLOCK
+ *   or IO_ERROR if the socket refused part of the batch, bytes is then the
+ *   number sent before that.
+ ******************************************************************************/
+IOResult UDPCommSocket::transmitBatch(struct mmsghdr *messages, uint32_t count) {
+    uint32_t sent = 0;
+    
+    if(! connected())
+        return IOResult(IO_NOT_CONNECTED);
+    
+    for(uint32_t i = 0; i < count; i++) {
+        messages[i].msg_hdr.msg_name = &m_oAddress;
+        messages[i].msg_hdr.msg_namelen = sizeof(m_oAddress);
+    }
+    
+    while(sent < count) {
+        int res = sendmmsg(m_pSocketFD, messages + sent, count - sent, 0);
+        
+        if(res < 0) {
+            if(errno == EINTR)
+                continue;
+            
+            return IOResult(errno == EAGAIN || errno == EWOULDBLOCK ? IO_WOULD_BLOCK : IO_ERROR,
+                            sent, errno);
+        }
+        
+        sent += res;
+    }
+    
+    LOG(DEBUG2) << "datagrams written: " << sent;
+    return IOResult(IO_OK, sent);
+}
+
 /******************************************************************************
  * Method: readData
  * Description: the port agent doesn't currently need to read UDP so we didn't
@@ -225,4 +309,53 @@ uint32_t UDPCommSocket::writeData(const char *buffer, const uint32_t size) {
  ******************************************************************************/
 uint32_t UDPCommSocket::readData(char *buffer, const uint32_t size) {
     throw NotImplemented();
-}
\ No newline at end of file
+}
+
+/******************************************************************************
+ * Method: receive
+ * Description: not implemented, see readData.
+ *
+ * Return:
+ *   IO_ERROR with ENOSYS
+ ******************************************************************************/
+IOResult UDPCommSocket::receive(char *buffer, const uint32_t size) {
+    return IOResult(IO_ERROR, 0, ENOSYS);
+}
+
+/******************************************************************************
+ *   PRIVATE METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: setMulticastOptions
+ * Description: Set the TTL and outgoing interface of a multicast socket.
+ * The interface may be an interface name or an address assigned to it.
+ *
+ * Parameters:
+ *   fd - new socket
+ * Exceptions:
+ *   SocketCreateFailure
+ ******************************************************************************/
+void UDPCommSocket::setMulticastOptions(int fd) {
+    unsigned char ttl = m_iTTL;
+    
+    LOG(DEBUG2) << "multicast ttl: " << m_iTTL << " interface: " << m_sInterface;
+    
+    if(setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0)
+        throw SocketCreateFailure(strerror(errno));
+    
+    if(! m_sInterface.length())
+        return;
+    
+    struct ip_mreqn mreq;
+    bzero((char *) &mreq, sizeof(mreq));
+    
+    if(! inet_aton(m_sInterface.c_str(), &mreq.imr_address)) {
+        mreq.imr_ifindex = if_nametoindex(m_sInterface.c_str());
+        if(! mreq.imr_ifindex)
+            throw SocketCreateFailure("unknown interface " + m_sInterface);
+    }
+    
+    if(setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &mreq, sizeof(mreq)) < 0)
+        throw SocketCreateFailure(strerror(errno));
+}
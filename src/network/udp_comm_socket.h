@@ -28,6 +28,15 @@
  * // Write data to the client.
  * int bytes_written = socket.writeData("Hello World", strlen("Hello World"));
  *
+ * // Multicast groups take a TTL and the interface to send on, either an
+ * // interface name or one of its addresses.  Set them before initialize.
+ * socket.setHostname("239.255.0.1");
+ * socket.setMulticastTTL(4);
+ * socket.setMulticastInterface("eth0");
+ *
+ * // Send several datagrams with one system call.  See DatagramBatch.
+ * socket.transmitBatch(messages, count);
+ *
  ******************************************************************************/
 
 #ifndef __UDP_COMM_SOCKET_H_
@@ -36,6 +45,12 @@
 #include "common/logger.h"
 #include "network/comm_socket.h"
 
+#include <string>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define DEFAULT_MULTICAST_TTL 1
+
 using namespace std;
 using namespace logger;
 
@@ -64,6 +79,15 @@ namespace network {
 			
 			uint16_t port() { return m_iPort; }
 			string hostname() { return m_sHostname; }
+			
+			void setMulticastTTL(int ttl) { m_iTTL = ttl; }
+			int multicastTTL() { return m_iTTL; }
+			
+			void setMulticastInterface(const string &interface) { m_sInterface = interface; }
+			string multicastInterface() { return m_sInterface; }
+			
+			// Is the destination a multicast group?  Known after initialize.
+			bool multicast();
 
             /* Commands */
 	    
@@ -72,12 +96,22 @@ namespace network {
             
 	    virtual uint32_t writeData(const char *buffer, uint32_t size);
             virtual uint32_t readData(char *buffer, uint32_t size);
+            
+            virtual IOResult transmit(const char *buffer, uint32_t size);
+            virtual IOResult receive(char *buffer, uint32_t size);
+            
+            // Send prepared messages with one sendmmsg call, bytes in the
+            // result is the number of datagrams sent
+            IOResult transmitBatch(struct mmsghdr *messages, uint32_t count);
 
         protected:
 
         private:
             // Does this object have a complete configuration?
             bool isConfigured();
+            
+            // Apply the multicast TTL and interface to a new socket
+            void setMulticastOptions(int fd);
 
         /********************
          *      MEMBERS     *
@@ -86,6 +120,11 @@ namespace network {
         protected:
             
         private:
+            int m_iTTL;
+            string m_sInterface;
+            
+            // Destination, resolved once by initialize
+            struct sockaddr_in m_oAddress;
     };
 }
 
@@ -0,0 +1,153 @@
+/*******************************************************************************
+ * Class: UnixCommListener
+ * Filename: unix_comm_listener.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Manage a unix domain socket listener.  Accepting, reading and writing are
+ * inherited from TCPCommListener.
+ *
+ ******************************************************************************/
+
+#include "unix_comm_listener.h"
+#include "common/logger.h"
+#include "common/exception.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/un.h>
+
+using namespace std;
+using namespace logger;
+using namespace network;
+
+/******************************************************************************
+ *   PUBLIC METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Constructor
+ * Description: Default constructor, a stream socket.
+ ******************************************************************************/
+UnixCommListener::UnixCommListener() : TCPCommListener() {
+    m_iSocketType = SOCK_STREAM;
+}
+
+/******************************************************************************
+ * Method: Copy Constructor
+ * Description: Copy constructor.
+ ******************************************************************************/
+UnixCommListener::UnixCommListener(const UnixCommListener &rhs) : TCPCommListener(rhs) {
+    m_sPath = rhs.m_sPath;
+    m_iSocketType = rhs.m_iSocketType;
+}
+
+/******************************************************************************
+ * Method: Destructor
+ * Description: Close the sockets here, the base destructor can't remove the
+ * socket file.
+ ******************************************************************************/
+UnixCommListener::~UnixCommListener() {
+    disconnect();
+}
+
+/******************************************************************************
+ * Method: copy
+ * Description: return a new object deep copied.
+ ******************************************************************************/
+CommBase * UnixCommListener::copy() {
+    return new UnixCommListener(*this);
+}
+
+/******************************************************************************
+ * Method: compare
+ * Description: Listeners are the same if they have the same path and type.
+ ******************************************************************************/
+bool UnixCommListener::compare(CommBase *rhs) {
+    if(rhs->type() != COMM_UNIX_LISTENER)
+        return false;
+
+    UnixCommListener *listener = (UnixCommListener *)rhs;
+    return m_sPath == listener->m_sPath && m_iSocketType == listener->m_iSocketType;
+}
+
+/******************************************************************************
+ * Method: getListenPort
+ * Description: There is no port to look up, report the configured one so
+ * callers checking a TCP listener's port don't reinitialize this one.
+ * Return:
+ *   configured port, 0 if not listening
+ ******************************************************************************/
+uint16_t UnixCommListener::getListenPort() {
+    return listening() ? m_iPort : 0;
+}
+
+/******************************************************************************
+ * Method: disconnectServer
+ * Description: Close the server socket and remove the socket file.
+ ******************************************************************************/
+bool UnixCommListener::disconnectServer() {
+    if(listening() && !abstract())
+        unlink(m_sPath.c_str());
+
+    return TCPCommListener::disconnectServer();
+}
+
+/******************************************************************************
+ * Method: initalize
+ * Description: Setup a unix domain socket listener
+ * Exceptions:
+ *   SocketMissingConfig
+ *   SocketCreateFailure
+ *   SocketConnectFailure
+ ******************************************************************************/
+bool UnixCommListener::initialize() {
+    struct sockaddr_un addr;
+    socklen_t length;
+    int newsock;
+
+    LOG(DEBUG) << "Unix Listener initialize() " << m_sPath;
+
+    if(m_sPath.length() < 2 || m_sPath.length() >= sizeof(addr.sun_path))
+        throw SocketMissingConfig("missing or invalid unix socket path");
+
+    if(m_iSocketType != SOCK_STREAM && m_iSocketType != SOCK_SEQPACKET)
+        throw SocketMissingConfig("unix socket type must be stream or seqpacket");
+
+    disconnectServer();
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, m_sPath.c_str(), m_sPath.length());
+    length = offsetof(struct sockaddr_un, sun_path) + m_sPath.length();
+
+    // Abstract names start with a nul and aren't nul terminated
+    if(abstract())
+        addr.sun_path[0] = '\0';
+    else {
+        unlink(m_sPath.c_str());
+        length++;
+    }
+
+    newsock = socket(AF_UNIX, m_iSocketType, 0);
+    if(newsock < 0)
+        throw SocketCreateFailure(strerror(errno));
+
+    if(bind(newsock, (struct sockaddr *)&addr, length) < 0 || listen(newsock, 0) < 0) {
+        string error = strerror(errno);
+        close(newsock);
+        throw SocketConnectFailure(m_sPath + ": " + error);
+    }
+
+    if(! blocking())
+        fcntl(newsock, F_SETFL, O_NONBLOCK);
+
+    LOG(DEBUG2) << "storing new fd: " << newsock;
+    m_pServerFD = newsock;
+
+    LOG(DEBUG2) << "startup complete.  unix socket " << m_sPath;
+    return true;
+}
@@ -0,0 +1,93 @@
+/*******************************************************************************
+ * Class: UnixCommListener
+ * Filename: unix_comm_listener.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Start a unix domain socket server for clients on the same host.  Client
+ * handling is the same as TCPCommListener, one client at a time, so it can
+ * be used anywhere a TCP listener is; only the address family differs.
+ *
+ * A path starting with '@' is an abstract socket name.  Nothing is created
+ * in the file system and the name goes away with the socket.  Other paths
+ * are socket files; a stale file left by a previous process is removed
+ * before binding.
+ *
+ * With SOCK_SEQPACKET every write is delivered as one message, so each
+ * packet written to a client arrives on its own read and the client never
+ * has to look for packet boundaries in the stream.
+ *
+ * The port is not used for the connection, it is kept so the listener can
+ * stand in for a TCP listener configured with the same port.
+ *
+ * Usage:
+ *
+ * UnixCommListener ts;
+ *
+ * // Abstract name, messages keep their boundaries
+ * ts.setPath("@port_agent_4001");
+ * ts.setSocketType(SOCK_SEQPACKET);
+ *
+ * ts.initialize();
+ * ts.acceptClient();
+ *
+ * int bytes_written = ts.writeData("Hello World", strlen("Hello World"));
+ ******************************************************************************/
+
+#ifndef __UNIX_COMM_LISTENER_H_
+#define __UNIX_COMM_LISTENER_H_
+
+#include "network/tcp_comm_listener.h"
+
+#include <string>
+#include <sys/socket.h>
+
+using namespace std;
+
+namespace network {
+
+    class UnixCommListener : public TCPCommListener {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            ///////////////////////
+            // Public Methods
+            UnixCommListener();
+            UnixCommListener(const UnixCommListener &rhs);
+            virtual ~UnixCommListener();
+
+            virtual CommBase *copy();
+
+            /* Accessors */
+            CommType type() { return COMM_UNIX_LISTENER; }
+            virtual bool compare(CommBase *rhs);
+
+            void setPath(const string &path) { m_sPath = path; }
+            const string & path() { return m_sPath; }
+
+            // SOCK_STREAM or SOCK_SEQPACKET
+            void setSocketType(int type) { m_iSocketType = type; }
+            int socketType() { return m_iSocketType; }
+
+            bool abstract() { return m_sPath.length() && m_sPath[0] == '@'; }
+
+            // The configured port while listening
+            uint16_t getListenPort();
+
+            /* Commands */
+            bool disconnectServer();
+            bool initialize();
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            string m_sPath;
+            int m_iSocketType;
+    };
+}
+
+#endif //__UNIX_COMM_LISTENER_H_
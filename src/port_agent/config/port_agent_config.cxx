@@ -17,6 +17,8 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <getopt.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
 
 #include <iostream>
 #include <fstream>
@@ -53,13 +55,30 @@ PortAgentConfig::PortAgentConfig(int argc, char* argv[]) {
     m_verbose = 0;
     m_observatoryCommandPort = 0;
     m_observatoryDataPort = 0;
+    m_unixSocketSeqPacket = true;
     m_help = false;
     m_kill = false;
     m_version = false;
     m_outputThrottle = 0;
+    m_kernelTimestamps = false;
+    m_instrumentNoDelay = false;
+    m_driverCoalesce = false;
     m_maxPacketSize = DEFAULT_PACKET_SIZE;
+    m_bulkReadBudget = DEFAULT_BULK_READ_BUDGET;
     m_ppid = 0;
     m_telnetSnifferPort = 0;
+    m_telnetSnifferSplice = false;
+    m_telnetSnifferClients = DEFAULT_TELNET_SNIFFER_CLIENTS;
+    m_subscriberPort = 0;
+    m_subscriberRingSize = DEFAULT_SUBSCRIPTION_RING_SIZE;
+    m_subscriberClients = DEFAULT_SUBSCRIPTION_SUBSCRIBERS;
+    m_statsPort = 0;
+    m_statsBinary = false;
+    m_traceSampleRate = 0;
+    m_shmSize = DEFAULT_SHM_SIZE;
+    m_multicastPort = 0;
+    m_multicastTTL = DEFAULT_MULTICAST_TTL;
+    m_multicastSequence = false;
     
     // For backward compatibility, observatory connection defaults to standard
     m_observatoryConnectionType = OBS_TYPE_STANDARD;
@@ -181,6 +200,38 @@ string PortAgentConfig::logfile() {
 }
 
 
+/******************************************************************************
+ * Method: eventfile()
+ * Description: return a path to the binary event log;
+ * Return: formatted path string
+ ******************************************************************************/
+string PortAgentConfig::eventfile() {
+    ostringstream out;
+    out << logdir() << "/" << BASE_FILENAME << "_"
+        << observatoryCommandPort() << ".events";
+    
+    LOG(DEBUG) << "Event log path: " << out.str();
+    
+    return out.str();
+}
+
+
+/******************************************************************************
+ * Method: tracefile()
+ * Description: return a path to the per-packet trace file;
+ * Return: formatted path string
+ ******************************************************************************/
+string PortAgentConfig::tracefile() {
+    ostringstream out;
+    out << logdir() << "/" << BASE_FILENAME << "_"
+        << observatoryCommandPort() << ".trace";
+    
+    LOG(DEBUG) << "Trace file path: " << out.str();
+    
+    return out.str();
+}
+
+
 /******************************************************************************
  * Method: pidfile()
  * Description: return a path to the pid file;
@@ -325,7 +376,8 @@ bool PortAgentConfig::isConfigured() {
         }
     }
 
-    if(instrumentConnectionType() == TYPE_BOTPT) {
+    if(instrumentConnectionType() == TYPE_BOTPT ||
+       instrumentConnectionType() == TYPE_UDP) {
         if(! instrumentAddr().length()) {
             LOG(DEBUG) << "Missing instrument address";
             ready = false;
@@ -402,6 +454,15 @@ string PortAgentConfig::getConfig() {
         << "command_port " << m_observatoryCommandPort << endl
         << "data_port " << m_observatoryDataPort << endl;
         
+        if(m_observatoryCommandSocket.length())
+            out << "command_socket " << m_observatoryCommandSocket << endl;
+        
+        if(m_observatoryDataSocket.length())
+            out << "data_socket " << m_observatoryDataSocket << endl;
+        
+        if(m_observatoryCommandSocket.length() || m_observatoryDataSocket.length())
+            out << "unix_socket_type " << (m_unixSocketSeqPacket ? "seqpacket" : "stream") << endl;
+        
         if(m_instrumentConnectionType) {
             out << "instrument_type ";
             
@@ -413,6 +474,8 @@ string PortAgentConfig::getConfig() {
                 out << "BOTPT";
             else if(m_instrumentConnectionType == TYPE_RSN)
                 out << "rsn";
+            else if(m_instrumentConnectionType == TYPE_UDP)
+                out << "udp";
             
             out << endl;
         }
@@ -432,7 +495,11 @@ string PortAgentConfig::getConfig() {
         out << "'" << endl;
         
         out << "output_throttle " << m_outputThrottle << endl
+            << "kernel_timestamps " << m_kernelTimestamps << endl
+            << "instrument_nodelay " << m_instrumentNoDelay << endl
+            << "driver_coalesce " << m_driverCoalesce << endl
             << "max_packet_size " << m_maxPacketSize << endl
+            << "bulk_read_budget " << m_bulkReadBudget << endl
             << "baud " << m_baud << endl
             << "stopbits " << m_stopbits << endl
             << "databits " << m_databits << endl
@@ -450,6 +517,35 @@ string PortAgentConfig::getConfig() {
                 out << "telnet_sniffer_prefix " << m_telnetSnifferPrefix << endl;
             if(m_telnetSnifferSuffix.length()) 
                 out << "telnet_sniffer_suffix " << m_telnetSnifferSuffix << endl;
+            out << "telnet_sniffer_splice " << m_telnetSnifferSplice << endl;
+            out << "telnet_sniffer_clients " << m_telnetSnifferClients << endl;
+        }
+        
+        if(m_subscriberPort) {
+            out << "subscriber_port " << m_subscriberPort << endl
+                << "subscriber_ring_size " << m_subscriberRingSize << endl
+                << "subscriber_clients " << m_subscriberClients << endl;
+        }
+        
+        if(m_statsPort)
+            out << "stats_port " << m_statsPort << endl;
+        
+        if(m_traceSampleRate)
+            out << "trace_sample_rate " << m_traceSampleRate << endl;
+        
+        if(m_shmName.length()) {
+            out << "shm_name " << m_shmName << endl
+                << "shm_size " << m_shmSize << endl;
+        }
+        
+        if(m_multicastAddr.length()) {
+            out << "multicast_addr " << m_multicastAddr << endl
+                << "multicast_port " << m_multicastPort << endl
+                << "multicast_ttl " << m_multicastTTL << endl
+                << "multicast_sequence " << m_multicastSequence << endl;
+            
+            if(m_multicastInterface.length())
+                out << "multicast_interface " << m_multicastInterface << endl;
         }
         
     return out.str();
@@ -524,6 +620,11 @@ bool PortAgentConfig::setInstrumentConnectionType(const string &param) {
         LOG(INFO) << "connection type set to rsn";
         m_instrumentConnectionType = TYPE_RSN;
     }
+
+    else if(param == "udp") {
+        LOG(INFO) << "connection type set to udp";
+        m_instrumentConnectionType = TYPE_UDP;
+    }
     
     else {
         LOG(ERROR) << "unknown connection type: " << param;
@@ -621,7 +722,10 @@ bool PortAgentConfig::setSentinleSequence(const string &command) {
 
 /******************************************************************************
  * Method: setOutputThrottle
- * Description: Set the output throttle
+ * Description: Set the output throttle.  The throttle is the max number of
+ *              instrument data packets published per second.  Reads are
+ *              coalesced into packets until a packet is full or it has waited
+ *              one throttle period.  0 disables the throttle.
  * Param:
  *     param - string represention of the value of the throttle.  If it is not
  *     a number the value will be set to 0.
@@ -649,6 +753,121 @@ bool PortAgentConfig::setOutputThrottle(const string &param) {
     return true;
 }
 
+/******************************************************************************
+ * Method: setKernelTimestamps
+ * Description: Timestamp instrument data with the time the kernel received
+ *              it rather than the time the port agent read it.  Only socket
+ *              instrument connections support this.
+ * Param:
+ *     param - 1 to enable, 0 to disable
+ * Return:
+ *     return true if the flag was set correctly, otherwise false.
+ *****************************************************************************/
+bool PortAgentConfig::setKernelTimestamps(const string &param) {
+    m_kernelTimestamps = false;
+    
+    if(param != "0" && param != "1") {
+        LOG(ERROR) << "invalid kernel timestamps parameter, " << param;
+        return false;
+    }
+    
+    m_kernelTimestamps = param == "1";
+    LOG(INFO) << "set kernel timestamps to " << m_kernelTimestamps;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setInstrumentNoDelay
+ * Description: Set TCP_NODELAY on TCP instrument connections so driver
+ *              commands are sent as soon as they are written.
+ * Param:
+ *     param - 1 to enable, 0 to disable
+ * Return:
+ *     return true if the flag was set correctly, otherwise false.
+ *****************************************************************************/
+bool PortAgentConfig::setInstrumentNoDelay(const string &param) {
+    m_instrumentNoDelay = false;
+    
+    if(param != "0" && param != "1") {
+        LOG(ERROR) << "invalid instrument nodelay parameter, " << param;
+        return false;
+    }
+    
+    m_instrumentNoDelay = param == "1";
+    LOG(INFO) << "set instrument nodelay to " << m_instrumentNoDelay;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setDriverCoalesce
+ * Description: Collect the driver data read on one pass of the port agent
+ *              loop and write it to the instrument at once, rather than
+ *              writing each read as it comes in.
+ * Param:
+ *     param - 1 to enable, 0 to disable
+ * Return:
+ *     return true if the flag was set correctly, otherwise false.
+ *****************************************************************************/
+bool PortAgentConfig::setDriverCoalesce(const string &param) {
+    m_driverCoalesce = false;
+    
+    if(param != "0" && param != "1") {
+        LOG(ERROR) << "invalid driver coalesce parameter, " << param;
+        return false;
+    }
+    
+    m_driverCoalesce = param == "1";
+    LOG(INFO) << "set driver coalesce to " << m_driverCoalesce;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setTelnetSnifferSplice
+ * Description: Copy instrument data to the telnet sniffer in-kernel with
+ * splice and tee rather than publishing it from user space.
+ * Param:
+ *     param - 0 or 1
+ * Return:
+ *     return true if the value was set correctly, otherwise false.
+ *****************************************************************************/
+bool PortAgentConfig::setTelnetSnifferSplice(const string &param) {
+    m_telnetSnifferSplice = false;
+    
+    if(param != "0" && param != "1") {
+        LOG(ERROR) << "invalid telnet sniffer splice parameter, " << param;
+        return false;
+    }
+    
+    m_telnetSnifferSplice = param == "1";
+    LOG(INFO) << "set telnet sniffer splice to " << m_telnetSnifferSplice;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setTelnetSnifferClients
+ * Description: Set how many clients can watch the telnet sniffer at once.
+ * With more than one the sniffer is served from a subscription hub.
+ * Param:
+ *     param - client count, 1 to MAX_TELNET_SNIFFER_CLIENTS
+ * Return:
+ *     return true if the count is in range, otherwise false and the default
+ *     is used.
+ *****************************************************************************/
+bool PortAgentConfig::setTelnetSnifferClients(const string &param) {
+    int value = atoi(param.c_str());
+    m_telnetSnifferClients = DEFAULT_TELNET_SNIFFER_CLIENTS;
+    
+    if(! isdigit(param.c_str()[0]) || value < 1 || value > MAX_TELNET_SNIFFER_CLIENTS) {
+        LOG(ERROR) << "Invalid telnet sniffer client count, using default "
+                   << DEFAULT_TELNET_SNIFFER_CLIENTS;
+        return false;
+    }
+    
+    LOG(INFO) << "set telnet sniffer clients to " << value;
+    m_telnetSnifferClients = value;
+    return true;
+}
+
 /******************************************************************************
  * Method: setHeartbeatInterval
  * Description: Set the heartbeat interval
@@ -768,6 +987,87 @@ bool PortAgentConfig::setObservatoryCommandPort(const string &param) {
     return true;
 }
 
+/******************************************************************************
+ * Method: validUnixSocketPath
+ * Description: Is this a path or abstract name a unix domain socket can be
+ * bound to?  Relative paths aren't allowed because the daemon changes its
+ * working directory.
+ *****************************************************************************/
+static bool validUnixSocketPath(const string &param) {
+    return param.length() > 1 && param.length() <= MAX_UNIX_SOCKET_PATH &&
+           (param[0] == '/' || param[0] == '@');
+}
+
+/******************************************************************************
+ * Method: setObservatoryDataSocket
+ * Description: Listen for the data client on a unix domain socket instead
+ * of TCP.  The data port is still required, it identifies the port agent.
+ * Param:
+ *     param - socket file path, or an abstract name starting with '@'.
+ *     "tcp" switches back to TCP.
+ * Return:
+ *     return true if the path is valid, otherwise false and TCP is used.
+ *****************************************************************************/
+bool PortAgentConfig::setObservatoryDataSocket(const string &param) {
+    m_observatoryDataSocket = "";
+    
+    if(param == "tcp")
+        return true;
+    
+    if(! validUnixSocketPath(param)) {
+        LOG(ERROR) << "Invalid data socket path: " << param;
+        return false;
+    }
+    
+    LOG(INFO) << "set data socket to " << param;
+    m_observatoryDataSocket = param;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setObservatoryCommandSocket
+ * Description: Listen for the command client on a unix domain socket
+ * instead of TCP.  See setObservatoryDataSocket.
+ *****************************************************************************/
+bool PortAgentConfig::setObservatoryCommandSocket(const string &param) {
+    m_observatoryCommandSocket = "";
+    
+    if(param == "tcp")
+        return true;
+    
+    if(! validUnixSocketPath(param)) {
+        LOG(ERROR) << "Invalid command socket path: " << param;
+        return false;
+    }
+    
+    LOG(INFO) << "set command socket to " << param;
+    m_observatoryCommandSocket = param;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setUnixSocketType
+ * Description: Set the type of the unix domain sockets.  seqpacket keeps
+ * each packet written to a client in its own message.
+ * Param:
+ *     param - stream or seqpacket
+ * Return:
+ *     return true if the type was set, otherwise false and seqpacket is used.
+ *****************************************************************************/
+bool PortAgentConfig::setUnixSocketType(const string &param) {
+    m_unixSocketSeqPacket = true;
+    
+    if(param == "stream")
+        m_unixSocketSeqPacket = false;
+    else if(param != "seqpacket") {
+        LOG(ERROR) << "Invalid unix socket type: " << param;
+        return false;
+    }
+    
+    LOG(INFO) << "set unix socket type to " << param;
+    return true;
+}
+
 /******************************************************************************
  * Method: setInstrumentDataPort
  * Description: Set the instrument data port
@@ -795,7 +1095,7 @@ bool PortAgentConfig::setInstrumentDataPort(const string &param) {
 
 /******************************************************************************
  * Method: setInstrumentDataTxPort
- * Description: Set the instrument TX data port (BOTPT)
+ * Description: Set the instrument TX data port (BOTPT, UDP)
  * Param:
  *     param - string represention of the value of the port.  If it is not
  *     a number the value will be set to 0.
@@ -820,7 +1120,7 @@ bool PortAgentConfig::setInstrumentDataTxPort(const string &param) {
 
 /******************************************************************************
  * Method: setInstrumentDataRxPort
- * Description: Set the instrument RX data port (BOTPT)
+ * Description: Set the instrument RX data port (BOTPT, UDP)
  * Param:
  *     param - string represention of the value of the port.  If it is not
  *     a number the value will be set to 0.
@@ -900,6 +1200,32 @@ bool PortAgentConfig::setMaxPacketSize(const string &param) {
     return true;
 }
 
+/******************************************************************************
+ * Method: setBulkReadBudget
+ * Description: Set how many instrument reads the port agent makes on one
+ * pass of its loop before going back to select.  Command port traffic is
+ * checked for between each read.
+ * Param:
+ *     param - read count, 1 to MAX_BULK_READ_BUDGET
+ * Return:
+ *     return true if the budget is in range, otherwise false and the default
+ *     is used.
+ *****************************************************************************/
+bool PortAgentConfig::setBulkReadBudget(const string &param) {
+    int value = atoi(param.c_str());
+    m_bulkReadBudget = DEFAULT_BULK_READ_BUDGET;
+    
+    if(! isdigit(param.c_str()[0]) || value < 1 || value > MAX_BULK_READ_BUDGET) {
+        LOG(ERROR) << "Invalid bulk read budget, using default "
+                   << DEFAULT_BULK_READ_BUDGET;
+        return false;
+    }
+    
+    LOG(INFO) << "set bulk read budget to " << value;
+    m_bulkReadBudget = value;
+    return true;
+}
+
 /******************************************************************************
  * Method: setLogLevel
  * Description: Change the log level
@@ -1105,6 +1431,305 @@ bool PortAgentConfig::setTelnetSnifferPort(const string &param) {
     return true;
 }
 
+/******************************************************************************
+ * Method: setSubscriberPort
+ * Description: Set the port that data subscribers connect to.  Any number of
+ * clients can subscribe to the one port.
+ * Param:
+ *     param - string represention of the value of the port.  If it is not
+ *     a number the value will be set to 0.
+ * Return:
+ *     return true if the port was set correctly, otherwise false.
+ *****************************************************************************/
+bool PortAgentConfig::setSubscriberPort(const string &param) {
+    int value = atoi(param.c_str());
+    m_subscriberPort = 0;
+    
+    if(value <= 0 || value > 65535) {
+        LOG(ERROR) << "Invalid subscriber port specification, setting to 0";
+        return false;
+    }
+    
+    LOG(INFO) << "set subscriber port to " << value;
+    m_subscriberPort = value;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setStatsPort
+ * Description: Set the local port monitoring scrapes metrics from over
+ * HTTP.  The listener only binds to the loopback interface.
+ * Param:
+ *     param - string represention of the value of the port.  0 turns the
+ *     listener off.
+ * Return:
+ *     return true if the port was set correctly, otherwise false.
+ *****************************************************************************/
+bool PortAgentConfig::setStatsPort(const string &param) {
+    int value = atoi(param.c_str());
+    m_statsPort = 0;
+    
+    if(! isdigit(param.c_str()[0]) || value < 0 || value > 65535) {
+        LOG(ERROR) << "Invalid stats port specification, setting to 0";
+        return false;
+    }
+    
+    LOG(INFO) << "set stats port to " << value;
+    m_statsPort = value;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setTraceSampleRate
+ * Description: Set how often instrument reads are traced through the port
+ * agent.  One read in every rate is written to the trace file.
+ * Param:
+ *     param - string represention of the rate.  0 turns tracing off.
+ * Return:
+ *     return true if the rate was set correctly, otherwise false.
+ *****************************************************************************/
+bool PortAgentConfig::setTraceSampleRate(const string &param) {
+    int value = atoi(param.c_str());
+    m_traceSampleRate = 0;
+    
+    if(! isdigit(param.c_str()[0]) || value < 0) {
+        LOG(ERROR) << "Invalid trace sample rate specification, setting to 0";
+        return false;
+    }
+    
+    LOG(INFO) << "set trace sample rate to " << value;
+    m_traceSampleRate = value;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setStatsFormat
+ * Description: Set the format of the get_stats reply.
+ * Param:
+ *     param - json or binary
+ * Return:
+ *     return true if the format is known, otherwise false and json is used.
+ *****************************************************************************/
+bool PortAgentConfig::setStatsFormat(const string &param) {
+    m_statsBinary = false;
+    
+    if(param != "json" && param != "binary") {
+        LOG(ERROR) << "invalid stats format, " << param << ", using json";
+        return false;
+    }
+    
+    m_statsBinary = param == "binary";
+    return true;
+}
+
+/******************************************************************************
+ * Method: setSubscriberRingSize
+ * Description: Set the size of the ring shared by data subscribers.  A
+ * subscriber that falls this many bytes behind is disconnected.
+ * Param:
+ *     param - size in bytes
+ * Return:
+ *     return true if the size is in range, otherwise false and the default
+ *     is used.
+ *****************************************************************************/
+bool PortAgentConfig::setSubscriberRingSize(const string &param) {
+    long value = atol(param.c_str());
+    m_subscriberRingSize = DEFAULT_SUBSCRIPTION_RING_SIZE;
+    
+    if(value < MIN_SUBSCRIPTION_RING_SIZE || value > MAX_SUBSCRIPTION_RING_SIZE) {
+        LOG(ERROR) << "Invalid subscriber ring size, using default "
+                   << DEFAULT_SUBSCRIPTION_RING_SIZE;
+        return false;
+    }
+    
+    LOG(INFO) << "set subscriber ring size to " << value;
+    m_subscriberRingSize = value;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setSubscriberClients
+ * Description: Set how many clients can subscribe to the data hub at once.
+ * Connections beyond the limit are closed when they are accepted.
+ * Param:
+ *     param - client count, 1 to MAX_SUBSCRIPTION_SUBSCRIBERS
+ * Return:
+ *     return true if the count is in range, otherwise false and the default
+ *     is used.
+ *****************************************************************************/
+bool PortAgentConfig::setSubscriberClients(const string &param) {
+    int value = atoi(param.c_str());
+    m_subscriberClients = DEFAULT_SUBSCRIPTION_SUBSCRIBERS;
+    
+    if(! isdigit(param.c_str()[0]) || value < 1 || value > MAX_SUBSCRIPTION_SUBSCRIBERS) {
+        LOG(ERROR) << "Invalid subscriber client count, using default "
+                   << DEFAULT_SUBSCRIPTION_SUBSCRIBERS;
+        return false;
+    }
+    
+    LOG(INFO) << "set subscriber clients to " << value;
+    m_subscriberClients = value;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setShmName
+ * Description: Set the name of the shared memory ring packets are published
+ * to for local readers.  POSIX shared memory names are a single leading
+ * slash followed by a name, i.e. /port_agent_4001.
+ * Param:
+ *     param - shared memory name, empty to disable
+ * Return:
+ *     return true if the name is valid, otherwise false and the name is
+ *     cleared.
+ *****************************************************************************/
+bool PortAgentConfig::setShmName(const string &param) {
+    m_shmName = "";
+    
+    if(param.length() && (param.length() < 2 || param[0] != '/' ||
+                          param.find('/', 1) != string::npos)) {
+        LOG(ERROR) << "Invalid shared memory name: " << param;
+        return false;
+    }
+    
+    LOG(INFO) << "set shared memory name to " << param;
+    m_shmName = param;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setShmSize
+ * Description: Set the size of the shared memory ring.  A reader that falls
+ * this many bytes behind is overrun.
+ * Param:
+ *     param - size in bytes
+ * Return:
+ *     return true if the size is in range, otherwise false and the default
+ *     is used.
+ *****************************************************************************/
+bool PortAgentConfig::setShmSize(const string &param) {
+    long value = atol(param.c_str());
+    m_shmSize = DEFAULT_SHM_SIZE;
+    
+    if(value < MIN_SHM_SIZE || value > MAX_SHM_SIZE) {
+        LOG(ERROR) << "Invalid shared memory size, using default "
+                   << DEFAULT_SHM_SIZE;
+        return false;
+    }
+    
+    LOG(INFO) << "set shared memory size to " << value;
+    m_shmSize = value;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setMulticastAddr
+ * Description: Set the group the multicast publisher sends to.  An empty
+ * address disables the publisher.
+ * Param:
+ *     param - IPv4 multicast address, 224.0.0.0 through 239.255.255.255
+ * Return:
+ *     return true if the address is a multicast group, otherwise false and
+ *     the publisher is disabled.
+ *****************************************************************************/
+bool PortAgentConfig::setMulticastAddr(const string &param) {
+    struct in_addr addr;
+    m_multicastAddr = "";
+    
+    if(param.length() && (! inet_aton(param.c_str(), &addr) ||
+                          ! IN_MULTICAST(ntohl(addr.s_addr)))) {
+        LOG(ERROR) << "Invalid multicast address: " << param;
+        return false;
+    }
+    
+    LOG(INFO) << "set multicast address to " << param;
+    m_multicastAddr = param;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setMulticastPort
+ * Description: Set the UDP port of the multicast group.
+ * Param:
+ *     param - port number
+ * Return:
+ *     return true if the port is valid, otherwise false and it is set to 0.
+ *****************************************************************************/
+bool PortAgentConfig::setMulticastPort(const string &param) {
+    int value = atoi(param.c_str());
+    m_multicastPort = 0;
+    
+    if(value <= 0 || value > 65535) {
+        LOG(ERROR) << "Invalid multicast port specification, setting to 0";
+        return false;
+    }
+    
+    LOG(INFO) << "set multicast port to " << value;
+    m_multicastPort = value;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setMulticastTTL
+ * Description: Set how many routers multicast datagrams may cross.  The
+ * default of 1 keeps them on the local network.
+ * Param:
+ *     param - TTL, 0 to 255
+ * Return:
+ *     return true if the TTL is in range, otherwise false and the default
+ *     is used.
+ *****************************************************************************/
+bool PortAgentConfig::setMulticastTTL(const string &param) {
+    int value = atoi(param.c_str());
+    m_multicastTTL = DEFAULT_MULTICAST_TTL;
+    
+    if(! isdigit(param.c_str()[0]) || value > 255) {
+        LOG(ERROR) << "Invalid multicast ttl, using default " << DEFAULT_MULTICAST_TTL;
+        return false;
+    }
+    
+    LOG(INFO) << "set multicast ttl to " << value;
+    m_multicastTTL = value;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setMulticastInterface
+ * Description: Set the interface multicast datagrams are sent on.  Empty
+ * lets the routing table decide.
+ * Param:
+ *     param - interface name or one of its IPv4 addresses
+ * Return:
+ *     return true
+ *****************************************************************************/
+bool PortAgentConfig::setMulticastInterface(const string &param) {
+    LOG(INFO) << "set multicast interface to " << param;
+    m_multicastInterface = param;
+    return true;
+}
+
+/******************************************************************************
+ * Method: setMulticastSequence
+ * Description: Enable the sequence header on multicast datagrams so
+ * receivers can detect loss.
+ * Param:
+ *     param - 1 to enable, 0 to disable
+ * Return:
+ *     return true if the flag was set correctly, otherwise false.
+ *****************************************************************************/
+bool PortAgentConfig::setMulticastSequence(const string &param) {
+    m_multicastSequence = false;
+    
+    if(param != "0" && param != "1") {
+        LOG(ERROR) << "invalid multicast sequence parameter, " << param;
+        return false;
+    }
+    
+    m_multicastSequence = param == "1";
+    LOG(INFO) << "set multicast sequence to " << m_multicastSequence;
+    return true;
+}
+
 
 /******************************************************************************
  *   PRIVATE METHODS
@@ -1240,6 +1865,11 @@ bool PortAgentConfig::processCommand(const string & command) {
     else if( command == "get_state" )
         addCommand(CMD_GET_STATE);
         
+    else if( command == "get_stats" ) {
+        addCommand(CMD_GET_STATS);
+        return setStatsFormat("json");
+    }
+        
     else if( command == "ping" )
         addCommand(CMD_PING);
         
@@ -1278,6 +1908,20 @@ bool PortAgentConfig::processCommand(const string & command) {
         return setOutputThrottle(param);
     }
     
+    else if(cmd == "kernel_timestamps") {
+        addCommand(CMD_TIMESTAMP_CONFIG_UPDATE);
+        return setKernelTimestamps(param);
+    }
+    
+    else if(cmd == "instrument_nodelay") {
+        addCommand(CMD_PUBLISHER_CONFIG_UPDATE);
+        return setInstrumentNoDelay(param);
+    }
+    
+    else if(cmd == "driver_coalesce") {
+        return setDriverCoalesce(param);
+    }
+    
     else if(cmd == "heartbeat_interval") {
         return setHeartbeatInterval(param);
     }
@@ -1287,6 +1931,10 @@ bool PortAgentConfig::processCommand(const string & command) {
         return setMaxPacketSize(param);
     }
     
+    else if(cmd == "bulk_read_budget") {
+        return setBulkReadBudget(param);
+    }
+    
     else if(cmd == "data_port") {
         addCommand(CMD_COMM_CONFIG_UPDATE);
         return setObservatoryDataPort(param);
@@ -1303,6 +1951,21 @@ bool PortAgentConfig::processCommand(const string & command) {
         return setObservatoryCommandPort(param);
     }
     
+    else if(cmd == "data_socket") {
+        addCommand(CMD_COMM_CONFIG_UPDATE);
+        return setObservatoryDataSocket(param);
+    }
+    
+    else if(cmd == "command_socket") {
+        addCommand(CMD_COMM_CONFIG_UPDATE);
+        return setObservatoryCommandSocket(param);
+    }
+    
+    else if(cmd == "unix_socket_type") {
+        addCommand(CMD_COMM_CONFIG_UPDATE);
+        return setUnixSocketType(param);
+    }
+    
     else if(cmd == "instrument_data_port") {
         addCommand(CMD_COMM_CONFIG_UPDATE);
         return setInstrumentDataPort(param);
@@ -1420,6 +2083,81 @@ bool PortAgentConfig::processCommand(const string & command) {
         return setTelnetSnifferSuffix(param);
     }
     
+    else if(cmd == "telnet_sniffer_splice") {
+        addCommand(CMD_PUBLISHER_CONFIG_UPDATE);
+        return setTelnetSnifferSplice(param);
+    }
+    
+    else if(cmd == "telnet_sniffer_clients") {
+        addCommand(CMD_PUBLISHER_CONFIG_UPDATE);
+        return setTelnetSnifferClients(param);
+    }
+    
+    else if(cmd == "get_stats") {
+        addCommand(CMD_GET_STATS);
+        return setStatsFormat(param);
+    }
+    
+    else if(cmd == "stats_port") {
+        addCommand(CMD_STATS_CONFIG_UPDATE);
+        return setStatsPort(param);
+    }
+    
+    else if(cmd == "trace_sample_rate") {
+        addCommand(CMD_TRACE_CONFIG_UPDATE);
+        return setTraceSampleRate(param);
+    }
+    
+    else if(cmd == "subscriber_port") {
+        addCommand(CMD_PUBLISHER_CONFIG_UPDATE);
+        return setSubscriberPort(param);
+    }
+    
+    else if(cmd == "subscriber_ring_size") {
+        addCommand(CMD_PUBLISHER_CONFIG_UPDATE);
+        return setSubscriberRingSize(param);
+    }
+    
+    else if(cmd == "subscriber_clients") {
+        addCommand(CMD_PUBLISHER_CONFIG_UPDATE);
+        return setSubscriberClients(param);
+    }
+    
+    else if(cmd == "shm_name") {
+        addCommand(CMD_PUBLISHER_CONFIG_UPDATE);
+        return setShmName(param);
+    }
+    
+    else if(cmd == "shm_size") {
+        addCommand(CMD_PUBLISHER_CONFIG_UPDATE);
+        return setShmSize(param);
+    }
+    
+    else if(cmd == "multicast_addr") {
+        addCommand(CMD_PUBLISHER_CONFIG_UPDATE);
+        return setMulticastAddr(param);
+    }
+    
+    else if(cmd == "multicast_port") {
+        addCommand(CMD_PUBLISHER_CONFIG_UPDATE);
+        return setMulticastPort(param);
+    }
+    
+    else if(cmd == "multicast_ttl") {
+        addCommand(CMD_PUBLISHER_CONFIG_UPDATE);
+        return setMulticastTTL(param);
+    }
+    
+    else if(cmd == "multicast_interface") {
+        addCommand(CMD_PUBLISHER_CONFIG_UPDATE);
+        return setMulticastInterface(param);
+    }
+    
+    else if(cmd == "multicast_sequence") {
+        addCommand(CMD_PUBLISHER_CONFIG_UPDATE);
+        return setMulticastSequence(param);
+    }
+    
     // Couldn't parse this command
     else {
         LOG(ERROR) << "Failed to parse command: " << cmd;
@@ -20,6 +20,7 @@
 #include <list>
 #include <stdint.h>
 #include "common/log_file.h"
+#include "network/subscription_hub.h"
 
 using namespace std;
 using namespace logger;
@@ -30,7 +31,17 @@ using namespace logger;
 #define MAX_BREAK_DURATION 4000
 #define MAX_PACKET_SIZE       4097
 #define RSN_RAW_PACKET_BUFFER_SIZE 65536  // TODO: What should RSN packet buffer size be?
+#define OUTPUT_THROTTLE_BUFFER_SIZE 65536
 #define DEFAULT_HEARTBEAT_INTERVAL 120
+#define DEFAULT_BULK_READ_BUDGET 8
+#define MAX_BULK_READ_BUDGET 1024
+#define DEFAULT_SHM_SIZE 4194304
+#define DEFAULT_TELNET_SNIFFER_CLIENTS 1
+#define MAX_TELNET_SNIFFER_CLIENTS 64
+#define DEFAULT_MULTICAST_TTL 1
+#define MAX_UNIX_SOCKET_PATH 107
+#define MIN_SHM_SIZE 65536
+#define MAX_SHM_SIZE 1073741824
 
 // Set the RSN Digi to add Binary Timestamps to data
 #define TIMESTAMP_BINARY 2
@@ -59,7 +70,11 @@ namespace port_agent {
         CMD_PING                    = 0x00000008,
         CMD_BREAK                   = 0x00000009,
         CMD_SHUTDOWN                = 0x00000010,
-        CMD_ROTATION_INTERVAL       = 0x00000011
+        CMD_ROTATION_INTERVAL       = 0x00000011,
+        CMD_GET_STATS               = 0x00000012,
+        CMD_STATS_CONFIG_UPDATE     = 0x00000013,
+        CMD_TRACE_CONFIG_UPDATE     = 0x00000014,
+        CMD_TIMESTAMP_CONFIG_UPDATE = 0x00000015
     } PortAgentCommand;
     typedef list<PortAgentCommand>  CommandQueue;
     
@@ -76,7 +91,8 @@ namespace port_agent {
         TYPE_SERIAL            = 0x00000001,
         TYPE_TCP               = 0x00000002,
         TYPE_BOTPT             = 0x00000003,
-        TYPE_RSN               = 0x00000004
+        TYPE_RSN               = 0x00000004,
+        TYPE_UDP               = 0x00000005
     } InstrumentConnectionType;
 
     // DHE NEW: a list of data port entries; in the future the ObservatoryDataPortEntry_T
@@ -136,12 +152,19 @@ namespace port_agent {
             // when replaces, but that name isn't as descriptive
             bool addObservatoryDataPort(const string &param);
             bool setObservatoryCommandPort(const string &param);
+            bool setObservatoryDataSocket(const string &param);
+            bool setObservatoryCommandSocket(const string &param);
+            bool setUnixSocketType(const string &param);
             bool setInstrumentBreakDuration(const string &param);
             bool setInstrumentConnectionType(const string &param);
             bool setSentinleSequence(const string &param);
             bool setOutputThrottle(const string &param);
+            bool setKernelTimestamps(const string &param);
+            bool setInstrumentNoDelay(const string &param);
+            bool setDriverCoalesce(const string &param);
             bool setHeartbeatInterval(const string &param);
             bool setMaxPacketSize(const string &param);
+            bool setBulkReadBudget(const string &param);
             bool setLogLevel(const string &param);
             bool setDevicePath(const string &param);
             bool setBaud(const string &param);
@@ -157,6 +180,21 @@ namespace port_agent {
 			bool setTelnetSnifferPort(const string &param);
             bool setTelnetSnifferPrefix(const string &param) { m_telnetSnifferPrefix = param; return true; }
             bool setTelnetSnifferSuffix(const string &param) { m_telnetSnifferSuffix = param; return true; }
+            bool setTelnetSnifferSplice(const string &param);
+            bool setTelnetSnifferClients(const string &param);
+            bool setSubscriberPort(const string &param);
+            bool setSubscriberRingSize(const string &param);
+            bool setSubscriberClients(const string &param);
+            bool setStatsPort(const string &param);
+            bool setStatsFormat(const string &param);
+            bool setTraceSampleRate(const string &param);
+            bool setShmName(const string &param);
+            bool setShmSize(const string &param);
+            bool setMulticastAddr(const string &param);
+            bool setMulticastPort(const string &param);
+            bool setMulticastTTL(const string &param);
+            bool setMulticastInterface(const string &param);
+            bool setMulticastSequence(const string &param);
             
             // Common Config
             string programName() { return m_programName; }
@@ -166,6 +204,8 @@ namespace port_agent {
             uint32_t ppid() { return m_ppid; }
             
             string logfile();
+            string eventfile();
+            string tracefile();
             string pidfile();
             string conffile();
             string datafile();
@@ -182,12 +222,22 @@ namespace port_agent {
             unsigned int observatoryCommandPort() { return m_observatoryCommandPort; }
             unsigned int observatoryDataPort() { return m_observatoryDataPort; }
             
+            // Unix domain socket paths for the observatory ports, empty
+            // when the port uses TCP
+            string observatoryDataSocket() { return m_observatoryDataSocket; }
+            string observatoryCommandSocket() { return m_observatoryCommandSocket; }
+            bool unixSocketSeqPacket() { return m_unixSocketSeqPacket; }
+            
             ObservatoryConnectionType observatoryConnectionType() { return m_observatoryConnectionType; }
             InstrumentConnectionType instrumentConnectionType() { return m_instrumentConnectionType; }
             const string & sentinleSequence() { return m_sentinleSequence; }
             uint32_t outputThrottle() { return m_outputThrottle; }
+            bool kernelTimestamps() { return m_kernelTimestamps; }
+            bool instrumentNoDelay() { return m_instrumentNoDelay; }
+            bool driverCoalesce() { return m_driverCoalesce; }
             uint32_t heartbeatInterval() { return m_heartbeatInterval; }
             uint32_t maxPacketSize() { return m_maxPacketSize; }
+            uint32_t bulkReadBudget() { return m_bulkReadBudget; }
             
             bool    devicePathChanged() { return m_bDevicePathChanged; }
             void    clearDevicePathChanged() { m_bDevicePathChanged = false; }
@@ -210,6 +260,29 @@ namespace port_agent {
             uint16_t telnetSnifferPort() { return m_telnetSnifferPort; }
             string telnetSnifferPrefix() { return m_telnetSnifferPrefix; }
             string telnetSnifferSuffix() { return m_telnetSnifferSuffix; }
+            bool telnetSnifferSplice() { return m_telnetSnifferSplice; }
+            uint32_t telnetSnifferClients() { return m_telnetSnifferClients; }
+            
+            // Subscription hub config
+            uint16_t subscriberPort() { return m_subscriberPort; }
+            uint32_t subscriberRingSize() { return m_subscriberRingSize; }
+            uint32_t subscriberClients() { return m_subscriberClients; }
+            
+            // Monitoring config
+            uint16_t statsPort() { return m_statsPort; }
+            bool statsBinary() { return m_statsBinary; }
+            uint32_t traceSampleRate() { return m_traceSampleRate; }
+            
+            // Shared memory publisher config
+            string shmName() { return m_shmName; }
+            uint32_t shmSize() { return m_shmSize; }
+            
+            // Multicast publisher config
+            string multicastAddr() { return m_multicastAddr; }
+            uint16_t multicastPort() { return m_multicastPort; }
+            int multicastTTL() { return m_multicastTTL; }
+            string multicastInterface() { return m_multicastInterface; }
+            bool multicastSequence() { return m_multicastSequence; }
             
         private:
             void setParameter(char option, char *value);
@@ -247,10 +320,17 @@ namespace port_agent {
             
             uint16_t m_observatoryCommandPort;
             uint16_t m_observatoryDataPort;
+            string m_observatoryDataSocket;
+            string m_observatoryCommandSocket;
+            bool m_unixSocketSeqPacket;
             string m_sentinleSequence;
             
             uint32_t m_outputThrottle;
+            bool m_kernelTimestamps;
+            bool m_instrumentNoDelay;
+            bool m_driverCoalesce;
             uint32_t m_maxPacketSize;
+            uint32_t m_bulkReadBudget;
             
             ObservatoryConnectionType m_observatoryConnectionType;
             InstrumentConnectionType m_instrumentConnectionType;
@@ -277,6 +357,29 @@ namespace port_agent {
 			uint16_t m_telnetSnifferPort;
 			string m_telnetSnifferPrefix;
 			string m_telnetSnifferSuffix;
+			bool m_telnetSnifferSplice;
+			uint32_t m_telnetSnifferClients;
+			
+			// Subscription hub config
+			uint16_t m_subscriberPort;
+			uint32_t m_subscriberRingSize;
+			uint32_t m_subscriberClients;
+			
+			// Monitoring config
+			uint16_t m_statsPort;
+			bool m_statsBinary;
+			uint32_t m_traceSampleRate;
+			
+			// Shared memory publisher config
+			string m_shmName;
+			uint32_t m_shmSize;
+			
+			// Multicast publisher config
+			string m_multicastAddr;
+			uint16_t m_multicastPort;
+			int m_multicastTTL;
+			string m_multicastInterface;
+			bool m_multicastSequence;
     };
 }
 
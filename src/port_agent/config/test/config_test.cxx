@@ -234,6 +234,10 @@ TEST_F(CommonTest, SetInstrumentConnectionType) {
     EXPECT_TRUE(config.parse("instrument_type rsn"));
     EXPECT_EQ(config.instrumentConnectionType(), TYPE_RSN);
     
+    // UDP Connection
+    EXPECT_TRUE(config.parse("instrument_type udp"));
+    EXPECT_EQ(config.instrumentConnectionType(), TYPE_UDP);
+    
     // No parameter
     EXPECT_FALSE(config.parse("instrument_type"));
     EXPECT_FALSE(config.instrumentConnectionType());
@@ -312,6 +316,208 @@ TEST_F(CommonTest, SetOutputThrottle) {
     EXPECT_EQ(config.outputThrottle(), 0);
 }
 
+/* Test setting the kernel timestamps flag */
+TEST_F(CommonTest, SetKernelTimestamps) {
+    char* argv[] = { "port_agent_config_test", "-p", TEST_PORT };
+    int argc = sizeof(argv) / sizeof(char*);
+    
+    PortAgentConfig config(argc, argv);
+    while(config.getCommand()) {}
+    
+    EXPECT_FALSE(config.kernelTimestamps());
+    
+    EXPECT_TRUE(config.parse("kernel_timestamps 1"));
+    EXPECT_EQ(config.getCommand(), CMD_TIMESTAMP_CONFIG_UPDATE);
+    EXPECT_TRUE(config.kernelTimestamps());
+    
+    EXPECT_TRUE(config.parse("kernel_timestamps 0"));
+    EXPECT_FALSE(config.kernelTimestamps());
+    
+    EXPECT_TRUE(config.parse("kernel_timestamps 1"));
+    EXPECT_FALSE(config.parse("kernel_timestamps yes"));
+    EXPECT_FALSE(config.kernelTimestamps());
+    
+    EXPECT_FALSE(config.parse("kernel_timestamps"));
+    EXPECT_FALSE(config.kernelTimestamps());
+}
+
+/* Test setting the driver to instrument write options */
+TEST_F(CommonTest, SetDriverWriteOptions) {
+    char* argv[] = { "port_agent_config_test", "-p", TEST_PORT };
+    int argc = sizeof(argv) / sizeof(char*);
+    
+    PortAgentConfig config(argc, argv);
+    
+    EXPECT_FALSE(config.instrumentNoDelay());
+    EXPECT_FALSE(config.driverCoalesce());
+    
+    EXPECT_TRUE(config.parse("instrument_nodelay 1"));
+    EXPECT_TRUE(config.instrumentNoDelay());
+    EXPECT_TRUE(config.parse("driver_coalesce 1"));
+    EXPECT_TRUE(config.driverCoalesce());
+    
+    EXPECT_TRUE(config.parse("instrument_nodelay 0"));
+    EXPECT_FALSE(config.instrumentNoDelay());
+    EXPECT_TRUE(config.parse("driver_coalesce 0"));
+    EXPECT_FALSE(config.driverCoalesce());
+    
+    EXPECT_TRUE(config.parse("instrument_nodelay 1"));
+    EXPECT_FALSE(config.parse("instrument_nodelay on"));
+    EXPECT_FALSE(config.instrumentNoDelay());
+    
+    EXPECT_TRUE(config.parse("driver_coalesce 1"));
+    EXPECT_FALSE(config.parse("driver_coalesce"));
+    EXPECT_FALSE(config.driverCoalesce());
+}
+
+/* Test setting the instrument reads allowed per loop pass */
+TEST_F(CommonTest, SetBulkReadBudget) {
+    char* argv[] = { "port_agent_config_test", "-p", TEST_PORT };
+    int argc = sizeof(argv) / sizeof(char*);
+    
+    PortAgentConfig config(argc, argv);
+    
+    EXPECT_EQ(config.bulkReadBudget(), DEFAULT_BULK_READ_BUDGET);
+    
+    EXPECT_TRUE(config.parse("bulk_read_budget 1"));
+    EXPECT_EQ(config.bulkReadBudget(), 1);
+    
+    EXPECT_TRUE(config.parse("bulk_read_budget 1024"));
+    EXPECT_EQ(config.bulkReadBudget(), 1024);
+    
+    EXPECT_FALSE(config.parse("bulk_read_budget 1025"));
+    EXPECT_EQ(config.bulkReadBudget(), DEFAULT_BULK_READ_BUDGET);
+    
+    EXPECT_FALSE(config.parse("bulk_read_budget 0"));
+    EXPECT_FALSE(config.parse("bulk_read_budget -1"));
+    EXPECT_FALSE(config.parse("bulk_read_budget lots"));
+    EXPECT_FALSE(config.parse("bulk_read_budget"));
+    EXPECT_EQ(config.bulkReadBudget(), DEFAULT_BULK_READ_BUDGET);
+}
+
+/* Test setting the subscription hub parameters */
+TEST_F(CommonTest, SetSubscriber) {
+    char* argv[] = { "port_agent_config_test", "-p", TEST_PORT };
+    int argc = sizeof(argv) / sizeof(char*);
+    
+    PortAgentConfig config(argc, argv);
+    
+    EXPECT_EQ(config.subscriberPort(), 0);
+    EXPECT_EQ(config.subscriberRingSize(), DEFAULT_SUBSCRIPTION_RING_SIZE);
+    
+    EXPECT_TRUE(config.parse("subscriber_port 4005"));
+    EXPECT_EQ(config.subscriberPort(), 4005);
+    
+    EXPECT_FALSE(config.parse("subscriber_port 70000"));
+    EXPECT_EQ(config.subscriberPort(), 0);
+    
+    EXPECT_TRUE(config.parse("subscriber_ring_size 65536"));
+    EXPECT_EQ(config.subscriberRingSize(), 65536);
+    
+    EXPECT_FALSE(config.parse("subscriber_ring_size 100"));
+    EXPECT_EQ(config.subscriberRingSize(), DEFAULT_SUBSCRIPTION_RING_SIZE);
+    
+    EXPECT_EQ(config.subscriberClients(), DEFAULT_SUBSCRIPTION_SUBSCRIBERS);
+    EXPECT_TRUE(config.parse("subscriber_clients 8"));
+    EXPECT_EQ(config.subscriberClients(), 8);
+    
+    EXPECT_FALSE(config.parse("subscriber_clients 0"));
+    EXPECT_FALSE(config.parse("subscriber_clients 100000"));
+    EXPECT_FALSE(config.parse("subscriber_clients many"));
+    EXPECT_EQ(config.subscriberClients(), DEFAULT_SUBSCRIPTION_SUBSCRIBERS);
+}
+
+/* Test setting the shared memory publisher parameters */
+TEST_F(CommonTest, SetShm) {
+    char* argv[] = { "port_agent_config_test", "-p", TEST_PORT };
+    int argc = sizeof(argv) / sizeof(char*);
+    
+    PortAgentConfig config(argc, argv);
+    
+    EXPECT_EQ(config.shmName(), "");
+    EXPECT_EQ(config.shmSize(), DEFAULT_SHM_SIZE);
+    
+    EXPECT_TRUE(config.parse("shm_name /port_agent_4001"));
+    EXPECT_EQ(config.shmName(), "/port_agent_4001");
+    
+    EXPECT_FALSE(config.parse("shm_name port/agent"));
+    EXPECT_EQ(config.shmName(), "");
+    
+    EXPECT_TRUE(config.parse("shm_size 1048576"));
+    EXPECT_EQ(config.shmSize(), 1048576);
+    
+    EXPECT_FALSE(config.parse("shm_size 100"));
+    EXPECT_EQ(config.shmSize(), DEFAULT_SHM_SIZE);
+}
+
+/* Test setting unix domain socket transports */
+TEST_F(CommonTest, SetUnixSocket) {
+    char* argv[] = { "port_agent_config_test", "-p", TEST_PORT };
+    int argc = sizeof(argv) / sizeof(char*);
+    
+    PortAgentConfig config(argc, argv);
+    
+    EXPECT_EQ(config.observatoryCommandSocket(), "");
+    EXPECT_EQ(config.observatoryDataSocket(), "");
+    EXPECT_TRUE(config.unixSocketSeqPacket());
+    
+    EXPECT_TRUE(config.parse("command_socket @port_agent_cmd"));
+    EXPECT_EQ(config.observatoryCommandSocket(), "@port_agent_cmd");
+    EXPECT_EQ(config.getCommand(), CMD_COMM_CONFIG_UPDATE);
+    
+    EXPECT_TRUE(config.parse("data_socket /tmp/port_agent.data"));
+    EXPECT_EQ(config.observatoryDataSocket(), "/tmp/port_agent.data");
+    
+    EXPECT_FALSE(config.parse("data_socket relative.data"));
+    EXPECT_EQ(config.observatoryDataSocket(), "");
+    
+    EXPECT_TRUE(config.parse("command_socket tcp"));
+    EXPECT_EQ(config.observatoryCommandSocket(), "");
+    
+    EXPECT_TRUE(config.parse("unix_socket_type stream"));
+    EXPECT_FALSE(config.unixSocketSeqPacket());
+    
+    EXPECT_FALSE(config.parse("unix_socket_type dgram"));
+    EXPECT_TRUE(config.unixSocketSeqPacket());
+}
+
+/* Test setting the multicast publisher */
+TEST_F(CommonTest, SetMulticast) {
+    char* argv[] = { "port_agent_config_test", "-p", TEST_PORT };
+    int argc = sizeof(argv) / sizeof(char*);
+    
+    PortAgentConfig config(argc, argv);
+    
+    EXPECT_EQ(config.multicastAddr(), "");
+    EXPECT_EQ(config.multicastTTL(), DEFAULT_MULTICAST_TTL);
+    EXPECT_FALSE(config.multicastSequence());
+    
+    EXPECT_TRUE(config.parse("multicast_addr 239.255.0.1"));
+    EXPECT_EQ(config.multicastAddr(), "239.255.0.1");
+    EXPECT_EQ(config.getCommand(), CMD_PUBLISHER_CONFIG_UPDATE);
+    
+    EXPECT_FALSE(config.parse("multicast_addr 10.0.0.1"));
+    EXPECT_EQ(config.multicastAddr(), "");
+    
+    EXPECT_TRUE(config.parse("multicast_port 5000"));
+    EXPECT_EQ(config.multicastPort(), 5000);
+    EXPECT_FALSE(config.parse("multicast_port 70000"));
+    EXPECT_EQ(config.multicastPort(), 0);
+    
+    EXPECT_TRUE(config.parse("multicast_ttl 0"));
+    EXPECT_EQ(config.multicastTTL(), 0);
+    EXPECT_FALSE(config.parse("multicast_ttl 300"));
+    EXPECT_EQ(config.multicastTTL(), DEFAULT_MULTICAST_TTL);
+    
+    EXPECT_TRUE(config.parse("multicast_interface eth0"));
+    EXPECT_EQ(config.multicastInterface(), "eth0");
+    
+    EXPECT_TRUE(config.parse("multicast_sequence 1"));
+    EXPECT_TRUE(config.multicastSequence());
+    EXPECT_FALSE(config.parse("multicast_sequence yes"));
+    EXPECT_FALSE(config.multicastSequence());
+}
+
 /* Test setting the heartbeat interval parametere */
 TEST_F(CommonTest, SetHeartbeatInterval) {
     char* argv[] = { "port_agent_config_test", "-p", TEST_PORT };
@@ -805,6 +1011,29 @@ TEST_F(CommonTest, TelnetSnifferConfig) {
 	EXPECT_EQ(config.telnetSnifferPort(), 10);
 	EXPECT_EQ(config.telnetSnifferPrefix(), "<<<");
 	EXPECT_EQ(config.telnetSnifferSuffix(), ">>>");
+    
+    EXPECT_FALSE(config.telnetSnifferSplice());
+    EXPECT_TRUE(config.parse("telnet_sniffer_splice 1"));
+    EXPECT_TRUE(config.telnetSnifferSplice());
+    EXPECT_TRUE(config.parse("telnet_sniffer_splice 0"));
+    EXPECT_FALSE(config.telnetSnifferSplice());
+    
+    EXPECT_TRUE(config.parse("telnet_sniffer_splice 1"));
+    EXPECT_FALSE(config.parse("telnet_sniffer_splice yes"));
+    EXPECT_FALSE(config.telnetSnifferSplice());
+    
+    EXPECT_EQ(config.telnetSnifferClients(), DEFAULT_TELNET_SNIFFER_CLIENTS);
+    EXPECT_TRUE(config.parse("telnet_sniffer_clients 8"));
+    EXPECT_EQ(config.telnetSnifferClients(), 8);
+    EXPECT_TRUE(config.parse("telnet_sniffer_clients 64"));
+    EXPECT_EQ(config.telnetSnifferClients(), 64);
+    
+    EXPECT_FALSE(config.parse("telnet_sniffer_clients 65"));
+    EXPECT_EQ(config.telnetSnifferClients(), DEFAULT_TELNET_SNIFFER_CLIENTS);
+    EXPECT_FALSE(config.parse("telnet_sniffer_clients 0"));
+    EXPECT_FALSE(config.parse("telnet_sniffer_clients -2"));
+    EXPECT_FALSE(config.parse("telnet_sniffer_clients many"));
+    EXPECT_EQ(config.telnetSnifferClients(), DEFAULT_TELNET_SNIFFER_CLIENTS);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1022,6 +1251,38 @@ TEST_F(CommonTest, IsConfiguredSerial) {
     }
 }
 
+/* Test isConfigured method */
+TEST_F(CommonTest, IsConfiguredUDP) {
+    try {
+        char* argv[] = { "port_agent_config_test", "-p", TEST_PORT };
+        int argc = sizeof(argv) / sizeof(char*);
+        ostringstream cfg;
+        
+        PortAgentConfig config(argc, argv);
+        
+        EXPECT_TRUE(config.parse("instrument_type udp"));
+        EXPECT_TRUE(config.parse("data_port 4000"));
+        
+        EXPECT_FALSE(config.isConfigured());
+        EXPECT_TRUE(config.parse("instrument_addr 127.0.0.1"));
+        
+        EXPECT_FALSE(config.isConfigured());
+        EXPECT_TRUE(config.parse("instrument_data_tx_port 1270"));
+        
+        EXPECT_FALSE(config.isConfigured());
+        EXPECT_TRUE(config.parse("instrument_data_rx_port 1271"));
+        
+        EXPECT_TRUE(config.isConfigured());
+        EXPECT_TRUE(config.parse("instrument_type serial"));
+        EXPECT_FALSE(config.isConfigured());
+    }
+    catch(OOIException &e) {
+	string errmsg = e.what();
+	LOG(ERROR) << "EXCEPTION: " << errmsg;
+        ASSERT_FALSE(true);
+    }
+}
+
 /* Test directory override method */
  TEST_F(CommonTest, DirectoryOverride) {
      try {
@@ -1073,3 +1334,58 @@ TEST_F(CommonTest, DirectoryOverrideKill) {
         ASSERT_FALSE(true);
     }
 }
+
+/* Test the get_stats command and stats port */
+TEST_F(CommonTest, SetStatsOptions) {
+    char* argv[] = { "port_agent_config_test", "-p", TEST_PORT };
+    int argc = sizeof(argv) / sizeof(char*);
+    
+    PortAgentConfig config(argc, argv);
+    while(config.getCommand()) {}
+    
+    EXPECT_EQ(config.statsPort(), 0);
+    EXPECT_FALSE(config.statsBinary());
+    
+    EXPECT_TRUE(config.parse("get_stats binary"));
+    EXPECT_EQ(config.getCommand(), CMD_GET_STATS);
+    EXPECT_TRUE(config.statsBinary());
+    
+    EXPECT_TRUE(config.parse("get_stats"));
+    EXPECT_EQ(config.getCommand(), CMD_GET_STATS);
+    EXPECT_FALSE(config.statsBinary());
+    
+    EXPECT_FALSE(config.parse("get_stats xml"));
+    EXPECT_FALSE(config.statsBinary());
+    while(config.getCommand()) {}
+    
+    EXPECT_TRUE(config.parse("stats_port 9100"));
+    EXPECT_EQ(config.getCommand(), CMD_STATS_CONFIG_UPDATE);
+    EXPECT_EQ(config.statsPort(), 9100);
+    
+    EXPECT_TRUE(config.parse("stats_port 0"));
+    EXPECT_EQ(config.statsPort(), 0);
+    
+    EXPECT_FALSE(config.parse("stats_port 70000"));
+    EXPECT_EQ(config.statsPort(), 0);
+}
+
+/* Test the trace sample rate */
+TEST_F(CommonTest, SetTraceSampleRate) {
+    char* argv[] = { "port_agent_config_test", "-p", TEST_PORT };
+    int argc = sizeof(argv) / sizeof(char*);
+    
+    PortAgentConfig config(argc, argv);
+    while(config.getCommand()) {}
+    
+    EXPECT_EQ(config.traceSampleRate(), 0);
+    
+    EXPECT_TRUE(config.parse("trace_sample_rate 100"));
+    EXPECT_EQ(config.getCommand(), CMD_TRACE_CONFIG_UPDATE);
+    EXPECT_EQ(config.traceSampleRate(), 100);
+    EXPECT_NE(config.getConfig().find("trace_sample_rate 100\n"), string::npos);
+    
+    EXPECT_FALSE(config.parse("trace_sample_rate often"));
+    EXPECT_EQ(config.traceSampleRate(), 0);
+    
+    EXPECT_EQ(config.tracefile().substr(config.tracefile().length() - 6), ".trace");
+}
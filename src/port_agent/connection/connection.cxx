@@ -15,6 +15,7 @@
 #include "common/logger.h"
 #include "common/exception.h"
 #include "network/comm_base.h"
+#include "network/unix_comm_listener.h"
 
 using namespace std;
 using namespace logger;
@@ -79,3 +80,72 @@ void Connection::initialize() {
 }
 
 
+
+/******************************************************************************
+ *   PROTECTED METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: setListenerTransport
+ * Description: Make sure a listener uses the requested transport.  If it
+ * doesn't, it is closed and replaced with a new, uninitialized listener on
+ * the same port.
+ *
+ * Parameters:
+ *   listener - listener to check, may be NULL
+ *   path - unix domain socket path or abstract name, empty for TCP
+ *   seqpacket - use SOCK_SEQPACKET for a unix domain socket
+ * Return:
+ *   true if the listener was replaced
+ ******************************************************************************/
+bool Connection::setListenerTransport(TCPCommListener *&listener,
+                                      const string &path, bool seqpacket) {
+    int socketType = seqpacket ? SOCK_SEQPACKET : SOCK_STREAM;
+    uint16_t port = listener ? listener->port() : 0;
+    
+    if(listener) {
+        if(path.length() == 0 && listener->type() == COMM_TCP_LISTENER)
+            return false;
+        
+        if(path.length() && listener->type() == COMM_UNIX_LISTENER &&
+           ((UnixCommListener *)listener)->path() == path &&
+           ((UnixCommListener *)listener)->socketType() == socketType)
+            return false;
+        
+        delete listener;
+    }
+    
+    if(path.length()) {
+        UnixCommListener *unixListener = new UnixCommListener();
+        unixListener->setPath(path);
+        unixListener->setSocketType(socketType);
+        listener = unixListener;
+    }
+    else
+        listener = new TCPCommListener();
+    
+    listener->setPort(port);
+    return true;
+}
+
+/******************************************************************************
+ * Method: cloneListener
+ * Description: Create a listener with the same transport and port as
+ * another.  Sockets aren't shared, the new listener is uninitialized.
+ ******************************************************************************/
+TCPCommListener * Connection::cloneListener(TCPCommListener *rhs) {
+    TCPCommListener *listener = NULL;
+    
+    if(rhs && rhs->type() == COMM_UNIX_LISTENER) {
+        UnixCommListener *unixListener = (UnixCommListener *)rhs;
+        setListenerTransport(listener, unixListener->path(),
+                             unixListener->socketType() == SOCK_SEQPACKET);
+    }
+    else
+        setListenerTransport(listener, "", false);
+    
+    if(rhs)
+        listener->setPort(rhs->port());
+    
+    return listener;
+}
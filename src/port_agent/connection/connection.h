@@ -14,6 +14,9 @@
 #define __CONNECTION_H_
 
 #include "network/comm_base.h"
+#include "network/tcp_comm_listener.h"
+
+#include <string>
 
 using namespace std;
 using namespace network;
@@ -26,7 +29,8 @@ namespace port_agent {
         PACONN_INSTRUMENT_TCP       = 0x03,
         PACONN_INSTRUMENT_BOTPT     = 0x04,
         PACONN_INSTRUMENT_SERIAL    = 0x05,
-        PACONN_INSTRUMENT_RSN    	= 0x06
+        PACONN_INSTRUMENT_RSN    	= 0x06,
+        PACONN_INSTRUMENT_UDP       = 0x07
 
     } PortAgentConnectionType;
     
@@ -80,8 +84,16 @@ namespace port_agent {
 
             // Send break condition for duration (milliseconds)
             virtual bool sendBreak(uint32_t duration) { return false; }
+            
+            // Listen for commands on a unix domain socket instead of TCP.
+            // An empty path switches back to TCP.  Returns true if the
+            // listener was replaced and needs to be initialized.
+            virtual bool setCommandSocketPath(const string &path, bool seqpacket) { return false; }
         
         protected:
+            static bool setListenerTransport(TCPCommListener *&listener,
+                                             const string &path, bool seqpacket);
+            static TCPCommListener * cloneListener(TCPCommListener *rhs);
 
         private:
         
@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * Class: InstrumentUDPConnection
+ * Filename: instrument_udp_connection.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Manages the connection to a UDP instrument.
+ *
+ ******************************************************************************/
+
+#include "instrument_udp_connection.h"
+#include "common/util.h"
+#include "common/logger.h"
+#include "common/exception.h"
+
+using namespace std;
+using namespace logger;
+using namespace network;
+using namespace port_agent;
+
+/******************************************************************************
+ *   PUBLIC METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: Constructor
+ * Description: Default constructor.
+ ******************************************************************************/
+InstrumentUDPConnection::InstrumentUDPConnection() : Connection() {
+}
+
+/******************************************************************************
+ * Method: Copy Constructor
+ * Description: Copy the configuration.  The socket and pool aren't shared.
+ ******************************************************************************/
+InstrumentUDPConnection::InstrumentUDPConnection(const InstrumentUDPConnection& rhs) {
+    copy(rhs);
+}
+
+/******************************************************************************
+ * Method: Destructor
+ ******************************************************************************/
+InstrumentUDPConnection::~InstrumentUDPConnection() {
+    m_oDataSocket.disconnect();
+}
+
+/******************************************************************************
+ * Method: Assignemnt operator
+ ******************************************************************************/
+InstrumentUDPConnection & InstrumentUDPConnection::operator=(const InstrumentUDPConnection &rhs) {
+    copy(rhs);
+    return *this;
+}
+
+/******************************************************************************
+ * Method: copy
+ * Description: Copy the socket configuration.
+ ******************************************************************************/
+void InstrumentUDPConnection::copy(const InstrumentUDPConnection &copy) {
+    m_oDataSocket = copy.m_oDataSocket;
+}
+
+/******************************************************************************
+ * Method: setDataHost
+ * Description: Set the instrument host.  If the socket is open it is
+ * reinitialized to resolve the new host.
+ ******************************************************************************/
+void InstrumentUDPConnection::setDataHost(const string & host) {
+    string oldhost = m_oDataSocket.hostname();
+    m_oDataSocket.setHostname(host);
+
+    if(m_oDataSocket.connected() && host != oldhost)
+        m_oDataSocket.initialize();
+}
+
+/******************************************************************************
+ * Method: setDataTxPort
+ * Description: Set the instrument port driver data is sent to.
+ ******************************************************************************/
+void InstrumentUDPConnection::setDataTxPort(uint16_t port) {
+    uint16_t oldPort = m_oDataSocket.remotePort();
+    m_oDataSocket.setRemotePort(port);
+
+    if(m_oDataSocket.connected() && port != oldPort)
+        m_oDataSocket.initialize();
+}
+
+/******************************************************************************
+ * Method: setDataRxPort
+ * Description: Set the local port the instrument sends to.
+ ******************************************************************************/
+void InstrumentUDPConnection::setDataRxPort(uint16_t port) {
+    uint16_t oldPort = m_oDataSocket.port();
+    m_oDataSocket.setPort(port);
+
+    if(m_oDataSocket.connected() && port != oldPort)
+        m_oDataSocket.initialize();
+}
+
+/******************************************************************************
+ * Method: dataConfigured
+ * Description: We need the instrument address and both ports.
+ ******************************************************************************/
+bool InstrumentUDPConnection::dataConfigured() {
+    return m_oDataSocket.isConfigured() && m_oDataSocket.hostname().length() &&
+           m_oDataSocket.remotePort();
+}
+
+/******************************************************************************
+ * Method: initializeDataSocket
+ * Description: Bind the RX port.
+ ******************************************************************************/
+void InstrumentUDPConnection::initializeDataSocket() {
+    m_oDataSocket.initialize();
+}
@@ -0,0 +1,107 @@
+/*******************************************************************************
+ * Class: InstrumentUDPConnection
+ * Filename: instrument_udp_connection.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Manages the connection to an instrument that sends its data as UDP
+ * datagrams.  The port agent binds the RX port and the instrument sends to
+ * it; driver data is sent to the instrument's address and TX port.  There is
+ * no command port for this connection type.
+ *
+ * Datagrams are read in batches into a pool owned by the connection, see
+ * UDPCommListener::readBatch.
+ *
+ * Usage:
+ *
+ * InstrumentUDPConnection connection;
+ *
+ * connection.setDataHost("instrument");
+ * connection.setDataTxPort(5000);
+ * connection.setDataRxPort(5001);
+ *
+ * connection.initialize();
+ *
+ * IOResult result = connection.readDatagrams();
+ * DatagramPool &pool = connection.datagrams();
+ *
+ ******************************************************************************/
+
+#ifndef __INSTRUMENT_UDP_CONNECTION_H_
+#define __INSTRUMENT_UDP_CONNECTION_H_
+
+#include "port_agent/connection/connection.h"
+#include "network/udp_comm_listener.h"
+
+using namespace std;
+using namespace network;
+
+namespace port_agent {
+    class InstrumentUDPConnection : public Connection {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            ///////////////////////
+            // Public Methods
+            InstrumentUDPConnection();
+            InstrumentUDPConnection(const InstrumentUDPConnection &rhs);
+            virtual ~InstrumentUDPConnection();
+
+            void copy(const InstrumentUDPConnection &copy);
+
+            /* Operators */
+            InstrumentUDPConnection & operator=(const InstrumentUDPConnection &rhs);
+
+            /* Accessors */
+
+            CommBase *dataConnectionObject() { return &m_oDataSocket; }
+            CommBase *commandConnectionObject() { return NULL; }
+
+            PortAgentConnectionType connectionType() { return PACONN_INSTRUMENT_UDP; }
+
+            // Custom configurations for the instrument connection
+            void setDataHost(const string &host);
+            void setDataTxPort(uint16_t port);
+            void setDataRxPort(uint16_t port);
+
+            string dataHost() { return m_oDataSocket.hostname(); }
+            uint16_t dataTxPort() { return m_oDataSocket.remotePort(); }
+            uint16_t dataRxPort() { return m_oDataSocket.port(); }
+            bool connected() { return m_oDataSocket.connected(); }
+            bool disconnect() { return m_oDataSocket.disconnect(); }
+
+            // Datagrams from the last readDatagrams call
+            DatagramPool & datagrams() { return m_oPool; }
+
+            /* Query Methods */
+
+            bool dataConfigured();
+            bool commandConfigured() { return false; }
+
+            bool dataInitialized() { return m_oDataSocket.connected(); }
+            bool commandInitialized() { return false; }
+
+            bool dataConnected() { return m_oDataSocket.connected(); }
+            bool commandConnected() { return false; }
+
+            /* Commands */
+
+            void initializeDataSocket();
+            void initializeCommandSocket() {}
+
+            // Read every datagram waiting into the pool
+            IOResult readDatagrams() { return m_oDataSocket.readBatch(m_oPool); }
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            UDPCommListener m_oDataSocket;
+            DatagramPool m_oPool;
+    };
+}
+
+#endif //__INSTRUMENT_UDP_CONNECTION_H_
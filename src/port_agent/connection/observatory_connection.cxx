@@ -58,6 +58,8 @@ using namespace port_agent;
  *              define it explicitly.
  ******************************************************************************/
 ObservatoryConnection::ObservatoryConnection() : Connection() {
+    m_pDataSocket = new TCPCommListener();
+    m_pCommandSocket = new TCPCommListener();
 }
 
 /******************************************************************************
@@ -68,6 +70,8 @@ ObservatoryConnection::ObservatoryConnection() : Connection() {
  *   copy - rhs object to copy
  ******************************************************************************/
 ObservatoryConnection::ObservatoryConnection(const ObservatoryConnection& rhs) {
+    m_pDataSocket = NULL;
+    m_pCommandSocket = NULL;
     copy(rhs);
 }
 
@@ -76,6 +80,11 @@ ObservatoryConnection::ObservatoryConnection(const ObservatoryConnection& rhs) {
  * Description: free up our dynamically created packet data.
  ******************************************************************************/
 ObservatoryConnection::~ObservatoryConnection() {
+    if(m_pDataSocket)
+        delete m_pDataSocket;
+    
+    if(m_pCommandSocket)
+        delete m_pCommandSocket;
 }
 
 /******************************************************************************
@@ -100,8 +109,17 @@ ObservatoryConnection & ObservatoryConnection::operator=(const ObservatoryConnec
  *   copy - rhs object to copy
  ******************************************************************************/
 void ObservatoryConnection::copy(const ObservatoryConnection &copy) {
-    m_oDataSocket = copy.m_oDataSocket;
-    m_oCommandSocket = copy.m_oCommandSocket;
+    if(this == &copy)
+        return;
+    
+    if(m_pDataSocket)
+        delete m_pDataSocket;
+    
+    if(m_pCommandSocket)
+        delete m_pCommandSocket;
+    
+    m_pDataSocket = cloneListener(copy.m_pDataSocket);
+    m_pCommandSocket = cloneListener(copy.m_pCommandSocket);
 }
 
 /******************************************************************************
@@ -112,10 +130,10 @@ void ObservatoryConnection::copy(const ObservatoryConnection &copy) {
  * bound to a new port.
  ******************************************************************************/
 void ObservatoryConnection::setDataPort(uint16_t port) {
-    m_oDataSocket.setPort(port);
+    m_pDataSocket->setPort(port);
     
-    if(m_oDataSocket.listening() && m_oDataSocket.port() != m_oDataSocket.getListenPort()) {
-	m_oDataSocket.initialize();
+    if(m_pDataSocket->listening() && m_pDataSocket->port() != m_pDataSocket->getListenPort()) {
+	m_pDataSocket->initialize();
     }
 }
 
@@ -124,7 +142,31 @@ void ObservatoryConnection::setDataPort(uint16_t port) {
  * Description: Set the command socket listener port
  ******************************************************************************/
 void ObservatoryConnection::setCommandPort(uint16_t port) {
-    m_oCommandSocket.setPort(port);
+    m_pCommandSocket->setPort(port);
+}
+
+/******************************************************************************
+ * Method: setDataSocketPath
+ * Description: Listen for data clients on a unix domain socket instead of
+ * TCP.  The data port is kept.
+ *
+ * Parameters:
+ *   path - socket path or abstract name starting with '@', empty for TCP
+ *   seqpacket - preserve message boundaries
+ * Return:
+ *   true if the listener was replaced and needs to be initialized
+ ******************************************************************************/
+bool ObservatoryConnection::setDataSocketPath(const string &path, bool seqpacket) {
+    return setListenerTransport(m_pDataSocket, path, seqpacket);
+}
+
+/******************************************************************************
+ * Method: setCommandSocketPath
+ * Description: Listen for command clients on a unix domain socket instead
+ * of TCP.  See setDataSocketPath.
+ ******************************************************************************/
+bool ObservatoryConnection::setCommandSocketPath(const string &path, bool seqpacket) {
+    return setListenerTransport(m_pCommandSocket, path, seqpacket);
 }
 
 /******************************************************************************
@@ -136,7 +178,7 @@ void ObservatoryConnection::setCommandPort(uint16_t port) {
  *   True if we have enough configuration information
  ******************************************************************************/
 bool ObservatoryConnection::dataConfigured() {
-    return m_oDataSocket.isConfigured();
+    return m_pDataSocket->isConfigured();
 }
 
 /******************************************************************************
@@ -148,7 +190,7 @@ bool ObservatoryConnection::dataConfigured() {
  *   True if we have enough configuration information
  ******************************************************************************/
 bool ObservatoryConnection::commandConfigured() {
-    return m_oCommandSocket.port() && m_oCommandSocket.isConfigured();
+    return m_pCommandSocket->port() && m_pCommandSocket->isConfigured();
 }
 
 /******************************************************************************
@@ -159,7 +201,7 @@ bool ObservatoryConnection::commandConfigured() {
  *   True if the socket has been configured and is bound to a port listening
  ******************************************************************************/
 bool ObservatoryConnection::dataInitialized() {
-    return m_oDataSocket.listening();
+    return m_pDataSocket->listening();
 }
 
 /******************************************************************************
@@ -170,7 +212,7 @@ bool ObservatoryConnection::dataInitialized() {
  *   True if the socket has been configured and is bound to a port listening
  ******************************************************************************/
 bool ObservatoryConnection::commandInitialized() {
-    return m_oCommandSocket.listening();
+    return m_pCommandSocket->listening();
 }
 
 /******************************************************************************
@@ -181,7 +223,7 @@ bool ObservatoryConnection::commandInitialized() {
  *   True if the data socket is connected
  ******************************************************************************/
 bool ObservatoryConnection::dataConnected() {
-    return m_oDataSocket.connected();
+    return m_pDataSocket->connected();
 }
 
 /******************************************************************************
@@ -192,7 +234,7 @@ bool ObservatoryConnection::dataConnected() {
  *   True if the command socket is connected
  ******************************************************************************/
 bool ObservatoryConnection::commandConnected() {
-    return m_oCommandSocket.connected();
+    return m_pCommandSocket->connected();
 }
 
 /******************************************************************************
@@ -200,7 +242,7 @@ bool ObservatoryConnection::commandConnected() {
  * Description: Initialize the data socket
  ******************************************************************************/
 void ObservatoryConnection::initializeDataSocket() {
-    m_oDataSocket.initialize();
+    m_pDataSocket->initialize();
 }
 
 /******************************************************************************
@@ -208,7 +250,7 @@ void ObservatoryConnection::initializeDataSocket() {
  * Description: Initialize the command socket
  ******************************************************************************/
 void ObservatoryConnection::initializeCommandSocket() {
-    m_oCommandSocket.initialize();
+    m_pCommandSocket->initialize();
 }
 
 
@@ -74,8 +74,8 @@ namespace port_agent {
 
             /* Accessors */
             
-            CommBase *dataConnectionObject() { return &m_oDataSocket; }
-            CommBase *commandConnectionObject() { return &m_oCommandSocket; }
+            CommBase *dataConnectionObject() { return m_pDataSocket; }
+            CommBase *commandConnectionObject() { return m_pCommandSocket; }
             
             PortAgentConnectionType connectionType() { return PACONN_OBSERVATORY_STANDARD; }
             
@@ -83,6 +83,10 @@ namespace port_agent {
             void setDataPort(uint16_t port);
             void setCommandPort(uint16_t port);
             
+            // Use a unix domain socket instead of TCP, see UnixCommListener
+            bool setDataSocketPath(const string &path, bool seqpacket);
+            bool setCommandSocketPath(const string &path, bool seqpacket);
+            
             /* Query Methods */
             
             // Do we have complete configuration information for each
@@ -115,8 +119,8 @@ namespace port_agent {
         protected:
             
         private:
-            TCPCommListener m_oDataSocket;
-            TCPCommListener m_oCommandSocket;
+            TCPCommListener *m_pDataSocket;
+            TCPCommListener *m_pCommandSocket;
             
     };
 }
@@ -58,6 +58,7 @@ using namespace port_agent;
  *              define it explicitly.
  ******************************************************************************/
 ObservatoryMultiConnection::ObservatoryMultiConnection() : Connection() {
+    m_pCommandSocket = new TCPCommListener();
 }
 
 /******************************************************************************
@@ -68,6 +69,7 @@ ObservatoryMultiConnection::ObservatoryMultiConnection() : Connection() {
  *   copy - rhs object to copy
  ******************************************************************************/
 ObservatoryMultiConnection::ObservatoryMultiConnection(const ObservatoryMultiConnection& rhs) {
+    m_pCommandSocket = NULL;
     copy(rhs);
 }
 
@@ -76,6 +78,8 @@ ObservatoryMultiConnection::ObservatoryMultiConnection(const ObservatoryMultiCon
  * Description: free up our dynamically created packet data.
  ******************************************************************************/
 ObservatoryMultiConnection::~ObservatoryMultiConnection() {
+    if(m_pCommandSocket)
+        delete m_pCommandSocket;
 }
 
 /******************************************************************************
@@ -101,44 +105,39 @@ ObservatoryMultiConnection & ObservatoryMultiConnection::operator=(const Observa
  ******************************************************************************/
 void ObservatoryMultiConnection::copy(const ObservatoryMultiConnection &copy) {
     //m_oDataSocket = copy.m_oDataSocket;
-    m_oCommandSocket = copy.m_oCommandSocket;
+    if(this == &copy)
+        return;
+    
+    if(m_pCommandSocket)
+        delete m_pCommandSocket;
+    
+    m_pCommandSocket = cloneListener(copy.m_pCommandSocket);
 }
 
 /******************************************************************************
- * Method: addDataPort
- * Description: Set the data socket listener port.  First we want to see if the
- * port is bound and is listening on a port other than the target port we are
- * setting up.  If it is different, then we need to disconnect so it can be
- * bound to a new port.
+ * Method: setDataPort
+ * Description: Add a data listener for the port.  A multi connection listens
+ * on every port it is given, see addListener.
+ ******************************************************************************/
 void ObservatoryMultiConnection::setDataPort(uint16_t port) {
-
-    // DHE: this needs multiple sockets.
-    m_oDataSocket.setPort(port);
-    
-    if(m_oDataSocket.listening() && m_oDataSocket.port() != m_oDataSocket.getListenPort()) {
-	m_oDataSocket.initialize();
-    }
+    addListener(port);
 }
- ******************************************************************************/
 
 /******************************************************************************
  * Method: addListener
- * Description: Add a listener for the given port.
+ * Description: Add a listener for the given port.  Ports that already have a
+ * listener are ignored so the configured state can be reentered.
  ******************************************************************************/
 void ObservatoryMultiConnection::addListener(uint16_t port) {
+    if(m_oDataSockets.findPort(port)) {
+        LOG(DEBUG2) << "already listening on data port: " << port;
+        return;
+    }
 
-    // DHE: this needs multiple sockets.
     TCPCommListener *listener = new TCPCommListener();
     listener->setPort(port);
     listener->initialize();
-    ObservatoryDataSockets::instance()->addSocket(listener);
-    //m_poDataSockets.setPort(port);
-
-    /***
-    if(m_oDataSocket.listening() && m_oDataSocket.port() != m_oDataSocket.getListenPort()) {
-    m_oDataSocket.initialize();
-    }
-    ***/
+    m_oDataSockets.addSocket(listener);
 }
 
 /******************************************************************************
@@ -146,7 +145,22 @@ void ObservatoryMultiConnection::addListener(uint16_t port) {
  * Description: Set the command socket listener port
  ******************************************************************************/
 void ObservatoryMultiConnection::setCommandPort(uint16_t port) {
-    m_oCommandSocket.setPort(port);
+    m_pCommandSocket->setPort(port);
+}
+
+/******************************************************************************
+ * Method: setCommandSocketPath
+ * Description: Listen for command clients on a unix domain socket instead
+ * of TCP.
+ *
+ * Parameters:
+ *   path - socket path or abstract name starting with '@', empty for TCP
+ *   seqpacket - preserve message boundaries
+ * Return:
+ *   true if the listener was replaced and needs to be initialized
+ ******************************************************************************/
+bool ObservatoryMultiConnection::setCommandSocketPath(const string &path, bool seqpacket) {
+    return setListenerTransport(m_pCommandSocket, path, seqpacket);
 }
 
 /******************************************************************************
@@ -160,19 +174,13 @@ void ObservatoryMultiConnection::setCommandPort(uint16_t port) {
  *   True if we have enough configuration information
  ******************************************************************************/
 bool ObservatoryMultiConnection::dataConfigured() {
-    TCPCommListener* pListener = 0;
-    bool bConfigured = true;
-
-    pListener = ObservatoryDataSockets::instance()->getFirstSocket();
-    while (pListener) {
-        if (!pListener->isConfigured()) {
-            bConfigured = false;
-            break;
-        }
-        pListener = ObservatoryDataSockets::instance()->getNextSocket();
+    for(size_t i = 0; i < m_oDataSockets.size(); i++) {
+        TCPCommListener *pListener = m_oDataSockets.socket(i);
+        if (!pListener->isConfigured())
+            return false;
     }
 
-    return bConfigured;
+    return true;
 }
 
 /******************************************************************************
@@ -184,7 +192,7 @@ bool ObservatoryMultiConnection::dataConfigured() {
  *   True if we have enough configuration information
  ******************************************************************************/
 bool ObservatoryMultiConnection::commandConfigured() {
-    return m_oCommandSocket.port() && m_oCommandSocket.isConfigured();
+    return m_pCommandSocket->port() && m_pCommandSocket->isConfigured();
 }
 
 /******************************************************************************
@@ -197,19 +205,13 @@ bool ObservatoryMultiConnection::commandConfigured() {
  *   True if the socket has been configured and is bound to a port listening
  ******************************************************************************/
 bool ObservatoryMultiConnection::isDataInitialized() {
-    TCPCommListener* pListener = 0;
-    bool bListening = true;
-
-    pListener = ObservatoryDataSockets::instance()->getFirstSocket();
-    while (pListener) {
-        if (!pListener->listening()) {
-            bListening = false;
-            break;
-        }
-        pListener = ObservatoryDataSockets::instance()->getNextSocket();
+    for(size_t i = 0; i < m_oDataSockets.size(); i++) {
+        TCPCommListener *pListener = m_oDataSockets.socket(i);
+        if (!pListener->listening())
+            return false;
     }
 
-    return bListening;
+    return true;
 }
 
 /******************************************************************************
@@ -220,7 +222,7 @@ bool ObservatoryMultiConnection::isDataInitialized() {
  *   True if the socket has been configured and is bound to a port listening
  ******************************************************************************/
 bool ObservatoryMultiConnection::commandInitialized() {
-    return m_oCommandSocket.listening();
+    return m_pCommandSocket->listening();
 }
 
 /******************************************************************************
@@ -233,19 +235,13 @@ bool ObservatoryMultiConnection::commandInitialized() {
  *   True if the data socket is connected
  ******************************************************************************/
 bool ObservatoryMultiConnection::dataConnected() {
-    TCPCommListener* pListener = 0;
-    bool bConnected = true;
-
-    pListener = ObservatoryDataSockets::instance()->getFirstSocket();
-    while (pListener) {
-        if (!pListener->listening()) {
-            bConnected = false;
-            break;
-        }
-        pListener = ObservatoryDataSockets::instance()->getNextSocket();
+    for(size_t i = 0; i < m_oDataSockets.size(); i++) {
+        TCPCommListener *pListener = m_oDataSockets.socket(i);
+        if (!pListener->connected())
+            return false;
     }
 
-    return bConnected;
+    return true;
 }
 
 /******************************************************************************
@@ -256,7 +252,7 @@ bool ObservatoryMultiConnection::dataConnected() {
  *   True if the command socket is connected
  ******************************************************************************/
 bool ObservatoryMultiConnection::commandConnected() {
-    return m_oCommandSocket.connected();
+    return m_pCommandSocket->connected();
 }
 
 /******************************************************************************
@@ -264,13 +260,10 @@ bool ObservatoryMultiConnection::commandConnected() {
  * Description: Initialize the data socket
  ******************************************************************************/
 void ObservatoryMultiConnection::initializeDataSocket() {
-    TCPCommListener* pListener = 0;
+    for(size_t i = 0; i < m_oDataSockets.size(); i++)
+        m_oDataSockets.socket(i)->initialize();
 
-    pListener = ObservatoryDataSockets::instance()->getFirstSocket();
-    while (pListener) {
-        pListener->initialize();
-        pListener = ObservatoryDataSockets::instance()->getNextSocket();
-    }
+    m_oDataSockets.update();
 }
 
 /******************************************************************************
@@ -278,103 +271,251 @@ void ObservatoryMultiConnection::initializeDataSocket() {
  * Description: Initialize the command socket
  ******************************************************************************/
 void ObservatoryMultiConnection::initializeCommandSocket() {
-    m_oCommandSocket.initialize();
+    m_pCommandSocket->initialize();
 }
 
-ObservatoryDataSockets* ObservatoryDataSockets::m_pInstance = 0;
+/******************************************************************************
+ *   OBSERVATORY DATA SOCKETS
+ ******************************************************************************/
 
+/******************************************************************************
+ * Method: Constructor
+ * Description: Empty registry.
+ ******************************************************************************/
 ObservatoryDataSockets::ObservatoryDataSockets() {
-
+    FD_ZERO(&m_oReadFDs);
+    m_iMaxFD = 0;
 }
 
 /******************************************************************************
- * Method: instance()
- * Description: Return a pointer to the singleton instance of the
- * ObservatoryDataSockets container.  If the singleton does not yet exist, create
- * it.
- * Return: return a pointer to the instance.
+ * Method: Destructor
+ * Description: Free the listeners, which closes their sockets.
  ******************************************************************************/
-ObservatoryDataSockets* ObservatoryDataSockets::instance() {
-
-    if (0 == m_pInstance) {
-       m_pInstance = new ObservatoryDataSockets();
-    }
-
-    return m_pInstance;
+ObservatoryDataSockets::~ObservatoryDataSockets() {
+    for(size_t i = 0; i < m_oSockets.size(); i++)
+        delete m_oSockets[i];
 }
 
 /******************************************************************************
- * Method: logPorts()
+ * Method: logSockets()
  * Description: Log the ports
  * Return: void
  ******************************************************************************/
 void ObservatoryDataSockets::logSockets() {
-
-    list<TCPCommListener*>::iterator i = m_observatoryDataSockets.begin();
-    int j = 0;
-    for (i = m_observatoryDataSockets.begin(); i != m_observatoryDataSockets.end(); i++) {
-        LOG(DEBUG) << "Data port: " << j << ", " << (*i)->clientFD();
-        j++;
-    }
+    for(size_t i = 0; i < m_oSockets.size(); i++)
+        LOG(DEBUG) << "Data port: " << i << ", " << m_oSockets[i]->clientFD();
 }
 
 /******************************************************************************
  * Method: addSocket(TCPCommListener* pSocket)
- * Description: Add the given socket to the container of listener objects.
- * Return: return true if success, false if not.
+ * Description: Add the given socket to the registry.  The registry takes
+ * ownership of the listener.
+ * Return: return true if success, false if the socket is already registered.
  ******************************************************************************/
 bool ObservatoryDataSockets::addSocket(TCPCommListener* pSocket) {
-    bool bRetVal = true;
+    if(!pSocket)
+        return false;
 
     LOG(DEBUG) << "ObservatoryDataSockets::addSocket: Adding socket: " << pSocket->serverFD();
 
-    // First remove any existing element with the same port value
-    m_observatoryDataSockets.remove(pSocket);
-    m_observatoryDataSockets.push_back(pSocket);
+    for(size_t i = 0; i < m_oSockets.size(); i++)
+        if(m_oSockets[i] == pSocket)
+            return false;
+
+    m_oSockets.push_back(pSocket);
+    m_oServerFDs.push_back(0);
+    m_oClientFDs.push_back(0);
+    index(m_oSockets.size() - 1);
 
-    return bRetVal;
+    return true;
 }
 
 /******************************************************************************
- * Method: getFirstPort
- * Description: Get the first port from the container of socket objects.
- * Return: value of first port if there is one, otherwise 0
+ * Method: socket
+ * Description: Get a listener by position.
+ * Return: the listener, NULL if the index is out of range
  ******************************************************************************/
-TCPCommListener* ObservatoryDataSockets::getFirstSocket()
-{
+TCPCommListener* ObservatoryDataSockets::socket(size_t index) {
+    return index < m_oSockets.size() ? m_oSockets[index] : NULL;
+}
 
-   // get the first cam agent
-   m_socketIt = m_observatoryDataSockets.begin();
+/******************************************************************************
+ * Method: findPort
+ * Description: Find the listener configured for a port.
+ * Return: the listener, NULL if there isn't one
+ ******************************************************************************/
+TCPCommListener* ObservatoryDataSockets::findPort(uint16_t port) {
+    for(size_t i = 0; i < m_oSockets.size(); i++)
+        if(m_oSockets[i]->port() == port)
+            return m_oSockets[i];
 
-   // if the first is the end, there are no ports in the list
-   if (m_socketIt == m_observatoryDataSockets.end()) {
-      return 0;
-   }
-   else {
-      return *m_socketIt;
-   }
+    return NULL;
 }
 
 /******************************************************************************
- * Method: getNextPort
- * Description: Get the next port from the container of socket objects.
- * Return: value of next port if there is one, otherwise 0
+ * Method: lookup
+ * Description: Find the listener a file descriptor belongs to, either its
+ * listening socket or its client.
+ * Return: the listener, NULL if the fd isn't registered
  ******************************************************************************/
-TCPCommListener* ObservatoryDataSockets::getNextSocket()
-{
+TCPCommListener* ObservatoryDataSockets::lookup(int fd) {
+    if(fd <= 0 || (size_t)fd >= m_oFDs.size() || m_oFDs[fd].socket < 0)
+        return NULL;
 
-   m_socketIt++;
+    return m_oSockets[m_oFDs[fd].socket];
+}
 
-   // if the next is the end, there are no more ports in the list
-   if (m_socketIt == m_observatoryDataSockets.end()) {
-      return 0;
-   }
-   else {
-      return *m_socketIt;
-   }
+/******************************************************************************
+ * Method: update
+ * Description: Reindex any listener whose fds changed since it was last
+ * indexed.  Clients can be dropped from outside the registry, e.g. when a
+ * publisher write finds the peer gone, so this runs before every select.
+ ******************************************************************************/
+void ObservatoryDataSockets::update() {
+    for(size_t i = 0; i < m_oSockets.size(); i++) {
+        if(m_oSockets[i]->serverFD() != m_oServerFDs[i] ||
+           m_oSockets[i]->clientFD() != m_oClientFDs[i])
+            index(i);
+    }
 }
 
+/******************************************************************************
+ * Method: addFDs
+ * Description: Add the registered fds to a select set and update the max
+ * file descriptor.
+ ******************************************************************************/
+void ObservatoryDataSockets::addFDs(int &maxFD, fd_set &readFDs) {
+    update();
+
+    if(!m_iMaxFD)
+        return;
+
+    fd_mask *to = (fd_mask *)&readFDs;
+    const fd_mask *from = (const fd_mask *)&m_oReadFDs;
+
+    for(int i = 0; i <= m_iMaxFD / NFDBITS; i++)
+        to[i] |= from[i];
+
+    maxFD = m_iMaxFD > maxFD ? m_iMaxFD : maxFD;
+}
+
+/******************************************************************************
+ * Method: acceptReady
+ * Description: Call the handler for each listening socket with a connection
+ * waiting.
+ ******************************************************************************/
+void ObservatoryDataSockets::acceptReady(const fd_set &readFDs,
+                                         ObservatoryDataHandler &handler) {
+    dispatch(readFDs, handler, true);
+}
+
+/******************************************************************************
+ * Method: readReady
+ * Description: Call the handler for each client with data waiting.
+ ******************************************************************************/
+void ObservatoryDataSockets::readReady(const fd_set &readFDs,
+                                       ObservatoryDataHandler &handler) {
+    dispatch(readFDs, handler, false);
+}
+
+/******************************************************************************
+ *   PRIVATE METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: dispatch
+ * Description: Walk the words of the ready set that overlap the registered
+ * fds and look up each set bit in the fd index.  Cost is one word per 64
+ * fds plus one lookup per ready fd, however many listeners there are.
+ * Parameters:
+ *   readFDs - the set returned by select
+ *   handler - callbacks for ready sockets
+ *   server - dispatch listening sockets if true, clients if false
+ ******************************************************************************/
+void ObservatoryDataSockets::dispatch(const fd_set &readFDs,
+                                      ObservatoryDataHandler &handler,
+                                      bool server) {
+    const fd_mask *ready = (const fd_mask *)&readFDs;
+    const fd_mask *registered = (const fd_mask *)&m_oReadFDs;
+    int words = m_iMaxFD ? m_iMaxFD / NFDBITS + 1 : 0;
+
+    for(int i = 0; i < words; i++) {
+        fd_mask bits = ready[i] & registered[i];
+
+        while(bits) {
+            int bit = __builtin_ctzl(bits);
+            int fd = i * NFDBITS + bit;
+            bits &= bits - 1;
+
+            ObservatoryDataFD entry = m_oFDs[fd];
+            if(entry.socket < 0 || entry.server != server)
+                continue;
+
+            // A client dropped since the last update may have left a stale
+            // entry, and its fd may since have been reused.
+            TCPCommListener *listener = m_oSockets[entry.socket];
+            if((server ? listener->serverFD() : listener->clientFD()) != fd) {
+                index(entry.socket);
+                continue;
+            }
+
+            if(server)
+                handler.observatoryDataAccept(*listener);
+            else
+                handler.observatoryDataRead(*listener);
+
+            // Accepting opens a client fd, reading can close one.
+            index(entry.socket);
+        }
+    }
+}
+
+/******************************************************************************
+ * Method: index
+ * Description: Replace the index entries of a listener with its current fds.
+ ******************************************************************************/
+void ObservatoryDataSockets::index(size_t socket) {
+    TCPCommListener *listener = m_oSockets[socket];
+
+    setFD(m_oServerFDs[socket], -1, false);
+    setFD(m_oClientFDs[socket], -1, false);
+
+    m_oServerFDs[socket] = listener->serverFD() > 0 ? listener->serverFD() : 0;
+    m_oClientFDs[socket] = listener->clientFD() > 0 ? listener->clientFD() : 0;
 
+    setFD(m_oServerFDs[socket], socket, true);
+    setFD(m_oClientFDs[socket], socket, false);
 
+    // The max only shrinks when the top fd is released
+    while(m_iMaxFD > 0 && !FD_ISSET(m_iMaxFD, &m_oReadFDs))
+        m_iMaxFD--;
+}
+
+/******************************************************************************
+ * Method: setFD
+ * Description: Set the index entry and select bit for a file descriptor.
+ * Parameters:
+ *   fd - file descriptor, ignored if 0
+ *   socket - listener index, -1 to remove the fd
+ *   server - true if fd is the listening socket
+ ******************************************************************************/
+void ObservatoryDataSockets::setFD(int fd, int socket, bool server) {
+    if(fd <= 0 || fd >= FD_SETSIZE)
+        return;
 
+    if((size_t)fd >= m_oFDs.size()) {
+        ObservatoryDataFD empty = { -1, false };
+        m_oFDs.resize(fd + 1, empty);
+    }
+
+    m_oFDs[fd].socket = socket;
+    m_oFDs[fd].server = server;
 
+    if(socket < 0) {
+        FD_CLR(fd, &m_oReadFDs);
+    }
+    else {
+        FD_SET(fd, &m_oReadFDs);
+        m_iMaxFD = fd > m_iMaxFD ? fd : m_iMaxFD;
+    }
+}
@@ -43,12 +43,21 @@
  * // Get a pointer tcp command listener object
  * TCPCommListener *command = connection.commandConnectionObject();
  *    
+ * // Data listeners are indexed by fd.  Ready sockets are passed to an
+ * // ObservatoryDataHandler.
+ * ObservatoryDataSockets &sockets = connection.dataSockets();
+ * sockets.addFDs(maxFD, readFDs);
+ * select(maxFD + 1, &readFDs, NULL, NULL, &tv);
+ * sockets.acceptReady(readFDs, handler);
+ * sockets.readReady(readFDs, handler);
+ *    
  ******************************************************************************/
 
 #ifndef __OBSERVATORY_MULTI_CONNECTION_H_
 #define __OBSERVATORY_MULTI_CONNECTION_H_
 
-#include <list>
+#include <vector>
+#include <sys/select.h>
 #include "port_agent/connection/connection.h"
 #include "network/tcp_comm_listener.h"
 
@@ -56,32 +65,73 @@ using namespace std;
 using namespace network;
 
 namespace port_agent {
-    // Forward reference in order to define the typedefs that follow this.
-    class ObservatoryDataSockets;
+    // Callbacks for ready observatory data sockets
+    class ObservatoryDataHandler {
+        public:
+            virtual ~ObservatoryDataHandler() {}
+
+            // A data listener has a connection waiting to be accepted
+            virtual void observatoryDataAccept(TCPCommListener &listener) = 0;
+
+            // A data client has data waiting to be read
+            virtual void observatoryDataRead(TCPCommListener &listener) = 0;
+    };
 
-    // DHE NEW: a list of pointers to TCPCommListener objects; The fact that
-    // it's a list be abstracted, so that we can change it to a map for faster
-    // lookup in the future.
-    //typedef TCPCommListener* ObservatoryDataSocket_T;
-    //typedef list<ObservatoryDataSocket_T> ObservatoryDataSockets_T;
-    typedef list<TCPCommListener*> ObservatoryDataSockets_T;
+    // What a file descriptor in the registry belongs to
+    typedef struct ObservatoryDataFD {
+        // index of the listener, -1 if the fd isn't registered
+        int socket;
+        // true for the listening socket, false for the client
+        bool server;
+    } ObservatoryDataFD;
 
-    // A singleton class that contains sockets
+    // The data listeners of one multi connection, indexed by file descriptor
+    // so the sockets select marked ready are found without walking every
+    // listener.  The registry owns the listeners.
     class ObservatoryDataSockets {
         public:
-            static  ObservatoryDataSockets* instance();
+            ObservatoryDataSockets();
+            ~ObservatoryDataSockets();
+
             void    logSockets();
             bool    addSocket(TCPCommListener*);
-            TCPCommListener* getFirstSocket();
-            TCPCommListener* getNextSocket();
+
+            size_t size() { return m_oSockets.size(); }
+            TCPCommListener* socket(size_t index);
+            TCPCommListener* findPort(uint16_t port);
+            TCPCommListener* lookup(int fd);
+
+            // Pick up fds opened or closed since the last call
+            void update();
+
+            // Add the registered fds to a select set
+            void addFDs(int &maxFD, fd_set &readFDs);
+
+            // Call the handler for each registered fd that is ready
+            void acceptReady(const fd_set &readFDs, ObservatoryDataHandler &handler);
+            void readReady(const fd_set &readFDs, ObservatoryDataHandler &handler);
 
         private:
-            // CTOR
-            ObservatoryDataSockets();
+            // Not copyable, the registry owns the listeners
+            ObservatoryDataSockets(const ObservatoryDataSockets &rhs);
+            ObservatoryDataSockets & operator=(const ObservatoryDataSockets &rhs);
+
+            void dispatch(const fd_set &readFDs, ObservatoryDataHandler &handler, bool server);
+            void index(size_t socket);
+            void setFD(int fd, int socket, bool server);
+
+            vector<TCPCommListener*> m_oSockets;
 
-            static ObservatoryDataSockets* m_pInstance;
-            ObservatoryDataSockets_T        m_observatoryDataSockets;
-            ObservatoryDataSockets_T::iterator m_socketIt;
+            // Server and client fd of each listener as of the last index()
+            vector<int> m_oServerFDs;
+            vector<int> m_oClientFDs;
+
+            // Registry entry for each fd number
+            vector<ObservatoryDataFD> m_oFDs;
+
+            // The registered fds as a select set
+            fd_set m_oReadFDs;
+            int m_iMaxFD;
     };
 
     class ObservatoryMultiConnection : public Connection {
@@ -106,13 +156,18 @@ namespace port_agent {
             // DHE: this needs to iterate.
             //CommBase *dataConnectionObject() { return &m_oDataSocket; }
             CommBase *dataConnectionObject() { return (CommBase*) NULL; }
-            CommBase *commandConnectionObject() { return &m_oCommandSocket; }
+            CommBase *commandConnectionObject() { return m_pCommandSocket; }
+            
+            ObservatoryDataSockets & dataSockets() { return m_oDataSockets; }
             
             PortAgentConnectionType connectionType() { return PACONN_OBSERVATORY_MULTI; }
             
             // Custom configurations for the observatory connection
             void setDataPort(uint16_t port);
             void setCommandPort(uint16_t port);
+            
+            // Use a unix domain socket instead of TCP, see UnixCommListener
+            bool setCommandSocketPath(const string &path, bool seqpacket);
 
             void addListener(uint16_t port);
             
@@ -149,11 +204,8 @@ namespace port_agent {
         protected:
             
         private:
-            // DHE: should have a multiSocketObject here that abstracts the
-            // type of data structure holding the sockets.
-            //TCPCommListener m_oDataSocket;
-            ObservatoryDataSockets* m_poDataSockets;
-            TCPCommListener m_oCommandSocket;
+            ObservatoryDataSockets m_oDataSockets;
+            TCPCommListener *m_pCommandSocket;
             
     };
 }
@@ -0,0 +1,106 @@
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/util.h"
+#include "port_agent/connection/instrument_udp_connection.h"
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <string>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace std;
+using namespace logger;
+using namespace port_agent;
+
+#define TEST_DATA_TX_PORT "7011"
+#define TEST_DATA_RX_PORT "7012"
+#define TEST_DATA_HOST "127.0.0.1"
+
+class InstrumentUDPConnectionTest : public testing::Test {
+
+    protected:
+        virtual void SetUp() {
+            Logger::SetLogFile("/tmp/gtest.log");
+            Logger::SetLogLevel("MESG");
+
+            LOG(INFO) << "************************************************";
+            LOG(INFO) << "    Instrument UDP Connection Test Start Up";
+            LOG(INFO) << "************************************************";
+        }
+};
+
+/* Test Normal Instrument UDP Connection */
+TEST_F(InstrumentUDPConnectionTest, NormalConnection) {
+    try {
+        InstrumentUDPConnection connection;
+        Connection *pConnection = &connection;
+
+        EXPECT_FALSE(connection.dataConfigured());
+        EXPECT_FALSE(connection.commandConfigured());
+
+        connection.setDataTxPort(atoi(TEST_DATA_TX_PORT));
+        EXPECT_FALSE(connection.dataConfigured());
+        connection.setDataRxPort(atoi(TEST_DATA_RX_PORT));
+        EXPECT_FALSE(connection.dataConfigured());
+        connection.setDataHost(TEST_DATA_HOST);
+        EXPECT_TRUE(connection.dataConfigured());
+
+        EXPECT_EQ(pConnection->connectionType(), PACONN_INSTRUMENT_UDP);
+
+        connection.initialize();
+
+        EXPECT_TRUE(connection.dataInitialized());
+        EXPECT_FALSE(connection.commandInitialized());
+
+        EXPECT_TRUE(connection.dataConnected());
+        EXPECT_FALSE(connection.commandConnected());
+
+        ASSERT_TRUE(connection.dataConnectionObject());
+        ASSERT_FALSE(connection.commandConnectionObject());
+    }
+    catch(OOIException &e) {
+		string err = e.what();
+		LOG(ERROR) << "EXCEPTION: " << err;
+		ASSERT_FALSE(true);
+	}
+}
+
+/* Datagrams sent to the RX port are read in one batch */
+TEST_F(InstrumentUDPConnectionTest, ReadDatagrams) {
+    struct sockaddr_in addr;
+    int sender = socket(AF_INET, SOCK_DGRAM, 0);
+
+    InstrumentUDPConnection connection;
+    connection.setDataTxPort(atoi(TEST_DATA_TX_PORT));
+    connection.setDataRxPort(atoi(TEST_DATA_RX_PORT));
+    connection.setDataHost(TEST_DATA_HOST);
+    connection.initialize();
+    ASSERT_TRUE(connection.connected());
+
+    EXPECT_EQ(connection.readDatagrams().status, IO_WOULD_BLOCK);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(atoi(TEST_DATA_RX_PORT));
+
+    sendto(sender, "one", 3, 0, (struct sockaddr *)&addr, sizeof(addr));
+    sendto(sender, "two", 3, 0, (struct sockaddr *)&addr, sizeof(addr));
+    close(sender);
+
+    IOResult result = connection.readDatagrams();
+    EXPECT_EQ(result.status, IO_OK);
+    EXPECT_EQ(result.bytes, 2);
+
+    DatagramPool &pool = connection.datagrams();
+    ASSERT_EQ(pool.count(), 2);
+    EXPECT_EQ(string(pool.data(0), pool.length(0)), "one");
+    EXPECT_EQ(string(pool.data(1), pool.length(1)), "two");
+
+    EXPECT_TRUE(connection.disconnect());
+    EXPECT_FALSE(connection.dataConnected());
+}
@@ -6,7 +6,13 @@
 
 #include <sstream>
 #include <string>
+#include <vector>
 #include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
 
 using namespace std;
 using namespace logger;
@@ -15,6 +21,8 @@ using namespace port_agent;
 #define TEST_DATA_PORT_01 6001
 #define TEST_DATA_PORT_02 6002
 #define TEST_COMMAND_PORT 6000
+#define TEST_REGISTRY_PORT_01 6011
+#define TEST_REGISTRY_PORT_02 6012
 
 class ObservatoryMultiConnectionTest : public testing::Test {
     
@@ -66,3 +74,110 @@ TEST_F(ObservatoryMultiConnectionTest, DISABLED_NormalConnection) {
 	}
 }
 
+
+/* Records the callbacks made by the data socket registry */
+class RecordingDataHandler : public ObservatoryDataHandler {
+    public:
+        void observatoryDataAccept(TCPCommListener &listener) {
+            accepted.push_back(&listener);
+            listener.acceptClient();
+        }
+
+        void observatoryDataRead(TCPCommListener &listener) {
+            char buffer[64];
+            read.push_back(&listener);
+            listener.receive(buffer, sizeof(buffer));
+        }
+
+        vector<TCPCommListener*> accepted;
+        vector<TCPCommListener*> read;
+};
+
+/* Connect a blocking client to a local port */
+static int connectLocal(uint16_t port) {
+    struct sockaddr_in addr;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if(fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        if(fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/* Select on the registry fds */
+static fd_set selectRegistry(ObservatoryDataSockets &sockets) {
+    fd_set readFDs;
+    struct timeval tv = { 2, 0 };
+    int maxFD = 0;
+
+    FD_ZERO(&readFDs);
+    sockets.addFDs(maxFD, readFDs);
+    select(maxFD + 1, &readFDs, NULL, NULL, &tv);
+
+    return readFDs;
+}
+
+/* Test the fd indexed data socket registry */
+TEST_F(ObservatoryMultiConnectionTest, DataSocketRegistry) {
+    ObservatoryMultiConnection connection;
+    ObservatoryDataSockets &sockets = connection.dataSockets();
+    RecordingDataHandler handler;
+    fd_set readFDs;
+
+    connection.addListener(TEST_REGISTRY_PORT_01);
+    connection.addListener(TEST_REGISTRY_PORT_02);
+    connection.addListener(TEST_REGISTRY_PORT_02);
+    ASSERT_EQ(sockets.size(), 2);
+    EXPECT_TRUE(connection.isDataInitialized());
+    EXPECT_FALSE(connection.dataConnected());
+
+    TCPCommListener *first = sockets.findPort(TEST_REGISTRY_PORT_01);
+    TCPCommListener *second = sockets.findPort(TEST_REGISTRY_PORT_02);
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(sockets.lookup(first->serverFD()), first);
+    EXPECT_EQ(sockets.lookup(second->serverFD()), second);
+    EXPECT_FALSE(sockets.lookup(0));
+    EXPECT_FALSE(sockets.lookup(100000));
+
+    // Only the listener with a pending connection is accepted
+    int client = connectLocal(TEST_REGISTRY_PORT_02);
+    ASSERT_GT(client, 0);
+
+    readFDs = selectRegistry(sockets);
+    sockets.readReady(readFDs, handler);
+    EXPECT_EQ(handler.read.size(), 0);
+    sockets.acceptReady(readFDs, handler);
+    ASSERT_EQ(handler.accepted.size(), 1);
+    EXPECT_EQ(handler.accepted[0], second);
+    ASSERT_GT(second->clientFD(), 0);
+    EXPECT_EQ(sockets.lookup(second->clientFD()), second);
+
+    // Data on the client is dispatched as a read
+    ASSERT_EQ(write(client, "data", 4), 4);
+    readFDs = selectRegistry(sockets);
+    sockets.acceptReady(readFDs, handler);
+    EXPECT_EQ(handler.accepted.size(), 1);
+    sockets.readReady(readFDs, handler);
+    ASSERT_EQ(handler.read.size(), 1);
+    EXPECT_EQ(handler.read[0], second);
+
+    // A client dropped outside the registry is removed before the next select
+    int clientFD = second->clientFD();
+    int maxFD = 0;
+    second->disconnectClient();
+    FD_ZERO(&readFDs);
+    sockets.addFDs(maxFD, readFDs);
+    EXPECT_FALSE(FD_ISSET(clientFD, &readFDs));
+    EXPECT_FALSE(sockets.lookup(clientFD));
+
+    close(client);
+}
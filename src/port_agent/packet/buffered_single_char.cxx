@@ -176,7 +176,12 @@ BufferedSingleCharPacket & BufferedSingleCharPacket::operator=(const BufferedSin
  * 
  ******************************************************************************/
 void BufferedSingleCharPacket::add( char input ) {
-	add(input, Timestamp());
+    // Only read the clock when the time is used.  The first byte sets the
+    // packet time and the quiescent trigger needs the time of every byte.
+    if(packetSize() == HEADER_SIZE || m_fQuiescentTime)
+        add(input, Timestamp());
+    else
+        add(input, m_oTimestamp);
 }
 
 /******************************************************************************
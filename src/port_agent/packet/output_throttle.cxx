@@ -0,0 +1,244 @@
+/*******************************************************************************
+ * Class: OutputThrottle
+ * Filename: output_throttle.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Raw data is stored in the circular buffer of the base class.  Along side
+ * the data we keep a list of read segments, one per writeData call, so that
+ * packets can be stamped with the time their first byte was read.
+ *
+ * The rate limit is a token bucket holding at most a single token, refilled
+ * at maxPacketRate tokens per second.  A max packet rate of 0 disables rate
+ * limiting and only coalescing is done.
+ *
+ ******************************************************************************/
+
+#include "output_throttle.h"
+#include "common/logger.h"
+#include "common/exception.h"
+
+#include <string>
+#include <stdint.h>
+
+using namespace logger;
+using namespace packet;
+using namespace std;
+
+/******************************************************************************
+ * Method: Constructor
+ * Description: Only constructor for this class
+ * Parameters:
+ *   bufferCapacity - Maximum number of raw bytes that can be buffered
+ *   maxPayloadSize - Maximum payload size of a generated packet
+ *   maxPacketRate - Maximum packets per second, 0 for no limit
+ *   maxLatency - Maximum time in seconds a byte can wait for more data before
+ *                the packet is ready to send.
+ * Throws:
+ *   PacketParamOutOfRange - payload size is 0 or larger than the capacity,
+ *                           or the latency is negative.
+ *
+ ******************************************************************************/
+OutputThrottle::OutputThrottle(size_t bufferCapacity, uint16_t maxPayloadSize,
+                               uint32_t maxPacketRate, float maxLatency) :
+    CircularBuffer(bufferCapacity),
+    m_iMaxPayloadSize(maxPayloadSize),
+    m_iMaxPacketRate(maxPacketRate),
+    m_fMaxLatency(maxLatency),
+    m_dTokens(1),
+    m_dLastRefill(0),
+    m_pPayload(NULL) {
+
+    if (maxPayloadSize == 0 || maxPayloadSize > bufferCapacity)
+        throw PacketParamOutOfRange("invalid throttle payload size");
+
+    if (maxLatency < 0)
+        throw PacketParamOutOfRange("throttle latency must be >= 0");
+
+    m_pPayload = new char[maxPayloadSize];
+}
+
+/******************************************************************************
+ * Method: Destructor
+ * Description: Free the payload scratch buffer
+ *
+ ******************************************************************************/
+OutputThrottle::~OutputThrottle() {
+    if (m_pPayload)
+        delete [] m_pPayload;
+
+    m_pPayload = NULL;
+}
+
+/******************************************************************************
+ * Method: writeData
+ * Description: Write raw data to the buffer and remember when it was read.
+ * Parameters:
+ *   data - Raw data to buffer
+ *   bytes - Size of raw data
+ *   timestamp - Time the data was read
+ * Throws:
+ *   RawPacketDataBufferOverflow - not enough room in the buffer
+ *
+ ******************************************************************************/
+void OutputThrottle::writeData(const char *data, size_t bytes, const Timestamp &timestamp) {
+    if (bytes == 0)
+        return;
+
+    if (bytes > available())
+        throw RawPacketDataBufferOverflow("output throttle full");
+
+    write(data, bytes);
+
+    ReadSegment segment;
+    segment.size = bytes;
+    segment.timestamp = timestamp;
+    m_oSegments.push_back(segment);
+
+    LOG(DEBUG2) << "output throttle buffered " << bytes << " bytes, "
+                << size() << " pending";
+}
+
+/******************************************************************************
+ * Method: getNextPacket
+ * Description: Return the next packet if it is complete and the rate limit
+ *   allows it to be sent.  A packet is complete when a full payload is
+ *   buffered or the first byte in the buffer is older than the max latency.
+ * Parameters:
+ *   now - current time
+ * Return:
+ *   NULL if no packet is ready, otherwise a dynamically allocated packet
+ *   that must be deleted by the caller.
+ *
+ ******************************************************************************/
+Packet* OutputThrottle::getNextPacket(const Timestamp &now) {
+    if (size() == 0)
+        return NULL;
+
+    Timestamp current(now);
+    double dNow = current.asDouble();
+
+    if (size() < m_iMaxPayloadSize) {
+        Timestamp first(m_oSegments.front().timestamp);
+        if (dNow - first.asDouble() < m_fMaxLatency)
+            return NULL;
+    }
+
+    if (m_iMaxPacketRate) {
+        refill(dNow);
+        if (m_dTokens < 1)
+            return NULL;
+        m_dTokens -= 1;
+    }
+
+    return buildPacket();
+}
+
+/******************************************************************************
+ * Method: flush
+ * Description: Return the next packet regardless of the latency and rate
+ *   limits.  Used to drain the buffer on shutdown or when it is full.
+ * Return:
+ *   NULL if the buffer is empty, otherwise a dynamically allocated packet
+ *   that must be deleted by the caller.
+ *
+ ******************************************************************************/
+Packet* OutputThrottle::flush() {
+    if (size() == 0)
+        return NULL;
+
+    return buildPacket();
+}
+
+/******************************************************************************
+ * Method: timeUntilReady
+ * Description: Compute how long until getNextPacket could return a packet.
+ *   Used to set the select timeout in the main loop.
+ * Parameters:
+ *   now - current time
+ * Return:
+ *   seconds until the next packet is ready, 0 if ready now, < 0 if the buffer
+ *   is empty.
+ *
+ ******************************************************************************/
+double OutputThrottle::timeUntilReady(const Timestamp &now) {
+    if (size() == 0)
+        return -1;
+
+    Timestamp current(now);
+    double dNow = current.asDouble();
+    double wait = 0;
+
+    if (size() < m_iMaxPayloadSize) {
+        Timestamp first(m_oSegments.front().timestamp);
+        wait = m_fMaxLatency - (dNow - first.asDouble());
+    }
+
+    if (m_iMaxPacketRate) {
+        refill(dNow);
+        double tokenWait = (1 - m_dTokens) / m_iMaxPacketRate;
+        if (tokenWait > wait)
+            wait = tokenWait;
+    }
+
+    return wait > 0 ? wait : 0;
+}
+
+/******************************************************************************
+ *   PRIVATE METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: refill
+ * Description: Add tokens for the time elapsed since the last refill.  The
+ *   bucket holds a single token so packets are evenly spaced.
+ * Parameters:
+ *   now - current time in seconds
+ *
+ ******************************************************************************/
+void OutputThrottle::refill(double now) {
+    if (m_dLastRefill && now > m_dLastRefill)
+        m_dTokens += (now - m_dLastRefill) * m_iMaxPacketRate;
+
+    if (m_dTokens > 1)
+        m_dTokens = 1;
+
+    if (now > m_dLastRefill)
+        m_dLastRefill = now;
+}
+
+/******************************************************************************
+ * Method: buildPacket
+ * Description: Remove up to a full payload from the buffer and build a packet
+ *   stamped with the read time of its first byte.
+ * Return:
+ *   Dynamically allocated packet
+ * Throws:
+ *   RawPacketDataReadError - unexpected error occurred reading from buffer
+ *
+ ******************************************************************************/
+Packet* OutputThrottle::buildPacket() {
+    Timestamp timestamp(m_oSegments.front().timestamp);
+    size_t bytes = size() < m_iMaxPayloadSize ? size() : m_iMaxPayloadSize;
+
+    if (read(m_pPayload, bytes) != bytes)
+        throw RawPacketDataReadError("output throttle read");
+
+    // Consume the segments covered by this packet
+    size_t remaining = bytes;
+    while (remaining && ! m_oSegments.empty()) {
+        ReadSegment &segment = m_oSegments.front();
+        if (segment.size > remaining) {
+            segment.size -= remaining;
+            remaining = 0;
+        }
+        else {
+            remaining -= segment.size;
+            m_oSegments.pop_front();
+        }
+    }
+
+    LOG(DEBUG2) << "output throttle built packet, payload size: " << bytes;
+
+    return new Packet(DATA_FROM_INSTRUMENT, timestamp, m_pPayload, bytes);
+}
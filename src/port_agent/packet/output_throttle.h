@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * Class: OutputThrottle
+ * Filename: output_throttle.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * A coalescing, rate limited buffer that sits between instrument reads and
+ * the publishers.  Raw instrument data is written into the buffer as it is
+ * read and port agent packets are composed from the buffered bytes.
+ *
+ * A packet is ready when either a full payload (maxPayloadSize) has been
+ * buffered or the oldest buffered byte has been waiting longer than the max
+ * latency.  Ready packets are then released through a token bucket so no
+ * more than maxPacketRate packets per second are emitted.  Chatty
+ * instruments that return a single byte per read will then produce one
+ * packet per latency period instead of one packet per byte.
+ *
+ * The packet timestamp is the time the first byte in the packet was read.
+ *
+ * Data is never dropped.  If the buffer cannot hold a new read the caller
+ * should drain it with flush() first.
+ *
+ * Usage:
+ *
+ * OutputThrottle throttle(capacity, maxPayloadSize, maxPacketRate, maxLatency);
+ *
+ * throttle.writeData(rawData, rawDataSize, Timestamp());
+ *
+ * Packet* packet;
+ * while((packet = throttle.getNextPacket(Timestamp())) != NULL) {
+ *     publish(packet);
+ *     delete packet;
+ * }
+ *
+ * Exceptions:
+ *
+ * PacketParamOutOfRange - raised when
+ *     - max payload size is 0 or greater than the buffer capacity
+ *     - a negative max latency.
+ *
+ * RawPacketDataBufferOverflow - from writeData when the buffer is full
+ *
+ ******************************************************************************/
+
+#ifndef __OUTPUT_THROTTLE_H_
+#define __OUTPUT_THROTTLE_H_
+
+#include "common/circular_buffer.h"
+#include "common/timestamp.h"
+#include "packet.h"
+
+#include <list>
+#include <stddef.h>
+#include <stdint.h>
+
+using namespace std;
+
+namespace packet {
+
+class OutputThrottle : public CircularBuffer {
+        /********************
+         *      METHODS     *
+         ********************/
+
+    public:
+        ///////////////////////
+        // Public Methods
+
+        // Only constructor
+        OutputThrottle(size_t bufferCapacity, uint16_t maxPayloadSize,
+                       uint32_t maxPacketRate, float maxLatency);
+
+        // Destructor
+        ~OutputThrottle();
+
+        // Write data to the buffer
+        void writeData(const char *data, size_t bytes, const Timestamp &timestamp);
+
+        // Get the next packet if one is ready and allowed by the rate limit
+        Packet* getNextPacket(const Timestamp &now);
+
+        // Get the next packet ignoring the latency and rate limits
+        Packet* flush();
+
+        // Seconds until getNextPacket could return a packet, < 0 if empty
+        double timeUntilReady(const Timestamp &now);
+
+        uint16_t maxPayloadSize() { return m_iMaxPayloadSize; }
+        uint32_t maxPacketRate() { return m_iMaxPacketRate; }
+        float maxLatency() { return m_fMaxLatency; }
+
+    private:
+
+        // Private to prevent usage
+        OutputThrottle();
+
+        // Add tokens to the bucket for the time elapsed since the last call
+        void refill(double now);
+
+        // Build a packet from the front of the buffer
+        Packet* buildPacket();
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        // Arrival time and size of each buffered read.  Used to stamp each
+        // packet with the read time of its first byte.
+        struct ReadSegment {
+            size_t size;
+            Timestamp timestamp;
+        };
+
+        list<ReadSegment> m_oSegments;
+
+        uint16_t m_iMaxPayloadSize;
+        uint32_t m_iMaxPacketRate;
+        float m_fMaxLatency;
+
+        // Token bucket state
+        double m_dTokens;
+        double m_dLastRefill;
+
+        char *m_pPayload;
+    };
+}
+
+#endif // __OUTPUT_THROTTLE_H_
@@ -51,6 +51,32 @@
 using namespace std;
 using namespace packet;
 using namespace logger;
+
+// ASCII envelope for each packet type, the timestamp goes between the prefix
+// and the suffix.
+#define ASCII_PREFIX(type) \
+    { "<port_agent_packet type=\"" type "\" time=\"", \
+      sizeof("<port_agent_packet type=\"" type "\" time=\"") - 1 }
+
+static const struct {
+    const char *text;
+    size_t length;
+} asciiPrefix[] = {
+    ASCII_PREFIX("UNKNOWN"),
+    ASCII_PREFIX("DATA_FROM_INSTRUMENT"),
+    ASCII_PREFIX("DATA_FROM_DRIVER"),
+    ASCII_PREFIX("PORT_AGENT_COMMAND"),
+    ASCII_PREFIX("PORT_AGENT_STATUS"),
+    ASCII_PREFIX("PORT_AGENT_FAULT"),
+    ASCII_PREFIX("INSTRUMENT_COMMAND"),
+    ASCII_PREFIX("PORT_AGENT_HEARTBEAT"),
+    ASCII_PREFIX("OUT_OF_RANGE")
+};
+
+static const size_t ASCII_PREFIX_COUNT = sizeof(asciiPrefix) / sizeof(asciiPrefix[0]);
+
+static const char ASCII_TIME_END[] = "\">";
+static const char ASCII_SUFFIX[] = "</port_agent_packet>\n\r";
     
 /******************************************************************************
  *   PUBLIC METHODS
@@ -192,21 +218,82 @@ void Packet::copy(const Packet &copy) {
  * Description: an ascii representation of the packet.
  ******************************************************************************/
 string Packet::asAscii() {
-    ostringstream out;
+    string out;
 
-    char* packetBuffer = packet();
+    out.resize(asciiSize());
+    out.resize(asAscii(&out[0], out.size()));
 
-    out << "<" << asciiPacketLabel() << " type=\"" << asciiPacketType() << "\" "
-        << "time=\"" << asciiPacketTimestamp() << "\">";
+    return out;
+}
 
-    if(packetBuffer) {
-        for(int i = HEADER_SIZE; i < packetSize(); i++)
-            out << packetBuffer[i];
+/******************************************************************************
+ * Method: asAscii
+ * Description: Render the ascii representation of the packet into a buffer.
+ *
+ * Parameters:
+ *   buffer - where to write the packet
+ *   size - size of the buffer, asciiSize() is always large enough
+ *
+ * Return:
+ *   bytes written, 0 if the packet doesn't fit.
+ ******************************************************************************/
+size_t Packet::asAscii(char *buffer, size_t size) {
+    char* packetBuffer = packet();
+    size_t payloadLength = packetBuffer ? payloadSize() : 0;
+    size_t type = m_tPacketType < ASCII_PREFIX_COUNT ? m_tPacketType : ASCII_PREFIX_COUNT - 1;
+    char timestamp[TIMESTAMP_NUMBER_SIZE];
+    size_t timestampLength = m_oTimestamp.formatNumber(timestamp, sizeof(timestamp));
+    size_t length = asciiPrefix[type].length + timestampLength + sizeof(ASCII_TIME_END) - 1 +
+                    payloadLength + sizeof(ASCII_SUFFIX) - 1;
+    char *pos = buffer;
+
+    if(length > size)
+        return 0;
+
+    memcpy(pos, asciiPrefix[type].text, asciiPrefix[type].length);
+    pos += asciiPrefix[type].length;
+    memcpy(pos, timestamp, timestampLength);
+    pos += timestampLength;
+    memcpy(pos, ASCII_TIME_END, sizeof(ASCII_TIME_END) - 1);
+    pos += sizeof(ASCII_TIME_END) - 1;
+    if(payloadLength) {
+        memcpy(pos, packetBuffer + HEADER_SIZE, payloadLength);
+        pos += payloadLength;
     }
+    memcpy(pos, ASCII_SUFFIX, sizeof(ASCII_SUFFIX) - 1);
 
-    out << "</" << asciiPacketLabel() << ">\n\r";
+    return length;
+}
 
-    return out.str();
+/******************************************************************************
+ * Method: asAscii
+ * Description: Render the ascii representation of several packets back to
+ * back in one buffer so they can be written together.  Stops at the first
+ * packet that doesn't fit.
+ *
+ * Parameters:
+ *   packets - packets to render
+ *   count - number of packets
+ *   buffer - where to write the packets
+ *   size - size of the buffer
+ *   rendered - set to the number of packets written
+ *
+ * Return:
+ *   bytes written
+ ******************************************************************************/
+size_t Packet::asAscii(Packet **packets, size_t count, char *buffer,
+                       size_t size, size_t &rendered) {
+    size_t total = 0;
+
+    for(rendered = 0; rendered < count; rendered++) {
+        size_t length = packets[rendered]->asAscii(buffer + total, size - total);
+        if(!length)
+            break;
+
+        total += length;
+    }
+
+    return total;
 }
 
 /******************************************************************************
@@ -231,7 +318,9 @@ string Packet::pretty() {
     out << "Type: " << m_tPacketType << " (" << typeToString(m_tPacketType) << ")" << endl;
     out << "Size: " << m_iPacketSize << endl;
     out << "Checksum: " << hex << m_iChecksum << dec << endl;
-    out << "Timestamp: " << m_oTimestamp.asNumber() << endl;
+    char timestamp[TIMESTAMP_NUMBER_SIZE];
+    m_oTimestamp.formatNumber(timestamp, sizeof(timestamp));
+    out << "Timestamp: " << timestamp << endl;
 	
 	LOG(DEBUG) << "Size: " << m_iPacketSize;
     
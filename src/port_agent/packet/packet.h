@@ -31,6 +31,13 @@
  *
  * if(packet.readyToSend())
  *    write(packet.packet(), packet().packetSize());
+ *
+ * ASCII output wraps the payload in an xml style envelope.  It can be
+ * rendered into a caller buffer of at least asciiSize() bytes without
+ * allocating, or several packets can be rendered into one buffer:
+ *
+ * size_t length = packet.asAscii(buffer, sizeof(buffer));
+ * size_t length = Packet::asAscii(packets, count, buffer, sizeof(buffer), rendered);
  *    
  ******************************************************************************/
 
@@ -57,9 +64,15 @@ namespace packet {
         INSTRUMENT_COMMAND,
         PORT_AGENT_HEARTBEAT
     };
+    
+    // Number of packet types, for tables indexed by type
+    const int PACKET_TYPE_COUNT = PORT_AGENT_HEARTBEAT + 1;
 
     const uint32_t SYNC = 0xA39D7A;
     const short    HEADER_SIZE = 16;
+    
+    // Upper bound on the ascii envelope around the payload
+    const size_t   ASCII_ENVELOPE_SIZE = 128;
 
 
     class Packet {
@@ -90,6 +103,17 @@ namespace packet {
             
             // return a ASCII string representation of the packet
             string asAscii();
+            
+            // Render the ASCII representation into a buffer.  Returns the
+            // length written or 0 if the buffer is too small.
+            size_t asAscii(char *buffer, size_t size);
+            
+            // Render as many packets as fit into one buffer.
+            static size_t asAscii(Packet **packets, size_t count,
+                                  char *buffer, size_t size, size_t &rendered);
+            
+            // Buffer size that always holds the ASCII representation
+            size_t asciiSize() { return ASCII_ENVELOPE_SIZE + payloadSize(); }
 
             // return a pretty string representation of the packet
             string pretty();
@@ -108,11 +132,6 @@ namespace packet {
             // deep copy a packet object
             virtual void copy(const Packet &copy);
 
-            // ascii packet label
-            string asciiPacketLabel() { return "port_agent_packet"; }
-            string asciiPacketTimestamp() { return m_oTimestamp.asNumber(); }
-            string asciiPacketType() { return typeToString(m_tPacketType); }
-
 
         private:
         
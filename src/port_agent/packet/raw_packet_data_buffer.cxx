@@ -62,6 +62,10 @@ RawPacketDataBuffer::RawPacketDataBuffer(size_t bufferCapacity, size_t maxPacket
     if (maxInvalidDataSize_ > maxPacketSize_) {
         maxInvalidDataSize_ = maxPacketSize_;
     }
+
+    packets_ = metrics::Metrics::GetCounter("rsn.packets");
+    resyncs_ = metrics::Metrics::GetCounter("rsn.resyncs");
+    invalidBytes_ = metrics::Metrics::GetCounter("rsn.invalid_bytes");
 }
 
 /******************************************************************************
@@ -122,6 +126,7 @@ Packet* RawPacketDataBuffer::checkForInvalidPacket(bool invalidSync) {
 
     if (numberInvalidBytes > 0)
     {
+        invalidBytes_->add(numberInvalidBytes);
         RawPacket* rawPacket = reinterpret_cast<RawPacket*>(data);
         packet = new Packet(PORT_AGENT_FAULT, Timestamp(), data, numberInvalidBytes);  // TODO: new packet type?
     }
@@ -162,9 +167,11 @@ Packet* RawPacketDataBuffer::checkForPacket() {
                 if (bytesDiscarded != rawPacket->getPacketSize()) {
                     throw RawPacketDataReadError();
                 }
+                packets_->add();
             } else {
                 // TODO: Throw packet away unless it contains a sync?
                 LOG(DEBUG) << "Invalid checksum, throw whole packet away";
+                resyncs_->add();
                 packet = checkForInvalidPacket(true);
             }
         } else {
@@ -174,6 +181,7 @@ Packet* RawPacketDataBuffer::checkForPacket() {
     } else {
         LOG(DEBUG) << "Invalid header";
         // TODO: Throw header away unless it contains a sync?
+        resyncs_->add();
         packet = checkForInvalidPacket(true);
     }
 
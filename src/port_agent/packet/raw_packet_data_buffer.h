@@ -30,6 +30,7 @@
 #define SYNC_MIN_INDEX 1
 
 #include "common/circular_buffer.h"
+#include "common/metrics.h"
 #include "packet.h"
 #include "raw_packet.h"
 
@@ -97,6 +98,11 @@ class RawPacketDataBuffer : public CircularBuffer {
         // Big endian sync bytes
         const char* syncChar;
 
+        // Valid packets, bad headers or checksums and bytes skipped
+        metrics::Counter* packets_;
+        metrics::Counter* resyncs_;
+        metrics::Counter* invalidBytes_;
+
     };
 }
 
@@ -221,3 +221,39 @@ TEST_F(PortAgentPacketTest, AsciiOutput) {
     delete [] payload;
 }
 
+
+/* Test the ascii output rendered into a buffer */
+TEST_F(PortAgentPacketTest, AsciiBuffer) {
+	Timestamp timestamp(1, 0x80000000);
+    char payload[] = "ad";
+    char buffer[256];
+
+    Packet driver(DATA_FROM_DRIVER, timestamp, payload, 2);
+    Packet heartbeat(PORT_AGENT_HEARTBEAT, timestamp, NULL, 0);
+
+    string expected = "<port_agent_packet type=\"DATA_FROM_DRIVER\" time=\"1.5\">ad</port_agent_packet>\n\r";
+    size_t length = driver.asAscii(buffer, sizeof(buffer));
+    EXPECT_EQ(expected, string(buffer, length));
+    EXPECT_LE(length, driver.asciiSize());
+
+    expected = "<port_agent_packet type=\"PORT_AGENT_HEARTBEAT\" time=\"1.5\"></port_agent_packet>\n\r";
+    length = heartbeat.asAscii(buffer, sizeof(buffer));
+    EXPECT_EQ(expected, string(buffer, length));
+    EXPECT_EQ(expected, heartbeat.asAscii());
+
+    // Too small
+    EXPECT_EQ(driver.asAscii(buffer, 10), 0);
+
+    // Batched, the second packet doesn't fit
+    Packet *packets[] = { &driver, &heartbeat };
+    size_t rendered;
+    string first = driver.asAscii();
+
+    length = Packet::asAscii(packets, 2, buffer, sizeof(buffer), rendered);
+    EXPECT_EQ(rendered, 2);
+    EXPECT_EQ(first + expected, string(buffer, length));
+
+    length = Packet::asAscii(packets, 2, buffer, first.length() + 10, rendered);
+    EXPECT_EQ(rendered, 1);
+    EXPECT_EQ(first, string(buffer, length));
+}
@@ -0,0 +1,173 @@
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/util.h"
+#include "port_agent/packet/output_throttle.h"
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <string>
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace packet;
+using namespace logger;
+
+#define NTP_HALF_SECOND 0x80000000
+
+class OutputThrottleTest : public testing::Test {
+
+    protected:
+        virtual void SetUp() {
+            Logger::SetLogFile("/tmp/gtest.log");
+            Logger::SetLogLevel("MESG");
+
+            LOG(INFO) << "************************************************";
+            LOG(INFO) << "    Port Agent Output Throttle Test Start Up";
+            LOG(INFO) << "************************************************";
+        }
+};
+
+/* Constructor Throw Tests */
+TEST_F(OutputThrottleTest, CTORThrowTests) {
+    bool exceptionCaught;
+
+    try {
+        LOG(DEBUG) << "Check for zero payload size";
+        exceptionCaught = false;
+        OutputThrottle throttle(100, 0, 10, 1);
+    }
+    catch(PacketParamOutOfRange &e) {
+        exceptionCaught = true;
+    }
+    EXPECT_TRUE(exceptionCaught);
+
+    try {
+        LOG(DEBUG) << "Check for payload larger than the buffer";
+        exceptionCaught = false;
+        OutputThrottle throttle(100, 101, 10, 1);
+    }
+    catch(PacketParamOutOfRange &e) {
+        exceptionCaught = true;
+    }
+    EXPECT_TRUE(exceptionCaught);
+
+    try {
+        LOG(DEBUG) << "Check for negative latency";
+        exceptionCaught = false;
+        OutputThrottle throttle(100, 10, 10, -1);
+    }
+    catch(PacketParamOutOfRange &e) {
+        exceptionCaught = true;
+    }
+    EXPECT_TRUE(exceptionCaught);
+}
+
+/* Single byte reads are coalesced until the latency expires */
+TEST_F(OutputThrottleTest, CoalesceOnLatency) {
+    OutputThrottle throttle(100, 10, 0, 1);
+    Timestamp first(1000, 0);
+    Timestamp second(1000, NTP_HALF_SECOND);
+    Packet *packet;
+
+    EXPECT_TRUE(throttle.getNextPacket(first) == NULL);
+    EXPECT_LT(throttle.timeUntilReady(first), 0);
+
+    throttle.writeData("a", 1, first);
+    throttle.writeData("b", 1, second);
+
+    EXPECT_TRUE(throttle.getNextPacket(second) == NULL);
+    EXPECT_NEAR(throttle.timeUntilReady(second), 0.5, 0.001);
+
+    packet = throttle.getNextPacket(Timestamp(1001, 0));
+    ASSERT_TRUE(packet != NULL);
+    EXPECT_EQ(packet->packetType(), DATA_FROM_INSTRUMENT);
+    EXPECT_EQ(packet->payloadSize(), 2);
+    EXPECT_EQ(strncmp(packet->payload(), "ab", 2), 0);
+
+    // Timestamp of the first byte read
+    EXPECT_EQ(packet->timestamp().seconds(), 1000);
+    EXPECT_EQ(packet->timestamp().fraction(), 0);
+    delete packet;
+
+    EXPECT_EQ(throttle.size(), 0);
+    EXPECT_TRUE(throttle.getNextPacket(Timestamp(1002, 0)) == NULL);
+}
+
+/* Full payloads are ready immediately and split on the max payload size */
+TEST_F(OutputThrottleTest, CoalesceOnSize) {
+    OutputThrottle throttle(100, 4, 0, 10);
+    Timestamp first(1000, 0);
+    Timestamp second(1000, NTP_HALF_SECOND);
+    Packet *packet;
+
+    throttle.writeData("abc", 3, first);
+    EXPECT_TRUE(throttle.getNextPacket(first) == NULL);
+
+    throttle.writeData("defgh", 5, second);
+
+    packet = throttle.getNextPacket(second);
+    ASSERT_TRUE(packet != NULL);
+    EXPECT_EQ(packet->payloadSize(), 4);
+    EXPECT_EQ(strncmp(packet->payload(), "abcd", 4), 0);
+    EXPECT_EQ(packet->timestamp().fraction(), 0);
+    delete packet;
+
+    // Second packet starts with the second read so takes its timestamp
+    packet = throttle.getNextPacket(second);
+    ASSERT_TRUE(packet != NULL);
+    EXPECT_EQ(packet->payloadSize(), 4);
+    EXPECT_EQ(strncmp(packet->payload(), "efgh", 4), 0);
+    EXPECT_EQ(packet->timestamp().fraction(), NTP_HALF_SECOND);
+    delete packet;
+
+    EXPECT_TRUE(throttle.getNextPacket(second) == NULL);
+}
+
+/* Packets are released no faster than the max packet rate */
+TEST_F(OutputThrottleTest, RateLimit) {
+    OutputThrottle throttle(100, 2, 2, 0);
+    Timestamp now(1000, 0);
+    Packet *packet;
+
+    throttle.writeData("aabbcc", 6, now);
+
+    packet = throttle.getNextPacket(now);
+    ASSERT_TRUE(packet != NULL);
+    delete packet;
+
+    // Bucket is empty, next token in half a second
+    EXPECT_TRUE(throttle.getNextPacket(now) == NULL);
+    EXPECT_NEAR(throttle.timeUntilReady(now), 0.5, 0.001);
+
+    packet = throttle.getNextPacket(Timestamp(1000, NTP_HALF_SECOND));
+    ASSERT_TRUE(packet != NULL);
+    EXPECT_EQ(strncmp(packet->payload(), "bb", 2), 0);
+    delete packet;
+
+    // Flush ignores the rate limit
+    packet = throttle.flush();
+    ASSERT_TRUE(packet != NULL);
+    EXPECT_EQ(strncmp(packet->payload(), "cc", 2), 0);
+    delete packet;
+
+    EXPECT_TRUE(throttle.flush() == NULL);
+}
+
+/* Writing past the capacity throws and leaves the buffer intact */
+TEST_F(OutputThrottleTest, Overflow) {
+    OutputThrottle throttle(4, 4, 0, 1);
+    bool exceptionCaught = false;
+
+    throttle.writeData("abc", 3, Timestamp());
+
+    try {
+        throttle.writeData("de", 2, Timestamp());
+    }
+    catch(RawPacketDataBufferOverflow &e) {
+        exceptionCaught = true;
+    }
+
+    EXPECT_TRUE(exceptionCaught);
+    EXPECT_EQ(throttle.size(), 3);
+}
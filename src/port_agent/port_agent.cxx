@@ -15,8 +15,12 @@
 #include "connection/instrument_rsn_connection.h"
 #include "connection/instrument_botpt_connection.h"
 #include "connection/instrument_serial_connection.h"
+#include "connection/instrument_udp_connection.h"
 #include "packet/packet.h"
 #include "packet/buffered_single_char.h"
+#include "common/event_log.h"
+#include "common/trace_log.h"
+#include "common/clock.h"
 
 #include "publisher/log_publisher.h"
 #include "publisher/driver_command_publisher.h"
@@ -24,6 +28,9 @@
 #include "publisher/instrument_command_publisher.h"
 #include "publisher/instrument_data_publisher.h"
 #include "publisher/telnet_sniffer_publisher.h"
+#include "publisher/subscription_publisher.h"
+#include "publisher/shm_publisher.h"
+#include "publisher/multicast_publisher.h"
 #include "publisher/udp_publisher.h"
 #include "publisher/tcp_publisher.h"
 
@@ -44,6 +51,18 @@ using namespace std;
 using namespace packet;
 using namespace network;
 using namespace port_agent;
+using namespace metrics;
+
+// Formats written to the binary event log header
+static const EventMessage portAgentEvents[] = {
+    { EVENT_STARTUP,         "port agent started, pid %d" },
+    { EVENT_STATE_CHANGE,    "state transition %d to %d" },
+    { EVENT_INSTRUMENT_READ, "instrument read %d bytes" },
+    { EVENT_DRIVER_READ,     "driver read %d bytes from fd %d" },
+    { EVENT_HEARTBEAT,       "heartbeat" },
+    { EVENT_FAULT,           "fault, %d byte message" },
+    { EVENT_THROTTLE_FULL,   "output throttle full, %d bytes read" },
+};
 
 /******************************************************************************
  *   PUBLIC METHODS
@@ -56,9 +75,20 @@ PortAgent::PortAgent() {
     m_pObservatoryConnection = NULL;
     m_pInstrumentConnection = NULL;
     m_pTelnetSnifferConnection = NULL;
+    m_pTelnetSnifferHub = NULL;
+    m_pSubscriptionHub = NULL;
+    m_pShmRing = NULL;
+    m_pDatagramBatch = NULL;
+    m_pStreamTee = NULL;
+    m_bSnifferSpliced = false;
+    m_iSnifferSinkFD = 0;
     m_pConfig = NULL;
     m_oState = STATE_UNKNOWN;
     m_rsnRawPacketDataBuffer = NULL;
+    m_pOutputThrottle = NULL;
+    m_pStatsServer = NULL;
+    
+    initializeMetrics();
 }
 
 /******************************************************************************
@@ -84,7 +114,17 @@ PortAgent::PortAgent(int argc, char *argv[]) {
     m_pInstrumentConnection = NULL;
     m_pObservatoryConnection = NULL;
     m_pTelnetSnifferConnection = NULL;
-
+    m_pTelnetSnifferHub = NULL;
+    m_pSubscriptionHub = NULL;
+    m_pShmRing = NULL;
+    m_pDatagramBatch = NULL;
+    m_pStreamTee = NULL;
+    m_bSnifferSpliced = false;
+    m_iSnifferSinkFD = 0;
+    m_pOutputThrottle = NULL;
+    m_pStatsServer = NULL;
+    
+    initializeMetrics();
 }
 
 /******************************************************************************
@@ -92,6 +132,20 @@ PortAgent::PortAgent(int argc, char *argv[]) {
  * Description: Clear dynamic memory
  ******************************************************************************/
 PortAgent::~PortAgent() {
+    // Don't lose buffered instrument data, publish it while the
+    // connections are still around.
+    if(m_pOutputThrottle) {
+        try {
+            flushOutputThrottle();
+        }
+        catch(OOIException &e) {
+            LOG(ERROR) << "failed to flush output throttle: " << e.what();
+        }
+
+        delete m_pOutputThrottle;
+        m_pOutputThrottle = NULL;
+    }
+
     if(m_pObservatoryConnection)
         delete m_pObservatoryConnection;
         
@@ -101,6 +155,21 @@ PortAgent::~PortAgent() {
     if(m_pTelnetSnifferConnection)
         delete m_pTelnetSnifferConnection;
         
+    if(m_pTelnetSnifferHub)
+        delete m_pTelnetSnifferHub;
+        
+    if(m_pSubscriptionHub)
+        delete m_pSubscriptionHub;
+        
+    if(m_pShmRing)
+        delete m_pShmRing;
+        
+    if(m_pDatagramBatch)
+        delete m_pDatagramBatch;
+        
+    if(m_pStatsServer)
+        delete m_pStatsServer;
+        
     if(m_pConfig)
         delete m_pConfig;
         
@@ -110,6 +179,11 @@ PortAgent::~PortAgent() {
         delete m_rsnRawPacketDataBuffer;
 
     m_rsnRawPacketDataBuffer = NULL;
+
+    EventLog::Close();
+
+    // Write any queued log messages before we go.
+    Logger::StopAsync();
 }
 
 /******************************************************************************
@@ -222,7 +296,10 @@ void PortAgent::initializeObservatoryStandardDataConnection() {
         connection = (ObservatoryConnection*)m_pObservatoryConnection;
     }
     
-    // Initialize!
+    // Initialize!  A change of transport replaces the listener, leaving it
+    // uninitialized.
+    connection->setDataSocketPath(m_pConfig->observatoryDataSocket(),
+                                  m_pConfig->unixSocketSeqPacket());
     connection->setDataPort(m_pConfig->observatoryDataPort());
     
     if (!connection->dataInitialized())
@@ -298,6 +375,14 @@ void PortAgent::initializeObservatoryCommandConnection() {
             delete m_pObservatoryConnection;
             m_pObservatoryConnection = 0;
         }
+        
+        // Switching between TCP and a unix domain socket replaces the listener,
+        // the new one keeps the port
+        else if (m_pObservatoryConnection->setCommandSocketPath(m_pConfig->observatoryCommandSocket(),
+                                                                m_pConfig->unixSocketSeqPacket())) {
+            LOG(DEBUG) << "Observatory command transport changed: new listener.";
+            m_pObservatoryConnection->initializeCommandSocket();
+        }
     }
 
     // Create the connection object
@@ -306,6 +391,8 @@ void PortAgent::initializeObservatoryCommandConnection() {
             LOG(DEBUG2) << "creating new observatory standard connection object";
             m_pObservatoryConnection = new ObservatoryConnection();
             ObservatoryConnection* pConnection = (ObservatoryConnection*) m_pObservatoryConnection;
+            pConnection->setCommandSocketPath(m_pConfig->observatoryCommandSocket(),
+                                              m_pConfig->unixSocketSeqPacket());
             pConnection->setCommandPort(m_pConfig->observatoryCommandPort());
 
             if (!pConnection->commandInitialized())
@@ -315,6 +402,8 @@ void PortAgent::initializeObservatoryCommandConnection() {
             LOG(DEBUG2) << "creating new observatory multi connection object";
             m_pObservatoryConnection = new ObservatoryMultiConnection();
             ObservatoryMultiConnection* pConnection = (ObservatoryMultiConnection*) m_pObservatoryConnection;
+            pConnection->setCommandSocketPath(m_pConfig->observatoryCommandSocket(),
+                                              m_pConfig->unixSocketSeqPacket());
             pConnection->setCommandPort(m_pConfig->observatoryCommandPort());
 
             if (!pConnection->commandInitialized())
@@ -350,10 +439,14 @@ void PortAgent::initializeInstrumentConnection() {
     else if (m_pConfig->instrumentConnectionType() == TYPE_RSN) {
         initializeRSNInstrumentConnection();
     }
+    else if (m_pConfig->instrumentConnectionType() == TYPE_UDP) {
+        initializeUDPInstrumentConnection();
+    }
     else {
         LOG(ERROR) << "Instrument connection type not recognized.";
    }
 
+    initializeReceiveTimestamps();
 }
 
 /******************************************************************************
@@ -540,6 +633,64 @@ void PortAgent::initialize_BOTPT_InstrumentConnection() {
         setState(STATE_CONNECTED);
 }
 
+/******************************************************************************
+ * Method: initializeUDPInstrumentConnection
+ * Description: Bind the local port a UDP instrument sends its data to.  Driver
+ * data is sent to the instrument address and TX port.  There is no command
+ * port and nothing to connect to, so the connection is up once the port is
+ * bound.
+ *
+ * State Transitions:
+ *  Connected - if we can bind the port
+ *  Disconnected - if we fail to bind the port
+ ******************************************************************************/
+void PortAgent::initializeUDPInstrumentConnection() {
+    InstrumentUDPConnection *connection = (InstrumentUDPConnection *)m_pInstrumentConnection;
+
+    // Clear if we have already initialized the wrong type
+    if(connection && connection->connectionType() != PACONN_INSTRUMENT_UDP) {
+        LOG(INFO) << "Detected connection type change.  rebuilding connection.";
+        delete connection;
+        connection = NULL;
+    }
+
+    if (!connection)
+        m_pInstrumentConnection = connection = new InstrumentUDPConnection();
+
+    // If we have changed out configuration the set the new values and try to connect
+    if (connection->dataHost() != m_pConfig->instrumentAddr() ||
+       connection->dataTxPort() != m_pConfig->instrumentDataTxPort() ||
+       connection->dataRxPort() != m_pConfig->instrumentDataRxPort() ) {
+        LOG(INFO) << "Detected connection configuration change.  reconfiguring.";
+
+        connection->disconnect();
+
+        connection->setDataHost(m_pConfig->instrumentAddr());
+        connection->setDataTxPort(m_pConfig->instrumentDataTxPort());
+        connection->setDataRxPort(m_pConfig->instrumentDataRxPort());
+    }
+
+    if (!connection->connected()) {
+        LOG(DEBUG) << "Instrument port not bound, attempting to bind";
+        LOG(DEBUG2) << "rx port: " << connection->dataRxPort()
+                    << " host: " << connection->dataHost() << " tx port: " << connection->dataTxPort();
+
+        setState(STATE_DISCONNECTED);
+
+        try {
+            connection->initialize();
+        }
+        catch(OOIException &e) {
+            connection->disconnect();
+            string msg = e.what();
+            LOG(ERROR) << msg;
+        };
+    }
+
+    if(connection->connected())
+        setState(STATE_CONNECTED);
+}
+
 /******************************************************************************
  * Method: initializeSerialInstrumentConnection
  * Description: Connect to a Serial type instrument.
@@ -610,6 +761,121 @@ bool PortAgent::initializeSerialSettings() {
 
 }
 
+/******************************************************************************
+ * Method: initializeOutputThrottle
+ * Description: setup the output throttle for instrument data.  Anything held
+ * by an existing throttle is published first.  The throttle is the max packet
+ * rate and reads are coalesced for at most one throttle period.  RSN data is
+ * already packetized so it is never throttled.
+ ******************************************************************************/
+void PortAgent::initializeOutputThrottle() {
+    uint32_t rate = m_pConfig->outputThrottle();
+
+    if(m_pOutputThrottle) {
+        flushOutputThrottle();
+        delete m_pOutputThrottle;
+        m_pOutputThrottle = NULL;
+    }
+
+    if(! rate || m_pConfig->instrumentConnectionType() == TYPE_RSN) {
+        LOG(DEBUG) << "Output throttle disabled";
+        return;
+    }
+
+    LOG(INFO) << "Initialize Output Throttle, max packet rate: " << rate
+              << " max packet size: " << m_pConfig->maxPacketSize();
+
+    m_pOutputThrottle = new OutputThrottle(OUTPUT_THROTTLE_BUFFER_SIZE,
+                                           m_pConfig->maxPacketSize(),
+                                           rate, 1.0 / rate);
+}
+
+/******************************************************************************
+ * Method: initializeStatsServer
+ * Description: start, move or stop the HTTP listener monitoring scrapes
+ * metrics from.  Like the subscription hub, the server is kept for the life
+ * of the port agent and only restarted when the port changes.
+ ******************************************************************************/
+void PortAgent::initializeStatsServer() {
+    int port = m_pConfig->statsPort();
+    
+    if(port <= 0) {
+        if(m_pStatsServer)
+            m_pStatsServer->disconnect();
+        return;
+    }
+    
+    if(! m_pStatsServer)
+        m_pStatsServer = new StatsServer();
+    
+    if(m_pStatsServer->listening() && m_pStatsServer->port() == port)
+        return;
+    
+    LOG(INFO) << "Initialize stats server on port " << port;
+    m_pStatsServer->setPort(port);
+    
+    try {
+        m_pStatsServer->initialize();
+    }
+    catch(OOIException &e) {
+        LOG(ERROR) << "Failed to establish stats server: " << e.what();
+    }
+}
+
+/******************************************************************************
+ * Method: initializeTrace
+ * Description: start or stop per-packet tracing.  The trace file is opened
+ * when a sample rate is set and closed again when it is set back to 0.
+ ******************************************************************************/
+void PortAgent::initializeTrace() {
+    uint32_t rate = m_pConfig->traceSampleRate();
+    
+    TraceLog::SetSampleRate(rate);
+    
+    if(! rate) {
+        TraceLog::Close();
+        return;
+    }
+    
+    if(TraceLog::IsOpen())
+        return;
+    
+    LOG(INFO) << "Initialize trace file, sample rate " << rate;
+    
+    try {
+        TraceLog::Open(m_pConfig->tracefile());
+    }
+    catch(TraceLogOpenFailure &e) {
+        LOG(ERROR) << e.what();
+    }
+}
+
+/******************************************************************************
+ * Method: initializeReceiveTimestamps
+ * Description: turn kernel receive timestamps on or off for the instrument
+ * data socket.  The socket keeps the setting across reconnects, so this is
+ * only needed when the connection is built or the config changes.  Serial
+ * devices aren't sockets and are always stamped when read.
+ ******************************************************************************/
+void PortAgent::initializeReceiveTimestamps() {
+    bool enable = m_pConfig->kernelTimestamps();
+    CommBase *pConnection;
+
+    if(! m_pInstrumentConnection ||
+       m_pConfig->instrumentConnectionType() == TYPE_SERIAL)
+        return;
+
+    if (m_pInstrumentConnection->connectionType() == PACONN_INSTRUMENT_BOTPT)
+        pConnection = ((InstrumentBOTPTConnection*) m_pInstrumentConnection)->dataRxConnectionObject();
+    else
+        pConnection = m_pInstrumentConnection->dataConnectionObject();
+
+    if(pConnection && pConnection->receiveTimestamps() != enable) {
+        LOG(INFO) << "Set kernel receive timestamps to " << enable;
+        pConnection->setReceiveTimestamps(enable);
+    }
+}
+
 /******************************************************************************
  * Method: initializePulishers
  * Description: setup all publishers
@@ -624,6 +890,8 @@ void PortAgent::initializePublishers() {
     initializePublisherTCP();    
     initializePublisherUDP();    
     initializePublisherTelnetSniffer();    
+    initializePublisherSubscription();
+    initializePublisherShm();
 }
 
 /******************************************************************************
@@ -702,12 +970,9 @@ void PortAgent::initializePublisherObservatoryStandardData() {
 
 /******************************************************************************
  * Method: initializePublisherObservatoryMultiData
- * Description: setup the observatory data publisher
+ * Description: setup a data publisher for each observatory data listener
  ******************************************************************************/
 void PortAgent::initializePublisherObservatoryMultiData() {
-    CommBase *pConnection = 0;
-    //TCPCommListener* pListener = 0;
-
     LOG(INFO) << "Initialize Observatory Multi Data Publisher";
     if( ! m_pObservatoryConnection ) {
         LOG(ERROR) << "Observatory connection does not exist. "
@@ -715,14 +980,13 @@ void PortAgent::initializePublisherObservatoryMultiData() {
         return;
     }
 
-    // Iterate through the listeners adding the clientFDs
-    pConnection = ObservatoryDataSockets::instance()->getFirstSocket();
-    while (pConnection) {
+    ObservatoryDataSockets &sockets =
+        ((ObservatoryMultiConnection*)m_pObservatoryConnection)->dataSockets();
+
+    for(size_t i = 0; i < sockets.size(); i++) {
         LOG(DEBUG) << "Create new publisher";
-        DriverDataPublisher publisher(pConnection);
+        DriverDataPublisher publisher(sockets.socket(i));
         m_oPublishers.add(&publisher);
-
-        pConnection = ObservatoryDataSockets::instance()->getNextSocket();
     }
 }
 
@@ -780,8 +1044,12 @@ void PortAgent::initializePublisherInstrumentData() {
         return;
     }
     
+    connection->setNoDelay(m_pConfig->instrumentNoDelay());
+    
+    // Driver data is written to the instrument before it's published
     LOG(DEBUG) << "Create new publisher";
     InstrumentDataPublisher publisher(connection);
+    publisher.setDirect(true);
     
     m_oPublishers.add(&publisher);
 }
@@ -822,14 +1090,26 @@ void PortAgent::initializePublisherTelnetSniffer() {
     
     int port = m_pConfig->telnetSnifferPort();
     if(port <= 0) {
+        if(m_pTelnetSnifferHub)
+            m_pTelnetSnifferHub->disconnect();
+        
         LOG(INFO) << "telnet sniffer not configured.  Not starting.";
         return;
     }
     
-    LOG(DEBUG) << "Establish TCP Listener for Telnet Sniffer";
     if(m_pTelnetSnifferConnection)
         delete m_pTelnetSnifferConnection;
+    m_pTelnetSnifferConnection = NULL;
     
+    if(m_pConfig->telnetSnifferClients() > 1) {
+        initializePublisherTelnetSnifferHub();
+        return;
+    }
+    
+    if(m_pTelnetSnifferHub)
+        m_pTelnetSnifferHub->disconnect();
+    
+    LOG(DEBUG) << "Establish TCP Listener for Telnet Sniffer";
     m_pTelnetSnifferConnection = new TCPCommListener();
     m_pTelnetSnifferConnection->setPort(port);
     
@@ -852,6 +1132,144 @@ void PortAgent::initializePublisherTelnetSniffer() {
     if(m_pConfig->telnetSnifferSuffix().length())
         publisher.setSuffix(m_pConfig->telnetSnifferSuffix());
     
+    // Instrument data can be copied to the sniffer in-kernel
+    if(m_pConfig->telnetSnifferSplice() && ! m_pStreamTee) {
+        m_pStreamTee = new StreamTee();
+        
+        try {
+            m_pStreamTee->initialize();
+        }
+        catch(OOIException &e) {
+            LOG(ERROR) << "Failed to create telnet sniffer pipes: " << e.what();
+            delete m_pStreamTee;
+            m_pStreamTee = NULL;
+        }
+    }
+    
+    m_bSnifferSpliced = snifferSpliceAvailable();
+    publisher.setSpliced(m_bSnifferSpliced);
+    
+    m_oPublishers.add(&publisher);
+}
+
+/******************************************************************************
+ * Method: initializePublisherTelnetSnifferHub
+ * Description: setup a telnet sniffer several clients can watch at once.
+ * Like the subscription hub, the sniffer hub is kept for the life of the
+ * port agent so clients stay connected across configuration updates.
+ ******************************************************************************/
+void PortAgent::initializePublisherTelnetSnifferHub() {
+    int port = m_pConfig->telnetSnifferPort();
+    
+    if(! m_pTelnetSnifferHub)
+        m_pTelnetSnifferHub = new SubscriptionHub();
+    
+    m_pTelnetSnifferHub->setMaxSubscribers(m_pConfig->telnetSnifferClients());
+    
+    if(! m_pTelnetSnifferHub->listening() || m_pTelnetSnifferHub->port() != port) {
+        LOG(DEBUG) << "Establish telnet sniffer hub listener";
+        m_pTelnetSnifferHub->setPort(port);
+        
+        try {
+            m_pTelnetSnifferHub->initialize();
+        }
+        catch(OOIException &e) {
+            LOG(ERROR) << "Failed to establish telnet sniffer: " << e.what();
+            return;
+        }
+    }
+    
+    TelnetSnifferPublisher publisher(m_pTelnetSnifferHub);
+    
+    if(m_pConfig->telnetSnifferPrefix().length())
+        publisher.setPrefix(m_pConfig->telnetSnifferPrefix());
+    
+    if(m_pConfig->telnetSnifferSuffix().length())
+        publisher.setSuffix(m_pConfig->telnetSnifferSuffix());
+    
+    m_bSnifferSpliced = false;
+    m_oPublishers.add(&publisher);
+}
+
+/******************************************************************************
+ * Method: initializePublisherSubscription
+ * Description: setup the subscription hub and its publisher.  The hub is
+ * created once and kept, so the publisher in the list stays valid when the
+ * port changes.
+ ******************************************************************************/
+void PortAgent::initializePublisherSubscription() {
+    LOG(INFO) << "Initialize Subscription Publisher";
+    
+    int port = m_pConfig->subscriberPort();
+    if(port <= 0) {
+        if(m_pSubscriptionHub)
+            m_pSubscriptionHub->disconnect();
+        
+        LOG(INFO) << "subscription hub not configured.  Not starting.";
+        return;
+    }
+    
+    if(! m_pSubscriptionHub)
+        m_pSubscriptionHub = new SubscriptionHub();
+    
+    m_pSubscriptionHub->setRingSize(m_pConfig->subscriberRingSize());
+    m_pSubscriptionHub->setMaxSubscribers(m_pConfig->subscriberClients());
+    
+    if(! m_pSubscriptionHub->listening() || m_pSubscriptionHub->port() != port) {
+        LOG(DEBUG) << "Establish subscription hub listener";
+        m_pSubscriptionHub->setPort(port);
+        
+        try {
+            m_pSubscriptionHub->initialize();
+        }
+        catch(OOIException &e) {
+            LOG(ERROR) << "Failed to establish subscription hub: " << e.what();
+            return;
+        }
+    }
+    
+    SubscriptionPublisher publisher(m_pSubscriptionHub);
+    m_oPublishers.add(&publisher);
+}
+
+/******************************************************************************
+ * Method: initializePublisherShm
+ * Description: setup the shared memory ring and its publisher.  Like the
+ * subscription hub, the ring object is kept for the life of the port agent
+ * and only reopened when the name or size changes.
+ ******************************************************************************/
+void PortAgent::initializePublisherShm() {
+    LOG(INFO) << "Initialize Shared Memory Publisher";
+    
+    string name = m_pConfig->shmName();
+    if(! name.length()) {
+        if(m_pShmRing)
+            m_pShmRing->close();
+        
+        LOG(INFO) << "shared memory publisher not configured.  Not starting.";
+        return;
+    }
+    
+    if(! m_pShmRing)
+        m_pShmRing = new ShmRing();
+    
+    // Ring sizes are rounded up to 8 bytes
+    size_t size = (m_pConfig->shmSize() + 7) & ~7;
+    
+    if(! m_pShmRing->isOpen() || m_pShmRing->name() != name ||
+       m_pShmRing->size() != size) {
+        LOG(DEBUG) << "Open shared memory ring " << name;
+        
+        try {
+            m_pShmRing->open(name, size);
+        }
+        catch(OOIException &e) {
+            LOG(ERROR) << "Failed to open shared memory ring: " << e.what();
+            return;
+        }
+    }
+    
+    ShmPublisher publisher(m_pShmRing);
     m_oPublishers.add(&publisher);
 }
 
@@ -869,6 +1287,46 @@ void PortAgent::initializePublisherTCP() {
  ******************************************************************************/
 void PortAgent::initializePublisherUDP() {
     LOG(INFO) << "Initialize UDP Publisher";
+    
+    string addr = m_pConfig->multicastAddr();
+    uint16_t port = m_pConfig->multicastPort();
+    if(! addr.length() || ! port) {
+        if(m_pDatagramBatch)
+            m_pDatagramBatch->socket().disconnect();
+        
+        LOG(INFO) << "multicast publisher not configured.  Not starting.";
+        return;
+    }
+    
+    if(! m_pDatagramBatch)
+        m_pDatagramBatch = new DatagramBatch();
+    
+    m_pDatagramBatch->setSequenceHeader(m_pConfig->multicastSequence());
+    
+    UDPCommSocket &socket = m_pDatagramBatch->socket();
+    if(! socket.connected() || socket.hostname() != addr || socket.port() != port ||
+       socket.multicastTTL() != m_pConfig->multicastTTL() ||
+       socket.multicastInterface() != m_pConfig->multicastInterface()) {
+        LOG(DEBUG) << "Open multicast socket " << addr << ":" << port;
+        
+        m_pDatagramBatch->flush();
+        socket.disconnect();
+        socket.setHostname(addr);
+        socket.setPort(port);
+        socket.setMulticastTTL(m_pConfig->multicastTTL());
+        socket.setMulticastInterface(m_pConfig->multicastInterface());
+        
+        try {
+            socket.initialize();
+        }
+        catch(OOIException &e) {
+            LOG(ERROR) << "Failed to open multicast socket: " << e.what();
+            return;
+        }
+    }
+    
+    MulticastPublisher publisher(m_pDatagramBatch);
+    m_oPublishers.add(&publisher);
 }
 
 
@@ -933,6 +1391,22 @@ void PortAgent::processPortAgentCommands() {
                 LOG(DEBUG) << "get config command";
                 publishFault("not implemented");
                 break;
+            case CMD_GET_STATS:
+                LOG(DEBUG) << "get stats command";
+                publishStats();
+                break;
+            case CMD_STATS_CONFIG_UPDATE:
+                LOG(DEBUG) << "stats config update command";
+                initializeStatsServer();
+                break;
+            case CMD_TRACE_CONFIG_UPDATE:
+                LOG(DEBUG) << "trace config update command";
+                initializeTrace();
+                break;
+            case CMD_TIMESTAMP_CONFIG_UPDATE:
+                LOG(DEBUG) << "timestamp config update command";
+                initializeReceiveTimestamps();
+                break;
             case CMD_GET_STATE:
                 LOG(DEBUG) << "get state command";
                 publishStatus(getCurrentStateAsString());
@@ -1004,6 +1478,9 @@ void PortAgent::handleStateConfigured(const fd_set &readFDs) {
     initializeObservatoryDataConnection();
     initializeInstrumentConnection();
     initializePublishers();
+    initializeOutputThrottle();
+    initializeStatsServer();
+    initializeTrace();
 
     // connection/publisher initialized, so turn on timestamping
     // from the RSN Digi
@@ -1019,14 +1496,9 @@ void PortAgent::handleStateConfigured(const fd_set &readFDs) {
 void PortAgent::handleStateConnected(const fd_set &readFDs) {
     LOG(DEBUG) << "start state connected handler";
     
-    // Accept any new connections.
-    handleObservatoryCommandAccept(readFDs);
-    handleObservatoryDataAccept(readFDs);
-    
-    // Read data
-    handleObservatoryCommandRead(readFDs);
-    handleObservatoryDataRead(readFDs);
-    handleInstrumentDataRead(readFDs);
+    // Command port traffic always goes ahead of instrument data
+    handlePriority(readFDs);
+    handleBulkData(readFDs);
 }
 
 /******************************************************************************
@@ -1036,14 +1508,56 @@ void PortAgent::handleStateConnected(const fd_set &readFDs) {
 void PortAgent::handleStateDisconnected(const fd_set &readFDs) {
     LOG(DEBUG) << "start state disconnected handler";
     
+    // Command port traffic always goes ahead of instrument data
+    handlePriority(readFDs);
+    handleBulkData(readFDs);
+}
+
+/******************************************************************************
+ * Method: handlePriority
+ * Description: handle the observatory command and data connections.  Port
+ * agent commands like break and driver commands to the instrument have
+ * timing requirements, so they are handled before any instrument data.
+ ******************************************************************************/
+void PortAgent::handlePriority(const fd_set &readFDs) {
     // Accept any new connections.
     handleObservatoryCommandAccept(readFDs);
     handleObservatoryDataAccept(readFDs);
     
-    // Read data
+    // Read commands, driver commands are written straight to the instrument
     handleObservatoryCommandRead(readFDs);
     handleObservatoryDataRead(readFDs);
-    handleInstrumentDataRead(readFDs);
+    flushDriverData();
+}
+
+/******************************************************************************
+ * Method: handleBulkData
+ * Description: read instrument data, up to the bulk read budget times while
+ * the instrument has more waiting.  Between reads we look for command port
+ * traffic without waiting and handle it first, so a data burst can't hold
+ * up a break or wakeup for longer than one read.
+ ******************************************************************************/
+void PortAgent::handleBulkData(const fd_set &readFDs) {
+    PortAgentState state = getCurrentState();
+    uint32_t budget = m_pConfig->bulkReadBudget();
+    fd_set ready = readFDs;
+    
+    for(uint32_t i = 0; i < budget; i++) {
+        handleInstrumentDataRead(ready);
+        
+        if(i + 1 == budget || ! selectPending(ready))
+            break;
+        
+        handlePriority(ready);
+        
+        // A command may have reconfigured us
+        if(getCurrentState() != state)
+            break;
+        
+        int clientFD = getInstrumentDataRxClientFD();
+        if(! clientFD || ! FD_ISSET(clientFD, &ready))
+            break;
+    }
 }
 
 /******************************************************************************
@@ -1063,8 +1577,21 @@ void PortAgent::handleStateUnknown() {
  * connection.
  ******************************************************************************/
 void PortAgent::handleStateStartup() {
-    // Setup logging
+    // Setup logging.  We are past the daemon fork so the log writer
+    // thread can be started; LOG() no longer waits on the log file.
     Logger::SetLogFile(m_pConfig->logfile());
+    Logger::StartAsync();
+    
+    // The event log is for post-mortems, run without it if it can't be
+    // created.
+    try {
+        EventLog::Open(m_pConfig->eventfile(), portAgentEvents,
+                       sizeof(portAgentEvents) / sizeof(EventMessage));
+        EventLog::Write(INFO, EVENT_STARTUP, getpid());
+    }
+    catch(EventLogOpenFailure &e) {
+        LOG(ERROR) << e.what();
+    }
         
     LOG(DEBUG) << "start up state handler";
     
@@ -1081,22 +1608,62 @@ void PortAgent::handleCommon(const fd_set &readFDs) {
     handleTelnetSnifferRead(readFDs);
 }
 
+/******************************************************************************
+ * Method: initializeMetrics
+ * Description: Look up the metrics updated from the event loop.  The
+ * registry owns them, we only keep the pointers.
+ ******************************************************************************/
+void PortAgent::initializeMetrics() {
+    m_pInstrumentReads = Metrics::GetCounter("instrument.reads");
+    m_pInstrumentBytes = Metrics::GetCounter("instrument.bytes");
+    m_pDriverReads = Metrics::GetCounter("driver.reads");
+    m_pDriverBytes = Metrics::GetCounter("driver.bytes");
+    m_pLoopIterations = Metrics::GetCounter("loop.iterations");
+    m_pLoopBusy = Metrics::GetHistogram("loop.busy_us");
+    m_pInstrumentWrites = Metrics::GetCounter("publisher.instrument_data.packets");
+    m_pInstrumentWriteBytes = Metrics::GetCounter("publisher.instrument_data.bytes");
+    m_pInstrumentWriteErrors = Metrics::GetCounter("publisher.instrument_data.errors");
+    m_pDriverWriteLatency = Metrics::GetHistogram("driver.write_latency_us");
+}
+
 /******************************************************************************
  * Method: poll
  * Description: main program loop.  Looping structure is in base class
  ******************************************************************************/
 void PortAgent::poll() {
     fd_set readFDs;
+    fd_set writeFDs;
     struct timeval tv;
+    struct timespec start, end;
     int readyCount;
-    int maxFD = buildFDSet(readFDs);
+    int maxFD;
+    
+    // Everything up to select shares one clock read
+    Clock::Tick();
+    maxFD = buildFDSet(readFDs);
+    
+    // Only subscribers with unsent data wait on write
+    FD_ZERO(&writeFDs);
+    addSubscriberFDs(maxFD, readFDs, writeFDs);
+    
+    if(m_pStatsServer)
+        m_pStatsServer->addFDs(maxFD, readFDs, writeFDs);
     
     tv.tv_sec = SELECT_SLEEP_TIME;
     tv.tv_usec = 0;
     
+    // Wake up in time to publish data held by the output throttle
+    if(m_pOutputThrottle) {
+        double wait = m_pOutputThrottle->timeUntilReady(Timestamp());
+        if(wait >= 0 && wait < SELECT_SLEEP_TIME) {
+            tv.tv_sec = 0;
+            tv.tv_usec = (long)(wait * 1000000);
+        }
+    }
+    
     // Main select to see if any incoming pipes have data.
     LOG(DEBUG) << "Start select process";
-    readyCount = select(maxFD+1, &readFDs, NULL, NULL, &tv);
+    readyCount = select(maxFD+1, &readFDs, &writeFDs, NULL, &tv);
     if(readyCount < 0) {
         if (errno != EINTR) 
             LOG(ERROR) << "Socket select error: " << strerror(errno);
@@ -1106,6 +1673,12 @@ void PortAgent::poll() {
         return;
     }
 
+    // Coarse time for logging, heartbeats and rotation while we handle this
+    // wake up.  Data is timestamped from the high resolution clock.
+    Clock::Tick();
+    Clock::Now(start);
+    m_pLoopIterations->add();
+
     LOG(DEBUG) << "On select: ready to read on " << readyCount << " connections";
     
     LOG(DEBUG) << "Port Agent Version: " << PORT_AGENT_VERSION;
@@ -1134,8 +1707,19 @@ void PortAgent::poll() {
             handleStateUnknown();
             
         handleCommon(readFDs);
+        
+        // Driver data is already at the instrument, now log and publish it
+        flushDriverData();
+        publishDriverData();
             
+        publishThrottledPackets();
         publishHeartbeat();
+        
+        // Send subscribers everything published on this pass
+        handleSubscribers(readFDs, writeFDs);
+        flushDatagrams();
+        
+        handleStatsServer(readFDs, writeFDs);
 
     }
     catch(UnknownState &e) {
@@ -1147,6 +1731,12 @@ void PortAgent::poll() {
         LOG(ERROR) << msg;
         // TODO: publish fault packet
     }
+    
+    // Time spent handling this wake up, not waiting in select
+    Clock::Now(end);
+    int64_t busy = (end.tv_sec - start.tv_sec) * 1000000LL +
+                   (end.tv_nsec - start.tv_nsec) / 1000;
+    m_pLoopBusy->record(busy > 0 ? busy : 0);
 }
 
 /******************************************************************************
@@ -1182,6 +1772,31 @@ int PortAgent::buildFDSet(fd_set &readFDs) {
     return maxFD;
 }
 
+/******************************************************************************
+ * Method: selectPending
+ * Description: See, without waiting, which of the observatory connections
+ * and the instrument data connection are ready to read.
+ * Return:
+ *  true if any are ready.  readFDs populated with the ready FDs
+ ******************************************************************************/
+bool PortAgent::selectPending(fd_set &readFDs) {
+    struct timeval tv;
+    int maxFD = 0;
+    
+    FD_ZERO(&readFDs);
+    
+    addObservatoryCommandListenerFD(maxFD, readFDs);
+    addObservatoryCommandClientFD(maxFD, readFDs);
+    addObservatoryDataListenerFD(maxFD, readFDs);
+    addObservatoryDataClientFD(maxFD, readFDs);
+    addInstrumentDataClientFD(maxFD, readFDs);
+    
+    tv.tv_sec = 0;
+    tv.tv_usec = 0;
+    
+    return select(maxFD+1, &readFDs, NULL, NULL, &tv) > 0;
+}
+
 /******************************************************************************
  * Method: addTelnetSnifferListenerFD
  * Description: Add the telnet sniffer fd to the fd_set.  Also update
@@ -1230,6 +1845,23 @@ void PortAgent::addTelnetSnifferClientFD(int &maxFD, fd_set &readFDs) {
     }
 }
 
+/******************************************************************************
+ * Method: addSubscriberFDs
+ * Description: Add the subscription and telnet sniffer hub listeners and
+ * subscribers to the read
+ * set and subscribers with unsent data to the write set.  Also update the
+ * max file descriptor.
+ *
+ * If the hub isn't initialized then do nothing.
+ ******************************************************************************/
+void PortAgent::addSubscriberFDs(int &maxFD, fd_set &readFDs, fd_set &writeFDs) {
+    if(m_pSubscriptionHub)
+        m_pSubscriptionHub->addFDs(maxFD, readFDs, writeFDs);
+    
+    if(m_pTelnetSnifferHub)
+        m_pTelnetSnifferHub->addFDs(maxFD, readFDs, writeFDs);
+}
+
 /******************************************************************************
  * Method: addObservatoryCommandListenerFD
  * Description: Add the observatory connection fd to the fd_set.  Also update
@@ -1302,7 +1934,7 @@ void PortAgent::addObservatoryDataListenerFD(int &maxFD, fd_set &readFDs) {
             addObservatoryStandardDataListenerFD(maxFD, readFDs);
         }
         else if (PACONN_OBSERVATORY_MULTI == connectionType) {
-            addObservatoryMultiDataListenerFDs(maxFD, readFDs);
+            addObservatoryMultiDataFDs(maxFD, readFDs);
         }
         else {
             LOG(ERROR) << "PortAgent::addObservatoryDataListenerFD: unknown observatory type: " << connectionType;
@@ -1339,28 +1971,15 @@ void PortAgent::addObservatoryStandardDataListenerFD(int &maxFD, fd_set &readFDs
 }
 
 /******************************************************************************
- * Method: addObservatoryMultiDataListenerFDs
- * Description: Iterate through the listeners, adding their fds to the fd_set.
- * Also update the max file descriptor.
+ * Method: addObservatoryMultiDataFDs
+ * Description: Add the listener and client fds of every observatory data
+ * socket to the fd_set.  Also update the max file descriptor.
  *
  * If the connection isn't initialized then do nothing.
  ******************************************************************************/
-void PortAgent::addObservatoryMultiDataListenerFDs(int &maxFD, fd_set &readFDs) {
-    TCPCommListener* pListener = 0;
-
+void PortAgent::addObservatoryMultiDataFDs(int &maxFD, fd_set &readFDs) {
     if (m_pObservatoryConnection) {
-        pListener = ObservatoryDataSockets::instance()->getFirstSocket();
-        while (pListener) {
-            if (pListener->listening()) {
-                int fd = pListener->serverFD();
-                if (fd) {
-                    LOG(DEBUG2) << "adding observatory multi data listener FD: " << fd;
-                    maxFD = fd > maxFD ? fd : maxFD;
-                    FD_SET(fd, &readFDs);
-                }
-            }
-            pListener = ObservatoryDataSockets::instance()->getNextSocket();
-        }
+        ((ObservatoryMultiConnection*)m_pObservatoryConnection)->dataSockets().addFDs(maxFD, readFDs);
     }
 }
 
@@ -1381,7 +2000,7 @@ void PortAgent::addObservatoryDataClientFD(int &maxFD, fd_set &readFDs) {
             addObservatoryStandardDataClientFD(maxFD, readFDs);
         }
         else if (PACONN_OBSERVATORY_MULTI == connectionType) {
-            addObservatoryMultiDataClientFDs(maxFD, readFDs);
+            // Added with the listeners, see addObservatoryMultiDataFDs
         }
         else {
             LOG(ERROR) << "PortAgent::addObservatoryDataClientFD: unknown observatory type: " << connectionType;
@@ -1416,32 +2035,6 @@ void PortAgent::addObservatoryStandardDataClientFD(int &maxFD, fd_set &readFDs)
     }
 }
 
-/******************************************************************************
- * Method: addObservatoryMultiDataClientFD
- * Description: Iterate through the connections, adding their fds to the fd_set.
- * Also update the max file descriptor.
- *
- * If the connection isn't initialized then do nothing.
- ******************************************************************************/
-void PortAgent::addObservatoryMultiDataClientFDs(int &maxFD, fd_set &readFDs) {
-    TCPCommListener* pListener = 0;
-    
-    if (m_pObservatoryConnection) {
-        pListener = ObservatoryDataSockets::instance()->getFirstSocket();
-        while (pListener) {
-            if (pListener->connected()) {
-                int fd = pListener->clientFD();
-                if (fd) {
-                    LOG(DEBUG2) << "adding observatory multi data client FD: " << fd;
-                    maxFD = fd > maxFD ? fd : maxFD;
-                    FD_SET(fd, &readFDs);
-                }
-            }
-            pListener = ObservatoryDataSockets::instance()->getNextSocket();
-        }
-    }
-}
-
 /******************************************************************************
  * Method: addInstrumentDataClientFD
  * Description: Add the instrument client fd to the fd_set.  Also update
@@ -1606,14 +2199,14 @@ int PortAgent::getInstrumentDataRxClientFD() {
  *              exceeded.
  ******************************************************************************/
 void PortAgent::publishHeartbeat() {
-    Timestamp ts;
-    time_t now = time(NULL);
+    time_t now = Clock::CoarseSeconds();
     
     // if we have specificed a heartbeat interval and we need to send a heartbeat
     if(m_pConfig->heartbeatInterval() && now - m_lLastHeartbeat > m_pConfig->heartbeatInterval() ) {
-        
+        Timestamp ts;
         Packet packet(PORT_AGENT_HEARTBEAT, ts, "", 0);
         LOG(DEBUG) << "Port Agent Heartbeat";
+        EventLog::Write(DEBUG, EVENT_HEARTBEAT);
         publishPacket(&packet);
         m_lLastHeartbeat = now;
     }
@@ -1628,6 +2221,7 @@ void PortAgent::publishFault(const string &msg) {
     Packet packet(PORT_AGENT_FAULT, ts, (char *)(msg.c_str()), msg.length());
 
     LOG(ERROR) << "Port Agent Fault: " << msg;
+    EventLog::Write(ERROR, EVENT_FAULT, msg.length());
     publishPacket(&packet);
 }
 
@@ -1643,6 +2237,59 @@ void PortAgent::publishStatus(const string &msg) {
     publishPacket(&packet);
 }
 
+/******************************************************************************
+ * Method: publishStats
+ * Description: Answer get_stats with a status packet holding a snapshot of
+ * every metric, as JSON or in the binary layout described in metrics.h.
+ ******************************************************************************/
+void PortAgent::publishStats() {
+    Timestamp ts;
+    string stats;
+    
+    sampleGauges();
+    stats = m_pConfig->statsBinary() ? Metrics::Binary() : Metrics::Json();
+    
+    if(stats.length() > 0xffff - HEADER_SIZE) {
+        publishFault("stats snapshot too large for a packet");
+        return;
+    }
+    
+    Packet packet(PORT_AGENT_STATUS, ts, (char *)stats.data(), stats.length());
+    publishPacket(&packet);
+}
+
+/******************************************************************************
+ * Method: sampleGauges
+ * Description: Read the queue depths and drop counts kept by the objects
+ * that own them into gauges.  Done only when a snapshot is taken so nothing
+ * is sampled on the data path.
+ ******************************************************************************/
+void PortAgent::sampleGauges() {
+    Metrics::GetGauge("throttle.buffered_bytes")->set(
+        m_pOutputThrottle ? m_pOutputThrottle->size() : 0);
+    Metrics::GetGauge("rsn.buffered_bytes")->set(
+        m_rsnRawPacketDataBuffer ? m_rsnRawPacketDataBuffer->size() : 0);
+    Metrics::GetGauge("driver.pending_write_bytes")->set(m_sDriverWrite.length());
+    
+    Metrics::GetGauge("subscription.subscribers")->set(
+        m_pSubscriptionHub ? m_pSubscriptionHub->subscribers() : 0);
+    Metrics::GetGauge("subscription.pending_bytes")->set(
+        m_pSubscriptionHub ? m_pSubscriptionHub->pending() : 0);
+    Metrics::GetGauge("subscription.overruns")->set(
+        m_pSubscriptionHub ? m_pSubscriptionHub->overruns() : 0);
+    
+    Metrics::GetGauge("telnet_sniffer.subscribers")->set(
+        m_pTelnetSnifferHub ? m_pTelnetSnifferHub->subscribers() : 0);
+    Metrics::GetGauge("telnet_sniffer.pending_bytes")->set(
+        m_pTelnetSnifferHub ? m_pTelnetSnifferHub->pending() : 0);
+    Metrics::GetGauge("telnet_sniffer.overruns")->set(
+        m_pTelnetSnifferHub ? m_pTelnetSnifferHub->overruns() : 0);
+    Metrics::GetGauge("telnet_sniffer.tee_pending_bytes")->set(
+        m_pStreamTee ? m_pStreamTee->pending() : 0);
+    Metrics::GetGauge("telnet_sniffer.tee_dropped_bytes")->set(
+        m_pStreamTee ? m_pStreamTee->dropped() : 0);
+}
+
 /******************************************************************************
  * Method: publishBreak
  * Description: Generate break command with specified duration and send it to
@@ -1701,7 +2348,8 @@ void PortAgent::publishTimestamp(uint32_t val) {
  ******************************************************************************/
 void PortAgent::publishPacket(Packet *packet) {
     LOG(DEBUG) << "Publish packet.";
-    m_oPublishers.publish(packet);
+    if(m_oPublishers.publish(packet) != PUBLISH_OK)
+        LOG(DEBUG) << "packet publish failed for one or more publishers";
 }
 
 /******************************************************************************
@@ -1710,10 +2358,75 @@ void PortAgent::publishPacket(Packet *packet) {
  ******************************************************************************/
 void PortAgent::publishPacket(char *payload, uint16_t size, PacketType type) {
     Timestamp ts;
+    publishPacket(payload, size, type, ts);
+}
+
+/******************************************************************************
+ * Method: publishPacket
+ * Description: Create a packet with a given timestamp and publish it.
+ ******************************************************************************/
+void PortAgent::publishPacket(char *payload, uint16_t size, PacketType type,
+                              const Timestamp &ts) {
     Packet packet(type, ts, payload, size);
     publishPacket(&packet); 
 }
 
+/******************************************************************************
+ * Method: publishDriverData
+ * Description: Publish a DATA_FROM_DRIVER packet for each driver read this
+ * pass.  The instrument publisher isn't on this route, the data was written
+ * to the instrument when it was read.
+ ******************************************************************************/
+void PortAgent::publishDriverData() {
+    uint32_t offset = 0;
+    
+    for(size_t i = 0; i < m_oDriverCopies.size(); i++) {
+        DriverCopy &copy = m_oDriverCopies[i];
+        publishPacket((char *)m_sDriverCopyData.data() + offset, copy.size,
+                      DATA_FROM_DRIVER, copy.ts);
+        offset += copy.size;
+    }
+    
+    m_oDriverCopies.clear();
+    m_sDriverCopyData.clear();
+}
+
+/******************************************************************************
+ * Method: publishThrottledPackets
+ * Description: Publish all packets the output throttle has ready to send.
+ ******************************************************************************/
+void PortAgent::publishThrottledPackets() {
+    Packet *packet = NULL;
+
+    if(! m_pOutputThrottle)
+        return;
+
+    Timestamp now;
+    while((packet = m_pOutputThrottle->getNextPacket(now)) != NULL) {
+        publishPacket(packet);
+        delete packet;
+        packet = NULL;
+    }
+}
+
+/******************************************************************************
+ * Method: flushOutputThrottle
+ * Description: Publish everything held by the output throttle ignoring the
+ *              latency and rate limits.
+ ******************************************************************************/
+void PortAgent::flushOutputThrottle() {
+    Packet *packet = NULL;
+
+    if(! m_pOutputThrottle)
+        return;
+
+    while((packet = m_pOutputThrottle->flush()) != NULL) {
+        publishPacket(packet);
+        delete packet;
+        packet = NULL;
+    }
+}
+
 /******************************************************************************
  * Method: handleTelnetSnifferAccept
  * Description: Accept connection to the telnet sniffer connection.
@@ -1750,7 +2463,7 @@ void PortAgent::handleTelnetSnifferRead(const fd_set &readFDs) {
         
     if(clientFD && FD_ISSET(clientFD, &readFDs)) {
         LOG(DEBUG) << "Read data from Telnet Sniffer Client FD: " << clientFD;
-        bytesRead = m_pTelnetSnifferConnection->readData(buffer, 1023);
+        bytesRead = readConnection(m_pTelnetSnifferConnection, buffer, 1023);
         buffer[bytesRead] = '\0';
         
         if(bytesRead) {
@@ -1793,7 +2506,7 @@ void PortAgent::handleObservatoryCommandRead(const fd_set &readFDs) {
         
     if(clientFD && FD_ISSET(clientFD, &readFDs)) {
         LOG(DEBUG) << "Read data from Observatory Command Client FD: " << clientFD;
-        bytesRead = ((TCPCommListener*)pConnection)->readData(buffer, 1023);
+        bytesRead = readConnection(pConnection, buffer, 1023);
         buffer[bytesRead] = '\0';
         
         if(bytesRead) {
@@ -1841,28 +2554,24 @@ void PortAgent::handleObservatoryStandardDataAccept(const fd_set &readFDs) {
 }
 
 /******************************************************************************
- * Method: handleObservatoryDataAccept
- * Description: Iterate through the observatory data connections accepting
- * those that are ready.
+ * Method: handleObservatoryMultiDataAccept
+ * Description: Accept connections on the observatory data listeners that are
+ * ready.  See observatoryDataAccept.
  ******************************************************************************/
 void PortAgent::handleObservatoryMultiDataAccept(const fd_set &readFDs) {
-    CommBase *pConnection = 0;
-    int serverFD = 0;
-    
     LOG(DEBUG) << "handleObservatoryMultiDataAccept - checking for new connections";
 
-    // Iterate through the listeners adding the clientFDs
-    pConnection = ObservatoryDataSockets::instance()->getFirstSocket();
-    while (pConnection) {
-        // Accept a new observatory command client
-        serverFD = ((TCPCommListener*)pConnection)->serverFD();
-        if(serverFD && FD_ISSET(serverFD, &readFDs)) {
-            LOG(DEBUG) << "Observatory data listener has new connection request";
-            handleTCPConnect(*((TCPCommListener*)pConnection));
-        }
+    ((ObservatoryMultiConnection*)m_pObservatoryConnection)->dataSockets().acceptReady(readFDs, *this);
+}
 
-        pConnection = ObservatoryDataSockets::instance()->getNextSocket();
-    }
+/******************************************************************************
+ * Method: observatoryDataAccept
+ * Description: Callback for an observatory data listener with a connection
+ * request.
+ ******************************************************************************/
+void PortAgent::observatoryDataAccept(TCPCommListener &listener) {
+    LOG(DEBUG) << "Observatory data listener has new connection request";
+    handleTCPConnect(listener);
 }
 
 /******************************************************************************
@@ -1898,46 +2607,126 @@ void PortAgent::handleObservatoryStandardDataRead(const fd_set &readFDs) {
 
     if(clientFD && FD_ISSET(clientFD, &readFDs)) {
         LOG(DEBUG2) << "Read data from Observatory Data Client FD: " << clientFD;
-        bytesRead = ((TCPCommListener*)pConnection)->readData(buffer, 1023);
+        bytesRead = readConnection(pConnection, buffer, 1023);
         buffer[bytesRead] = '\0';
 
         if(bytesRead) {
             LOG(DEBUG2) << "Bytes read: " << bytesRead;
-            publishPacket(buffer, bytesRead, DATA_FROM_DRIVER);
+            EventLog::Write(INFO, EVENT_DRIVER_READ, bytesRead, clientFD);
+            handleDriverData(buffer, bytesRead);
         }
     }
 }
 
 /******************************************************************************
  * Method: handleObservatoryMultiDataRead
- * Description: Iterate through the observatory data connections reading
- * those that are ready.
+ * Description: Read the observatory data clients that are ready.  See
+ * observatoryDataRead.
  ******************************************************************************/
 void PortAgent::handleObservatoryMultiDataRead(const fd_set &readFDs) {
-    CommBase *pConnection = 0;
+    LOG(DEBUG) << "handleObservatoryDataRead - checking for observatory multi data";
+
+    ((ObservatoryMultiConnection*)m_pObservatoryConnection)->dataSockets().readReady(readFDs, *this);
+}
+
+/******************************************************************************
+ * Method: observatoryDataRead
+ * Description: Callback for an observatory data client with data to read.
+ ******************************************************************************/
+void PortAgent::observatoryDataRead(TCPCommListener &listener) {
+    int clientFD = listener.clientFD();
     int bytesRead = 0;
     char buffer[1024];
 
-    LOG(DEBUG) << "handleObservatoryDataRead - checking for observatory multi data";
+    LOG(DEBUG2) << "Read data from Observatory Data Client FD: " << clientFD;
+    bytesRead = readConnection(&listener, buffer, 1023);
+    buffer[bytesRead] = '\0';
 
-    // Iterate through the listeners checking the clientFDs
-    pConnection = ObservatoryDataSockets::instance()->getFirstSocket();
-    while (pConnection) {
-        int clientFD = ((TCPCommListener*) pConnection)->clientFD();
-        LOG(DEBUG2) << "Observatory Data Client FD: " << clientFD;
+    if(bytesRead) {
+        LOG(DEBUG2) << "Bytes read: " << bytesRead;
+        EventLog::Write(INFO, EVENT_DRIVER_READ, bytesRead, clientFD);
+        handleDriverData(buffer, bytesRead);
+    }
+}
 
-        if (clientFD && FD_ISSET(clientFD, &readFDs)) {
-            LOG(DEBUG2) << "Read data from Observatory Data Client FD: " << clientFD;
-            bytesRead = ((TCPCommListener*)pConnection)->readData(buffer, 1023);
-            buffer[bytesRead] = '\0';
+/******************************************************************************
+ * Method: handleDriverData
+ * Description: Driver data is written to the instrument as soon as it's
+ * read, or collected for one write at the end of the pass when coalescing.
+ * The DATA_FROM_DRIVER packet for the log and other publishers is built
+ * later by publishDriverData, stamped with the time the data was read.
+ ******************************************************************************/
+void PortAgent::handleDriverData(char *buffer, uint32_t size) {
+    DriverCopy copy;
+    copy.size = size;
+    
+    m_pDriverReads->add();
+    m_pDriverBytes->add(size);
+    
+    if(m_pConfig->driverCoalesce())
+        m_sDriverWrite.append(buffer, size);
+    else
+        writeInstrumentData(buffer, size, copy.ts);
+    
+    m_oDriverCopies.push_back(copy);
+    m_sDriverCopyData.append(buffer, size);
+}
 
-            if(bytesRead) {
-                LOG(DEBUG2) << "Bytes read: " << bytesRead;
-                publishPacket(buffer, bytesRead, DATA_FROM_DRIVER);
-            }
+/******************************************************************************
+ * Method: flushDriverData
+ * Description: Write driver data collected while coalescing to the
+ * instrument.
+ ******************************************************************************/
+void PortAgent::flushDriverData() {
+    if(m_sDriverWrite.empty())
+        return;
+    
+    // Everything collected this pass was read after the first copy
+    writeInstrumentData(m_sDriverWrite.data(), m_sDriverWrite.length(),
+                        m_oDriverCopies.front().ts);
+    m_sDriverWrite.clear();
+}
+
+/******************************************************************************
+ * Method: writeInstrumentData
+ * Description: Write driver data to the instrument through the instrument
+ * data publisher.  The write doesn't go through the publisher's dispatch,
+ * so the publisher.instrument_data counters are updated here along with
+ * driver.write_latency_us, the time from reading the data to writing it.
+ * Parameter:
+ *   buffer - driver data
+ *   size - bytes to write
+ *   read - when the oldest byte in the buffer was read from the driver
+ * Return:
+ *   true if all of the data was written
+ ******************************************************************************/
+bool PortAgent::writeInstrumentData(const char *buffer, uint32_t size, Timestamp &read) {
+    InstrumentDataPublisher *publisher =
+        (InstrumentDataPublisher *)m_oPublishers.searchByType(PUBLISHER_INSTRUMENT_DATA);
+    
+    if(! publisher) {
+        LOG(DEBUG) << "no instrument data publisher, driver data not written";
+        return false;
+    }
+    
+    try {
+        if(publisher->writeDriverData(buffer, size)) {
+            double elapsed = read.elapseTime();
+            
+            m_pInstrumentWrites->add();
+            m_pInstrumentWriteBytes->add(size);
+            m_pDriverWriteLatency->record(elapsed > 0 ? (uint64_t)(elapsed * 1000000) : 0);
+            return true;
         }
-        pConnection = ObservatoryDataSockets::instance()->getNextSocket();
+        
+        LOG(DEBUG) << "instrument write failed: " << publisher->result().what();
+    }
+    catch(OOIException &e) {
+        LOG(ERROR) << "instrument write failed: " << e.what();
     }
+    
+    m_pInstrumentWriteErrors->add();
+    return false;
 }
 
 /******************************************************************************
@@ -1947,6 +2736,14 @@ void PortAgent::handleObservatoryMultiDataRead(const fd_set &readFDs) {
 void PortAgent::handleInstrumentDataRead(const fd_set &readFDs) {
     CommBase *pConnection;
 
+    if (m_pInstrumentConnection->connectionType() == PACONN_INSTRUMENT_UDP) {
+        if(m_pInstrumentConnection->dataConnected())
+            handleInstrumentDatagramRead(readFDs);
+        else
+            initializeInstrumentConnection();
+        return;
+    }
+
     if (m_pInstrumentConnection->connectionType() == PACONN_INSTRUMENT_BOTPT) {
         pConnection = ((InstrumentBOTPTConnection*) m_pInstrumentConnection)->dataRxConnectionObject();
     }
@@ -1969,33 +2766,261 @@ void PortAgent::handleInstrumentDataRead(const fd_set &readFDs) {
     LOG(DEBUG2) << "Instrument Data Client FD: " << clientFD;
         
     if(clientFD && FD_ISSET(clientFD, &readFDs)) {
+        Timestamp ts;
+        struct timespec received;
+        
+        if(m_bSnifferSpliced != snifferSpliceAvailable())
+            setSnifferSpliced(! m_bSnifferSpliced);
+        
         read_size = m_pConfig->maxPacketSize();
         LOG(DEBUG) << "Read data from Instrument Data Client FD: " << clientFD << " max packet size: " << read_size;
-        bytesRead = pConnection->readData(buffer, read_size);
+        if(m_bSnifferSpliced)
+            bytesRead = readConnectionSpliced(pConnection, buffer, read_size);
+        else
+            bytesRead = readConnection(pConnection, buffer, read_size);
+        
+        // Use the time the data arrived rather than the time we got to it
+        bool stamped = pConnection->lastReceiveTime(received);
+        if(stamped)
+            ts.setTime(received);
         
         if(bytesRead) {
             LOG(DEBUG2) << "Bytes read: " << bytesRead;
-            if (m_pConfig->instrumentConnectionType() == TYPE_RSN) {
-                m_rsnRawPacketDataBuffer->write(buffer, bytesRead);
-                Packet *packet = NULL;
-                while ((packet = m_rsnRawPacketDataBuffer->getNextPacket()) != NULL) {
-                    if(Logger::GetLogLevel() == MESG) {
-                        LOG(MESG) << "RSN Data Buffer Retrieved Packet:" << endl
-                                  << packet->pretty() << endl;
-                    }
-                    publishPacket(packet);
-                    delete packet;
-                    packet = NULL;
-                }
+            EventLog::Write(INFO, EVENT_INSTRUMENT_READ, bytesRead);
+            TraceLog::Start(bytesRead, stamped ? &received : NULL);
+            publishInstrumentData(buffer, bytesRead, ts);
+            TraceLog::Finish();
+        }
+    }
+}
+
+/******************************************************************************
+ * Method: handleInstrumentDatagramRead
+ * Description: Read every datagram waiting from a UDP instrument with one
+ * system call and publish each one.  Each datagram keeps the time the kernel
+ * received it when kernel timestamps are enabled, otherwise the whole batch
+ * is stamped with the time it was read.  Datagrams larger than the max
+ * packet size are split.
+ ******************************************************************************/
+void PortAgent::handleInstrumentDatagramRead(const fd_set &readFDs) {
+    InstrumentUDPConnection *connection = (InstrumentUDPConnection *)m_pInstrumentConnection;
+    int clientFD = getInstrumentDataRxClientFD();
+
+    if(! clientFD || ! FD_ISSET(clientFD, &readFDs))
+        return;
+
+    IOResult result = connection->readDatagrams();
+    if(result.status == IO_ERROR) {
+        LOG(ERROR) << "instrument datagram read failed: " << result.what();
+        return;
+    }
+
+    DatagramPool &pool = connection->datagrams();
+    uint32_t maxSize = m_pConfig->maxPacketSize();
+    Timestamp now;
+
+    LOG(DEBUG2) << "Datagrams read: " << pool.count();
+
+    for(uint32_t i = 0; i < pool.count(); i++) {
+        char *data = (char *)pool.data(i);
+        uint32_t length = pool.length(i);
+        struct timespec received;
+        Timestamp ts = now;
+
+        if(pool.truncated(i))
+            LOG(WARNING) << "instrument datagram truncated to " << length << " bytes";
+
+        bool stamped = pool.receiveTime(i, received);
+        if(stamped)
+            ts.setTime(received);
+
+        EventLog::Write(INFO, EVENT_INSTRUMENT_READ, length);
+        TraceLog::Start(length, stamped ? &received : NULL);
+
+        for(uint32_t offset = 0; offset < length; offset += maxSize) {
+            uint32_t size = length - offset < maxSize ? length - offset : maxSize;
+            publishInstrumentData(data + offset, size, ts);
+        }
+
+        TraceLog::Finish();
+    }
+}
+
+/******************************************************************************
+ * Method: publishInstrumentData
+ * Description: Publish data read from the instrument, through the RSN packet
+ * buffer or the output throttle when they are in use.
+ ******************************************************************************/
+void PortAgent::publishInstrumentData(char *buffer, uint32_t bytesRead, const Timestamp &ts) {
+    m_pInstrumentReads->add();
+    m_pInstrumentBytes->add(bytesRead);
+    
+    if (m_pConfig->instrumentConnectionType() == TYPE_RSN) {
+        m_rsnRawPacketDataBuffer->write(buffer, bytesRead);
+        Packet *packet = NULL;
+        while ((packet = m_rsnRawPacketDataBuffer->getNextPacket()) != NULL) {
+            if(Logger::GetLogLevel() == MESG) {
+                LOG(MESG) << "RSN Data Buffer Retrieved Packet:" << endl
+                          << packet->pretty() << endl;
             }
-            else {
-                publishPacket(buffer, bytesRead, DATA_FROM_INSTRUMENT);
-                //buffer[bytesRead] = '\0';
+            publishPacket(packet);
+            delete packet;
+            packet = NULL;
+        }
+    }
+    else if (m_pOutputThrottle) {
+        // Never drop data.  If the throttle can't keep up then
+        // publish ahead of the rate limit to make room.
+        if(m_pOutputThrottle->available() < (size_t)bytesRead) {
+            LOG(WARNING) << "output throttle full, publishing ahead of the rate limit";
+            EventLog::Write(WARNING, EVENT_THROTTLE_FULL, bytesRead);
+            while(m_pOutputThrottle->available() < (size_t)bytesRead) {
+                Packet *packet = m_pOutputThrottle->flush();
+                publishPacket(packet);
+                delete packet;
             }
         }
+
+        m_pOutputThrottle->writeData(buffer, bytesRead, ts);
+        publishThrottledPackets();
+    }
+    else {
+        publishPacket(buffer, bytesRead, DATA_FROM_INSTRUMENT, ts);
+    }
+}
+
+/******************************************************************************
+ * Method: handleSubscribers
+ * Description: Accept and drop subscribers, then send them the packets
+ * published since the last pass.
+ ******************************************************************************/
+void PortAgent::handleSubscribers(const fd_set &readFDs, const fd_set &writeFDs) {
+    if(m_pSubscriptionHub) {
+        m_pSubscriptionHub->handle(readFDs, writeFDs);
+        m_pSubscriptionHub->flush();
+    }
+    
+    if(m_pTelnetSnifferHub) {
+        m_pTelnetSnifferHub->handle(readFDs, writeFDs);
+        m_pTelnetSnifferHub->flush();
     }
 }
 
+/******************************************************************************
+ * Method: handleStatsServer
+ * Description: Service monitoring scrapes.  Metrics are rendered at most
+ * once a pass, however many clients are waiting.
+ ******************************************************************************/
+void PortAgent::handleStatsServer(const fd_set &readFDs, const fd_set &writeFDs) {
+    if(! m_pStatsServer)
+        return;
+    
+    m_pStatsServer->handle(readFDs, writeFDs);
+    
+    if(m_pStatsServer->waiting()) {
+        sampleGauges();
+        m_pStatsServer->respond(Metrics::Prometheus());
+    }
+}
+
+/******************************************************************************
+ * Method: flushDatagrams
+ * Description: Send the datagrams published since the last pass with one
+ * system call.
+ ******************************************************************************/
+void PortAgent::flushDatagrams() {
+    if(! m_pDatagramBatch)
+        return;
+    
+    IOResult result = m_pDatagramBatch->flush();
+    if(result.status == IO_ERROR)
+        LOG(DEBUG) << "multicast send failed: " << result.what();
+}
+
+/******************************************************************************
+ * Method: readConnection
+ * Description: Read from a connection that select says is ready.  A closed
+ * connection or a non-blocking read with nothing ready reads zero bytes;
+ * the connection object has already cleaned up after a closed peer.
+ * Parameters:
+ *   pConnection - connection to read
+ *   buffer - where to store the data
+ *   size - max bytes to read
+ * Return:
+ *   bytes read
+ ******************************************************************************/
+uint32_t PortAgent::readConnection(CommBase *pConnection, char *buffer, uint32_t size) {
+    IOResult result = pConnection->receive(buffer, size);
+    
+    if(result.status == IO_ERROR || result.status == IO_NOT_CONNECTED)
+        LOG(ERROR) << "read failed: " << result.what();
+    else if(result.status == IO_CLOSED)
+        LOG(DEBUG) << "connection closed by peer";
+    
+    return result.bytes;
+}
+
+/******************************************************************************
+ * Method: readConnectionSpliced
+ * Description: Read from the instrument and copy the data to the telnet
+ * sniffer client in-kernel.  If the instrument connection can't be spliced
+ * the sniffer goes back to being published to and we do a normal read.
+ ******************************************************************************/
+uint32_t PortAgent::readConnectionSpliced(CommBase *pConnection, char *buffer, uint32_t size) {
+    int sink = m_pTelnetSnifferConnection ? m_pTelnetSnifferConnection->clientFD() : 0;
+    
+    // Don't send one client's backlog to the next
+    if(sink != m_iSnifferSinkFD) {
+        m_pStreamTee->reset();
+        m_iSnifferSinkFD = sink;
+    }
+    
+    IOResult result = m_pStreamTee->receive((CommSocket *)pConnection, buffer, size,
+                                            sink > 0 ? sink : -1);
+    
+    if(result.status == IO_ERROR && ! m_pStreamTee->supported()) {
+        setSnifferSpliced(false);
+        return readConnection(pConnection, buffer, size);
+    }
+    
+    if(result.status == IO_ERROR || result.status == IO_NOT_CONNECTED)
+        LOG(ERROR) << "read failed: " << result.what();
+    else if(result.status == IO_CLOSED)
+        LOG(DEBUG) << "connection closed by peer";
+    
+    return result.bytes;
+}
+
+/******************************************************************************
+ * Method: snifferSpliceAvailable
+ * Description: Can instrument data go to the telnet sniffer in-kernel?  Only
+ * for stream instruments with a single sniffer client, and not with kernel
+ * timestamps which need the data read with recvmsg.
+ ******************************************************************************/
+bool PortAgent::snifferSpliceAvailable() {
+    return m_pStreamTee && m_pStreamTee->supported() && m_pTelnetSnifferConnection &&
+           m_pConfig->telnetSnifferPort() && m_pConfig->telnetSnifferSplice() &&
+           ! m_pConfig->kernelTimestamps() &&
+           m_pConfig->instrumentConnectionType() != TYPE_UDP;
+}
+
+/******************************************************************************
+ * Method: setSnifferSpliced
+ * Description: Switch instrument data between the in-kernel copy and the
+ * sniffer publisher.
+ ******************************************************************************/
+void PortAgent::setSnifferSpliced(bool spliced) {
+    TelnetSnifferPublisher *publisher =
+        (TelnetSnifferPublisher *)m_oPublishers.searchByType(PUBLISHER_TELNET_SNIFFER);
+    
+    LOG(INFO) << "telnet sniffer splice " << (spliced ? "enabled" : "disabled");
+    
+    if(publisher)
+        publisher->setSpliced(spliced);
+    
+    m_bSnifferSpliced = spliced && publisher;
+}
+
 /******************************************************************************
  * Method: getCurrentStateAsString
  * Description: return the current state as a string object
@@ -2024,6 +3049,7 @@ void PortAgent::setState(const PortAgentState &state) {
     if(state != getCurrentState()) {
         const string previousState = getCurrentStateAsString();
     
+        EventLog::Write(INFO, EVENT_STATE_CHANGE, getCurrentState(), state);
         m_oState = state;
 
         LOG(DEBUG) << "***********************************************";
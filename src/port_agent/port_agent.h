@@ -4,14 +4,24 @@
 #include "common/daemon_process.h"
 #include "network/tcp_comm_listener.h"
 #include "network/tcp_comm_socket.h"
+#include "network/subscription_hub.h"
+#include "common/shm_ring.h"
+#include "common/metrics.h"
+#include "network/datagram_batch.h"
+#include "network/stream_tee.h"
+#include "network/stats_server.h"
 #include "connection/connection.h"
+#include "connection/observatory_multi_connection.h"
 #include "config/port_agent_config.h"
 #include "packet/packet.h"
 #include "packet/raw_packet_data_buffer.h"
+#include "packet/output_throttle.h"
 #include "publisher/publisher_list.h"
 
 #include <sys/select.h>
 #include <time.h>
+#include <string>
+#include <vector>
 
 using namespace std;
 using namespace packet;
@@ -34,7 +44,30 @@ namespace port_agent {
         STATE_DISCONNECTED     = 0x00000005,
     } PortAgentState;
     
-    class PortAgent : public DaemonProcess {
+    //////////////////////////////
+    // Binary event log message ids.  Never renumber, old event logs
+    // are decoded with the formats of the agent that wrote them.
+    typedef enum PortAgentEvent
+    {
+        EVENT_STARTUP            = 1,
+        EVENT_STATE_CHANGE       = 2,
+        EVENT_INSTRUMENT_READ    = 3,
+        EVENT_DRIVER_READ        = 4,
+        EVENT_HEARTBEAT          = 5,
+        EVENT_FAULT              = 6,
+        EVENT_THROTTLE_FULL      = 7,
+    } PortAgentEvent;
+    
+    //////////////////////////////
+    // A driver read already written to the instrument but not yet published.
+    // The bytes are held in one buffer in read order.
+    typedef struct DriverCopy
+    {
+        Timestamp ts;
+        uint32_t size;
+    } DriverCopy;
+    
+    class PortAgent : public DaemonProcess, public ObservatoryDataHandler {
         public:
             PortAgent();
             PortAgent(int argc, char *argv[]);
@@ -60,21 +93,23 @@ namespace port_agent {
             
         private:
             void setState(const PortAgentState &state);
+            void initializeMetrics();
             
             int buildFDSet(fd_set &readFDs);
+            bool selectPending(fd_set &readFDs);
             void processPortAgentCommands();
     
             void addObservatoryCommandListenerFD(int &maxFD, fd_set &readFDs);
             void addObservatoryCommandClientFD(int &maxFD, fd_set &readFDs);
             void addObservatoryDataListenerFD(int &maxFD, fd_set &readFDs);
             void addObservatoryStandardDataListenerFD(int &maxFD, fd_set &readFDs);
-            void addObservatoryMultiDataListenerFDs(int &maxFD, fd_set &readFDs);
+            void addObservatoryMultiDataFDs(int &maxFD, fd_set &readFDs);
             void addObservatoryDataClientFD(int &maxFD, fd_set &readFDs);
             void addObservatoryStandardDataClientFD(int &maxFD, fd_set &readFDs);
-            void addObservatoryMultiDataClientFDs(int &maxFD, fd_set &readFDs);
             void addInstrumentDataClientFD(int &maxFD, fd_set &readFDs);
             void addTelnetSnifferListenerFD(int &maxFD, fd_set &readFDs);
             void addTelnetSnifferClientFD(int &maxFD, fd_set &readFDs);
+            void addSubscriberFDs(int &maxFD, fd_set &readFDs, fd_set &writeFDs);
             
             int getObservatoryCommandListenerFD();
             int getObservatoryCommandClientFD();
@@ -93,7 +128,12 @@ namespace port_agent {
             void initializeRSNInstrumentConnection();
             void initialize_BOTPT_InstrumentConnection();
             void initializeSerialInstrumentConnection();
+            void initializeUDPInstrumentConnection();
             bool initializeSerialSettings();
+            void initializeOutputThrottle();
+            void initializeStatsServer();
+            void initializeTrace();
+            void initializeReceiveTimestamps();
             
             // Publisher initializers
             void initializePublishers();
@@ -105,6 +145,9 @@ namespace port_agent {
             void initializePublisherInstrumentData();    
             void initializePublisherInstrumentCommand();    
             void initializePublisherTelnetSniffer();    
+            void initializePublisherTelnetSnifferHub();
+            void initializePublisherSubscription();
+            void initializePublisherShm();
             void initializePublisherTCP();    
             void initializePublisherUDP();    
             
@@ -114,6 +157,8 @@ namespace port_agent {
             void handleStateConfigured(const fd_set &readFDs);
             void handleStateConnected(const fd_set &readFDs);
             void handleStateDisconnected(const fd_set &readFDs);
+            void handlePriority(const fd_set &readFDs);
+            void handleBulkData(const fd_set &readFDs);
             void handleCommon(const fd_set &readFDs);
             void handleStateUnknown();
             
@@ -131,15 +176,35 @@ namespace port_agent {
             void handleObservatoryDataRead(const fd_set &readFDs);
             void handleObservatoryStandardDataRead(const fd_set &readFDs);
             void handleObservatoryMultiDataRead(const fd_set &readFDs);
+            void observatoryDataAccept(TCPCommListener &listener);
+            void observatoryDataRead(TCPCommListener &listener);
+            void handleDriverData(char *buffer, uint32_t size);
+            void flushDriverData();
+            bool writeInstrumentData(const char *buffer, uint32_t size, Timestamp &read);
             void handleInstrumentDataRead(const fd_set &readFDs);
+            void handleInstrumentDatagramRead(const fd_set &readFDs);
+            void handleSubscribers(const fd_set &readFDs, const fd_set &writeFDs);
+            void handleStatsServer(const fd_set &readFDs, const fd_set &writeFDs);
+            void flushDatagrams();
+            uint32_t readConnection(CommBase *pConnection, char *buffer, uint32_t size);
+            uint32_t readConnectionSpliced(CommBase *pConnection, char *buffer, uint32_t size);
+            bool snifferSpliceAvailable();
+            void setSnifferSpliced(bool spliced);
             
             void publishHeartbeat();
             void publishFault(const string &msg);
             void publishStatus(const string &msg);
+            void publishStats();
+            void sampleGauges();
             void publishBreak(uint32_t iDuration);
             void publishTimestamp(uint32_t val);
             void publishPacket(Packet *packet);
             void publishPacket(char *payload, uint16_t size, PacketType type);
+            void publishPacket(char *payload, uint16_t size, PacketType type, const Timestamp &ts);
+            void publishInstrumentData(char *buffer, uint32_t bytesRead, const Timestamp &ts);
+            void publishDriverData();
+            void publishThrottledPackets();
+            void flushOutputThrottle();
 
             void displayVersion();
             void setRotationInterval();
@@ -158,6 +223,7 @@ namespace port_agent {
             time_t m_lLastHeartbeat;
             
             RawPacketDataBuffer *m_rsnRawPacketDataBuffer;
+            OutputThrottle *m_pOutputThrottle;
 
             // Port agent connections
             Connection *m_pObservatoryConnection;
@@ -165,6 +231,39 @@ namespace port_agent {
 
             // Publisher Connections
             TCPCommListener *m_pTelnetSnifferConnection;
+            SubscriptionHub *m_pTelnetSnifferHub;
+            SubscriptionHub *m_pSubscriptionHub;
+            ShmRing *m_pShmRing;
+            DatagramBatch *m_pDatagramBatch;
+            
+            // In-kernel copy of instrument data to the telnet sniffer
+            StreamTee *m_pStreamTee;
+            bool m_bSnifferSpliced;
+            int m_iSnifferSinkFD;
+            
+            // Driver data waiting to be written to the instrument when
+            // coalescing, and copies waiting to be published
+            string m_sDriverWrite;
+            string m_sDriverCopyData;
+            vector<DriverCopy> m_oDriverCopies;
+            
+            // Local HTTP endpoint for monitoring scrapes
+            StatsServer *m_pStatsServer;
+            
+            // Event loop metrics, see initializeMetrics
+            metrics::Counter *m_pInstrumentReads;
+            metrics::Counter *m_pInstrumentBytes;
+            metrics::Counter *m_pDriverReads;
+            metrics::Counter *m_pDriverBytes;
+            metrics::Counter *m_pLoopIterations;
+            metrics::Histogram *m_pLoopBusy;
+            
+            // Driver writes to the instrument skip the instrument data
+            // publisher's dispatch, so they are counted here
+            metrics::Counter *m_pInstrumentWrites;
+            metrics::Counter *m_pInstrumentWriteBytes;
+            metrics::Counter *m_pInstrumentWriteErrors;
+            metrics::Histogram *m_pDriverWriteLatency;
             
     };
 }
@@ -0,0 +1,476 @@
+/*******************************************************************************
+ * Filename: port_agent_bench.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Microbenchmarks for the primitives every instrument read goes through:
+ * packet construction and checksums, the circular buffer, RSN packet
+ * parsing, single character buffering, timestamp formatting and publisher
+ * fan-out.  Nothing touches the network so results are repeatable offline.
+ *
+ * Each benchmark is calibrated to run for at least the minimum time, then
+ * repeated and the median taken.  Results go to stdout as JSON laid out like
+ * Google Benchmark output, so its compare tools can diff two runs; progress
+ * goes to stderr.
+ *
+ * Usage:
+ *
+ *   make bench                               # writes bench.json
+ *   make bench BENCH_FLAGS="-f packet -r 9"
+ *
+ *   port_agent_bench [-f filter] [-t min_seconds] [-r repetitions] [-l]
+ *
+ *   -f  only run benchmarks whose name contains filter
+ *   -t  minimum time for each repetition, default 0.2 seconds
+ *   -r  repetitions, default 5
+ *   -l  list the benchmarks and exit
+ *
+ ******************************************************************************/
+
+#include "version.h"
+#include "common/logger.h"
+#include "common/circular_buffer.h"
+#include "common/timestamp.h"
+#include "port_agent/config/port_agent_config.h"
+#include "port_agent/packet/packet.h"
+#include "port_agent/packet/buffered_single_char.h"
+#include "port_agent/packet/raw_packet_data_buffer.h"
+#include "port_agent/publisher/publisher_list.h"
+#include "port_agent/publisher/subscription_publisher.h"
+#include "network/subscription_hub.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace logger;
+using namespace packet;
+using namespace publisher;
+using namespace network;
+
+#define BENCH_MIN_TIME      0.2
+#define BENCH_REPETITIONS   5
+#define BENCH_MAX_ITERATIONS 1000000000ULL
+
+// Benchmarks add results here so the work can't be optimized away
+static volatile uint64_t g_sink = 0;
+
+// Run the benchmark body iterations times, returning the bytes processed
+typedef uint64_t (*BenchFunction)(uint64_t iterations, uint32_t arg);
+
+typedef struct Benchmark {
+    const char *name;
+    BenchFunction function;
+    uint32_t arg;
+} Benchmark;
+
+typedef struct BenchResult {
+    uint64_t iterations;
+    double realTime;        // median ns per iteration
+    double cpuTime;         // median cpu ns per iteration
+    double minRealTime;     // fastest repetition, ns per iteration
+    double bytesPerSecond;  // at the median
+} BenchResult;
+
+/******************************************************************************
+ *   HELPERS
+ ******************************************************************************/
+
+static double elapsed(clockid_t clock, const struct timespec &start) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (now.tv_sec - start.tv_sec) * 1e9 + (now.tv_nsec - start.tv_nsec);
+}
+
+// Payload bytes shared by the benchmarks, never contains a sync byte
+static const char * payloadData() {
+    static char data[MAX_PACKET_SIZE];
+    static bool initialized = false;
+
+    if(!initialized) {
+        for(size_t i = 0; i < sizeof(data); i++)
+            data[i] = 0x20 + (i % 0x5f);
+        initialized = true;
+    }
+
+    return data;
+}
+
+// Packet that exposes the checksum calculation
+class BenchPacket : public Packet {
+    public:
+        BenchPacket(uint16_t size)
+            : Packet(DATA_FROM_INSTRUMENT, Timestamp(), (char *)payloadData(), size) {}
+        uint16_t checksumNow() { return calculateChecksum(); }
+};
+
+/******************************************************************************
+ *   BENCHMARKS
+ ******************************************************************************/
+
+/* Build a data packet, which copies the payload and checksums it */
+static uint64_t benchPacketConstruct(uint64_t iterations, uint32_t size) {
+    Timestamp ts;
+
+    for(uint64_t i = 0; i < iterations; i++) {
+        Packet packet(DATA_FROM_INSTRUMENT, ts, (char *)payloadData(), size);
+        g_sink += packet.checksum();
+    }
+
+    return iterations * size;
+}
+
+/* Checksum an existing packet */
+static uint64_t benchPacketChecksum(uint64_t iterations, uint32_t size) {
+    BenchPacket packet(size);
+
+    for(uint64_t i = 0; i < iterations; i++)
+        g_sink += packet.checksumNow();
+
+    return iterations * (size + HEADER_SIZE);
+}
+
+/* Write then read a chunk.  The capacity isn't a multiple of the chunk so
+   the indexes keep crossing the wrap boundary. */
+static uint64_t benchCircularWriteRead(uint64_t iterations, uint32_t chunk) {
+    CircularBuffer buffer(65536);
+    vector<char> data(chunk);
+
+    for(uint64_t i = 0; i < iterations; i++) {
+        buffer.write(payloadData(), chunk);
+        g_sink += buffer.read(&data[0], chunk);
+    }
+
+    return iterations * chunk;
+}
+
+/* Write, peek, then discard a chunk, the way packets are parsed */
+static uint64_t benchCircularPeek(uint64_t iterations, uint32_t chunk) {
+    CircularBuffer buffer(65536);
+    vector<char> data(chunk);
+
+    for(uint64_t i = 0; i < iterations; i++) {
+        buffer.write(payloadData(), chunk);
+        g_sink += buffer.peek(&data[0], chunk);
+        buffer.reset_peek();
+        buffer.discard(chunk);
+    }
+
+    return iterations * chunk;
+}
+
+/* RSN packet streams, 64 packets of 256 bytes per iteration */
+enum { RSN_CLEAN, RSN_FRAGMENTED, RSN_GARBAGE };
+
+static uint64_t benchRawPacketDataBuffer(uint64_t iterations, uint32_t mode) {
+    RawPacketDataBuffer buffer(65536, MAX_PACKET_SIZE, MAX_PACKET_SIZE);
+    Timestamp ts;
+    string stream;
+    uint32_t seed = 1;
+
+    for(int i = 0; i < 64; i++) {
+        // Junk between packets never contains the first sync byte, so the
+        // buffer resyncs on the next packet.
+        if(mode == RSN_GARBAGE) {
+            for(int j = 0; j < 13; j++) {
+                seed = seed * 1103515245 + 12345;
+                char junk = (char)(seed >> 16);
+                stream += junk == (char)0xA3 ? (char)0 : junk;
+            }
+        }
+
+        Packet packet(DATA_FROM_INSTRUMENT, ts, (char *)payloadData(), 256);
+        stream.append(packet.packet(), packet.packetSize());
+    }
+
+    size_t fragment = mode == RSN_FRAGMENTED ? 37 : stream.length();
+
+    for(uint64_t i = 0; i < iterations; i++) {
+        for(size_t offset = 0; offset < stream.length(); offset += fragment) {
+            size_t bytes = min(fragment, stream.length() - offset);
+            buffer.writeRawData(stream.data() + offset, bytes);
+
+            Packet *packet;
+            while((packet = buffer.getNextPacket()) != NULL) {
+                g_sink += packet->packetSize();
+                delete packet;
+            }
+        }
+    }
+
+    return iterations * stream.length();
+}
+
+/* Buffer a line a character at a time until the sentinel completes it */
+static uint64_t benchBufferedSingleCharAdd(uint64_t iterations, uint32_t length) {
+    string line(payloadData(), length - 2);
+    line += "\r\n";
+
+    for(uint64_t i = 0; i < iterations; i++) {
+        BufferedSingleCharPacket packet(DATA_FROM_INSTRUMENT, 1024, 0, "\r\n", 2);
+
+        for(size_t c = 0; c < line.length(); c++) {
+            packet.add(line[c]);
+            if(packet.readyToSend())
+                break;
+        }
+
+        g_sink += packet.packetSize();
+    }
+
+    return iterations * length;
+}
+
+/* Timestamp formats used by ascii packets and logs */
+enum { TS_FORMAT_NUMBER, TS_FORMAT_HEX, TS_FORMAT_STRING, TS_AS_STRING };
+
+static uint64_t benchTimestampFormat(uint64_t iterations, uint32_t format) {
+    Timestamp ts;
+    char buffer[64];
+
+    for(uint64_t i = 0; i < iterations; i++) {
+        ts.setTime(ts.seconds(), (uint32_t)i);
+
+        switch(format) {
+            case TS_FORMAT_NUMBER: g_sink += ts.formatNumber(buffer, sizeof(buffer)); break;
+            case TS_FORMAT_HEX:    g_sink += ts.formatHex(buffer, sizeof(buffer)); break;
+            case TS_FORMAT_STRING: g_sink += ts.formatString(buffer, sizeof(buffer)); break;
+            default:               g_sink += ts.asString().length(); break;
+        }
+    }
+
+    return 0;
+}
+
+/* Publish a 1k data packet to several publishers.  Each publisher feeds a
+   subscription hub with no subscribers, which drops the packet, so this
+   measures the list and dispatch overhead rather than any I/O. */
+static uint64_t benchPublisherListPublish(uint64_t iterations, uint32_t count) {
+    PublisherList list;
+    vector<SubscriptionHub *> hubs;
+    Packet packet(DATA_FROM_INSTRUMENT, Timestamp(), (char *)payloadData(), 1024);
+
+    // The list keeps copies of the publishers
+    for(uint32_t i = 0; i < count; i++) {
+        hubs.push_back(new SubscriptionHub());
+        SubscriptionPublisher publisher(hubs.back());
+        list.add(&publisher);
+    }
+
+    for(uint64_t i = 0; i < iterations; i++)
+        g_sink += list.publish(&packet);
+
+    for(uint32_t i = 0; i < count; i++)
+        delete hubs[i];
+
+    return iterations * count * packet.packetSize();
+}
+
+static const Benchmark benchmarks[] = {
+    { "packet/construct/16",                    benchPacketConstruct,       16 },
+    { "packet/construct/1024",                  benchPacketConstruct,       1024 },
+    { "packet/construct/4096",                  benchPacketConstruct,       4096 },
+    { "packet/checksum/1024",                   benchPacketChecksum,        1024 },
+    { "packet/checksum/4096",                   benchPacketChecksum,        4096 },
+    { "circular_buffer/write_read/64",          benchCircularWriteRead,     64 },
+    { "circular_buffer/write_read/1000",        benchCircularWriteRead,     1000 },
+    { "circular_buffer/write_read/4000",        benchCircularWriteRead,     4000 },
+    { "circular_buffer/peek/1000",              benchCircularPeek,          1000 },
+    { "raw_packet_data_buffer/clean",           benchRawPacketDataBuffer,   RSN_CLEAN },
+    { "raw_packet_data_buffer/fragmented",      benchRawPacketDataBuffer,   RSN_FRAGMENTED },
+    { "raw_packet_data_buffer/garbage",         benchRawPacketDataBuffer,   RSN_GARBAGE },
+    { "buffered_single_char/add/80",            benchBufferedSingleCharAdd, 80 },
+    { "timestamp/format_number",                benchTimestampFormat,       TS_FORMAT_NUMBER },
+    { "timestamp/format_hex",                   benchTimestampFormat,       TS_FORMAT_HEX },
+    { "timestamp/format_string",                benchTimestampFormat,       TS_FORMAT_STRING },
+    { "timestamp/as_string",                    benchTimestampFormat,       TS_AS_STRING },
+    { "publisher_list/publish/1",               benchPublisherListPublish,  1 },
+    { "publisher_list/publish/4",               benchPublisherListPublish,  4 },
+    { "publisher_list/publish/8",               benchPublisherListPublish,  8 },
+};
+
+/******************************************************************************
+ *   RUNNER
+ ******************************************************************************/
+
+/* One timed run, times are in ns for the whole run */
+static uint64_t runOnce(const Benchmark &bench, uint64_t iterations,
+                        double &realTime, double &cpuTime) {
+    struct timespec realStart, cpuStart;
+    uint64_t bytes;
+
+    clock_gettime(CLOCK_MONOTONIC, &realStart);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuStart);
+
+    bytes = bench.function(iterations, bench.arg);
+
+    cpuTime = elapsed(CLOCK_PROCESS_CPUTIME_ID, cpuStart);
+    realTime = elapsed(CLOCK_MONOTONIC, realStart);
+    return bytes;
+}
+
+static double median(vector<double> values) {
+    sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
+
+/* Find an iteration count that runs for the minimum time, then repeat */
+static BenchResult run(const Benchmark &bench, double minTime, int repetitions) {
+    BenchResult result;
+    vector<double> real, cpu;
+    double realTime, cpuTime;
+    uint64_t iterations = 1, bytes = 0;
+
+    while(true) {
+        runOnce(bench, iterations, realTime, cpuTime);
+        if(realTime >= minTime * 1e9 || iterations >= BENCH_MAX_ITERATIONS)
+            break;
+
+        // Aim a little past the minimum, growing at most 10x at a time
+        double scale = realTime > 0 ? minTime * 1e9 * 1.4 / realTime : 10;
+        iterations = (uint64_t)(iterations * min(max(scale, 2.0), 10.0));
+        iterations = min(iterations, (uint64_t)BENCH_MAX_ITERATIONS);
+    }
+
+    for(int i = 0; i < repetitions; i++) {
+        bytes = runOnce(bench, iterations, realTime, cpuTime);
+        real.push_back(realTime / iterations);
+        cpu.push_back(cpuTime / iterations);
+    }
+
+    result.iterations = iterations;
+    result.realTime = median(real);
+    result.cpuTime = median(cpu);
+    result.minRealTime = *min_element(real.begin(), real.end());
+    result.bytesPerSecond = result.realTime > 0 ? bytes / iterations * 1e9 / result.realTime : 0;
+    return result;
+}
+
+static string jsonContext(double minTime, int repetitions) {
+    ostringstream out;
+    char host[256] = "";
+    char date[64] = "";
+    time_t now = time(NULL);
+
+    gethostname(host, sizeof(host) - 1);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    out << "  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"host_name\": \"" << host << "\",\n"
+        << "    \"executable\": \"port_agent_bench\",\n"
+        << "    \"version\": \"" << PORT_AGENT_VERSION << "\",\n"
+        << "    \"num_cpus\": " << sysconf(_SC_NPROCESSORS_ONLN) << ",\n"
+#ifdef __VERSION__
+        << "    \"compiler\": \"" << __VERSION__ << "\",\n"
+#endif
+#ifdef NDEBUG
+        << "    \"library_build_type\": \"release\",\n"
+#else
+        << "    \"library_build_type\": \"debug\",\n"
+#endif
+        << "    \"min_time\": " << minTime << ",\n"
+        << "    \"repetitions\": " << repetitions << "\n"
+        << "  },\n";
+
+    return out.str();
+}
+
+static string jsonResult(const Benchmark &bench, const BenchResult &result, int repetitions) {
+    ostringstream out;
+
+    out.setf(ios::fixed);
+    out.precision(3);
+
+    out << "    {\n"
+        << "      \"name\": \"" << bench.name << "\",\n"
+        << "      \"run_name\": \"" << bench.name << "\",\n"
+        << "      \"run_type\": \"aggregate\",\n"
+        << "      \"aggregate_name\": \"median\",\n"
+        << "      \"repetitions\": " << repetitions << ",\n"
+        << "      \"iterations\": " << result.iterations << ",\n"
+        << "      \"real_time\": " << result.realTime << ",\n"
+        << "      \"cpu_time\": " << result.cpuTime << ",\n"
+        << "      \"min_real_time\": " << result.minRealTime << ",\n"
+        << "      \"time_unit\": \"ns\"";
+
+    if(result.bytesPerSecond > 0)
+        out << ",\n      \"bytes_per_second\": " << result.bytesPerSecond;
+
+    out << "\n    }";
+    return out.str();
+}
+
+static void usage(const char *program) {
+    cerr << "usage: " << program << " [-f filter] [-t min_seconds] [-r repetitions] [-l]" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    string filter;
+    double minTime = BENCH_MIN_TIME;
+    int repetitions = BENCH_REPETITIONS;
+    bool list = false;
+    bool first = true;
+    int opt;
+
+    // Keep logging out of the measurements
+    Logger::SetLogFile("/dev/null");
+    Logger::SetLogLevel("ERROR");
+
+    while((opt = getopt(argc, argv, "f:t:r:lh")) != -1) {
+        switch(opt) {
+            case 'f': filter = optarg; break;
+            case 't': minTime = atof(optarg); break;
+            case 'r': repetitions = atoi(optarg); break;
+            case 'l': list = true; break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if(minTime <= 0 || repetitions <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    size_t count = sizeof(benchmarks) / sizeof(Benchmark);
+
+    if(list) {
+        for(size_t i = 0; i < count; i++)
+            cout << benchmarks[i].name << endl;
+        return EXIT_SUCCESS;
+    }
+
+    cout << "{\n" << jsonContext(minTime, repetitions) << "  \"benchmarks\": [\n";
+
+    for(size_t i = 0; i < count; i++) {
+        const Benchmark &bench = benchmarks[i];
+
+        if(filter.length() && string(bench.name).find(filter) == string::npos)
+            continue;
+
+        BenchResult result = run(bench, minTime, repetitions);
+
+        fprintf(stderr, "%-40s %12.1f ns %12.1f ns cpu %12llu iterations\n",
+                bench.name, result.realTime, result.cpuTime,
+                (unsigned long long)result.iterations);
+
+        cout << (first ? "" : ",\n") << jsonResult(bench, result, repetitions);
+        first = false;
+    }
+
+    cout << "\n  ]\n}" << endl;
+    return EXIT_SUCCESS;
+}
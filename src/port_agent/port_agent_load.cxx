@@ -0,0 +1,1077 @@
+/*******************************************************************************
+ * Filename: port_agent_load.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * End-to-end load harness.  Runs the real port agent binary against an
+ * instrument simulator and a number of observatory data clients, all on
+ * loopback, and reports sustained throughput, port agent CPU and end-to-end
+ * latency for each payload size and client count.
+ *
+ * The simulator is a TCP instrument, a UDP instrument, an RSN instrument
+ * (TCP data and command ports with the data framed as port agent packets)
+ * or a serial instrument on a pseudo terminal.  It sends fixed size records
+ * as fast as the port agent takes them, or at a fixed record rate.  Each
+ * record starts with a magic number, a sequence number and the monotonic
+ * time it was sent:
+ *
+ *   magic            32 bits
+ *   sequence         32 bits
+ *   send time        64 bits, CLOCK_MONOTONIC nanoseconds
+ *   fill             record size - 16 bytes
+ *
+ * Clients parse the port agent packets, put the instrument data back
+ * together into records and record the time from send to receive.  Each
+ * client has its own data port, or with -S they all subscribe to the
+ * subscription hub.  Latency is only recorded inside the measurement window,
+ * after the warmup.  Loss compares the records every client should have
+ * seen with the records they got once the port agent has drained.
+ *
+ * The port agent is restarted for every run in a scratch directory which
+ * holds its config, log, pid and data files; the data file is written as
+ * usual so its cost is part of the measurement.  CPU is the port agent
+ * process only, from /proc.
+ *
+ * Results go to stdout as JSON, a table of runs goes to stderr.
+ *
+ * Usage:
+ *
+ *   make load                                # writes load.json
+ *   make load LOAD_FLAGS="-m udp -r 20000 -s 64,1024 -n 1,8"
+ *
+ *   port_agent_load [-m tcp|udp|rsn|serial] [-s sizes] [-n clients]
+ *                   [-d seconds] [-w seconds] [-r rate] [-S]
+ *                   [-a port_agent] [-p port] [-D dir]
+ *
+ *   -m  instrument simulator, default tcp
+ *   -s  comma separated record sizes in bytes, default 64,512,4000
+ *   -n  comma separated client counts, default 1,4
+ *   -d  measurement time for each run, default 5 seconds
+ *   -w  warmup before measuring, default 1 second
+ *   -r  records per second, default 0 for as fast as possible
+ *   -S  clients subscribe to the subscription hub instead of data ports
+ *   -a  port agent binary, default ./port_agent
+ *   -p  first port to use, default 9200
+ *   -D  directory to make the scratch directory in, default /tmp
+ *
+ ******************************************************************************/
+
+#include "version.h"
+#include "common/logger.h"
+#include "common/metrics.h"
+#include "common/spawn_process.h"
+#include "common/timestamp.h"
+#include "port_agent/config/port_agent_config.h"
+#include "port_agent/packet/packet.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace logger;
+using namespace metrics;
+using namespace packet;
+
+#define LOAD_MAGIC              0x44414f4c  // "LOAD"
+#define LOAD_RECORD_HEADER      16
+#define LOAD_MAX_RECORD         (MAX_PACKET_SIZE - 1 - HEADER_SIZE)
+#define LOAD_MAX_CLIENTS        48
+#define LOAD_PORTS_PER_RUN      64
+
+#define LOAD_DURATION           5.0
+#define LOAD_WARMUP             1.0
+#define LOAD_PORT               9200
+#define LOAD_SERIAL_BAUD        115200
+
+#define LOAD_CONNECT_TIMEOUT    10.0
+#define LOAD_SETTLE_TIME        0.5
+#define LOAD_DRAIN_TIMEOUT      5.0
+#define LOAD_DRAIN_IDLE         0.3
+#define LOAD_STOP_TIMEOUT       2.0
+#define LOAD_POLL_MS            100
+#define LOAD_READ_SIZE          65536
+
+typedef enum SimulatorType {
+    SIM_TCP,
+    SIM_UDP,
+    SIM_RSN,
+    SIM_SERIAL
+} SimulatorType;
+
+static const char *SimulatorName[] = { "tcp", "udp", "rsn", "serial" };
+
+typedef struct LoadOptions {
+    SimulatorType simulator;
+    vector<uint32_t> sizes;
+    vector<uint32_t> clients;
+    double duration;
+    double warmup;
+    uint32_t rate;
+    bool subscribe;
+    string agent;
+    uint16_t port;
+    string dir;
+} LoadOptions;
+
+// One observatory data client, counters are written by its thread
+typedef struct LoadClient {
+    int fd;
+    pthread_t thread;
+    struct LoadRun *run;
+
+    vector<char> packets;       // unparsed port agent packets
+    vector<char> records;       // instrument data not yet a whole record
+
+    uint64_t packetCount;
+    uint64_t recordCount;
+    uint64_t resyncs;
+} LoadClient;
+
+// State shared by the simulator, clients and the main thread
+typedef struct LoadRun {
+    const LoadOptions *options;
+    uint32_t recordSize;
+    uint16_t port;
+
+    // Simulator
+    int listenFD;
+    int commandListenFD;
+    int dataFD;
+    int commandFD;
+    int slaveFD;
+    string devicePath;
+    pthread_t simulator;
+    uint64_t sentRecords;
+
+    // Set by the main thread, halt stops the simulator and stop everything
+    int go;
+    int measuring;
+    int halt;
+    int stop;
+    int failed;
+
+    Histogram *latency;
+    vector<LoadClient *> clients;
+} LoadRun;
+
+typedef struct LoadResult {
+    uint32_t recordSize;
+    uint32_t clients;
+    double seconds;
+    uint64_t sentRecords;
+    uint64_t receivedRecords;
+    uint64_t packets;
+    double sentMBps;            // instrument data into the port agent
+    double deliveredMBps;       // instrument data out to all clients
+    double recordsPerSecond;
+    double packetsPerSecond;
+    double cpuSeconds;
+    double cpuMsPerMB;
+    double lossPercent;
+    uint64_t resyncs;
+    uint64_t latencyCount;
+    double p50, p99, p999, max; // microseconds
+} LoadResult;
+
+/******************************************************************************
+ *   HELPERS
+ ******************************************************************************/
+
+static uint64_t now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sleepFor(double seconds) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - ts.tv_sec) * 1e9);
+    while(nanosleep(&ts, &ts) && errno == EINTR);
+}
+
+static bool isSet(int *flag) {
+    return __atomic_load_n(flag, __ATOMIC_ACQUIRE) != 0;
+}
+
+static void setFlag(int *flag, int value) {
+    __atomic_store_n(flag, value, __ATOMIC_RELEASE);
+}
+
+static uint64_t load64(uint64_t *value) {
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
+}
+
+static void add64(uint64_t *value, uint64_t amount) {
+    __atomic_fetch_add(value, amount, __ATOMIC_RELAXED);
+}
+
+static void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+static bool parseList(const char *arg, vector<uint32_t> &list) {
+    list.clear();
+
+    for(const char *p = arg; *p; ) {
+        char *end;
+        unsigned long value = strtoul(p, &end, 10);
+        if(end == p || !value)
+            return false;
+
+        list.push_back(value);
+        p = *end == ',' ? end + 1 : end;
+        if(*end && *end != ',')
+            return false;
+    }
+
+    return list.size() > 0;
+}
+
+/* Port agent user and system CPU seconds */
+static double processCPU(pid_t pid) {
+    char path[64];
+    char buffer[1024];
+    unsigned long utime = 0, stime = 0;
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE *file = fopen(path, "r");
+    if(!file)
+        return 0;
+
+    size_t length = fread(buffer, 1, sizeof(buffer) - 1, file);
+    fclose(file);
+    buffer[length] = '\0';
+
+    // Skip past the command name, it can contain spaces
+    char *fields = strrchr(buffer, ')');
+    if(!fields || sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                         &utime, &stime) != 2)
+        return 0;
+
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+/* Remove everything a run left in the scratch directory */
+static void cleanDir(const string &dir) {
+    DIR *d = opendir(dir.c_str());
+    struct dirent *entry;
+
+    if(!d)
+        return;
+
+    while((entry = readdir(d)) != NULL) {
+        if(!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+            continue;
+        unlink((dir + "/" + entry->d_name).c_str());
+    }
+
+    closedir(d);
+}
+
+static int listenTCP(uint16_t port) {
+    struct sockaddr_in addr;
+    int on = 1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if(fd < 0)
+        return -1;
+
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, 1)) {
+        close(fd);
+        return -1;
+    }
+
+    setNonBlocking(fd);
+    return fd;
+}
+
+static int connectTCP(uint16_t port) {
+    struct sockaddr_in addr;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if(fd < 0)
+        return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    if(connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        close(fd);
+        return -1;
+    }
+
+    setNonBlocking(fd);
+    return fd;
+}
+
+static int connectUDP(uint16_t port) {
+    struct sockaddr_in addr;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if(fd < 0)
+        return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    if(connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        close(fd);
+        return -1;
+    }
+
+    setNonBlocking(fd);
+    return fd;
+}
+
+/* Wait for a connection on a listener, gives up when the run stops */
+static int acceptTCP(LoadRun *run, int listenFD) {
+    struct pollfd pfd;
+
+    pfd.fd = listenFD;
+    pfd.events = POLLIN;
+
+    while(!isSet(&run->stop)) {
+        if(poll(&pfd, 1, LOAD_POLL_MS) <= 0)
+            continue;
+
+        int fd = accept(listenFD, NULL, NULL);
+        if(fd >= 0) {
+            setNonBlocking(fd);
+            return fd;
+        }
+    }
+
+    return -1;
+}
+
+/* Write all of a buffer, waiting while the port agent catches up.  UDP
+ * datagrams are sent once, a refused datagram is just lost. */
+static bool writeAll(LoadRun *run, int fd, const char *buffer, size_t length) {
+    struct pollfd pfd;
+    size_t written = 0;
+
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+
+    while(written < length) {
+        ssize_t result = write(fd, buffer + written, length - written);
+
+        if(result > 0) {
+            written += result;
+            continue;
+        }
+
+        if(result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            if(isSet(&run->halt) || isSet(&run->stop))
+                return false;
+            poll(&pfd, 1, LOAD_POLL_MS);
+            continue;
+        }
+
+        if(run->options->simulator == SIM_UDP && errno == ECONNREFUSED)
+            return true;
+
+        return false;
+    }
+
+    return true;
+}
+
+/******************************************************************************
+ *   INSTRUMENT SIMULATOR
+ ******************************************************************************/
+
+/* Listeners and the pty are made before the port agent starts */
+static bool simulatorInitialize(LoadRun *run) {
+    uint16_t dataPort = run->port + 1;
+    uint16_t commandPort = run->port + 2;
+
+    switch(run->options->simulator) {
+        case SIM_TCP:
+            run->listenFD = listenTCP(dataPort);
+            return run->listenFD >= 0;
+
+        case SIM_RSN:
+            run->listenFD = listenTCP(dataPort);
+            run->commandListenFD = listenTCP(commandPort);
+            return run->listenFD >= 0 && run->commandListenFD >= 0;
+
+        case SIM_UDP:
+            run->dataFD = connectUDP(dataPort);
+            return run->dataFD >= 0;
+
+        case SIM_SERIAL: {
+            struct termios config;
+
+            run->dataFD = posix_openpt(O_RDWR | O_NOCTTY);
+            if(run->dataFD < 0 || grantpt(run->dataFD) || unlockpt(run->dataFD))
+                return false;
+
+            run->devicePath = ptsname(run->dataFD);
+            setNonBlocking(run->dataFD);
+
+            // Hold the slave open in raw mode so nothing written before the
+            // port agent configures it is echoed or translated, and so the
+            // master doesn't see a hangup between runs.
+            run->slaveFD = open(run->devicePath.c_str(), O_RDWR | O_NOCTTY);
+            if(run->slaveFD < 0)
+                return false;
+
+            fcntl(run->slaveFD, F_SETFD, FD_CLOEXEC);
+            tcgetattr(run->slaveFD, &config);
+            cfmakeraw(&config);
+            tcsetattr(run->slaveFD, TCSANOW, &config);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void simulatorClose(LoadRun *run) {
+    int *fds[] = { &run->listenFD, &run->commandListenFD, &run->dataFD,
+                   &run->commandFD, &run->slaveFD };
+
+    for(size_t i = 0; i < sizeof(fds) / sizeof(int *); i++) {
+        if(*fds[i] >= 0)
+            close(*fds[i]);
+        *fds[i] = -1;
+    }
+}
+
+static void * simulatorThread(void *arg) {
+    LoadRun *run = (LoadRun *)arg;
+    SimulatorType type = run->options->simulator;
+    uint32_t size = run->recordSize;
+    vector<char> record(size);
+    uint32_t sequence = 0;
+    uint64_t start;
+
+    // Stream instruments wait for the port agent to connect
+    if(type == SIM_TCP || type == SIM_RSN) {
+        run->dataFD = acceptTCP(run, run->listenFD);
+        if(type == SIM_RSN && run->dataFD >= 0)
+            run->commandFD = acceptTCP(run, run->commandListenFD);
+
+        if(run->dataFD < 0 || (type == SIM_RSN && run->commandFD < 0)) {
+            if(!isSet(&run->stop))
+                setFlag(&run->failed, 1);
+            return NULL;
+        }
+    }
+
+    while(!isSet(&run->go) && !isSet(&run->stop))
+        sleepFor(0.001);
+
+    for(uint32_t i = LOAD_RECORD_HEADER; i < size; i++)
+        record[i] = 0x20 + (i % 0x5f);
+
+    start = now();
+
+    while(!isSet(&run->halt) && !isSet(&run->stop)) {
+        uint32_t magic = LOAD_MAGIC;
+        uint64_t sent;
+
+        // Hold to the record rate, if there is one
+        if(run->options->rate) {
+            uint64_t due = start + (uint64_t)(sequence * 1e9 / run->options->rate);
+            uint64_t current = now();
+            if(current < due)
+                sleepFor((due - current) / 1e9);
+        }
+
+        sent = now();
+        memcpy(&record[0], &magic, 4);
+        memcpy(&record[4], &sequence, 4);
+        memcpy(&record[8], &sent, 8);
+
+        bool ok;
+        if(type == SIM_RSN) {
+            Packet frame(DATA_FROM_INSTRUMENT, Timestamp(), &record[0], size);
+            ok = writeAll(run, run->dataFD, frame.packet(), frame.packetSize());
+        }
+        else {
+            ok = writeAll(run, run->dataFD, &record[0], size);
+        }
+
+        if(!ok) {
+            if(!isSet(&run->halt) && !isSet(&run->stop))
+                setFlag(&run->failed, 1);
+            break;
+        }
+
+        sequence++;
+        add64(&run->sentRecords, 1);
+    }
+
+    return NULL;
+}
+
+/******************************************************************************
+ *   OBSERVATORY CLIENTS
+ ******************************************************************************/
+
+/* Split instrument data back into records */
+static void clientRecords(LoadClient *client, const char *data, size_t length) {
+    LoadRun *run = client->run;
+    vector<char> &buffer = client->records;
+    uint32_t size = run->recordSize;
+    size_t offset = 0;
+
+    buffer.insert(buffer.end(), data, data + length);
+
+    while(buffer.size() - offset >= size) {
+        uint32_t magic;
+        uint64_t sent;
+
+        memcpy(&magic, &buffer[offset], 4);
+        if(magic != LOAD_MAGIC) {
+            offset++;
+            add64(&client->resyncs, 1);
+            continue;
+        }
+
+        memcpy(&sent, &buffer[offset + 8], 8);
+
+        if(isSet(&run->measuring))
+            run->latency->record(now() - sent);
+
+        add64(&client->recordCount, 1);
+        offset += size;
+    }
+
+    buffer.erase(buffer.begin(), buffer.begin() + offset);
+}
+
+/* Parse port agent packets, anything that isn't instrument data is skipped */
+static void clientPackets(LoadClient *client, const char *data, size_t length) {
+    vector<char> &buffer = client->packets;
+    size_t offset = 0;
+
+    buffer.insert(buffer.end(), data, data + length);
+
+    while(buffer.size() - offset >= (size_t)HEADER_SIZE) {
+        const unsigned char *header = (const unsigned char *)&buffer[offset];
+        uint16_t size;
+
+        if(header[0] != 0xa3 || header[1] != 0x9d || header[2] != 0x7a) {
+            offset++;
+            add64(&client->resyncs, 1);
+            continue;
+        }
+
+        memcpy(&size, header + 4, 2);
+        size = ntohs(size);
+
+        if(size < HEADER_SIZE) {
+            offset++;
+            add64(&client->resyncs, 1);
+            continue;
+        }
+
+        if(buffer.size() - offset < size)
+            break;
+
+        if(header[3] == DATA_FROM_INSTRUMENT) {
+            add64(&client->packetCount, 1);
+            clientRecords(client, &buffer[offset + HEADER_SIZE], size - HEADER_SIZE);
+        }
+
+        offset += size;
+    }
+
+    buffer.erase(buffer.begin(), buffer.begin() + offset);
+}
+
+static void * clientThread(void *arg) {
+    LoadClient *client = (LoadClient *)arg;
+    char buffer[LOAD_READ_SIZE];
+    struct pollfd pfd;
+
+    pfd.fd = client->fd;
+    pfd.events = POLLIN;
+
+    while(!isSet(&client->run->stop)) {
+        if(poll(&pfd, 1, LOAD_POLL_MS) <= 0)
+            continue;
+
+        ssize_t bytes = read(client->fd, buffer, sizeof(buffer));
+        if(bytes > 0)
+            clientPackets(client, buffer, bytes);
+        else if(bytes == 0 || (errno != EAGAIN && errno != EINTR))
+            break;
+    }
+
+    return NULL;
+}
+
+/******************************************************************************
+ *   RUNNER
+ ******************************************************************************/
+
+static string writeConfig(const LoadRun &run, const string &dir, uint32_t clients) {
+    const LoadOptions &options = *run.options;
+    string path = dir + "/port_agent_load.conf";
+    ofstream out(path.c_str());
+
+    out << "instrument_type " << SimulatorName[options.simulator] << endl
+        << "heartbeat_interval 0" << endl
+        << "max_packet_size " << MAX_PACKET_SIZE - 1 << endl
+        << "log_dir " << dir << endl
+        << "pid_dir " << dir << endl
+        << "data_dir " << dir << endl;
+
+    switch(options.simulator) {
+        case SIM_TCP:
+            out << "instrument_addr 127.0.0.1" << endl
+                << "instrument_data_port " << run.port + 1 << endl;
+            break;
+
+        case SIM_RSN:
+            out << "instrument_addr 127.0.0.1" << endl
+                << "instrument_data_port " << run.port + 1 << endl
+                << "instrument_command_port " << run.port + 2 << endl;
+            break;
+
+        case SIM_UDP:
+            out << "instrument_addr 127.0.0.1" << endl
+                << "instrument_data_rx_port " << run.port + 1 << endl
+                << "instrument_data_tx_port " << run.port + 2 << endl;
+            break;
+
+        case SIM_SERIAL:
+            out << "device_path " << run.devicePath << endl
+                << "baud " << LOAD_SERIAL_BAUD << endl;
+            break;
+    }
+
+    // More than one data port needs the multi observatory connection
+    if(options.subscribe || clients == 1) {
+        out << "data_port " << run.port + 10 << endl;
+    }
+    else {
+        out << "observatory_type multi" << endl;
+        for(uint32_t i = 0; i < clients; i++)
+            out << "add_data_port " << run.port + 10 + i << endl;
+    }
+
+    if(options.subscribe)
+        out << "subscriber_port " << run.port + 9 << endl;
+
+    return path;
+}
+
+static void stopAgent(SpawnProcess &agent) {
+    if(!agent.pid())
+        return;
+
+    kill(agent.pid(), SIGTERM);
+
+    uint64_t deadline = now() + (uint64_t)(LOAD_STOP_TIMEOUT * 1e9);
+    while(agent.is_running() && now() < deadline)
+        sleepFor(0.01);
+
+    if(agent.is_running()) {
+        kill(agent.pid(), SIGKILL);
+        waitpid(agent.pid(), NULL, 0);
+    }
+}
+
+static uint64_t clientTotal(LoadRun &run, uint64_t LoadClient::*counter) {
+    uint64_t total = 0;
+
+    for(size_t i = 0; i < run.clients.size(); i++)
+        total += load64(&(run.clients[i]->*counter));
+
+    return total;
+}
+
+/* One agent, one record size, one client count */
+static bool runLoad(const LoadOptions &options, const string &dir, uint16_t port,
+                    uint32_t recordSize, uint32_t clients, LoadResult &result) {
+    LoadRun run;
+    SpawnProcess *agent = NULL;
+    bool joined = false;
+    bool ok = false;
+    string error;
+
+    memset(&result, 0, sizeof(result));
+    result.recordSize = recordSize;
+    result.clients = clients;
+
+    run.options = &options;
+    run.recordSize = recordSize;
+    run.port = port;
+    run.listenFD = run.commandListenFD = run.dataFD = run.commandFD = run.slaveFD = -1;
+    run.sentRecords = 0;
+    run.go = run.measuring = run.halt = run.stop = run.failed = 0;
+    run.latency = new Histogram();
+
+    cleanDir(dir);
+
+    if(!simulatorInitialize(&run)) {
+        error = string("instrument simulator failed to start: ") + strerror(errno);
+        simulatorClose(&run);
+        delete run.latency;
+        cerr << "ERROR: " << error << endl;
+        return false;
+    }
+
+    string config = writeConfig(run, dir, clients);
+    ostringstream out;
+    out << port;
+    string commandPort = out.str();
+
+    char *args[] = { (char *)"-s", (char *)"-p", (char *)commandPort.c_str(),
+                     (char *)"-c", (char *)config.c_str() };
+    agent = new SpawnProcess(options.agent, 5, args);
+    agent->set_output_file(dir + "/port_agent.out");
+
+    pthread_create(&run.simulator, NULL, simulatorThread, &run);
+
+    try {
+        agent->run();
+    }
+    catch(exception &e) {
+        error = "failed to start " + options.agent;
+    }
+
+    // Connect the clients as their ports come up
+    uint64_t deadline = now() + (uint64_t)(LOAD_CONNECT_TIMEOUT * 1e9);
+    for(uint32_t i = 0; i < clients && !error.length(); i++) {
+        uint16_t clientPort = options.subscribe ? port + 9 : port + 10 + i;
+        int fd = -1;
+
+        while((fd = connectTCP(clientPort)) < 0 && now() < deadline && agent->is_running())
+            sleepFor(0.02);
+
+        if(fd < 0) {
+            error = agent->is_running() ? "timed out connecting to the port agent"
+                                        : "port agent exited, see " + dir + "/port_agent.out";
+            break;
+        }
+
+        LoadClient *client = new LoadClient();
+        client->fd = fd;
+        client->run = &run;
+        client->packetCount = client->recordCount = client->resyncs = 0;
+        run.clients.push_back(client);
+        pthread_create(&client->thread, NULL, clientThread, client);
+    }
+
+    if(!error.length()) {
+        double cpuStart, cpuEnd;
+        uint64_t sentStart, recordsStart, packetsStart, timeStart, timeEnd;
+
+        // Let the port agent connect to the instrument before sending
+        sleepFor(LOAD_SETTLE_TIME);
+        setFlag(&run.go, 1);
+        sleepFor(options.warmup);
+
+        cpuStart = processCPU(agent->pid());
+        sentStart = load64(&run.sentRecords);
+        recordsStart = clientTotal(run, &LoadClient::recordCount);
+        packetsStart = clientTotal(run, &LoadClient::packetCount);
+        timeStart = now();
+        setFlag(&run.measuring, 1);
+
+        sleepFor(options.duration);
+
+        setFlag(&run.measuring, 0);
+        timeEnd = now();
+        cpuEnd = processCPU(agent->pid());
+        result.sentRecords = load64(&run.sentRecords) - sentStart;
+        result.receivedRecords = clientTotal(run, &LoadClient::recordCount) - recordsStart;
+        result.packets = clientTotal(run, &LoadClient::packetCount) - packetsStart;
+
+        // Stop sending and let the port agent drain before counting loss
+        setFlag(&run.halt, 1);
+        pthread_join(run.simulator, NULL);
+        joined = true;
+
+        uint64_t sent = load64(&run.sentRecords);
+        uint64_t received = clientTotal(run, &LoadClient::recordCount);
+        uint64_t idle = now(), drainEnd = now() + (uint64_t)(LOAD_DRAIN_TIMEOUT * 1e9);
+
+        while(received < sent * clients && now() < drainEnd &&
+              now() - idle < (uint64_t)(LOAD_DRAIN_IDLE * 1e9)) {
+            sleepFor(0.01);
+            uint64_t current = clientTotal(run, &LoadClient::recordCount);
+            if(current != received)
+                idle = now();
+            received = current;
+        }
+
+        if(isSet(&run.failed))
+            error = "instrument simulator stopped, see " + dir + "/port_agent_" +
+                    commandPort + ".log";
+
+        result.seconds = (timeEnd - timeStart) / 1e9;
+        result.cpuSeconds = cpuEnd - cpuStart;
+        result.sentMBps = result.sentRecords * recordSize / result.seconds / 1e6;
+        result.deliveredMBps = result.receivedRecords * recordSize / result.seconds / 1e6;
+        result.recordsPerSecond = result.sentRecords / result.seconds;
+        result.packetsPerSecond = result.packets / result.seconds;
+        result.cpuMsPerMB = result.sentRecords ?
+            result.cpuSeconds * 1e3 / (result.sentRecords * recordSize / 1e6) : 0;
+        result.lossPercent = sent ? 100.0 * (1.0 - (double)received / (sent * clients)) : 0;
+        result.resyncs = clientTotal(run, &LoadClient::resyncs);
+        result.latencyCount = run.latency->count();
+        result.p50 = run.latency->percentile(50) / 1e3;
+        result.p99 = run.latency->percentile(99) / 1e3;
+        result.p999 = run.latency->percentile(99.9) / 1e3;
+        result.max = run.latency->max() / 1e3;
+
+        ok = !error.length() && result.sentRecords > 0;
+        if(!error.length() && !ok)
+            error = "no records were sent";
+    }
+
+    // Tear down
+    setFlag(&run.stop, 1);
+    stopAgent(*agent);
+
+    if(!joined)
+        pthread_join(run.simulator, NULL);
+
+    for(size_t i = 0; i < run.clients.size(); i++) {
+        pthread_join(run.clients[i]->thread, NULL);
+        close(run.clients[i]->fd);
+        delete run.clients[i];
+    }
+
+    simulatorClose(&run);
+    delete run.latency;
+    delete agent;
+
+    if(error.length())
+        cerr << "ERROR: " << error << endl;
+
+    return ok;
+}
+
+/******************************************************************************
+ *   OUTPUT
+ ******************************************************************************/
+
+static string jsonContext(const LoadOptions &options) {
+    ostringstream out;
+    char host[256] = "";
+    char date[64] = "";
+    time_t now = time(NULL);
+
+    gethostname(host, sizeof(host) - 1);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    out << "  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"host_name\": \"" << host << "\",\n"
+        << "    \"executable\": \"port_agent_load\",\n"
+        << "    \"version\": \"" << PORT_AGENT_VERSION << "\",\n"
+        << "    \"num_cpus\": " << sysconf(_SC_NPROCESSORS_ONLN) << ",\n"
+        << "    \"simulator\": \"" << SimulatorName[options.simulator] << "\",\n"
+        << "    \"clients_via\": \"" << (options.subscribe ? "subscriber_port" : "data_port") << "\",\n"
+        << "    \"rate\": " << options.rate << ",\n"
+        << "    \"duration\": " << options.duration << ",\n"
+        << "    \"warmup\": " << options.warmup << "\n"
+        << "  },\n";
+
+    return out.str();
+}
+
+static string jsonResult(const LoadOptions &options, const LoadResult &result) {
+    ostringstream out;
+
+    out.setf(ios::fixed);
+    out.precision(3);
+
+    out << "    {\n"
+        << "      \"name\": \"load/" << SimulatorName[options.simulator] << "/"
+                                     << result.recordSize << "/" << result.clients << "\",\n"
+        << "      \"record_size\": " << result.recordSize << ",\n"
+        << "      \"clients\": " << result.clients << ",\n"
+        << "      \"seconds\": " << result.seconds << ",\n"
+        << "      \"sent_records\": " << result.sentRecords << ",\n"
+        << "      \"received_records\": " << result.receivedRecords << ",\n"
+        << "      \"sent_mb_per_second\": " << result.sentMBps << ",\n"
+        << "      \"delivered_mb_per_second\": " << result.deliveredMBps << ",\n"
+        << "      \"records_per_second\": " << result.recordsPerSecond << ",\n"
+        << "      \"packets_per_second\": " << result.packetsPerSecond << ",\n"
+        << "      \"agent_cpu_seconds\": " << result.cpuSeconds << ",\n"
+        << "      \"agent_cpu_ms_per_mb\": " << result.cpuMsPerMB << ",\n"
+        << "      \"loss_percent\": " << result.lossPercent << ",\n"
+        << "      \"resyncs\": " << result.resyncs << ",\n"
+        << "      \"latency_samples\": " << result.latencyCount << ",\n"
+        << "      \"latency_p50\": " << result.p50 << ",\n"
+        << "      \"latency_p99\": " << result.p99 << ",\n"
+        << "      \"latency_p999\": " << result.p999 << ",\n"
+        << "      \"latency_max\": " << result.max << ",\n"
+        << "      \"time_unit\": \"us\"\n"
+        << "    }";
+
+    return out.str();
+}
+
+static void usage(const char *program) {
+    cerr << "usage: " << program << " [-m tcp|udp|rsn|serial] [-s sizes] [-n clients]" << endl
+         << "       [-d seconds] [-w seconds] [-r rate] [-S] [-a port_agent] [-p port] [-D dir]" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    LoadOptions options;
+    bool first = true;
+    int failures = 0;
+    int opt;
+
+    options.simulator = SIM_TCP;
+    options.duration = LOAD_DURATION;
+    options.warmup = LOAD_WARMUP;
+    options.rate = 0;
+    options.subscribe = false;
+    options.agent = "./port_agent";
+    options.port = LOAD_PORT;
+    options.dir = "/tmp";
+    parseList("64,512,4000", options.sizes);
+    parseList("1,4", options.clients);
+
+    Logger::SetLogFile("/dev/null");
+    Logger::SetLogLevel("ERROR");
+
+    // A client closed by the port agent shouldn't take the harness with it
+    signal(SIGPIPE, SIG_IGN);
+
+    while((opt = getopt(argc, argv, "m:s:n:d:w:r:Sa:p:D:h")) != -1) {
+        bool valid = true;
+
+        switch(opt) {
+            case 'm':
+                valid = false;
+                for(int i = SIM_TCP; i <= SIM_SERIAL; i++) {
+                    if(!strcmp(optarg, SimulatorName[i])) {
+                        options.simulator = (SimulatorType)i;
+                        valid = true;
+                    }
+                }
+                break;
+            case 's': valid = parseList(optarg, options.sizes); break;
+            case 'n': valid = parseList(optarg, options.clients); break;
+            case 'd': options.duration = atof(optarg); break;
+            case 'w': options.warmup = atof(optarg); break;
+            case 'r': options.rate = atoi(optarg); break;
+            case 'S': options.subscribe = true; break;
+            case 'a': options.agent = optarg; break;
+            case 'p': options.port = atoi(optarg); break;
+            case 'D': options.dir = optarg; break;
+            default: valid = false;
+        }
+
+        if(!valid) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(options.duration <= 0 || options.warmup < 0 || !options.port) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for(size_t i = 0; i < options.sizes.size(); i++) {
+        if(options.sizes[i] < LOAD_RECORD_HEADER || options.sizes[i] > LOAD_MAX_RECORD) {
+            cerr << "record sizes must be from " << LOAD_RECORD_HEADER
+                 << " to " << LOAD_MAX_RECORD << " bytes" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    for(size_t i = 0; i < options.clients.size(); i++) {
+        if(options.clients[i] > LOAD_MAX_CLIENTS) {
+            cerr << "at most " << LOAD_MAX_CLIENTS << " clients" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // The port agent's files for every run go in a scratch directory
+    string pattern = options.dir + "/port_agent_load.XXXXXX";
+    vector<char> dirName(pattern.begin(), pattern.end());
+    dirName.push_back('\0');
+
+    if(!mkdtemp(&dirName[0])) {
+        cerr << "ERROR: can't make a directory in " << options.dir << ": " << strerror(errno) << endl;
+        return EXIT_FAILURE;
+    }
+
+    string dir = &dirName[0];
+
+    fprintf(stderr, "%-6s %6s %7s %10s %10s %11s %11s %9s %7s %9s %9s %9s\n",
+            "sim", "size", "clients", "in MB/s", "out MB/s", "records/s", "packets/s",
+            "cpu ms/MB", "loss %", "p50 us", "p99 us", "p999 us");
+
+    cout << "{\n" << jsonContext(options) << "  \"runs\": [\n";
+
+    uint32_t index = 0;
+    for(size_t s = 0; s < options.sizes.size(); s++) {
+        for(size_t c = 0; c < options.clients.size(); c++, index++) {
+            LoadResult result;
+
+            // Each run gets fresh ports so nothing is left in TIME_WAIT
+            uint16_t port = options.port + (index % 16) * LOAD_PORTS_PER_RUN;
+
+            if(!runLoad(options, dir, port, options.sizes[s], options.clients[c], result)) {
+                failures++;
+                continue;
+            }
+
+            fprintf(stderr, "%-6s %6u %7u %10.2f %10.2f %11.0f %11.0f %9.2f %7.2f %9.1f %9.1f %9.1f\n",
+                    SimulatorName[options.simulator], result.recordSize, result.clients,
+                    result.sentMBps, result.deliveredMBps, result.recordsPerSecond,
+                    result.packetsPerSecond, result.cpuMsPerMB, result.lossPercent,
+                    result.p50, result.p99, result.p999);
+
+            cout << (first ? "" : ",\n") << jsonResult(options, result);
+            first = false;
+        }
+    }
+
+    cout << "\n  ]\n}" << endl;
+
+    cleanDir(dir);
+    rmdir(dir.c_str());
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
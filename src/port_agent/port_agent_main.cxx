@@ -45,6 +45,7 @@ int main(int argc, char *argv[]) {
     
     if(errmsg.length()) {
         LOG(ERROR) << errmsg;
+        Logger::StopAsync();
         cerr << "ERROR: " << errmsg << endl;
         cerr << "USAGE: " << agent->usage() << endl;
         
@@ -45,11 +45,11 @@ DriverCommandPublisher::DriverCommandPublisher() : DriverPublisher() { }
  *
  * Exceptions:
  *    FileDescriptorNULL
- *    PacketPublishFailure
  ******************************************************************************/
 bool DriverCommandPublisher::write(const char *buffer, uint32_t size) {
     if(m_pCommSocket && m_pCommSocket->connected()) 
-        DriverPublisher::write(buffer, size);
-    else
-        LOG(DEBUG) << "Command port not connected, not writing packets";
+        return DriverPublisher::write(buffer, size);
+    
+    LOG(DEBUG) << "Command port not connected, not writing packets";
+    return true;
 }
\ No newline at end of file
@@ -30,6 +30,7 @@ namespace publisher {
            bool write(const char *buffer, uint32_t size);
 
 	   const PublisherType publisherType() { return PUBLISHER_DRIVER_COMMAND; }
+	   bool consumes(PacketType type) { return type != PORT_AGENT_COMMAND; }
 	   
         protected:
             virtual bool handleInstrumentData(Packet *packet)     { return logPacket(packet); }
@@ -41,7 +42,7 @@ namespace publisher {
             virtual bool handleStatus(Packet *packet)             { return logPacket(packet); }
             virtual bool handleFault(Packet *packet)              { return logPacket(packet); }
             virtual bool handleDriverCommand(Packet *packet)      { return logPacket(packet); }
-            virtual bool handleHearteat(Packet *packet)           { return logPacket(packet); }
+            virtual bool handleHeartbeat(Packet *packet)          { return logPacket(packet); }
 
         private:
         
@@ -27,6 +27,10 @@ namespace publisher {
             DriverDataPublisher(CommBase *socket) : DriverPublisher(socket) {}
 	   
 	    const PublisherType publisherType() { return PUBLISHER_DRIVER_DATA; }
+	    bool consumes(PacketType type) {
+	        return type != DATA_FROM_DRIVER && type != PORT_AGENT_COMMAND &&
+	               type != INSTRUMENT_COMMAND;
+	    }
 
         protected:
             virtual bool handleInstrumentData(Packet *packet)     { return logPacket(packet); }
@@ -34,7 +38,7 @@ namespace publisher {
             virtual bool handleCommand(Packet *packet)            { return true; }
             virtual bool handleStatus(Packet *packet)             { return logPacket(packet); }
             virtual bool handleFault(Packet *packet)              { return logPacket(packet); }
-            virtual bool handleHearteat(Packet *packet)           { return logPacket(packet); }
+            virtual bool handleHeartbeat(Packet *packet)          { return logPacket(packet); }
             virtual bool handleInstrumentCommand(Packet *packet)  { return true; }
 
         private:
@@ -15,6 +15,7 @@
 #include "file_pointer_publisher.h"
 #include "common/logger.h"
 #include "common/exception.h"
+#include "common/trace_log.h"
 #include "port_agent/packet/packet.h"
 
 #include <sstream>
@@ -27,6 +28,7 @@ using namespace std;
 using namespace packet;
 using namespace logger;
 using namespace publisher;
+using namespace network;
     
 /******************************************************************************
  *   PUBLIC METHODS
@@ -182,11 +184,10 @@ void FilePointerPublisher::setFilePointer(FILE* file) {
  *    Packet* - Pointer to a packet of data we need to write to the FILE*
  ******************************************************************************/
 bool FilePointerPublisher::logPacket(Packet *packet) {
-    string output;
-
 	if(m_bAsciiOut) {
-        output = packet->asAscii();
-        return write(output.c_str(), output.length());
+        size_t length;
+        const char *output = asciiPacket(packet, length);
+        return write(output, length);
     }
 
 	// Must be binary
@@ -196,20 +197,25 @@ bool FilePointerPublisher::logPacket(Packet *packet) {
 /******************************************************************************
  * Method: write
  * Description: Write a buffer the the internal FILE*.  It attempts to write
- * the buffer three times.  Exceptions are thrown if the FILE* is not set or
- * we fail to write the entire packet.
+ * the buffer three times.  An exception is thrown if neither the FILE* nor
+ * comm object is set.  Write failures are stored in m_oResult.
+ *
+ * A packet that only made it part way onto a comm socket would corrupt the
+ * framing of everything after it, so the client is dropped instead.  If the
+ * socket took none of it the packet is lost but the client stays connected.
  *
  * Parameter:
  *    char* - the buffer that we are writing.
  *    size - how many bytes?
  *
+ * Return:
+ *    true if the entire buffer was written
+ *
  * Exceptions:
  *    FileDescriptorNULL
- *    PacketPublishFailure
  ******************************************************************************/
 bool FilePointerPublisher::write(const char *buffer, uint32_t size) {
-	int count;
-	int total = 0;
+	uint32_t total = 0;
 
 	if(size == 0) {
 		LOG(INFO) << "Empty buffer for write, bailing";
@@ -232,25 +238,37 @@ bool FilePointerPublisher::write(const char *buffer, uint32_t size) {
 		
 		if(m_pCommSocket) {
 			LOG(DEBUG2) << "write with comm socket.";
-		    total += m_pCommSocket->writeData(buffer + total, size - total);
+		    IOResult result = m_pCommSocket->transmit(buffer + total, size - total);
+		    total += result.bytes;
+		    
+		    if(result.status != IO_OK && result.status != IO_WOULD_BLOCK) {
+		        LOG(DEBUG) << "Publish failed: " << result.what();
+		        m_oResult = result;
+		        return false;
+		    }
 		}
 		else if(m_pFilePointer) {
 			LOG(DEBUG2) << "write with file pointer";
 		    total += fwrite(buffer + total, 1, size - total, m_pFilePointer);
 		}
-		else {
-			LOG(ERROR) << "socket not intialized! Boom!";
-			throw PacketPublishFailure("socket not initialized");
-		}
 		
 		LOG(DEBUG2) << "write attempt complete";
 	}
 
 	if(total != size) {
 		LOG(DEBUG) << "Publish failed.  Intended bytes: " << size << " actual write: " << total;
- 		throw PacketPublishFailure(strerror(errno));
+		m_oResult = IOResult(m_pCommSocket ? IO_WOULD_BLOCK : IO_ERROR, total, errno);
+
+		if(m_pCommSocket && total) {
+			LOG(ERROR) << "Partial packet written, dropping client";
+			m_pCommSocket->dropClient();
+			m_oResult.status = IO_CLOSED;
+		}
+		return false;
 	}
 
+	TraceLog::Point(TRACE_WRITE, total);
+	m_oResult = IOResult(IO_OK, total);
 	return true;
 }
 
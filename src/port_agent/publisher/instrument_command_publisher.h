@@ -29,6 +29,7 @@ namespace publisher {
             InstrumentCommandPublisher(CommBase *socket) : InstrumentPublisher(socket) {}
 
 	    const PublisherType publisherType() { return PUBLISHER_INSTRUMENT_COMMAND; }
+	    bool consumes(PacketType type) { return type == INSTRUMENT_COMMAND; }
 
         protected:
             virtual bool handleInstrumentCommand(Packet *packet);
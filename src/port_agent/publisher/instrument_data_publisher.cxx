@@ -32,7 +32,7 @@ using namespace publisher;
  * Method: Constructor
  * Description: default constructor
  ******************************************************************************/
-InstrumentDataPublisher::InstrumentDataPublisher() { }
+InstrumentDataPublisher::InstrumentDataPublisher() : m_bDirect(false) { }
 
 /******************************************************************************
  * Method: handleDriverData
@@ -6,6 +6,11 @@
  *
  * This publisher writes raw data to the instrument data port.  The only packets
  * it has a handler for is DATA_FROM_DRIVER packets
+ *
+ * A direct publisher is left out of the DATA_FROM_DRIVER route.  The port
+ * agent writes driver data to the instrument itself with writeDriverData()
+ * as soon as it's read, then publishes the packet to everyone else.  The port
+ * agent counts those writes in the publisher.instrument_data metrics.
  *    
  ******************************************************************************/
 
@@ -26,9 +31,16 @@ namespace publisher {
         
         public:
             InstrumentDataPublisher();
-            InstrumentDataPublisher(CommBase *socket) : InstrumentPublisher(socket) {}
+            InstrumentDataPublisher(CommBase *socket) : InstrumentPublisher(socket), m_bDirect(false) {}
 
 	    const PublisherType publisherType() { return PUBLISHER_INSTRUMENT_DATA; }
+	    bool consumes(PacketType type) { return type == DATA_FROM_DRIVER && ! m_bDirect; }
+	    
+	    void setDirect(bool direct) { m_bDirect = direct; }
+	    bool direct() { return m_bDirect; }
+	    
+	    // Write driver data to the instrument without a packet
+	    bool writeDriverData(const char *buffer, uint32_t size) { return write(buffer, size); }
 
         protected:
             virtual bool handleDriverData(Packet *packet);
@@ -43,6 +55,7 @@ namespace publisher {
         protected:
             
         private:
+            bool m_bDirect;
 
     };
 }
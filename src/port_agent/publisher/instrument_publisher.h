@@ -38,6 +38,7 @@ namespace publisher {
             virtual bool handleStatus(Packet *packet)             { return true; }
             virtual bool handleFault(Packet *packet)              { return true; }
             virtual bool handleInstrumentCommand(Packet *packet)  { return true; }
+            virtual bool handleHeartbeat(Packet *packet)          { return true; }
 
             bool logPacket(Packet *packet);
 
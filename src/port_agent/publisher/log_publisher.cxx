@@ -34,6 +34,7 @@
 #include "common/util.h"
 #include "common/logger.h"
 #include "common/exception.h"
+#include "common/trace_log.h"
 #include "port_agent/packet/packet.h"
 
 #include <sstream>
@@ -62,10 +63,14 @@ using namespace publisher;
 bool LogPublisher::logPacket(Packet *packet) {
 	if(m_bAsciiOut) {
         LOG(DEBUG3) << "write packet (ascii) to " << logger().getFilename();
-		logger() << packet->asAscii();
+		size_t length;
+		const char *output = asciiPacket(packet, length);
+		logger().write(output, length);
+		TraceLog::Point(TRACE_WRITE, length);
 	} else {
         LOG(DEBUG3) << "write packet (binary) to " << logger().getFilename();
 		logger().write(packet->packet(), packet->packetSize());
+		TraceLog::Point(TRACE_WRITE, packet->packetSize());
 	}
 
 	return true;
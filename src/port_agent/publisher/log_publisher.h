@@ -46,6 +46,8 @@ namespace publisher {
             // Public Methods
             LogPublisher() {}
 
+            bool consumes(PacketType type) { return type != PORT_AGENT_HEARTBEAT; }
+
         protected:
             virtual bool handleInstrumentData(Packet *packet)      { return logPacket(packet); }
             virtual bool handleDriverData(Packet *packet)          { return logPacket(packet); }
@@ -0,0 +1,32 @@
+/*******************************************************************************
+ * Class: MulticastPublisher
+ * Filename: multicast_publisher.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Publish packets as batched UDP datagrams.
+ *
+ ******************************************************************************/
+
+#include "multicast_publisher.h"
+
+using namespace std;
+using namespace publisher;
+using namespace network;
+
+/******************************************************************************
+ *   PROTECTED METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: writeSink
+ * Description: Queue the packet as one datagram.
+ * Parameter:
+ *    buffer - rendered packet
+ *    length - packet length
+ * Return:
+ *    false if the packet is too big for a datagram
+ ******************************************************************************/
+bool MulticastPublisher::writeSink(const char *buffer, size_t length) {
+    return batch()->queue(buffer, length);
+}
@@ -0,0 +1,55 @@
+/*******************************************************************************
+ * Class: MulticastPublisher
+ * Filename: multicast_publisher.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Publish packets as UDP datagrams, usually to a multicast group so any
+ * number of consumers on the LAN get one stream without a connection each.
+ * Packets are queued in a DatagramBatch and sent together when the batch is
+ * flushed at the end of the event loop pass.
+ *
+ * Usage:
+ *
+ *   DatagramBatch batch;
+ *   batch.socket().setHostname("239.255.0.1");
+ *   batch.socket().setPort(5000);
+ *   batch.socket().initialize();
+ *
+ *   MulticastPublisher publisher(&batch);
+ *   publisher.publish(packet);
+ *   batch.flush();
+ *
+ ******************************************************************************/
+
+#ifndef __MULTICAST_PUBLISHER_H_
+#define __MULTICAST_PUBLISHER_H_
+
+#include "sink_publisher.h"
+#include "network/datagram_batch.h"
+
+using namespace std;
+using namespace network;
+
+namespace publisher {
+    class MulticastPublisher : public SinkPublisher<DatagramBatch> {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            MulticastPublisher() : SinkPublisher() {}
+            MulticastPublisher(DatagramBatch *batch) : SinkPublisher(batch) {}
+            virtual ~MulticastPublisher() {}
+
+            const PublisherType publisherType() { return PUBLISHER_MULTICAST; }
+
+            void setBatch(DatagramBatch *batch) { setSink(batch); }
+            DatagramBatch * batch() { return sink(); }
+
+        protected:
+            bool writeSink(const char *buffer, size_t length);
+    };
+}
+
+#endif //__MULTICAST_PUBLISHER_H_
@@ -24,6 +24,8 @@ using namespace std;
 using namespace packet;
 using namespace logger;
 using namespace publisher;
+using namespace network;
+using namespace metrics;
     
 /******************************************************************************
  *   PUBLIC METHODS
@@ -36,6 +38,13 @@ using namespace publisher;
 Publisher::Publisher() {
     m_oError = NULL;
     m_bAsciiOut = false;
+    m_pAsciiBuffer = NULL;
+    m_iAsciiBufferSize = 0;
+    
+    m_pPackets = NULL;
+    m_pBytes = NULL;
+    m_pErrors = NULL;
+    m_pLatency = NULL;
 }
 
 /******************************************************************************
@@ -51,6 +60,13 @@ Publisher::Publisher(const Publisher& rhs) {
 	
 	m_oError = rhs.m_oError;
 	m_bAsciiOut = rhs.m_bAsciiOut;
+	m_pAsciiBuffer = NULL;
+	m_iAsciiBufferSize = 0;
+	
+	m_pPackets = rhs.m_pPackets;
+	m_pBytes = rhs.m_pBytes;
+	m_pErrors = rhs.m_pErrors;
+	m_pLatency = rhs.m_pLatency;
 }
 
 /******************************************************************************
@@ -58,6 +74,8 @@ Publisher::Publisher(const Publisher& rhs) {
  * Description: free up our dynamically created packet data.
  ******************************************************************************/
 Publisher::~Publisher() {
+    if(m_pAsciiBuffer)
+        delete [] m_pAsciiBuffer;
 }
 
 /******************************************************************************
@@ -98,9 +116,6 @@ bool Publisher::operator==(Publisher &rhs) {
  *
  ******************************************************************************/
 bool Publisher::publish(Packet *packet) {
-	clearError();
-
-
     // We want to check log level here because we don't want to actually call
     // the pretty method unless we have too.
     if(Logger::GetLogLevel() == MESG) {
@@ -108,6 +123,81 @@ bool Publisher::publish(Packet *packet) {
                   << packet->pretty() << endl;
     }
 
+    return dispatch(packet);
+}
+
+/******************************************************************************
+ * Method: dispatch
+ * Description: run a packet through the handler for its type.  Errors are
+ * stored and can be read with error().  Packets of the types we consume are
+ * counted, and for instrument data the time since it was read is recorded.
+ *
+ * Parameters:
+ *   packet - a Packet object or one of it's derivatives
+ *
+ * Return:
+ *   true if the handler succeeded
+ ******************************************************************************/
+bool Publisher::dispatch(Packet *packet) {
+    bool published = handle(packet);
+    
+    if(! consumes(packet->packetType()))
+        return published;
+    
+    if(! m_pPackets) {
+        string name = string("publisher.") + typeName();
+        m_pPackets = Metrics::GetCounter(name + ".packets");
+        m_pBytes = Metrics::GetCounter(name + ".bytes");
+        m_pErrors = Metrics::GetCounter(name + ".errors");
+        m_pLatency = Metrics::GetHistogram(name + ".latency_us");
+    }
+    
+    if(! published) {
+        m_pErrors->add();
+        return false;
+    }
+    
+    m_pPackets->add();
+    m_pBytes->add(packet->payloadSize());
+    
+    if(packet->packetType() == DATA_FROM_INSTRUMENT) {
+        double elapsed = packet->timestamp().elapseTime();
+        m_pLatency->record(elapsed > 0 ? (uint64_t)(elapsed * 1000000) : 0);
+    }
+    
+    return true;
+}
+
+/******************************************************************************
+ * Method: typeName
+ * Description: Short name for the publisher type, used to name its metrics.
+ ******************************************************************************/
+const char * Publisher::typeName() {
+    switch(publisherType()) {
+        case PUBLISHER_DRIVER_COMMAND:     return "driver_command";
+        case PUBLISHER_DRIVER_DATA:        return "driver_data";
+        case PUBLISHER_INSTRUMENT_COMMAND: return "instrument_command";
+        case PUBLISHER_INSTRUMENT_DATA:    return "instrument_data";
+        case PUBLISHER_FILE:               return "file";
+        case PUBLISHER_UDP:                return "udp";
+        case PUBLISHER_TCP:                return "tcp";
+        case PUBLISHER_TELNET_SNIFFER:     return "telnet_sniffer";
+        case PUBLISHER_SUBSCRIPTION:       return "subscription";
+        case PUBLISHER_SHM:                return "shm";
+        case PUBLISHER_MULTICAST:          return "multicast";
+        default:                           return "unknown";
+    };
+}
+
+/******************************************************************************
+ * Method: handle
+ * Description: run a packet through the handler for its type, storing any
+ * error.
+ ******************************************************************************/
+bool Publisher::handle(Packet *packet) {
+	clearError();
+	m_oResult = IOResult();
+
 	try {
 		switch(packet->packetType()) {
 		case DATA_FROM_INSTRUMENT:
@@ -168,6 +258,32 @@ OOIException * Publisher::error() {
     return m_oError;
 }
 
+/******************************************************************************
+ * Method: asciiPacket
+ * Description: Render a packet as ascii into the publisher's output buffer.
+ * The buffer is reused between packets and only grows when a packet won't
+ * fit, so steady state publishing doesn't allocate.
+ *
+ * Parameters:
+ *   packet - packet to render
+ *   length - set to the number of bytes rendered
+ *
+ * Return:
+ *   pointer to the rendered packet, valid until the next call
+ ******************************************************************************/
+const char * Publisher::asciiPacket(Packet *packet, size_t &length) {
+    if(packet->asciiSize() > m_iAsciiBufferSize) {
+        if(m_pAsciiBuffer)
+            delete [] m_pAsciiBuffer;
+
+        m_iAsciiBufferSize = packet->asciiSize();
+        m_pAsciiBuffer = new char[m_iAsciiBufferSize];
+    }
+
+    length = packet->asAscii(m_pAsciiBuffer, m_iAsciiBufferSize);
+    return m_pAsciiBuffer;
+}
+
 /******************************************************************************
  * Method: clearError
  * Description: Clear all errors out of the error list.
@@ -32,6 +32,14 @@
  *
  *   Exceptions are only thrown from constructors.
  *   If an error is thrown from publication then it is stored in the object.
+ *   Write failures on the output connection, like a client disconnecting,
+ *   aren't thrown; the status of the last write is available from result().
+ *
+ * Metrics:
+ *
+ *   Every publisher of a type shares publisher.<type>.packets, .bytes and
+ *   .errors counters, and a publisher.<type>.latency_us histogram of the
+ *   time from reading instrument data to writing it out.
  *    
  ******************************************************************************/
 
@@ -41,7 +49,9 @@
 #include "common/exception.h"
 #include "common/timestamp.h"
 #include "common/logger.h"
+#include "common/metrics.h"
 #include "port_agent/packet/packet.h"
+#include "network/io_result.h"
 
 #include <list>
 #include <string>
@@ -63,7 +73,10 @@ namespace publisher {
         PUBLISHER_FILE,
         PUBLISHER_UDP,
         PUBLISHER_TCP,
-        PUBLISHER_TELNET_SNIFFER
+        PUBLISHER_TELNET_SNIFFER,
+        PUBLISHER_SUBSCRIPTION,
+        PUBLISHER_SHM,
+        PUBLISHER_MULTICAST
     } PulisherType;
     
     class Publisher {
@@ -87,8 +100,17 @@ namespace publisher {
 
             /*  Commands */
             virtual bool publish(Packet *packet);
+
+            // Publish without logging the packet, used by the publisher list
+            // which logs each packet once.
+            bool dispatch(Packet *packet);
             virtual bool compare(Publisher *rhs) = 0;
 
+            // Does this publisher write packets of this type?  Handlers for
+            // types that aren't consumed do nothing, so the publisher list
+            // can skip them.
+            virtual bool consumes(PacketType type) { return true; }
+
             /* Accessors */
 	    
 	    virtual const PublisherType publisherType() = 0;
@@ -96,13 +118,25 @@ namespace publisher {
             // Get the error from the last publish call
             OOIException * error();
 
+            // Status of the last write from the last publish call
+            const network::IOResult & result() { return m_oResult; }
+
             // Enable/Disable ascii output mode
             void setAsciiMode(bool enabled = true);
 
+            // Name used for this publisher's metrics
+            const char * typeName();
+
         protected:
             // Clear all errors out of the error list.
             void clearError();
 
+            // Render a packet as ascii into the publisher's output buffer
+            const char * asciiPacket(Packet *packet, size_t &length);
+
+            // Run a packet through the handler for its type
+            bool handle(Packet *packet);
+
             /* Handlers */
 
             // Handlers are used to process and ultimately write the packet
@@ -125,11 +159,22 @@ namespace publisher {
         
         protected:
             bool m_bAsciiOut;
+            network::IOResult m_oResult;
 
             
         private:
             OOIException * m_oError;
 
+            // Output buffer for ascii packets, grown as needed
+            char * m_pAsciiBuffer;
+            size_t m_iAsciiBufferSize;
+
+            // Shared by every publisher of this type, found on first dispatch
+            metrics::Counter * m_pPackets;
+            metrics::Counter * m_pBytes;
+            metrics::Counter * m_pErrors;
+            metrics::Histogram * m_pLatency;
+
     };
 }
 
@@ -20,6 +20,8 @@
  * list.add(publisher);
  *
  * list.publish(packet);
+ *
+ * Routes are rebuilt whenever a publisher is added or replaced.
  *    
  ******************************************************************************/
 
@@ -27,6 +29,7 @@
 #include "common/util.h"
 #include "common/logger.h"
 #include "common/exception.h"
+#include "common/trace_log.h"
 #include "port_agent/packet/packet.h"
 #include "port_agent/publisher/driver_command_publisher.h"
 #include "port_agent/publisher/driver_data_publisher.h"
@@ -36,6 +39,9 @@
 #include "port_agent/publisher/tcp_publisher.h"
 #include "port_agent/publisher/udp_publisher.h"
 #include "port_agent/publisher/telnet_sniffer_publisher.h"
+#include "port_agent/publisher/subscription_publisher.h"
+#include "port_agent/publisher/shm_publisher.h"
+#include "port_agent/publisher/multicast_publisher.h"
 
 #include <sstream>
 #include <string>
@@ -70,31 +76,43 @@ PublisherList::~PublisherList() {
 
 /******************************************************************************
  * Method: publish
- * Description: publish a packet to all publishers
+ * Description: publish a packet to all publishers that consume its type.
+ * Every publisher on the route is tried even if an earlier one fails.
  *
  * Parameters:
  *   packet - a Packet object or one of it's derivatives
  *
+ * Return:
+ *   PUBLISH_OK, PUBLISH_FAILED if any publisher failed, or
+ *   PUBLISH_UNKNOWN_TYPE
  ******************************************************************************/
-bool PublisherList::publish(Packet *packet) {
-    PublisherObjectList::iterator i = m_oPublishers.begin();
-    string error;
+PublishStatus PublisherList::publish(Packet *packet) {
+    PublishStatus status = PUBLISH_OK;
+    int type = packet->packetType();
 	
-    for(i = m_oPublishers.begin(); i != m_oPublishers.end(); i++)
-        try {
-			LOG(DEBUG2) << "publish with publisher type: " << (*i)->publisherType();
-    		(*i)->publish(packet);
-		}
-		catch(OOIException &e) {
-			ostringstream err;
-			err << "<Publish Type> error: " << e.what() << endl;
-			error += err.str();
-		};
-		
-	if(error.length())
-	    throw PacketPublishFailure(error.c_str());
+    if(type <= UNKNOWN || type >= PACKET_TYPE_COUNT)
+        return PUBLISH_UNKNOWN_TYPE;
+
+    if(Logger::GetLogLevel() == MESG) {
+        LOG(MESG) << "Publishing Packet:" << endl
+                  << packet->pretty() << endl;
+    }
+
+    TraceLog::Point(TRACE_PACKET, type);
+
+    const PublisherRoute &publishers = m_oRoutes[type];
+    for(size_t i = 0; i < publishers.size(); i++) {
+        TraceLog::Point(TRACE_ENQUEUE, publishers[i]->publisherType());
+
+        if(!publishers[i]->dispatch(packet)) {
+            LOG(DEBUG2) << "publish failed with publisher type: " << publishers[i]->publisherType();
+            status = PUBLISH_FAILED;
+        }
+
+        TraceLog::Point(TRACE_DISPATCHED, publishers[i]->publisherType());
+    }
 	
-    return true;
+    return status;
 }
 
 /******************************************************************************
@@ -204,6 +222,15 @@ void PublisherList::addPublisher(Publisher *publisher) {
     else if(publisher->publisherType() == PUBLISHER_TELNET_SNIFFER)
         newPublisher = new TelnetSnifferPublisher(*(TelnetSnifferPublisher*)publisher);
 	
+    else if(publisher->publisherType() == PUBLISHER_SUBSCRIPTION)
+        newPublisher = new SubscriptionPublisher(*(SubscriptionPublisher*)publisher);
+	
+    else if(publisher->publisherType() == PUBLISHER_SHM)
+        newPublisher = new ShmPublisher(*(ShmPublisher*)publisher);
+	
+    else if(publisher->publisherType() == PUBLISHER_MULTICAST)
+        newPublisher = new MulticastPublisher(*(MulticastPublisher*)publisher);
+	
     else
         throw UnknownPublisherType();
     
@@ -214,6 +241,25 @@ void PublisherList::addPublisher(Publisher *publisher) {
 	} else {
         m_oPublishers.push_back(newPublisher);
 	}
+
+    buildRoutes();
+}
+
+/******************************************************************************
+ * Method: buildRoutes
+ * Description: Rebuild the publisher route for each packet type from the
+ * publisher list.  Routes keep the list order.
+ ******************************************************************************/
+void PublisherList::buildRoutes() {
+    PublisherObjectList::iterator i;
+
+    for(int type = 0; type < PACKET_TYPE_COUNT; type++) {
+        m_oRoutes[type].clear();
+
+        for(i = m_oPublishers.begin(); i != m_oPublishers.end(); i++)
+            if((*i)->consumes((PacketType)type))
+                m_oRoutes[type].push_back(*i);
+    }
 }
 
 
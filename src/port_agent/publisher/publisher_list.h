@@ -19,7 +19,12 @@
  *
  * list.add(&publisher);
  *
- * list.publish(packet);
+ * if(list.publish(packet) != PUBLISH_OK)
+ *     handleFailure();
+ *
+ * Each packet type has a route, the publishers that consume that type in
+ * publishing order.  Routes are rebuilt when the list changes so publish
+ * only visits publishers that will write the packet.
  *    
  ******************************************************************************/
 
@@ -31,6 +36,7 @@
 #include "port_agent/publisher/publisher.h"
 
 #include <list>
+#include <vector>
 #include <string>
 
 
@@ -40,6 +46,15 @@ using namespace packet;
 
 namespace publisher {
     typedef list<Publisher *> PublisherObjectList;
+    typedef vector<Publisher *> PublisherRoute;
+    
+    // Result of publishing a packet to the list
+    typedef enum PublishStatus {
+        PUBLISH_OK,
+        // At least one publisher failed, see Publisher::error()
+        PUBLISH_FAILED,
+        PUBLISH_UNKNOWN_TYPE
+    } PublishStatus;
     
     class PublisherList {
         /********************
@@ -55,7 +70,7 @@ namespace publisher {
             virtual ~PublisherList();
             
             /*  Commands */
-            bool publish(Packet *packet);
+            PublishStatus publish(Packet *packet);
             
 	    void add(Publisher *publisher);
 
@@ -64,6 +79,7 @@ namespace publisher {
 			Publisher * front() { return m_oPublishers.front(); }
 			Publisher * back() { return m_oPublishers.back(); }
 			Publisher * searchByType(PublisherType type);
+			const PublisherRoute & route(PacketType type) { return m_oRoutes[type]; }
 
         protected:
 
@@ -72,6 +88,7 @@ namespace publisher {
 	    
 	    void addUnique(Publisher *publisher);
 	    void addPublisher(Publisher *publisher);
+	    void buildRoutes();
         
         /********************
          *      MEMBERS     *
@@ -81,6 +98,7 @@ namespace publisher {
             
         private:
             PublisherObjectList m_oPublishers;
+            PublisherRoute m_oRoutes[PACKET_TYPE_COUNT];
 
     };
 }
@@ -0,0 +1,31 @@
+/*******************************************************************************
+ * Class: ShmPublisher
+ * Filename: shm_publisher.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Publish packets to a shared memory ring.
+ *
+ ******************************************************************************/
+
+#include "shm_publisher.h"
+
+using namespace std;
+using namespace publisher;
+
+/******************************************************************************
+ *   PROTECTED METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: writeSink
+ * Description: Append the packet to the ring.
+ * Parameter:
+ *    buffer - rendered packet
+ *    length - packet length
+ * Return:
+ *    false if the ring isn't open or the packet doesn't fit
+ ******************************************************************************/
+bool ShmPublisher::writeSink(const char *buffer, size_t length) {
+    return ring()->write(buffer, length);
+}
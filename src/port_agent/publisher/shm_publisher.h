@@ -0,0 +1,51 @@
+/*******************************************************************************
+ * Class: ShmPublisher
+ * Filename: shm_publisher.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Publish packets to a shared memory ring for consumers on the same host.
+ * Each packet is written to the ring once and read in place by any number
+ * of ShmRingReader processes, without a socket or system call per packet
+ * per consumer.
+ *
+ * Usage:
+ *
+ *   ShmRing ring;
+ *   ring.open("/port_agent_4001", DEFAULT_SHM_RING_SIZE);
+ *
+ *   ShmPublisher publisher(&ring);
+ *   publisher.publish(packet);
+ *
+ ******************************************************************************/
+
+#ifndef __SHM_PUBLISHER_H_
+#define __SHM_PUBLISHER_H_
+
+#include "sink_publisher.h"
+#include "common/shm_ring.h"
+
+using namespace std;
+
+namespace publisher {
+    class ShmPublisher : public SinkPublisher<ShmRing> {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            ShmPublisher() : SinkPublisher() {}
+            ShmPublisher(ShmRing *ring) : SinkPublisher(ring) {}
+            virtual ~ShmPublisher() {}
+
+            const PublisherType publisherType() { return PUBLISHER_SHM; }
+
+            void setRing(ShmRing *ring) { setSink(ring); }
+            ShmRing * ring() { return sink(); }
+
+        protected:
+            bool writeSink(const char *buffer, size_t length);
+    };
+}
+
+#endif //__SHM_PUBLISHER_H_
@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * Class: SinkPublisher
+ * Filename: sink_publisher.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Base class for publishers that fan packets out through a shared sink, such
+ * as a subscription hub, a shared memory ring or a datagram batch.  Each
+ * packet is rendered once and handed to the sink, which gets the same
+ * packets as the driver data port.  Publishers are the same if they write to
+ * the same sink.
+ *
+ * The template parameter is the sink type so each derived class holds a
+ * typed pointer.  The sink is owned by the caller and must outlive the
+ * publisher.  A derived class only implements writeSink() to pass the
+ * rendered packet on.
+ *
+ * Usage:
+ *
+ *   class HubPublisher : public SinkPublisher<SubscriptionHub> {
+ *       ...
+ *       protected:
+ *           bool writeSink(const char *buffer, size_t length) {
+ *               return sink()->publish(buffer, length);
+ *           }
+ *   };
+ *
+ ******************************************************************************/
+
+#ifndef __SINK_PUBLISHER_H_
+#define __SINK_PUBLISHER_H_
+
+#include "publisher.h"
+
+#include <stddef.h>
+
+using namespace std;
+
+namespace publisher {
+    template<class Sink>
+    class SinkPublisher : public Publisher {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            SinkPublisher() : Publisher(), m_pSink(NULL) {}
+            SinkPublisher(Sink *sink) : Publisher(), m_pSink(sink) {}
+            SinkPublisher(const SinkPublisher &rhs) : Publisher(rhs), m_pSink(rhs.m_pSink) {}
+            virtual ~SinkPublisher() {}
+
+            // The copy shares the sink
+            SinkPublisher & operator=(const SinkPublisher &rhs) {
+                Publisher::operator=(rhs);
+                m_pSink = rhs.m_pSink;
+                return *this;
+            }
+
+            // Publishers are the same if they are the same type and publish
+            // to the same sink.  The same type means the same sink type.
+            bool compare(Publisher *rhs) {
+                if(this == rhs) return true;
+                if(!rhs) return false;
+
+                if(publisherType() != rhs->publisherType())
+                    return false;
+
+                return m_pSink == ((SinkPublisher *)rhs)->m_pSink;
+            }
+
+            bool consumes(PacketType type) {
+                return type != DATA_FROM_DRIVER && type != PORT_AGENT_COMMAND &&
+                       type != INSTRUMENT_COMMAND;
+            }
+
+        protected:
+            void setSink(Sink *sink) { m_pSink = sink; }
+            Sink * sink() { return m_pSink; }
+
+            // Pass a rendered packet to the sink, which is never NULL here
+            virtual bool writeSink(const char *buffer, size_t length) = 0;
+
+            // Render the packet and pass it to the sink.  False if there is
+            // no sink or the sink rejects the packet.
+            bool write(Packet *packet) {
+                if(!m_pSink)
+                    return false;
+
+                if(m_bAsciiOut) {
+                    size_t length;
+                    const char *output = asciiPacket(packet, length);
+                    return writeSink(output, length);
+                }
+
+                return writeSink(packet->packet(), packet->packetSize());
+            }
+
+            virtual bool handleInstrumentData(Packet *packet)     { return write(packet); }
+            virtual bool handleDriverData(Packet *packet)         { return true; }
+            virtual bool handleCommand(Packet *packet)            { return true; }
+            virtual bool handleStatus(Packet *packet)             { return write(packet); }
+            virtual bool handleFault(Packet *packet)              { return write(packet); }
+            virtual bool handleHeartbeat(Packet *packet)          { return write(packet); }
+            virtual bool handleInstrumentCommand(Packet *packet)  { return true; }
+
+        /********************
+         *      MEMBERS     *
+         ********************/
+
+        private:
+            Sink *m_pSink;
+    };
+}
+
+#endif //__SINK_PUBLISHER_H_
@@ -0,0 +1,32 @@
+/*******************************************************************************
+ * Class: SubscriptionPublisher
+ * Filename: subscription_publisher.cxx
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Publish to every client subscribed to a SubscriptionHub.
+ *
+ ******************************************************************************/
+
+#include "subscription_publisher.h"
+
+using namespace std;
+using namespace publisher;
+using namespace network;
+
+/******************************************************************************
+ *   PROTECTED METHODS
+ ******************************************************************************/
+
+/******************************************************************************
+ * Method: writeSink
+ * Description: Append the packet to the hub ring.
+ * Parameter:
+ *    buffer - rendered packet
+ *    length - packet length
+ * Return:
+ *    false if the packet doesn't fit in the ring
+ ******************************************************************************/
+bool SubscriptionPublisher::writeSink(const char *buffer, size_t length) {
+    return hub()->publish(buffer, length);
+}
@@ -0,0 +1,51 @@
+/*******************************************************************************
+ * Class: SubscriptionPublisher
+ * Filename: subscription_publisher.h
+ * Author: Bill French (wfrench@ucsd.edu)
+ * License: Apache 2.0
+ *
+ * Publish to every client subscribed to a SubscriptionHub.  Each packet is
+ * appended to the hub's shared ring once, however many clients are
+ * subscribed.
+ *
+ * Usage:
+ *
+ *   SubscriptionHub hub;
+ *   SubscriptionPublisher publisher(&hub);
+ *
+ *   publisher.publish(packet);
+ *   hub.flush();
+ *
+ ******************************************************************************/
+
+#ifndef __SUBSCRIPTION_PUBLISHER_H_
+#define __SUBSCRIPTION_PUBLISHER_H_
+
+#include "sink_publisher.h"
+#include "network/subscription_hub.h"
+
+using namespace std;
+using namespace network;
+
+namespace publisher {
+    class SubscriptionPublisher : public SinkPublisher<SubscriptionHub> {
+        /********************
+         *      METHODS     *
+         ********************/
+
+        public:
+            SubscriptionPublisher() : SinkPublisher() {}
+            SubscriptionPublisher(SubscriptionHub *hub) : SinkPublisher(hub) {}
+            virtual ~SubscriptionPublisher() {}
+
+            const PublisherType publisherType() { return PUBLISHER_SUBSCRIPTION; }
+
+            void setHub(SubscriptionHub *hub) { setSink(hub); }
+            SubscriptionHub * hub() { return sink(); }
+
+        protected:
+            bool writeSink(const char *buffer, size_t length);
+    };
+}
+
+#endif //__SUBSCRIPTION_PUBLISHER_H_
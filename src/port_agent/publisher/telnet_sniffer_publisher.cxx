@@ -18,6 +18,7 @@
 #include <string>
 
 #include <stdio.h>
+#include <sys/uio.h>
 
 using namespace std;
 using namespace packet;
@@ -35,6 +36,38 @@ using namespace publisher;
 TelnetSnifferPublisher::TelnetSnifferPublisher() : TCPPublisher() {
     m_prefix = "";
     m_suffix = "";
+    m_bSpliced = false;
+    m_pHub = NULL;
+}
+
+/******************************************************************************
+ * Method: Constructor
+ * Description: Publish to every client of a subscription hub.
+ ******************************************************************************/
+TelnetSnifferPublisher::TelnetSnifferPublisher(SubscriptionHub *hub) : TCPPublisher() {
+    m_prefix = "";
+    m_suffix = "";
+    m_bSpliced = false;
+    m_pHub = hub;
+}
+
+/******************************************************************************
+ * Method: compare
+ * Description: Hub publishers are equal if they publish to the same hub,
+ * otherwise compare the sockets.
+ ******************************************************************************/
+bool TelnetSnifferPublisher::compare(Publisher *rhs) {
+    if(this == rhs) return true;
+    if(!rhs) return false;
+    
+    if(publisherType() != rhs->publisherType())
+        return false;
+    
+    TelnetSnifferPublisher *target = (TelnetSnifferPublisher *)rhs;
+    if(m_pHub || target->m_pHub)
+        return m_pHub == target->m_pHub;
+    
+    return TCPPublisher::compare(rhs);
 }
 
 		   
@@ -47,7 +80,15 @@ TelnetSnifferPublisher::TelnetSnifferPublisher() : TCPPublisher() {
  *    Packet* - Pointer to a packet of data we need to write to the FILE*
  ******************************************************************************/
 bool TelnetSnifferPublisher::publishDataFromInstrument(Packet *packet) {
+    // Already sent to the client in-kernel
+    if(m_bSpliced)
+        return true;
+    
     LOG(DEBUG2) << "Publish packet to sniffer: " << packet->payload();
+    
+    if(m_pHub)
+        return m_pHub->publish(packet->payload(), packet->payloadSize());
+    
     return write(packet->payload(), packet->payloadSize());
 }
 
@@ -61,6 +102,21 @@ bool TelnetSnifferPublisher::publishDataFromInstrument(Packet *packet) {
  ******************************************************************************/
 bool TelnetSnifferPublisher::publishDataFromObservatory(Packet *packet) {
     bool result = true;
+    
+    // Render the framed packet into the ring in one go
+    if(m_pHub && (m_prefix.length() || m_suffix.length())) {
+        struct iovec iov[3];
+        
+        iov[0].iov_base = (void *)m_prefix.c_str();
+        iov[0].iov_len = m_prefix.length();
+        iov[1].iov_base = packet->payload();
+        iov[1].iov_len = packet->payloadSize();
+        iov[2].iov_base = (void *)m_suffix.c_str();
+        iov[2].iov_len = m_suffix.length();
+        
+        return m_pHub->publish(iov, 3);
+    }
+    
     if(m_prefix.length() || m_suffix.length()) {
         if(m_prefix.length()) {
             write(m_prefix.c_str(), m_prefix.length());
@@ -5,6 +5,16 @@
  * License: Apache 2.0
  *
  * Publish data to the telnet sniffer.  Dumps raw instrument output to the port.
+ *
+ * When the port agent splices instrument data straight to the sniffer client
+ * (see network::StreamTee) the publisher is marked spliced and instrument
+ * packets are skipped, the client already has them.
+ *
+ * Given a SubscriptionHub instead of a listener any number of clients can
+ * watch at once.  Each packet, framed with the prefix and suffix, is
+ * rendered into the hub's ring once and sent to every client with one call
+ * per client.  Clients that fall behind are disconnected by the hub.  The
+ * hub is owned by the caller and must outlive the publisher.
  *    
  ******************************************************************************/
 
@@ -13,6 +23,7 @@
 
 #include "tcp_publisher.h"
 #include "common/log_file.h"
+#include "network/subscription_hub.h"
 
 using namespace std;
 using namespace logger;
@@ -25,25 +36,36 @@ namespace publisher {
         
         public:
            TelnetSnifferPublisher();
-           TelnetSnifferPublisher(CommBase *socket) : TCPPublisher(socket) {}
+           TelnetSnifferPublisher(CommBase *socket) : TCPPublisher(socket), m_bSpliced(false), m_pHub(NULL) {}
+           TelnetSnifferPublisher(SubscriptionHub *hub);
+           
+           bool compare(Publisher *rhs);
 
 	       const PublisherType publisherType() { return PUBLISHER_TELNET_SNIFFER; }
+	       bool consumes(PacketType type) {
+	           return type == DATA_FROM_INSTRUMENT || type == DATA_FROM_DRIVER;
+	       }
 		   
 		   bool publishDataFromInstrument(Packet *packet); 
 		   bool publishDataFromObservatory(Packet *packet);
 		   
 		   void setPrefix(const string &param) { m_prefix = param; }
 		   void setSuffix(const string &param) { m_suffix = param; }
+		   
+		   void setSpliced(bool spliced) { m_bSpliced = spliced; }
+		   bool spliced() { return m_bSpliced; }
+		   
+		   SubscriptionHub * hub() { return m_pHub; }
 	   
         protected:
-            virtual bool handleInstrumentData(Packet *packet)     { publishDataFromInstrument(packet); }
-            virtual bool handleDriverData(Packet *packet)         { publishDataFromObservatory(packet); }
+            virtual bool handleInstrumentData(Packet *packet)     { return publishDataFromInstrument(packet); }
+            virtual bool handleDriverData(Packet *packet)         { return publishDataFromObservatory(packet); }
             virtual bool handleInstrumentCommand(Packet *packet)  { return true; }
             virtual bool handleCommand(Packet *packet)            { return true; }
             virtual bool handleStatus(Packet *packet)             { return true; }
             virtual bool handleFault(Packet *packet)              { return true; }
             virtual bool handleDriverCommand(Packet *packet)      { return true; }
-            virtual bool handleHearteat(Packet *packet)           { return true; }
+            virtual bool handleHeartbeat(Packet *packet)          { return true; }
 
         private:
         
@@ -56,6 +78,8 @@ namespace publisher {
         private:
 			string m_prefix;
 			string m_suffix;
+			bool m_bSpliced;
+			SubscriptionHub *m_pHub;
 
     };
 }
@@ -4,6 +4,7 @@
 #include "gtest/gtest.h"
 #include "publisher_test.h"
 #include "instrument_data_publisher.h"
+#include "port_agent/publisher/publisher_list.h"
 #include "network/tcp_comm_socket.h"
 #include "network/tcp_comm_listener.h"
 
@@ -69,6 +70,32 @@ TEST_F(InstrumentDataPublisherTest, SingleBinaryOut) {
 	EXPECT_TRUE(testNoPublish(publisher, INSTRUMENT_COMMAND));
 }
 
+/* Test writing driver data directly */
+TEST_F(InstrumentDataPublisherTest, Direct) {
+	InstrumentDataPublisher publisher;
+	PublisherList list;
+	char buffer[16];
+	
+	EXPECT_FALSE(publisher.direct());
+	publisher.setDirect(true);
+	EXPECT_FALSE(publisher.consumes(DATA_FROM_DRIVER));
+	
+	// A direct publisher isn't on the driver data route
+	list.add(&publisher);
+	ASSERT_EQ(list.size(), 1);
+	EXPECT_TRUE(((InstrumentDataPublisher *)list.front())->direct());
+	EXPECT_EQ(list.route(DATA_FROM_DRIVER).size(), 0);
+	
+	FILE *file = tmpfile();
+	publisher.setFilePointer(file);
+	EXPECT_TRUE(publisher.writeDriverData("data", 4));
+	
+	rewind(file);
+	ASSERT_EQ(fread(buffer, 1, sizeof(buffer), file), 4);
+	EXPECT_EQ(string(buffer, 4), "data");
+	fclose(file);
+}
+
 /* Test publication failures */
 TEST_F(InstrumentDataPublisherTest, DISABLED_FailureNoFile) {
 	InstrumentDataPublisher publisher;
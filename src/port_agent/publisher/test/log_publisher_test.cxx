@@ -175,3 +175,30 @@ TEST_F(LogPublisherTest, EqualityOperator) {
 }
 
 
+
+/* Packets, bytes and failures are counted per publisher type */
+TEST_F(LogPublisherTest, Metrics) {
+    LogPublisher publisher, failing;
+    metrics::Counter *packets = metrics::Metrics::GetCounter("publisher.file.packets");
+    metrics::Counter *bytes = metrics::Metrics::GetCounter("publisher.file.bytes");
+    metrics::Counter *errors = metrics::Metrics::GetCounter("publisher.file.errors");
+    metrics::Histogram *latency = metrics::Metrics::GetHistogram("publisher.file.latency_us");
+
+    metrics::Metrics::Reset();
+    publisher.setFilename(DATAFILE);
+
+	Packet driver(DATA_FROM_DRIVER, Timestamp(), "data", 4);
+	Packet instrument(DATA_FROM_INSTRUMENT, Timestamp(), "instrument", 10);
+
+    EXPECT_TRUE(publisher.publish(&driver));
+    EXPECT_TRUE(publisher.publish(&instrument));
+    EXPECT_FALSE(failing.publish(&driver));
+
+    EXPECT_EQ(packets->value(), 2);
+    EXPECT_EQ(bytes->value(), 14);
+    EXPECT_EQ(errors->value(), 1);
+
+    // Only instrument data has a read to write latency
+    EXPECT_EQ(latency->count(), 1);
+    EXPECT_LT(latency->max(), 1000000);
+}
@@ -0,0 +1,87 @@
+#include "common/logger.h"
+#include "common/util.h"
+#include "network/datagram_batch.h"
+#include "port_agent/packet/packet.h"
+#include "gtest/gtest.h"
+#include "publisher_test.h"
+#include "multicast_publisher.h"
+
+#include <string>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace std;
+using namespace packet;
+using namespace logger;
+using namespace publisher;
+using namespace network;
+
+class MulticastPublisherTest : public PublisherTest {
+
+    protected:
+        virtual void SetUp() {
+            struct sockaddr_in addr;
+            socklen_t length = sizeof(addr);
+
+            Logger::SetLogFile("/tmp/gtest.log");
+            Logger::SetLogLevel("MESG");
+
+            LOG(INFO) << "************************************************";
+            LOG(INFO) << "   MulticastPublisherTest Test Start Up";
+            LOG(INFO) << "************************************************";
+
+            // Unicast loopback receiver, the batch doesn't care
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            receiver = socket(AF_INET, SOCK_DGRAM, 0);
+            bind(receiver, (struct sockaddr *)&addr, sizeof(addr));
+            getsockname(receiver, (struct sockaddr *)&addr, &length);
+            port = ntohs(addr.sin_port);
+        }
+
+        virtual void TearDown() {
+            close(receiver);
+        }
+
+        string next() {
+            char buffer[1024];
+            int bytes = recv(receiver, buffer, sizeof(buffer), MSG_DONTWAIT);
+            return bytes < 0 ? "none" : string(buffer, bytes);
+        }
+
+        int receiver;
+        uint16_t port;
+};
+
+/* Packets are sent one per datagram when the batch is flushed */
+TEST_F(MulticastPublisherTest, BinaryOut) {
+    DatagramBatch batch;
+
+    batch.socket().setHostname("127.0.0.1");
+    batch.socket().setPort(port);
+    ASSERT_TRUE(batch.socket().initialize());
+
+    MulticastPublisher publisher(&batch);
+    publisher.setAsciiMode(false);
+
+    Timestamp ts;
+    Packet data(DATA_FROM_INSTRUMENT, ts, "data", 4);
+    Packet more(DATA_FROM_INSTRUMENT, ts, "more", 4);
+    Packet driver(DATA_FROM_DRIVER, ts, "command", 7);
+
+    EXPECT_TRUE(publisher.publish(&data));
+    EXPECT_TRUE(publisher.publish(&more));
+    EXPECT_TRUE(publisher.publish(&driver));
+    EXPECT_EQ(batch.pending(), 2);
+    EXPECT_EQ(next(), "none");
+
+    batch.flush();
+    EXPECT_EQ(next(), string(data.packet(), data.packetSize()));
+    EXPECT_EQ(next(), string(more.packet(), more.packetSize()));
+    EXPECT_EQ(next(), "none");
+}
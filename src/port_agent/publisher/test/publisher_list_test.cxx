@@ -247,4 +247,30 @@ TEST_F(PublisherListTest, SearchAndSetRotation) {
 	EXPECT_TRUE(found);
 	
 	((FilePublisher*)found)->setRotationInterval(HOURLY);
-}
\ No newline at end of file
+}
+/* Test publishers are only routed the packet types they consume */
+TEST_F(PublisherListTest, Routing) {
+	PublisherList list;
+	LogPublisher logPublisher;
+	
+	TCPCommSocket socketA;
+    socketA.setHostname("localhost");
+    socketA.setPort(OBSERVATORY_COMMAND_PORT);
+    TCPPublisher tcpPublisher(&socketA);
+    InstrumentCommandPublisher instrumentPublisher(&socketA);
+    
+	list.add(&tcpPublisher);
+	list.add(&instrumentPublisher);
+	list.add(&logPublisher);
+	
+	EXPECT_EQ(list.route(DATA_FROM_INSTRUMENT).size(), 2);
+	EXPECT_EQ(list.route(INSTRUMENT_COMMAND).size(), 3);
+	EXPECT_EQ(list.route(PORT_AGENT_HEARTBEAT).size(), 1);
+	
+	// File publishers are routed first
+	EXPECT_EQ(list.route(DATA_FROM_DRIVER).front()->publisherType(), PUBLISHER_FILE);
+	EXPECT_EQ(list.route(PORT_AGENT_HEARTBEAT).front()->publisherType(), PUBLISHER_TCP);
+	
+	Packet unknown;
+	EXPECT_EQ(list.publish(&unknown), PUBLISH_UNKNOWN_TYPE);
+}
@@ -0,0 +1,67 @@
+#include "common/logger.h"
+#include "common/util.h"
+#include "common/shm_ring.h"
+#include "port_agent/packet/packet.h"
+#include "gtest/gtest.h"
+#include "publisher_test.h"
+#include "shm_publisher.h"
+
+#include <string>
+#include <sys/mman.h>
+
+using namespace std;
+using namespace packet;
+using namespace logger;
+using namespace publisher;
+
+#define SHM_NAME "/gtest_shm_publisher"
+
+class ShmPublisherTest : public PublisherTest {
+    
+    protected:
+        virtual void SetUp() {
+            Logger::SetLogFile("/tmp/gtest.log");
+            Logger::SetLogLevel("MESG");
+            
+            LOG(INFO) << "************************************************";
+            LOG(INFO) << "   ShmPublisherTest Test Start Up";
+            LOG(INFO) << "************************************************";
+            
+            shm_unlink(SHM_NAME);
+        }
+        
+        virtual void TearDown() {
+            shm_unlink(SHM_NAME);
+        }
+};
+
+/* Every reader gets the same serialized packets */
+TEST_F(ShmPublisherTest, BinaryOut) {
+    ShmRing ring;
+    ShmRingReader first, second;
+    char buffer[1024];
+    uint32_t bytes;
+    
+    ring.open(SHM_NAME, MIN_SHM_RING_SIZE);
+    first.open(SHM_NAME);
+    second.open(SHM_NAME);
+    
+    ShmPublisher publisher(&ring);
+    publisher.setAsciiMode(false);
+    
+    Timestamp ts;
+    Packet data(DATA_FROM_INSTRUMENT, ts, "data", 4);
+    Packet driver(DATA_FROM_DRIVER, ts, "command", 7);
+    
+    EXPECT_TRUE(publisher.publish(&data));
+    EXPECT_TRUE(publisher.publish(&driver));
+    
+    string expected(data.packet(), data.packetSize());
+    
+    ASSERT_EQ(first.read(buffer, sizeof(buffer), bytes), SHM_RING_OK);
+    EXPECT_EQ(string(buffer, bytes), expected);
+    EXPECT_EQ(first.read(buffer, sizeof(buffer), bytes), SHM_RING_EMPTY);
+    
+    ASSERT_EQ(second.read(buffer, sizeof(buffer), bytes), SHM_RING_OK);
+    EXPECT_EQ(string(buffer, bytes), expected);
+}
@@ -0,0 +1,103 @@
+#include "common/logger.h"
+#include "common/util.h"
+#include "common/shm_ring.h"
+#include "port_agent/packet/packet.h"
+#include "gtest/gtest.h"
+#include "publisher_test.h"
+#include "sink_publisher.h"
+#include "shm_publisher.h"
+
+#include <string>
+
+using namespace std;
+using namespace packet;
+using namespace logger;
+using namespace publisher;
+
+// Appends every packet to a string
+class StringPublisher : public SinkPublisher<string> {
+    public:
+        StringPublisher(string *output) : SinkPublisher(output) {}
+        const PublisherType publisherType() { return publisher::UNKNOWN; }
+
+    protected:
+        bool writeSink(const char *buffer, size_t length) {
+            sink()->append(buffer, length);
+            return true;
+        }
+};
+
+class SinkPublisherTest : public PublisherTest {
+
+    protected:
+        virtual void SetUp() {
+            Logger::SetLogFile("/tmp/gtest.log");
+            Logger::SetLogLevel("MESG");
+
+            LOG(INFO) << "************************************************";
+            LOG(INFO) << "   SinkPublisherTest Test Start Up";
+            LOG(INFO) << "************************************************";
+        }
+};
+
+/* Data, status, fault and heartbeat packets go to the sink once each */
+TEST_F(SinkPublisherTest, BinaryOut) {
+    string output;
+    StringPublisher publisher(&output);
+    publisher.setAsciiMode(false);
+
+    Timestamp ts;
+    Packet data(DATA_FROM_INSTRUMENT, ts, "data", 4);
+    Packet status(PORT_AGENT_STATUS, ts, "status", 6);
+    Packet driver(DATA_FROM_DRIVER, ts, "command", 7);
+    Packet command(INSTRUMENT_COMMAND, ts, "break", 5);
+
+    EXPECT_TRUE(publisher.consumes(DATA_FROM_INSTRUMENT));
+    EXPECT_FALSE(publisher.consumes(DATA_FROM_DRIVER));
+    EXPECT_FALSE(publisher.consumes(PORT_AGENT_COMMAND));
+    EXPECT_FALSE(publisher.consumes(INSTRUMENT_COMMAND));
+
+    EXPECT_TRUE(publisher.publish(&data));
+    EXPECT_TRUE(publisher.publish(&driver));
+    EXPECT_TRUE(publisher.publish(&command));
+    EXPECT_TRUE(publisher.publish(&status));
+
+    string expected(data.packet(), data.packetSize());
+    expected.append(status.packet(), status.packetSize());
+    EXPECT_EQ(output, expected);
+}
+
+/* Ascii mode hands the sink the rendered packet */
+TEST_F(SinkPublisherTest, AsciiOut) {
+    string output;
+    StringPublisher publisher(&output);
+    publisher.setAsciiMode(true);
+
+    Timestamp ts;
+    Packet data(DATA_FROM_INSTRUMENT, ts, "data", 4);
+    char expected[1024];
+    size_t length = data.asAscii(expected, sizeof(expected));
+
+    EXPECT_TRUE(publisher.publish(&data));
+    EXPECT_EQ(output, string(expected, length));
+}
+
+/* Publishers are the same if they are the same type with the same sink */
+TEST_F(SinkPublisherTest, EqualityOperator) {
+    string leftOutput, rightOutput;
+    StringPublisher left(&leftOutput), right(&rightOutput), copy(left);
+
+    EXPECT_TRUE(left.compare(&copy));
+    EXPECT_FALSE(left.compare(&right));
+
+    ShmRing ring;
+    ShmPublisher shm(&ring), shmCopy(shm);
+    EXPECT_TRUE(shm.compare(&shmCopy));
+    EXPECT_FALSE(shm.compare(&left));
+    EXPECT_FALSE(left.compare(&shm));
+
+    // No sink, nothing written
+    Timestamp ts;
+    Packet data(DATA_FROM_INSTRUMENT, ts, "data", 4);
+    EXPECT_FALSE(ShmPublisher().publish(&data));
+}
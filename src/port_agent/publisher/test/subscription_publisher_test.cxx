@@ -0,0 +1,101 @@
+#include "common/logger.h"
+#include "common/util.h"
+#include "port_agent/packet/packet.h"
+#include "gtest/gtest.h"
+#include "publisher_test.h"
+#include "subscription_publisher.h"
+#include "network/subscription_hub.h"
+
+#include <string>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace std;
+using namespace packet;
+using namespace logger;
+using namespace publisher;
+using namespace network;
+
+class SubscriptionPublisherTest : public PublisherTest {
+    
+    protected:
+        virtual void SetUp() {
+            Logger::SetLogFile("/tmp/gtest.log");
+            Logger::SetLogLevel("MESG");
+            
+            LOG(INFO) << "************************************************";
+            LOG(INFO) << "   SubscriptionPublisherTest Test Start Up";
+            LOG(INFO) << "************************************************";
+        }
+        
+        // Connect a subscriber and wait for the hub to accept it
+        int subscribe(SubscriptionHub &hub) {
+            struct sockaddr_in addr;
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(hub.getListenPort());
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            
+            if(fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+                return -1;
+            
+            for(int i = 0; i < 100 && !hub.acceptSubscriber(); i++)
+                usleep(10000);
+            
+            return fd;
+        }
+        
+        // Read size bytes from a subscriber
+        string receive(int fd, size_t size) {
+            string result;
+            char buffer[1024];
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            
+            while(result.length() < size && poll(&pfd, 1, 1000) > 0) {
+                ssize_t bytes = read(fd, buffer, sizeof(buffer));
+                if(bytes <= 0)
+                    break;
+                result.append(buffer, bytes);
+            }
+            
+            return result;
+        }
+};
+
+/* Every subscriber gets the same serialized packets */
+TEST_F(SubscriptionPublisherTest, BinaryOut) {
+    SubscriptionHub hub;
+    hub.initialize();
+    
+    int first = subscribe(hub);
+    int second = subscribe(hub);
+    ASSERT_GT(first, 0);
+    ASSERT_GT(second, 0);
+    ASSERT_EQ(hub.subscribers(), 2);
+    
+    SubscriptionPublisher publisher(&hub);
+    publisher.setAsciiMode(false);
+    
+    Timestamp ts;
+    Packet data(DATA_FROM_INSTRUMENT, ts, "data", 4);
+    Packet driver(DATA_FROM_DRIVER, ts, "command", 7);
+    
+    EXPECT_TRUE(publisher.publish(&data));
+    EXPECT_TRUE(publisher.publish(&driver));
+    EXPECT_EQ(hub.head(), data.packetSize());
+    
+    hub.flush();
+    
+    string expected(data.packet(), data.packetSize());
+    EXPECT_EQ(receive(first, expected.length()), expected);
+    EXPECT_EQ(receive(second, expected.length()), expected);
+    
+    close(first);
+    close(second);
+}
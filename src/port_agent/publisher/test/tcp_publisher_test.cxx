@@ -4,11 +4,15 @@
 #include "gtest/gtest.h"
 #include "publisher_test.h"
 #include "tcp_publisher.h"
+#include "network/tcp_comm_socket.h"
 
 
 #include <sstream>
 #include <string>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
 
 using namespace std;
 using namespace packet;
@@ -17,6 +21,13 @@ using namespace publisher;
 
 #define DATAFILE "/tmp/data.log"
 
+// A comm socket around one end of a socketpair
+class PairSocket : public TCPCommSocket {
+    public:
+        PairSocket(int fd) { setSocket(fd); }
+        bool initialize() { return connected(); }
+};
+
 class TCPPublisherTest : public FilePointerPublisherTest {
     
     protected:
@@ -59,3 +70,49 @@ TEST_F(TCPPublisherTest, DISABLED_FailureNoFile) {
 	TCPPublisher publisher;
 	EXPECT_TRUE(testPublishFailure(publisher, DATA_FROM_DRIVER));
 }
+
+/* A client that can't keep up never sees a truncated packet followed by
+   more data */
+TEST_F(TCPPublisherTest, NoPartialPacket) {
+	int fds[2];
+	int sndbuf = 4096;
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+	setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+	fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+	fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+
+	PairSocket socket(fds[0]);
+	TCPPublisher publisher(&socket);
+	publisher.setAsciiMode(false);
+
+	// Larger than the send buffer so the socket only takes part of it
+	char payload[16000];
+	for(size_t i = 0; i < sizeof(payload); i++)
+		payload[i] = 'a' + i % 26;
+	Timestamp ts;
+	Packet packet(DATA_FROM_INSTRUMENT, ts, payload, sizeof(payload));
+	string expected(packet.packet(), packet.packetSize());
+
+	EXPECT_FALSE(publisher.publish(&packet));
+	EXPECT_GT(publisher.result().bytes, 0);
+	EXPECT_FALSE(socket.connected());
+
+	// Drain the reader, then publish again
+	string received;
+	char buffer[8192];
+	int count;
+	while((count = ::read(fds[1], buffer, sizeof(buffer))) > 0)
+		received.append(buffer, count);
+
+	publisher.publish(&packet);
+	while((count = ::read(fds[1], buffer, sizeof(buffer))) > 0)
+		received.append(buffer, count);
+
+	// The reader sees the start of the packet and then the end of the stream
+	EXPECT_EQ(count, 0);
+	ASSERT_GT(received.size(), 0);
+	ASSERT_LT(received.size(), expected.size());
+	EXPECT_EQ(received, expected.substr(0, received.size()));
+
+	::close(fds[1]);
+}
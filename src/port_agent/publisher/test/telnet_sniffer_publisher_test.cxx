@@ -6,11 +6,17 @@
 #include "telnet_sniffer_publisher.h"
 #include "network/tcp_comm_socket.h"
 #include "network/tcp_comm_listener.h"
+#include "network/subscription_hub.h"
 
 
 #include <sstream>
 #include <string>
 #include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 
 using namespace std;
 using namespace packet;
@@ -82,3 +88,89 @@ TEST_F(TelnetSnifferPublisherTest, SingleBinaryOut) {
 	EXPECT_TRUE(testNoPublish(publisher, INSTRUMENT_COMMAND));
 }
 
+
+/* Spliced instrument data has already reached the client */
+TEST_F(TelnetSnifferPublisherTest, Spliced) {
+	TelnetSnifferPublisher publisher;
+	
+	EXPECT_FALSE(publisher.spliced());
+	publisher.setSpliced(true);
+	EXPECT_TRUE(publisher.spliced());
+	
+	EXPECT_TRUE(testNoPublish(publisher, DATA_FROM_INSTRUMENT));
+	
+	// Driver data is still published
+	m_prefix = "<<";
+	m_suffix = ">>";
+	publisher.setPrefix(m_prefix);
+	publisher.setSuffix(m_suffix);
+	EXPECT_TRUE(testPublish(publisher, DATA_FROM_DRIVER, true));
+	
+	// Copies keep the setting
+	TelnetSnifferPublisher copy(publisher);
+	EXPECT_TRUE(copy.spliced());
+}
+
+/* Every hub client gets the framed packets */
+TEST_F(TelnetSnifferPublisherTest, MultipleClients) {
+	SubscriptionHub hub;
+	hub.initialize();
+	
+	int clients[3];
+	for(int i = 0; i < 3; i++) {
+		struct sockaddr_in addr;
+		
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(hub.getListenPort());
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		
+		clients[i] = socket(AF_INET, SOCK_STREAM, 0);
+		ASSERT_EQ(connect(clients[i], (struct sockaddr *)&addr, sizeof(addr)), 0);
+		
+		for(int j = 0; j < 100 && !hub.acceptSubscriber(); j++)
+			usleep(10000);
+	}
+	ASSERT_EQ(hub.subscribers(), 3);
+	
+	TelnetSnifferPublisher publisher(&hub);
+	publisher.setPrefix("<<");
+	publisher.setSuffix(">>");
+	EXPECT_EQ(publisher.hub(), &hub);
+	
+	Timestamp ts;
+	Packet data(DATA_FROM_INSTRUMENT, ts, "data", 4);
+	Packet driver(DATA_FROM_DRIVER, ts, "command", 7);
+	Packet status(PORT_AGENT_STATUS, ts, "status", 6);
+	
+	EXPECT_TRUE(publisher.publish(&data));
+	EXPECT_TRUE(publisher.publish(&driver));
+	EXPECT_TRUE(publisher.publish(&status));
+	
+	// Rendered once
+	EXPECT_EQ(hub.head(), 15);
+	hub.flush();
+	
+	for(int i = 0; i < 3; i++) {
+		char buffer[64];
+		string result;
+		struct pollfd pfd = { clients[i], POLLIN, 0 };
+		
+		while(result.length() < 15 && poll(&pfd, 1, 1000) > 0) {
+			ssize_t bytes = read(clients[i], buffer, sizeof(buffer));
+			if(bytes <= 0)
+				break;
+			result.append(buffer, bytes);
+		}
+		
+		EXPECT_EQ(result, "data<<command>>");
+		::close(clients[i]);
+	}
+	
+	// Publishers to the same hub are the same publisher
+	SubscriptionHub other;
+	TelnetSnifferPublisher copy(publisher), different(&other), single;
+	EXPECT_TRUE(publisher.compare(&copy));
+	EXPECT_FALSE(publisher.compare(&different));
+	EXPECT_FALSE(publisher.compare(&single));
+}
@@ -0,0 +1,83 @@
+#!/usr/bin/env python
+
+# decode port_agent binary event log files (see src/common/event_log.h)
+#
+# usage: event_log_decoder.py <event file>
+#
+# Records are printed oldest first.  Message formats are read from the file
+# header.
+
+import struct, sys, time
+
+EVENT_LOG_MAGIC = 0x47564521
+EVENT_LOG_VERSION = 1
+EVENT_LOG_MESSAGES = 256
+EVENT_LOG_FORMAT_SIZE = 64
+
+HEADER = struct.Struct('<IIIIQQ')
+RECORD = struct.Struct('<QQIHHQqqqq')
+
+LENGTH_HEADER = HEADER.size + EVENT_LOG_MESSAGES * EVENT_LOG_FORMAT_SIZE
+
+LogLevelStr = ['ERROR', 'WARNING', 'INFO', 'DEBUG',
+               'DEBUG1', 'DEBUG2', 'DEBUG3', 'MESG']
+
+def ReadFormats (data):
+    formats = {}
+    for i in range(EVENT_LOG_MESSAGES):
+        start = HEADER.size + i * EVENT_LOG_FORMAT_SIZE
+        text = data[start:start + EVENT_LOG_FORMAT_SIZE].split(b'\0', 1)[0]
+        if text:
+            formats[i] = text.decode('ascii', 'replace')
+    return formats
+
+def FormatRecord (formats, sequence, seconds, nanoseconds, level, id, args):
+    stamp = time.strftime('%Y-%m-%d %H:%M:%S', time.gmtime(seconds))
+    stamp += '.%09d' % nanoseconds
+
+    if level < len(LogLevelStr):
+        levelStr = LogLevelStr[level]
+    else:
+        levelStr = str(level)
+
+    if id in formats:
+        text = formats[id]
+        count = text.count('%') - 2 * text.count('%%')
+        try:
+            text = text % tuple(args[:count])
+        except (TypeError, ValueError):
+            text = '%s %s' % (text, args)
+    else:
+        text = 'unknown message %d %s' % (id, args)
+
+    return '%s %s: %s' % (stamp, levelStr, text)
+
+def Decode (path):
+    data = open(path, 'rb').read()
+
+    magic, version, recordSize, records, head, reserved = HEADER.unpack_from(data, 0)
+    if magic != EVENT_LOG_MAGIC or version != EVENT_LOG_VERSION or recordSize != RECORD.size:
+        sys.stderr.write('%s: not a version %d event log\n' % (path, EVENT_LOG_VERSION))
+        return 1
+
+    formats = ReadFormats(data)
+
+    first = max(1, head - records + 1)
+    for sequence in range(first, head + 1):
+        offset = LENGTH_HEADER + ((sequence - 1) % records) * RECORD.size
+        fields = RECORD.unpack_from(data, offset)
+
+        # torn or overwritten record
+        if fields[0] != sequence:
+            continue
+
+        print(FormatRecord(formats, sequence, fields[1], fields[2], fields[3],
+                           fields[4], list(fields[6:])))
+    return 0
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        sys.stderr.write('usage: %s <event file>\n' % sys.argv[0])
+        sys.exit(1)
+
+    sys.exit(Decode(sys.argv[1]))
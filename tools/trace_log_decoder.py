@@ -0,0 +1,105 @@
+#!/usr/bin/env python
+
+# convert port_agent per-packet trace files (see src/common/trace_log.h) to
+# the Chrome trace event format for chrome://tracing or Perfetto
+#
+# usage: trace_log_decoder.py <trace file> [output file]
+#
+# Each traced read is a span from the read to when it was fully handled,
+# with a span per publisher inside it.  The kernel receive time, packet
+# hand off and writes are instant events.  Times are wall clock.
+
+import json, struct, sys
+
+TRACE_LOG_MAGIC = 0x43525421
+TRACE_LOG_VERSION = 1
+
+HEADER = struct.Struct('<IIIIQq')
+RECORD = struct.Struct('<QQQHHI')
+
+TRACE_RECEIVED = 1
+TRACE_READ = 2
+TRACE_PACKET = 3
+TRACE_ENQUEUE = 4
+TRACE_WRITE = 5
+TRACE_DISPATCHED = 6
+TRACE_DONE = 7
+
+PacketTypeStr = ['unknown', 'instrument data', 'driver data',
+                 'port agent command', 'port agent status',
+                 'port agent fault', 'instrument command', 'heartbeat']
+
+PublisherTypeStr = ['unknown', 'driver_command', 'driver_data',
+                    'instrument_command', 'instrument_data', 'file', 'udp',
+                    'tcp', 'telnet_sniffer', 'subscription', 'shm',
+                    'multicast']
+
+def Name (table, index):
+    if index < len(table):
+        return table[index]
+    return str(index)
+
+def Event (trace, point, arg, ts):
+    event = { 'pid': 1, 'tid': 1, 'ts': ts, 'args': { 'trace': trace } }
+
+    if point == TRACE_READ:
+        event.update(name='instrument read', ph='B')
+        event['args']['bytes'] = arg
+    elif point == TRACE_DONE:
+        event.update(name='instrument read', ph='E')
+    elif point == TRACE_ENQUEUE:
+        event.update(name='publish ' + Name(PublisherTypeStr, arg), ph='B')
+    elif point == TRACE_DISPATCHED:
+        event.update(name='publish ' + Name(PublisherTypeStr, arg), ph='E')
+    elif point == TRACE_RECEIVED:
+        event.update(name='received', ph='i', s='t')
+        event['args']['bytes'] = arg
+    elif point == TRACE_PACKET:
+        event.update(name='packet ' + Name(PacketTypeStr, arg), ph='i', s='t')
+    elif point == TRACE_WRITE:
+        event.update(name='write', ph='i', s='t')
+        event['args']['bytes'] = arg
+    else:
+        event.update(name='point %d' % point, ph='i', s='t')
+        event['args']['arg'] = arg
+
+    return event
+
+def Decode (path, out):
+    data = open(path, 'rb').read()
+
+    magic, version, recordSize, records, head, offset = HEADER.unpack_from(data, 0)
+    if magic != TRACE_LOG_MAGIC or version != TRACE_LOG_VERSION or recordSize != RECORD.size:
+        sys.stderr.write('%s: not a version %d trace file\n' % (path, TRACE_LOG_VERSION))
+        return 1
+
+    events = []
+    first = max(1, head - records + 1)
+    for sequence in range(first, head + 1):
+        fields = RECORD.unpack_from(data, HEADER.size + ((sequence - 1) % records) * RECORD.size)
+
+        # torn or overwritten record
+        if fields[0] != sequence:
+            continue
+
+        trace, time, point, reserved, arg = fields[1:]
+        events.append(Event(trace, point, arg, (time + offset) / 1000.0))
+
+    # The receive time comes before the read that recorded it
+    events.sort(key=lambda event: event['ts'])
+
+    json.dump({ 'traceEvents': events, 'displayTimeUnit': 'ns' }, out)
+    out.write('\n')
+    return 0
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        sys.stderr.write('usage: %s <trace file> [output file]\n' % sys.argv[0])
+        sys.exit(1)
+
+    if len(sys.argv) > 2:
+        out = open(sys.argv[2], 'w')
+    else:
+        out = sys.stdout
+
+    sys.exit(Decode(sys.argv[1], out))